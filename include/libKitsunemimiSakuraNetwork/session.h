@@ -26,6 +26,8 @@
 #include <iostream>
 #include <assert.h>
 #include <atomic>
+#include <vector>
+#include <deque>
 #include <mutex>
 #include <condition_variable>
 
@@ -33,9 +35,20 @@
 #include <libKitsunemimiCommon/buffer/data_buffer.h>
 #include <libKitsunemimiCommon/buffer/stack_buffer.h>
 
+#include <libKitsunemimiSakuraNetwork/session_metrics.h>
+
+// max number of stream-messages, which are given to the batch-callback at once
+#define STREAM_BATCH_SIZE 64
+
+// max number of requests, which can be send with one call of sendRequestBatch
+#define MAX_REQUEST_BATCH_SIZE 256
+
+struct iovec;
+
 namespace Kitsunemimi
 {
 struct DataBuffer;
+struct RingBuffer;
 namespace Network {
 class AbstractSocket;
 }
@@ -45,6 +58,14 @@ class SessionHandler;
 class SessionController;
 class InternalSessionInterface;
 class MultiblockIO;
+class SharedMemoryChannel;
+
+// cores for the threads and numa-node for the buffers of sessions and handlers
+struct AffinityPolicy
+{
+    std::vector<uint32_t> cores;
+    int32_t numaNode = -1;  // -1 to use the node of the first core
+};
 
 class Session
 {
@@ -58,34 +79,182 @@ public:
     bool sendStreamData(const void* data,
                         const uint64_t size,
                         const bool replyExpected = false);
+    bool trySendStreamData(const void* data,
+                           const uint64_t size,
+                           const bool replyExpected = false);
+
+    // flow-control of stream-messages
+    bool isStreamFlowControlActive() const;
+    int64_t getStreamCredits() const;
+
+    // coalescing of stream-messages
+    struct CoalescingStats
+    {
+        uint64_t numberOfFlushes = 0;
+        uint64_t numberOfFrames = 0;
+        uint32_t lastFramesPerFlush = 0;
+        uint32_t maxFramesPerFlush = 0;
+    };
+
+    bool setStreamCoalescing(const uint32_t flushThreshold,
+                             const uint32_t flushTimeout);
+    bool flushStreamData();
+    CoalescingStats getCoalescingStats();
 
     uint64_t sendStandaloneData(const void* data,
-                                const uint64_t size);
+                                const uint64_t size,
+                                const uint32_t priority = 1);
+
+    // messages, which are written directly into the send-memory
+    struct MessageReservation
+    {
+        DataBuffer* buffer = nullptr;
+        uint8_t* payload = nullptr;
+        uint64_t capacity = 0;
+    };
+
+    MessageReservation reserveMessage(const uint64_t capacity);
+    bool commitStreamData(MessageReservation &reservation,
+                          const uint64_t size,
+                          const bool replyExpected = false);
+    uint64_t commitStandaloneData(MessageReservation &reservation,
+                                  const uint64_t size,
+                                  const uint32_t priority = 1);
+    uint64_t commitResponse(MessageReservation &reservation,
+                            const uint64_t size,
+                            const uint64_t blockerId);
+    void discardMessage(MessageReservation &reservation);
+    uint64_t sendStandaloneDataNoCopy(const void* data,
+                                      const uint64_t size,
+                                      void (*processCompletion)(void*,
+                                                                Session*,
+                                                                const uint64_t,
+                                                                const bool),
+                                      void* target = nullptr,
+                                      const uint32_t priority = 1);
+    uint64_t sendFile(const std::string &filePath,
+                      const uint64_t offset = 0,
+                      const uint64_t length = 0,
+                      const uint32_t priority = 1);
+    uint64_t sendFile(const int fileDescriptor,
+                      const uint64_t offset = 0,
+                      const uint64_t length = 0,
+                      const uint32_t priority = 1);
+    bool setMultiblockPriority(const uint64_t multiblockMessageId,
+                               const uint32_t priority);
     void abortMessages(const uint64_t multiblockMessageId=0);
 
     DataBuffer* sendRequest(const void* data,
                             const uint64_t size,
                             const uint64_t timeout);
+    uint64_t sendRequestAsync(const void* data,
+                              const uint64_t size,
+                              const uint64_t timeout,
+                              void (*processResponse)(void*,
+                                                      Session*,
+                                                      const uint64_t,
+                                                      DataBuffer*),
+                              void* target = nullptr);
     uint64_t sendResponse(const void* data,
                           const uint64_t size,
                           const uint64_t blockerId);
 
+    // request of a batch with the slot for its response
+    struct RequestSlot
+    {
+        const void* data = nullptr;
+        uint64_t size = 0;
+        DataBuffer* response = nullptr;
+    };
+
+    uint32_t sendRequestBatch(RequestSlot* requests,
+                              const uint32_t numberOfRequests,
+                              const uint64_t timeout);
+
+    // received buffer
+    void releaseBuffer(DataBuffer* buffer);
+
+    // compression of payloads
+    struct CompressionStats
+    {
+        uint64_t numberOfCompressions = 0;
+        uint64_t numberOfDecompressions = 0;
+        uint64_t uncompressedSendBytes = 0;
+        uint64_t compressedSendBytes = 0;
+        uint64_t uncompressedReceivedBytes = 0;
+        uint64_t compressedReceivedBytes = 0;
+        uint64_t compressionTime = 0;    // in nanoseconds
+        uint64_t decompressionTime = 0;  // in nanoseconds
+    };
+
+    bool isCompressionActive() const;
+    bool isPayloadChecksumActive() const;
+    CompressionStats getCompressionStats();
+
+    // payload of an incoming stream-message for the batch-callback
+    struct StreamSpan
+    {
+        const void* data = nullptr;
+        uint64_t size = 0;
+    };
+
     // setter for changing callbacks
     void setStreamMessageCallback(void (*processStreamData)(Session*,
                                                             const void*,
                                                             const uint64_t));
+    void setStreamBatchCallback(void (*processStreamBatch)(Session*,
+                                                           const StreamSpan*,
+                                                           const uint64_t));
     void setStandaloneMessageCallback(void (*processStandaloneData)(Session*,
                                                                     const uint64_t,
                                                                     DataBuffer*));
     void setErrorCallback(void (*processError)(Session*,
                                                const uint8_t,
                                                const std::string));
+    void setMultiblockPartCallback(void (*processMultiblockPart)(Session*,
+                                                                 const uint64_t,
+                                                                 const uint64_t,
+                                                                 const void*,
+                                                                 const uint64_t,
+                                                                 const bool));
 
     // session-controlling functions
     bool closeSession(const bool replyExpected = false);
     uint32_t sessionId() const;
     bool isClientSide() const;
+    bool isHealthy();
     Session* getLinkedSession();
+    bool setHeartbeat(const uint32_t interval,
+                      const uint32_t missThreshold);
+
+    // pinning of the threads and buffers of the session
+    void setAffinity(const AffinityPolicy &policy);
+    AffinityPolicy getAffinity();
+
+    // forwarding of messages to the linked session
+    struct ForwardingStats
+    {
+        uint64_t numberOfMessages = 0;
+        uint64_t numberOfBytes = 0;
+        uint64_t numberOfWrites = 0;
+        // messages, which had to wait for the stream-credits of the linked session
+        uint64_t numberOfQueuedMessages = 0;
+    };
+
+    ForwardingStats getForwardingStats() const;
+
+    // additional connections for parts of multiblock-messages
+    struct StripeStats
+    {
+        uint64_t sendBytes = 0;
+        uint64_t receivedBytes = 0;
+    };
+
+    uint32_t getNumberOfStripes() const;
+    std::vector<StripeStats> getStripeStats();
+
+    // counters and latency-histograms
+    SessionMetrics getMetrics() const;
 
     enum errorCodes
     {
@@ -95,6 +264,7 @@ public:
         INVALID_MESSAGE_SIZE = 3,
         MESSAGE_TIMEOUT = 4,
         MULTIBLOCK_FAILED = 5,
+        CHECKSUM_MISMATCH = 6,
     };
 
     uint32_t increaseMessageIdCounter();
@@ -109,6 +279,8 @@ public:
 
     Kitsunemimi::Statemachine m_statemachine;
     Network::AbstractSocket* m_socket = nullptr;
+    // used instead of the socket for sessions over shared memory
+    SharedMemoryChannel* m_sharedMemory = nullptr;
     MultiblockIO* m_multiblockIo = nullptr;
     uint32_t m_sessionId = 0;
     std::string m_sessionIdentifier = "";
@@ -126,21 +298,167 @@ public:
     // end session
     bool endSession();
     bool disconnectSession();
+    bool isSessionReady();
+
+    bool checkHeartbeat();
 
-    bool sendHeartbeat();
+    // heartbeats
+    std::atomic<uint32_t> m_heartbeatInterval;
+    std::atomic<uint32_t> m_heartbeatMissThreshold;
+    std::atomic<uint64_t> m_lastInboundTraffic;
+    std::atomic<uint32_t> m_missedHeartbeats;
+    std::atomic<uint64_t> m_heartbeatSendTime;
     void initStatemachine();
 
+    // send
+    bool sendSegments(const struct iovec* segments,
+                      const uint32_t numberOfSegments,
+                      const bool coalesce = false,
+                      const bool control = false);
+
     // callbacks
     void (*m_processCreateSession)(Session*, const std::string);
     void (*m_processCloseSession)(Session*, const std::string);
     void (*m_processStreamData)(Session*, const void*, const uint64_t);
+    void (*m_processStreamBatch)(Session*, const StreamSpan*, const uint64_t) = nullptr;
     void (*m_processStandaloneData)(Session*, const uint64_t, DataBuffer*);
     void (*m_processError)(Session*, const uint8_t, const std::string);
+    void (*m_processMultiblockPart)(Session*,
+                                    const uint64_t,
+                                    const uint64_t,
+                                    const void*,
+                                    const uint64_t,
+                                    const bool) = nullptr;
+
+    // collected stream-messages of the receiving thread for the batch-callback
+    StreamSpan m_streamBatch[STREAM_BATCH_SIZE];
+    uint64_t m_streamBatchSize = 0;
+
+    // additional connections, where the parts of multiblock-messages are distributed over
+    Session* m_stripePrimary = nullptr;
+    uint64_t m_stripeToken = 0;
+    bool m_stripeConfirmed = false;
+    std::atomic_flag m_stripes_lock = ATOMIC_FLAG_INIT;
+    std::vector<Session*> m_stripes;
+    std::atomic<uint32_t> m_numberOfStripes;
+    std::atomic<uint64_t> m_connectionSendBytes;
+    std::atomic<uint64_t> m_connectionReceivedBytes;
+
+    void addStripe(Session* stripe);
+    Session* getStripe(const uint32_t partId);
+    void closeStripes();
+    bool disconnectStripe();
+
+    // finishes of multiblock-messages, which were completed by the thread of an additional
+    // connection, but are processed while holding the receive-mutex of the primary connection,
+    // so the callbacks of the session never run in parallel
+    struct StripeFinish
+    {
+        uint64_t multiblockId = 0;
+        uint8_t flags = 0;
+        uint64_t blockerId = 0;
+    };
+    std::mutex m_receiveMutex;
+    std::atomic_flag m_stripeFinishes_lock = ATOMIC_FLAG_INIT;
+    std::deque<StripeFinish> m_stripeFinishes;
+
+    // affinity, which is applied by the receiving and the sending thread itself
+    std::atomic_flag m_affinity_lock = ATOMIC_FLAG_INIT;
+    AffinityPolicy m_affinity;
+    std::atomic<uint64_t> m_affinityVersion;
+    uint64_t m_receiveAffinityVersion = 0;
+    uint64_t m_sendAffinityVersion = 0;
+
+    uint64_t getAffinityVersion() const;
+    void applyReceiveAffinity(RingBuffer* recvBuffer);
+    void applySendAffinity();
 
     // counter
-    std::atomic_flag m_messageIdCounter_lock = ATOMIC_FLAG_INIT;
     std::atomic_flag m_linkSession_lock = ATOMIC_FLAG_INIT;
-    uint32_t m_messageIdCounter = 0;
+    std::atomic<uint64_t> m_forwardedMessages;
+    std::atomic<uint64_t> m_forwardedBytes;
+    std::atomic<uint64_t> m_forwardingWrites;
+    std::atomic<uint64_t> m_queuedForwardMessages;
+    std::atomic<uint32_t> m_messageIdCounter;
+    MetricsRecorder m_metrics;
+
+    // send-buffer to gather small messages
+    uint8_t* m_sendBuffer = nullptr;
+
+    // send-lock, where control-messages are preferred before bulk-data, as long as the number
+    // of waiting control-messages is not 0
+    std::mutex m_sendMutex;
+    std::condition_variable m_controlCv;
+    std::condition_variable m_bulkCv;
+    bool m_sendBusy = false;
+    uint32_t m_waitingControlMessages = 0;
+
+    void lockSend(const bool control);
+    void unlockSend();
+
+    // number of threads, which write to the socket at the moment or wait for the send-lock
+    std::atomic<uint32_t> m_activeSenders;
+    bool isSendBusy() const;
+
+    // coalescing of stream-messages
+    uint8_t* m_coalescingBuffer = nullptr;
+    uint32_t m_coalescingBufferSize = 0;
+    uint32_t m_coalescingThreshold = 0;
+    uint32_t m_coalescingTimeout = 0;
+    uint32_t m_coalescingFrames = 0;
+    CoalescingStats m_coalescingStats;
+
+    bool flushCoalescingBuffer();
+
+    // compression of payloads
+    bool m_compressPayload = false;
+
+    // crc32c within the footer of each message
+    bool m_payloadChecksum = false;
+    std::atomic_flag m_compressionStats_lock = ATOMIC_FLAG_INIT;
+    CompressionStats m_compressionStats;
+
+    // flow-control of stream-messages
+    bool m_streamFlowControl = false;
+    std::atomic<int64_t> m_streamCredits;
+    std::atomic<uint32_t> m_pendingStreamCredits;
+    std::mutex m_creditMutex;
+    std::condition_variable m_creditCv;
+    static thread_local Session* m_receivingSession;
+
+    void initStreamFlowControl(const bool enable);
+    bool acquireStreamCredits(const uint32_t numberOfBytes,
+                              const bool wait);
+    void addStreamCredits(const uint32_t numberOfBytes);
+    bool consumeStreamMessage(const uint32_t numberOfBytes);
+    uint32_t takePendingStreamCredits();
+
+    // forwarded messages of the linked session, which are waiting for the credits of this session
+    struct QueuedForward
+    {
+        std::vector<uint8_t> message;
+        bool needsCredits = false;
+    };
+    std::mutex m_queuedForwardsMutex;
+    std::deque<QueuedForward> m_queuedForwards;
+    std::atomic<uint64_t> m_numberOfQueuedForwards;
+
+    void queueForwards(std::vector<QueuedForward> &queuedForwards);
+    void sendQueuedForwards();
+
+    bool sendStreamMessages(const void* data,
+                            const uint64_t size,
+                            const bool replyExpected,
+                            const bool wait);
+    uint64_t commitSingleOrMultiblock(MessageReservation &reservation,
+                                      const uint64_t size,
+                                      const uint32_t priority,
+                                      const uint64_t blockerId);
+
+    void updateCompressionStats(const uint32_t uncompressedSize,
+                                const uint32_t compressedSize,
+                                const uint64_t duration,
+                                const bool isCompression);
 };
 
 } // namespace Sakura
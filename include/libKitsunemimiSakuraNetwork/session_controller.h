@@ -38,6 +38,56 @@ class AbstractServer;
 namespace Sakura
 {
 
+struct BufferPoolStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t bytesHeld = 0;
+};
+
+struct DispatcherStats
+{
+    uint32_t numberOfWorkers = 0;
+    uint64_t queueDepth = 0;
+    uint64_t maxQueueDepth = 0;
+    uint64_t numberOfDispatchedTasks = 0;
+    uint64_t averageLatency = 0;
+    uint64_t maxLatency = 0;
+};
+
+struct IoEngineStats
+{
+    uint32_t numberOfLoops = 0;
+    uint64_t numberOfSessions = 0;
+    uint64_t maxSessionsPerLoop = 0;
+};
+
+struct SessionTarget
+{
+    enum TransportType
+    {
+        UNIX_DOMAIN = 0,
+        TCP = 1,
+        TLS_TCP = 2,
+    };
+
+    uint8_t transport = TCP;
+    std::string address = "";  // ip-address or socket-file
+    uint16_t port = 0;
+    std::string certFile = "";
+    std::string keyFile = "";
+};
+
+struct SessionPoolStats
+{
+    uint64_t numberOfPools = 0;
+    uint64_t numberOfIdleSessions = 0;
+    uint64_t numberOfAcquiredSessions = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t numberOfDiscardedSessions = 0;
+};
+
 class SessionController
 {
 public:
@@ -48,12 +98,22 @@ public:
 
     static Kitsunemimi::Sakura::SessionController* m_sessionController;
 
+    enum replyTypes
+    {
+        SESSION_REPLY = 1,
+        HEARTBEAT_REPLY = 2,
+        STREAM_REPLY = 4,
+        SINGLEBLOCK_REPLY = 5,
+        MULTIBLOCK_REPLY = 6,
+    };
+
     // server
     uint32_t addUnixDomainServer(const std::string &socketFile);
     uint32_t addTcpServer(const uint16_t port);
     uint32_t addTlsTcpServer(const uint16_t port,
                              const std::string &certFile,
                              const std::string &keyFile);
+    uint32_t addSharedMemoryServer(const std::string &socketFile);
     bool closeServer(const uint32_t id);
     void cloesAllServers();
 
@@ -62,12 +122,16 @@ public:
                                     const std::string &sessionIdentifier = "");
     Session* startTcpSession(const std::string &address,
                              const uint16_t port,
-                             const std::string &sessionIdentifier = "");
+                             const std::string &sessionIdentifier = "",
+                             const uint32_t numberOfConnections = 1);
     Session* startTlsTcpSession(const std::string &address,
                                 const uint16_t port,
                                 const std::string &certFile,
                                 const std::string &keyFile,
-                                const std::string &sessionIdentifier = "");
+                                const std::string &sessionIdentifier = "",
+                                const uint32_t numberOfConnections = 1);
+    Session* startSharedMemorySession(const std::string &socketFile,
+                                      const std::string &sessionIdentifier = "");
     bool closeSession(const uint32_t id);
     Session* getSession(const uint32_t id);
     void closeAllSession();
@@ -76,11 +140,58 @@ public:
     bool linkSessions(Session* session1, Session* session2);
     bool unlinkSession(Session* session);
 
+    // compression
+    void setCompression(const bool enable,
+                        const uint32_t threshold = 4096);
+
+    // flow-control
+    void setStreamFlowControl(const bool enable);
+
+    // integrity
+    void setPayloadChecksum(const bool enable);
+
+    // reply-timeouts
+    bool setReplyTimeout(const uint8_t replyType,
+                         const uint32_t timeout);
+    uint32_t getReplyTimeout(const uint8_t replyType);
+
+    // buffer-pool
+    BufferPoolStats getBufferPoolStats();
+
+    // callback-dispatcher
+    bool startCallbackDispatcher(const uint32_t numberOfWorkers);
+    DispatcherStats getDispatcherStats();
+
+    // io-engine
+    bool startIoEngine(const uint32_t numberOfLoops = 0);
+    IoEngineStats getIoEngineStats();
+
+    // session-pool
+    bool addSessionPool(const SessionTarget &target,
+                        const uint32_t numberOfSessions);
+    bool removeSessionPool(const SessionTarget &target);
+    Session* acquireSession(const SessionTarget &target);
+    bool releaseSession(Session* session);
+    SessionPoolStats getSessionPoolStats();
+
+    // affinity
+    void setGlobalAffinity(const AffinityPolicy &policy);
+    bool setServerAffinity(const uint32_t serverId,
+                           const AffinityPolicy &policy);
+
+    // metrics
+    SessionMetrics getGlobalMetrics();
+
 private:
     uint32_t m_serverIdCounter = 0;
 
     Session* startSession(Network::AbstractSocket* socket,
                           const std::string &sessionIdentifier);
+    Session* connectSession(Session* newSession,
+                            const std::string &sessionIdentifier);
+    bool startStripe(Session* primary,
+                     Network::AbstractSocket* socket,
+                     const uint32_t stripeId);
 };
 
 } // namespace Sakura
@@ -0,0 +1,146 @@
+/**
+ * @file       session_metrics.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef SESSION_METRICS_H
+#define SESSION_METRICS_H
+
+#include <stdint.h>
+#include <atomic>
+
+// number of counters per direction, where the index is the value of the message-type
+#define NUMBER_OF_METRIC_MESSAGE_TYPES 8
+// bucket 0 counts values of 0, bucket i values within [2^(i-1), 2^i) microseconds
+#define NUMBER_OF_LATENCY_BUCKETS 32
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+struct LatencyHistogram
+{
+    uint64_t buckets[NUMBER_OF_LATENCY_BUCKETS] = {};
+    uint64_t numberOfValues = 0;
+    uint64_t sum = 0;  // in microseconds
+    uint64_t max = 0;  // in microseconds
+
+    uint64_t getAverage() const;
+    uint64_t getPercentile(const double percentile) const;
+};
+
+struct SessionMetrics
+{
+    // counters for each message-type
+    uint64_t sendMessages[NUMBER_OF_METRIC_MESSAGE_TYPES] = {};
+    uint64_t sendBytes[NUMBER_OF_METRIC_MESSAGE_TYPES] = {};
+    uint64_t receivedMessages[NUMBER_OF_METRIC_MESSAGE_TYPES] = {};
+    uint64_t receivedBytes[NUMBER_OF_METRIC_MESSAGE_TYPES] = {};
+
+    uint64_t numberOfTimeouts = 0;
+    uint64_t numberOfChecksumErrors = 0;
+
+    // fill-level of the buffers
+    uint64_t ringBufferUsage = 0;
+    uint64_t maxRingBufferUsage = 0;
+    uint64_t multiblockQueueDepth = 0;
+    uint64_t maxMultiblockQueueDepth = 0;
+
+    // round-trip-times and latencies
+    LatencyHistogram replyRoundTrip;
+    LatencyHistogram heartbeatRoundTrip;
+    LatencyHistogram requestLatency;
+
+    // time between the send-call and the begin of the write into the socket
+    LatencyHistogram controlQueueDelay;
+    LatencyHistogram bulkQueueDelay;
+};
+
+//=====================================================================
+// ALL BELOW IS INTERNAL AND SHOULD NEVER BE USED BY EXTERNAL METHODS!
+//=====================================================================
+
+class AtomicHistogram
+{
+public:
+    AtomicHistogram();
+
+    void addValue(const uint64_t value);
+    void getSnapshot(LatencyHistogram &histogram) const;
+
+private:
+    std::atomic<uint64_t> m_buckets[NUMBER_OF_LATENCY_BUCKETS];
+    std::atomic<uint64_t> m_numberOfValues;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+};
+
+class MetricsRecorder
+{
+public:
+    MetricsRecorder(MetricsRecorder* parent = nullptr);
+
+    static uint64_t getCurrentTime();
+
+    void addSendMessage(const uint8_t messageType,
+                        const uint64_t size);
+    void addReceivedMessage(const uint8_t messageType,
+                            const uint64_t size);
+    void addTimeout();
+    void addChecksumError();
+    void addReplyRoundTrip(const uint64_t duration);
+    void addHeartbeatRoundTrip(const uint64_t duration);
+    void addRequestLatency(const uint64_t duration);
+    void addSendQueueDelay(const bool control,
+                           const uint64_t duration);
+
+    void updateRingBufferUsage(const uint64_t usage);
+    void updateMultiblockQueueDepth(const uint64_t depth);
+
+    void getSnapshot(SessionMetrics &metrics) const;
+
+private:
+    // recorder, which get all counter-updates and values of the histograms additionally
+    MetricsRecorder* m_parent = nullptr;
+
+    std::atomic<uint64_t> m_sendMessages[NUMBER_OF_METRIC_MESSAGE_TYPES];
+    std::atomic<uint64_t> m_sendBytes[NUMBER_OF_METRIC_MESSAGE_TYPES];
+    std::atomic<uint64_t> m_receivedMessages[NUMBER_OF_METRIC_MESSAGE_TYPES];
+    std::atomic<uint64_t> m_receivedBytes[NUMBER_OF_METRIC_MESSAGE_TYPES];
+    std::atomic<uint64_t> m_numberOfTimeouts;
+    std::atomic<uint64_t> m_numberOfChecksumErrors;
+
+    std::atomic<uint64_t> m_ringBufferUsage;
+    std::atomic<uint64_t> m_maxRingBufferUsage;
+    std::atomic<uint64_t> m_multiblockQueueDepth;
+    std::atomic<uint64_t> m_maxMultiblockQueueDepth;
+
+    AtomicHistogram m_replyRoundTrip;
+    AtomicHistogram m_heartbeatRoundTrip;
+    AtomicHistogram m_requestLatency;
+    AtomicHistogram m_controlQueueDelay;
+    AtomicHistogram m_bulkQueueDelay;
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // SESSION_METRICS_H
@@ -23,6 +23,10 @@
 #ifndef CALLBACKS_H
 #define CALLBACKS_H
 
+#include <cstddef>
+#include <algorithm>
+#include <sys/uio.h>
+
 #include <libKitsunemimiNetwork/abstract_socket.h>
 #include <libKitsunemimiCommon/buffer/ring_buffer.h>
 
@@ -31,6 +35,11 @@
 
 #include <libKitsunemimiSakuraNetwork/session_controller.h>
 
+#include <handler/heartbeat_handler.h>
+#include <handler/session_handler.h>
+#include <payload_checksum.h>
+#include <shared_memory/shared_memory_channel.h>
+
 #include <messages_processing/session_processing.h>
 #include <messages_processing/heartbeat_processing.h>
 #include <messages_processing/error_processing.h>
@@ -47,6 +56,248 @@ namespace Kitsunemimi
 namespace Sakura
 {
 
+/**
+ * @brief copy data from a position of the ring-buffer, which can be wrapped around the end of
+ *        the buffer
+ *
+ * @param recvBuffer ring-buffer to read from
+ * @param offset offset relative to the read-position of the ring-buffer
+ * @param target target for the data
+ * @param size number of bytes to copy
+ */
+inline void
+readFromRingBuffer(const RingBuffer &recvBuffer,
+                   const uint64_t offset,
+                   void* target,
+                   const uint64_t size)
+{
+    const uint64_t start = (recvBuffer.readPosition + offset) % recvBuffer.totalBufferSize;
+    const uint64_t firstPart = std::min(size, recvBuffer.totalBufferSize - start);
+
+    memcpy(target, &recvBuffer.data[start], firstPart);
+    memcpy(static_cast<uint8_t*>(target) + firstPart, recvBuffer.data, size - firstPart);
+}
+
+/**
+ * @brief overwrite data at a position of the ring-buffer, which can be wrapped around the end of
+ *        the buffer
+ *
+ * @param recvBuffer ring-buffer to write into
+ * @param offset offset relative to the read-position of the ring-buffer
+ * @param source new data
+ * @param size number of bytes to write
+ */
+inline void
+writeIntoRingBuffer(RingBuffer &recvBuffer,
+                    const uint64_t offset,
+                    const void* source,
+                    const uint64_t size)
+{
+    const uint64_t start = (recvBuffer.readPosition + offset) % recvBuffer.totalBufferSize;
+    const uint64_t firstPart = std::min(size, recvBuffer.totalBufferSize - start);
+
+    memcpy(&recvBuffer.data[start], source, firstPart);
+    memcpy(recvBuffer.data, static_cast<const uint8_t*>(source) + firstPart, size - firstPart);
+}
+
+/**
+ * @brief calculate the crc32c of a range of the ring-buffer, which can be wrapped around the end
+ *        of the buffer
+ *
+ * @param recvBuffer ring-buffer with the data
+ * @param begin begin of the range relative to the read-position of the ring-buffer
+ * @param end end of the range relative to the read-position of the ring-buffer
+ *
+ * @return crc32c of the range
+ */
+inline uint32_t
+getRingBufferChecksum(const RingBuffer &recvBuffer,
+                      const uint64_t begin,
+                      const uint64_t end)
+{
+    const uint64_t size = end - begin;
+    const uint64_t start = (recvBuffer.readPosition + begin) % recvBuffer.totalBufferSize;
+    const uint64_t firstPart = std::min(size, recvBuffer.totalBufferSize - start);
+
+    const uint32_t crc = crc32c(0, &recvBuffer.data[start], firstPart);
+    return crc32c(crc, recvBuffer.data, size - firstPart);
+}
+
+/**
+ * @brief forward all complete messages within the ring-buffer to the linked session. The
+ *        session-ids are patched directly within the ring-buffer and all messages are send with
+ *        one gathered write of at most two segments (before and after the wrap-around of the
+ *        ring-buffer). Stream-messages take the stream-credits of the linked session. The first
+ *        stream-message without credits and all messages behind it are copied into the queue of
+ *        the linked session, which is send, when new credits are granted to the linked session.
+ *        The credits of the queued stream-messages are given back to the other side of this
+ *        session not until they are send, so the queue is limited by the flow-control.
+ *
+ * @param session session, which had received the messages
+ * @param linkedSession session, where the messages should be forwarded to
+ * @param recvBuffer ring-buffer with the incoming data
+ *
+ * @return number of forwarded or queued bytes, which were taken from the buffer
+ */
+inline uint64_t
+forwardMessages(Session* session,
+                Session* linkedSession,
+                RingBuffer* recvBuffer)
+{
+    const uint32_t linkedSessionId = linkedSession->sessionId();
+    uint64_t spanSize = 0;
+    uint64_t position = 0;
+    uint64_t numberOfMessages = 0;
+    bool grantCredits = false;
+
+    // messages can not overtake the already queued messages
+    bool queueMessages = linkedSession->m_numberOfQueuedForwards.load() != 0;
+    std::vector<Session::QueuedForward> queuedForwards;
+
+    // collect all complete and valid messages
+    while(position + sizeof(CommonMessageHeader) <= recvBuffer->usedSize)
+    {
+        CommonMessageHeader header;
+        readFromRingBuffer(*recvBuffer, position, &header, sizeof(CommonMessageHeader));
+
+        // incomplete or broken messages are left for the normal processing
+        if(header.version != 0x1
+                || header.totalMessageSize < sizeof(CommonMessageHeader)
+                                             + sizeof(CommonMessageFooter)
+                || position + header.totalMessageSize > recvBuffer->usedSize)
+        {
+            break;
+        }
+
+        uint32_t delimiter = 0;
+        readFromRingBuffer(*recvBuffer,
+                           position + header.totalMessageSize - sizeof(uint32_t),
+                           &delimiter,
+                           sizeof(uint32_t));
+        if(delimiter != MESSAGE_DELIMITER) {
+            break;
+        }
+
+        // forwarded stream-messages fill the ring-buffer of the other side of the linked session,
+        // so they need its credits. The receiving thread doesn't wait for them, because it would
+        // also block all other messages of this session.
+        const bool isStream = header.type == STREAM_DATA_TYPE
+                              && header.subType == DATA_STREAM_STATIC_SUBTYPE;
+        if(isStream
+                && queueMessages == false
+                && linkedSession->acquireStreamCredits(header.totalMessageSize, false) == false)
+        {
+            queueMessages = true;
+        }
+
+        session->m_metrics.addReceivedMessage(header.type, header.totalMessageSize);
+        linkedSession->m_metrics.addSendMessage(header.type, header.totalMessageSize);
+
+        // stream-credits are only valid for this session, so they are not forwarded
+        if(session->m_streamFlowControl
+                && (header.type == STREAM_DATA_TYPE || header.type == HEARTBEAT_TYPE))
+        {
+            if(header.additionalValues != 0)
+            {
+                session->addStreamCredits(header.additionalValues);
+                const uint32_t noCredits = 0;
+                writeIntoRingBuffer(*recvBuffer,
+                                    position + offsetof(CommonMessageHeader, additionalValues),
+                                    &noCredits,
+                                    sizeof(uint32_t));
+            }
+
+            if(isStream && queueMessages == false)
+            {
+                grantCredits = session->consumeStreamMessage(header.totalMessageSize)
+                               || grantCredits;
+            }
+        }
+
+        // patch session-id in place
+        writeIntoRingBuffer(*recvBuffer,
+                            position + offsetof(CommonMessageHeader, sessionId),
+                            &linkedSessionId,
+                            sizeof(uint32_t));
+
+        // the checksum is behind the common header and so stays valid while forwarding, but it
+        // must be added, if only the linked session uses it
+        if(linkedSession->m_payloadChecksum
+                && session->m_payloadChecksum == false)
+        {
+            const uint64_t footerPos = position
+                                       + header.totalMessageSize
+                                       - sizeof(CommonMessageFooter);
+            const uint32_t checksum = getRingBufferChecksum(*recvBuffer,
+                                                            position + sizeof(CommonMessageHeader),
+                                                            footerPos);
+            writeIntoRingBuffer(*recvBuffer,
+                                footerPos + offsetof(CommonMessageFooter, additionalValues),
+                                &checksum,
+                                sizeof(uint32_t));
+        }
+
+        if(queueMessages)
+        {
+            Session::QueuedForward queuedForward;
+            queuedForward.message.resize(header.totalMessageSize);
+            queuedForward.needsCredits = isStream;
+            readFromRingBuffer(*recvBuffer,
+                               position,
+                               queuedForward.message.data(),
+                               header.totalMessageSize);
+            queuedForwards.push_back(std::move(queuedForward));
+        }
+        else
+        {
+            spanSize += header.totalMessageSize;
+        }
+
+        position += header.totalMessageSize;
+        numberOfMessages++;
+    }
+
+    if(position == 0) {
+        return 0;
+    }
+
+    if(spanSize != 0)
+    {
+        // build segments of the span, which is maybe split by the end of the ring-buffer
+        const uint64_t start = recvBuffer->readPosition % recvBuffer->totalBufferSize;
+        const uint64_t firstPart = std::min(spanSize, recvBuffer->totalBufferSize - start);
+
+        struct iovec segments[2];
+        uint32_t numberOfSegments = 1;
+        segments[0].iov_base = &recvBuffer->data[start];
+        segments[0].iov_len = firstPart;
+        if(firstPart < spanSize)
+        {
+            segments[1].iov_base = recvBuffer->data;
+            segments[1].iov_len = spanSize - firstPart;
+            numberOfSegments = 2;
+        }
+
+        linkedSession->sendSegments(segments, numberOfSegments);
+        session->m_forwardingWrites++;
+    }
+
+    session->m_forwardedMessages += numberOfMessages;
+    session->m_forwardedBytes += position;
+
+    if(grantCredits) {
+        send_Data_Stream_Credit(session);
+    }
+
+    if(queuedForwards.size() != 0)
+    {
+        session->m_queuedForwardMessages += queuedForwards.size();
+        linkedSession->queueForwards(queuedForwards);
+    }
+
+    return position;
+}
+
 /**
  * process incoming data
  *
@@ -61,6 +312,27 @@ processMessage(void* target,
 {
     // gsession, which is related to the message
     Session* session = static_cast<Session*>(target);
+    Session* connection = session;
+
+    // every incoming data show, that the other side is still alive
+    session->m_lastInboundTraffic.store(HeartbeatHandler::getCurrentTime(),
+                                        std::memory_order_relaxed);
+    session->m_metrics.updateRingBufferUsage(recvBuffer->usedSize);
+
+    // use the linked session to forward all complete messages at once
+    if(session->m_linkedSession != nullptr)
+    {
+        Session* linkedSession = session->getLinkedSession();
+        if(linkedSession != nullptr)
+        {
+            const uint64_t forwardedBytes = forwardMessages(session,
+                                                            linkedSession,
+                                                            recvBuffer);
+            if(forwardedBytes > 0) {
+                return forwardedBytes;
+            }
+        }
+    }
 
     // et header of message and check if header was complete within the buffer
     CommonMessageHeader* header = getObject_RingBuffer<CommonMessageHeader>(*recvBuffer);
@@ -102,15 +374,56 @@ processMessage(void* target,
         return 0;
     }
 
-    // use the linkes session to forward the message
-    if(session->m_linkedSession != nullptr)
+    // messages over additional connections belong to the primary session, except the messages,
+    // which control the connection itself
+    if(session->m_stripePrimary != nullptr
+            && header->type != SESSION_TYPE)
     {
-        Session* linkedSession = session->getLinkedSession();
+        session = session->m_stripePrimary;
+        session->m_lastInboundTraffic.store(HeartbeatHandler::getCurrentTime(),
+                                            std::memory_order_relaxed);
+    }
+
+    // check the checksum of everything behind the common header and drop broken messages
+    if(session->m_payloadChecksum)
+    {
+        const uint8_t* messageData = static_cast<const uint8_t*>(rawMessage);
+        const uint32_t checksum = crc32c(0,
+                                         &messageData[sizeof(CommonMessageHeader)],
+                                         header->totalMessageSize
+                                         - sizeof(CommonMessageHeader)
+                                         - sizeof(CommonMessageFooter));
+        const uint32_t* expected = end - 1;
+        if(checksum != *expected)
+        {
+            LOG_ERROR("checksum of message does not match");
+            Session* errorSession = session->m_stripePrimary != nullptr ? session->m_stripePrimary
+                                                                        : session;
+            errorSession->m_metrics.addChecksumError();
+            errorSession->m_processError(errorSession,
+                                         Session::errorCodes::CHECKSUM_MISMATCH,
+                                         "checksum of message does not match");
+            return header->totalMessageSize;
+        }
+    }
+
+    session->m_metrics.addReceivedMessage(header->type, header->totalMessageSize);
 
-        header->sessionId = linkedSession->sessionId();
-        linkedSession->m_socket->sendMessage(rawMessage, header->totalMessageSize);
+    // collected stream-messages must be processed before all other message-types, but only the
+    // batch of the own connection belongs to this thread
+    if(session == connection
+            && session->m_streamBatchSize != 0
+            && (header->type != STREAM_DATA_TYPE || header->subType != DATA_STREAM_STATIC_SUBTYPE))
+    {
+        flushStreamBatch(session, session->m_processStreamBatch);
+    }
 
-        return header->totalMessageSize;
+    // take credits for stream-messages, which were granted by the other side
+    if(header->additionalValues != 0
+            && session->m_streamFlowControl
+            && (header->type == STREAM_DATA_TYPE || header->type == HEARTBEAT_TYPE))
+    {
+        session->addStreamCredits(header->additionalValues);
     }
 
     // remove from reply-handler if message is reply
@@ -148,7 +461,8 @@ processMessage(void* target,
 }
 
 /**
- * process incoming data
+ * process all complete messages within the incoming data at once, instead of returning to the
+ * socket after each message
  *
  * @param target void-pointer to the session, which had received the message
  * @param recvBuffer data-buffer with the incoming data
@@ -160,23 +474,129 @@ processMessage_callback(void* target,
                         RingBuffer* recvBuffer,
                         AbstractSocket*)
 {
-    return processMessage(target, recvBuffer);
+    Session* session = static_cast<Session*>(target);
+
+    // mark the thread as receiving thread of the session, which must not wait for credits
+    Session::m_receivingSession = session;
+
+    // the receiving thread pins itself, because the thread belongs to the socket
+    if(session->getAffinityVersion() != session->m_receiveAffinityVersion) {
+        session->applyReceiveAffinity(recvBuffer);
+    }
+
+    // finishes, which are handed over by additional connections, are processed only while
+    // holding the receive-mutex, so they never run in parallel to this thread
+    const bool isPrimary = session->m_stripePrimary == nullptr;
+    if(isPrimary) {
+        session->m_receiveMutex.lock();
+    }
+
+    // the buffer is moved forward locally and reset at the end, because the socket moves it
+    // forward by the returned number of bytes
+    const uint64_t readPosition = recvBuffer->readPosition;
+    const uint64_t usedSize = recvBuffer->usedSize;
+    uint64_t result = 0;
+
+    while(recvBuffer->usedSize >= sizeof(CommonMessageHeader))
+    {
+        const uint64_t processedBytes = processMessage(target, recvBuffer);
+        if(processedBytes == 0) {
+            break;
+        }
+
+        result += processedBytes;
+        recvBuffer->readPosition = (recvBuffer->readPosition + processedBytes)
+                                   % recvBuffer->totalBufferSize;
+        recvBuffer->usedSize -= processedBytes;
+
+        // load the header of the next message, while the checks of its size are done
+        __builtin_prefetch(&recvBuffer->data[recvBuffer->readPosition]);
+    }
+
+    // payloads of the batch are still within the buffer, so they must be given out before
+    flushStreamBatch(session, session->m_processStreamBatch);
+    session->m_connectionReceivedBytes.fetch_add(result, std::memory_order_relaxed);
+
+    recvBuffer->readPosition = readPosition;
+    recvBuffer->usedSize = usedSize;
+
+    if(isPrimary)
+    {
+        processStripeFinishes(session);
+        session->m_receiveMutex.unlock();
+
+        // finishes, which were handed over while unlocking
+        while(hasStripeFinishes(session)
+              && session->m_receiveMutex.try_lock())
+        {
+            processStripeFinishes(session);
+            session->m_receiveMutex.unlock();
+        }
+    }
+    Session::m_receivingSession = nullptr;
+
+    return result;
+}
+
+/**
+ * @brief give a new incoming session the affinity, which was set for its server
+ *
+ * @param session new incoming session
+ * @param context context of the server, which has accepted the session
+ */
+inline void
+applyServerAffinity(Session* session,
+                    ServerContext* context)
+{
+    if(context == nullptr) {
+        return;
+    }
+
+    AffinityPolicy affinity;
+    context->mutex.lock();
+    affinity = context->affinity;
+    context->mutex.unlock();
+
+    if(affinity.cores.size() > 0
+            || affinity.numaNode >= 0)
+    {
+        session->setAffinity(affinity);
+    }
 }
 
 /**
  * @brief triggered for a new incoming connection
  *
+ * @param target context of the server, which has accepted the connection
  * @param socket socket for the new session
  */
 void
-processConnection_Callback(void*,
+processConnection_Callback(void* target,
                            AbstractSocket* socket)
 {
     Session* newSession = new Session(socket);
+    applyServerAffinity(newSession, static_cast<ServerContext*>(target));
     socket->setMessageCallback(newSession, &processMessage_callback);
     socket->startThread();
 }
 
+/**
+ * @brief triggered for a new incoming connection of the shared-memory-server
+ *
+ * @param target context of the server, which has accepted the connection
+ * @param channel already initialized shared-memory-channel for the new session
+ */
+void
+processSharedMemoryConnection_Callback(void* target,
+                                       SharedMemoryChannel* channel)
+{
+    Session* newSession = new Session(nullptr);
+    applyServerAffinity(newSession, static_cast<ServerContext*>(target));
+    newSession->m_sharedMemory = channel;
+    channel->setMessageCallback(newSession, &processMessage_callback);
+    channel->startThread();
+}
+
 } // namespace Sakura
 } // namespace Kitsunemimi
 
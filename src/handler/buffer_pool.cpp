@@ -0,0 +1,193 @@
+/**
+ * @file       buffer_pool.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include <handler/buffer_pool.h>
+
+#include <libKitsunemimiCommon/buffer/data_buffer.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief get the size-class for a number of blocks
+ *
+ * @param numberOfBlocks number of blocks of 4 KiB
+ *
+ * @return index of the smallest class, which can hold the number of blocks, or
+ *         NUMBER_OF_BUFFER_CLASSES if the number is too big for the pool
+ */
+inline uint32_t
+getBufferClass(const uint64_t numberOfBlocks)
+{
+    uint32_t bufferClass = 0;
+    while(bufferClass < NUMBER_OF_BUFFER_CLASSES
+          && (1ull << bufferClass) < numberOfBlocks)
+    {
+        bufferClass++;
+    }
+
+    return bufferClass;
+}
+
+/**
+ * @brief constructor
+ */
+BufferPool::BufferPool()
+{
+    m_hits = 0;
+    m_misses = 0;
+    m_bytesHeld = 0;
+}
+
+/**
+ * @brief destructor
+ */
+BufferPool::~BufferPool()
+{
+    for(uint32_t i = 0; i < NUMBER_OF_BUFFER_CLASSES; i++)
+    {
+        BufferClass* bufferClass = &m_classes[i];
+        while(bufferClass->lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+        for(uint32_t j = 0; j < bufferClass->buffers.size(); j++) {
+            delete bufferClass->buffers[j];
+        }
+        bufferClass->buffers.clear();
+
+        bufferClass->lock.clear(std::memory_order_release);
+    }
+
+    m_bytesHeld = 0;
+}
+
+/**
+ * @brief get an empty buffer, which can hold at least the requested number of bytes
+ *
+ * @param size number of bytes, which should fit into the buffer
+ *
+ * @return buffer from the pool, if available, else a new allocated buffer
+ */
+DataBuffer*
+BufferPool::getBuffer(const uint64_t size)
+{
+    const uint64_t numberOfBlocks = (size / 4096) + 1;
+    const uint32_t classId = getBufferClass(numberOfBlocks);
+
+    // buffers bigger than the biggest class are not handled by the pool
+    if(classId == NUMBER_OF_BUFFER_CLASSES)
+    {
+        m_misses++;
+        return new DataBuffer(static_cast<uint32_t>(numberOfBlocks));
+    }
+
+    // try to get buffer from the pool
+    DataBuffer* result = nullptr;
+    BufferClass* bufferClass = &m_classes[classId];
+    while(bufferClass->lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    if(bufferClass->buffers.size() > 0)
+    {
+        result = bufferClass->buffers.back();
+        bufferClass->buffers.pop_back();
+    }
+
+    bufferClass->lock.clear(std::memory_order_release);
+
+    // create new buffer, if class was empty
+    if(result == nullptr)
+    {
+        m_misses++;
+        return new DataBuffer(1u << classId);
+    }
+
+    m_hits++;
+    m_bytesHeld -= result->totalBufferSize;
+    result->bufferPosition = 0;
+
+    return result;
+}
+
+/**
+ * @brief give a buffer back to the pool. Buffers, which don't match a size-class or which would
+ *        exceed the limit of the class, are deleted.
+ *
+ * @param buffer buffer to release
+ */
+void
+BufferPool::releaseBuffer(DataBuffer* buffer)
+{
+    if(buffer == nullptr) {
+        return;
+    }
+
+    // check if buffer match exactly a size-class
+    const uint32_t classId = getBufferClass(buffer->numberOfBlocks);
+    if(classId == NUMBER_OF_BUFFER_CLASSES
+            || buffer->blockSize != 4096
+            || buffer->numberOfBlocks != (1ull << classId)
+            || buffer->totalBufferSize != buffer->numberOfBlocks * buffer->blockSize)
+    {
+        delete buffer;
+        return;
+    }
+
+    // put buffer back into the pool, if the class is not full
+    const uint64_t bufferSize = buffer->totalBufferSize;
+    BufferClass* bufferClass = &m_classes[classId];
+    while(bufferClass->lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    if((bufferClass->buffers.size() + 1) * bufferSize <= MAX_BUFFER_POOL_CLASS_SIZE)
+    {
+        bufferClass->buffers.push_back(buffer);
+        buffer = nullptr;
+    }
+
+    bufferClass->lock.clear(std::memory_order_release);
+
+    if(buffer == nullptr) {
+        m_bytesHeld += bufferSize;
+    } else {
+        delete buffer;
+    }
+}
+
+/**
+ * @brief get statistics of the pool
+ *
+ * @return object with the number of hits and misses and the held bytes
+ */
+BufferPoolStats
+BufferPool::getStats()
+{
+    BufferPoolStats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.bytesHeld = m_bytesHeld;
+
+    return stats;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,71 @@
+/**
+ * @file       buffer_pool.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <vector>
+#include <atomic>
+
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+
+// number of size-classes, which start with 1 block of 4 KiB and double with each class (max 1 MiB)
+#define NUMBER_OF_BUFFER_CLASSES 9
+// max number of bytes, which are held by the pool for each size-class
+#define MAX_BUFFER_POOL_CLASS_SIZE (8*1024*1024)
+
+namespace Kitsunemimi
+{
+class DataBuffer;
+namespace Sakura
+{
+
+class BufferPool
+{
+public:
+    BufferPool();
+    ~BufferPool();
+
+    DataBuffer* getBuffer(const uint64_t size);
+    void releaseBuffer(DataBuffer* buffer);
+
+    BufferPoolStats getStats();
+
+private:
+    struct BufferClass
+    {
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        std::vector<DataBuffer*> buffers;
+    };
+
+    BufferClass m_classes[NUMBER_OF_BUFFER_CLASSES];
+
+    std::atomic<uint64_t> m_hits;
+    std::atomic<uint64_t> m_misses;
+    std::atomic<uint64_t> m_bytesHeld;
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,379 @@
+/**
+ * @file       callback_dispatcher.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include <handler/callback_dispatcher.h>
+
+#include <algorithm>
+
+#include <handler/session_handler.h>
+#include <handler/message_blocker_handler.h>
+#include <handler/buffer_pool.h>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+#include <thread_affinity.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+// session, which is processed at the moment by the current worker-thread
+static thread_local Session* m_currentDispatchSession = nullptr;
+
+/**
+ * @brief constructor
+ *
+ * @param dispatcher pointer to the dispatcher, which provides the tasks
+ */
+DispatchWorker::DispatchWorker(CallbackDispatcher* dispatcher)
+{
+    m_dispatcher = dispatcher;
+}
+
+/**
+ * @brief thread-loop, which processes the tasks of the ready sessions
+ */
+void
+DispatchWorker::run()
+{
+    while(m_abort == false)
+    {
+        applyGlobalAffinity(m_appliedAffinity);
+        m_dispatcher->processNextSession(m_appliedAffinity);
+    }
+}
+
+/**
+ * @brief constructor
+ */
+CallbackDispatcher::CallbackDispatcher()
+{
+    m_isActive = false;
+}
+
+/**
+ * @brief destructor
+ */
+CallbackDispatcher::~CallbackDispatcher()
+{
+    m_isActive = false;
+
+    for(uint32_t i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i]->stopThread();
+        delete m_workers[i];
+    }
+    m_workers.clear();
+
+    // drop all tasks, which were not processed
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    std::unordered_map<Session*, SessionQueue>::iterator it;
+    for(it = m_sessionQueues.begin();
+        it != m_sessionQueues.end();
+        it++)
+    {
+        for(uint64_t i = 0; i < it->second.tasks.size(); i++) {
+            dropTask(it->second.tasks[i]);
+        }
+    }
+    m_sessionQueues.clear();
+    m_readySessions.clear();
+}
+
+/**
+ * @brief start the worker-threads. After this, the callbacks for standalone-messages, requests
+ *        and responses are not triggered anymore by the receiving thread of the socket.
+ *
+ * @param numberOfWorkers number of worker-threads
+ *
+ * @return false, if number is 0 or workers were already started, else true
+ */
+bool
+CallbackDispatcher::startWorkers(const uint32_t numberOfWorkers)
+{
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+
+    if(numberOfWorkers == 0
+            || m_workers.size() > 0)
+    {
+        return false;
+    }
+
+    for(uint32_t i = 0; i < numberOfWorkers; i++)
+    {
+        DispatchWorker* worker = new DispatchWorker(this);
+        worker->startThread();
+        m_workers.push_back(worker);
+    }
+
+    m_isActive = true;
+
+    return true;
+}
+
+/**
+ * @brief forward the data of an incoming standalone-message or response to the callback. If the
+ *        workers are active, the data are queued behind all other data of the same session, so
+ *        the order within a session is preserved. Otherwise the callback is triggered directly.
+ *
+ * @param session session, which has received the data
+ * @param id multiblock-id or blocker-id of the message
+ * @param data buffer with the received data
+ * @param isResponse true, if the data are the response of a request
+ */
+void
+CallbackDispatcher::dispatchIncomingData(Session* session,
+                                         const uint64_t id,
+                                         DataBuffer* data,
+                                         const bool isResponse)
+{
+    if(m_isActive == false)
+    {
+        processIncomingData(session, id, data, isResponse);
+        return;
+    }
+
+    DispatchTask task;
+    task.id = id;
+    task.data = data;
+    task.isResponse = isResponse;
+    task.queueTime = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+
+    SessionQueue* queue = &m_sessionQueues[session];
+    queue->tasks.push_back(task);
+
+    m_queueDepth++;
+    if(m_queueDepth > m_maxQueueDepth) {
+        m_maxQueueDepth = m_queueDepth;
+    }
+
+    // register session as ready, if not already registered or in processing
+    if(queue->scheduled == false)
+    {
+        queue->scheduled = true;
+        m_readySessions.push_back(session);
+        m_queueCv.notify_one();
+    }
+}
+
+/**
+ * @brief remove a session from the dispatcher and drop all of its not processed tasks. If a
+ *        worker processes the session at the moment, it waits until the worker is finished.
+ *
+ * @param session session to remove
+ */
+void
+CallbackDispatcher::removeSession(Session* session)
+{
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+
+    std::unordered_map<Session*, SessionQueue>::iterator it;
+    it = m_sessionQueues.find(session);
+    if(it == m_sessionQueues.end()) {
+        return;
+    }
+
+    // drop not processed tasks
+    for(uint64_t i = 0; i < it->second.tasks.size(); i++) {
+        dropTask(it->second.tasks[i]);
+    }
+    m_queueDepth -= it->second.tasks.size();
+    it->second.tasks.clear();
+
+    m_readySessions.erase(std::remove(m_readySessions.begin(), m_readySessions.end(), session),
+                          m_readySessions.end());
+
+    // session is removed within one of its own callbacks, so the worker removes it afterwards
+    if(m_currentDispatchSession == session)
+    {
+        it->second.removed = true;
+        return;
+    }
+
+    // wait until the worker has finished the session
+    while(it->second.active)
+    {
+        m_idleCv.wait(lock);
+        it = m_sessionQueues.find(session);
+        if(it == m_sessionQueues.end()) {
+            return;
+        }
+    }
+
+    m_sessionQueues.erase(it);
+}
+
+/**
+ * @brief get statistics of the dispatcher
+ *
+ * @return object with the queue-depth and latency-values
+ */
+DispatcherStats
+CallbackDispatcher::getStats()
+{
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+
+    DispatcherStats stats;
+    stats.numberOfWorkers = static_cast<uint32_t>(m_workers.size());
+    stats.queueDepth = m_queueDepth;
+    stats.maxQueueDepth = m_maxQueueDepth;
+    stats.numberOfDispatchedTasks = m_numberOfDispatchedTasks;
+    stats.maxLatency = m_maxLatency;
+    if(m_numberOfDispatchedTasks > 0) {
+        stats.averageLatency = m_totalLatency / m_numberOfDispatchedTasks;
+    }
+
+    return stats;
+}
+
+/**
+ * @brief take the next ready session and process a batch of its tasks. A session is only
+ *        processed by one worker at the same time, but each free worker can take any ready
+ *        session.
+ *
+ * @param appliedAffinity version of the global affinity-policy, which is applied to the
+ *                        calling worker
+ */
+void
+CallbackDispatcher::processNextSession(uint64_t &appliedAffinity)
+{
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+
+    if(m_readySessions.empty())
+    {
+        m_queueCv.wait_for(lock, std::chrono::milliseconds(100));
+        if(m_readySessions.empty()) {
+            return;
+        }
+    }
+
+    Session* session = m_readySessions.front();
+    m_readySessions.pop_front();
+
+    // references of the unordered_map stay valid while other entries are added or removed
+    SessionQueue* queue = &m_sessionQueues[session];
+    queue->active = true;
+
+    // take batch of tasks and update statistics
+    const TimePoint now = std::chrono::steady_clock::now();
+    std::vector<DispatchTask> batch;
+    while(queue->tasks.size() > 0
+          && batch.size() < DISPATCH_BATCH_SIZE)
+    {
+        const DispatchTask &task = queue->tasks.front();
+
+        const uint64_t latency = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        now - task.queueTime).count());
+        m_totalLatency += latency;
+        if(latency > m_maxLatency) {
+            m_maxLatency = latency;
+        }
+
+        batch.push_back(task);
+        queue->tasks.pop_front();
+    }
+    m_queueDepth -= batch.size();
+    m_numberOfDispatchedTasks += batch.size();
+
+    lock.unlock();
+
+    // the policy could be changed, while the worker was waiting for tasks
+    applyGlobalAffinity(appliedAffinity);
+
+    // trigger callbacks outside of the lock
+    m_currentDispatchSession = session;
+    for(uint64_t i = 0; i < batch.size(); i++) {
+        processIncomingData(session, batch[i].id, batch[i].data, batch[i].isResponse);
+    }
+    m_currentDispatchSession = nullptr;
+
+    lock.lock();
+
+    queue->active = false;
+
+    if(queue->removed)
+    {
+        for(uint64_t i = 0; i < queue->tasks.size(); i++) {
+            dropTask(queue->tasks[i]);
+        }
+        m_queueDepth -= queue->tasks.size();
+        m_sessionQueues.erase(session);
+    }
+    else if(queue->tasks.size() > 0)
+    {
+        // requeue at the end to give other sessions a chance
+        m_readySessions.push_back(session);
+        m_queueCv.notify_one();
+    }
+    else
+    {
+        queue->scheduled = false;
+    }
+
+    m_idleCv.notify_all();
+}
+
+/**
+ * @brief trigger the callback for incoming data
+ *
+ * @param session session, which has received the data
+ * @param id multiblock-id or blocker-id of the message
+ * @param data buffer with the received data
+ * @param isResponse true, if the data are the response of a request
+ */
+void
+CallbackDispatcher::processIncomingData(Session* session,
+                                        const uint64_t id,
+                                        DataBuffer* data,
+                                        const bool isResponse)
+{
+    if(isResponse)
+    {
+        // release thread, which is related to the blocker-id, or drop the response, if the
+        // request was already timed out
+        if(SessionHandler::m_blockerHandler->releaseMessage(id, data) == false) {
+            SessionHandler::m_bufferPool->releaseBuffer(data);
+        }
+    }
+    else
+    {
+        session->m_processStandaloneData(session, id, data);
+    }
+}
+
+/**
+ * @brief drop a task, which can not be processed anymore
+ *
+ * @param task task to drop
+ */
+void
+CallbackDispatcher::dropTask(const DispatchTask &task)
+{
+    SessionHandler::m_bufferPool->releaseBuffer(task.data);
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,125 @@
+/**
+ * @file       callback_dispatcher.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef CALLBACK_DISPATCHER_H
+#define CALLBACK_DISPATCHER_H
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include <libKitsunemimiCommon/threading/thread.h>
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+
+// max number of tasks of one session, which are processed in a row by a worker
+#define DISPATCH_BATCH_SIZE 16
+
+namespace Kitsunemimi
+{
+struct DataBuffer;
+namespace Sakura
+{
+class Session;
+class CallbackDispatcher;
+
+class DispatchWorker : public Kitsunemimi::Thread
+{
+public:
+    DispatchWorker(CallbackDispatcher* dispatcher);
+
+protected:
+    void run();
+
+private:
+    uint64_t m_appliedAffinity = 0;
+    CallbackDispatcher* m_dispatcher = nullptr;
+};
+
+class CallbackDispatcher
+{
+public:
+    CallbackDispatcher();
+    ~CallbackDispatcher();
+
+    bool startWorkers(const uint32_t numberOfWorkers);
+
+    void dispatchIncomingData(Session* session,
+                              const uint64_t id,
+                              DataBuffer* data,
+                              const bool isResponse);
+    void removeSession(Session* session);
+
+    DispatcherStats getStats();
+
+    void processNextSession(uint64_t &appliedAffinity);
+
+private:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    struct DispatchTask
+    {
+        uint64_t id = 0;
+        DataBuffer* data = nullptr;
+        bool isResponse = false;
+        TimePoint queueTime;
+    };
+
+    struct SessionQueue
+    {
+        std::deque<DispatchTask> tasks;
+        bool scheduled = false;
+        bool active = false;
+        bool removed = false;
+    };
+
+    std::atomic<bool> m_isActive;
+    std::vector<DispatchWorker*> m_workers;
+
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCv;
+    std::condition_variable m_idleCv;
+    std::unordered_map<Session*, SessionQueue> m_sessionQueues;
+    std::deque<Session*> m_readySessions;
+
+    // statistics
+    uint64_t m_queueDepth = 0;
+    uint64_t m_maxQueueDepth = 0;
+    uint64_t m_numberOfDispatchedTasks = 0;
+    uint64_t m_totalLatency = 0;
+    uint64_t m_maxLatency = 0;
+
+    static void processIncomingData(Session* session,
+                                    const uint64_t id,
+                                    DataBuffer* data,
+                                    const bool isResponse);
+    static void dropTask(const DispatchTask &task);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // CALLBACK_DISPATCHER_H
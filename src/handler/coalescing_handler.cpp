@@ -0,0 +1,161 @@
+/**
+ * @file       coalescing_handler.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include <handler/coalescing_handler.h>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+#include <thread_affinity.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+// session, which is flushed at the moment by the current thread
+static thread_local Session* m_currentFlushSession = nullptr;
+
+/**
+ * @brief constructor
+ */
+CoalescingHandler::CoalescingHandler() {}
+
+/**
+ * @brief destructor
+ */
+CoalescingHandler::~CoalescingHandler()
+{
+    std::unique_lock<std::mutex> lock(m_pendingMutex);
+    m_deadlines.clear();
+    m_pending.clear();
+}
+
+/**
+ * @brief register a session, which has stream-messages within its coalescing-buffer, to flush
+ *        the buffer when the timeout is reached
+ *
+ * @param session pointer to the session with the not flushed stream-messages
+ * @param flushTimeout time in microseconds until the buffer of the session has to be flushed
+ */
+void
+CoalescingHandler::addSession(Session* session,
+                              const uint32_t flushTimeout)
+{
+    const TimePoint deadline = std::chrono::steady_clock::now()
+                               + std::chrono::microseconds(flushTimeout);
+
+    std::unique_lock<std::mutex> lock(m_pendingMutex);
+
+    // replace an older deadline of the session
+    std::unordered_map<Session*, TimePoint>::iterator it;
+    it = m_pending.find(session);
+    if(it != m_pending.end())
+    {
+        m_deadlines.erase(std::make_pair(it->second, session));
+        it->second = deadline;
+    }
+    else
+    {
+        m_pending.insert(std::make_pair(session, deadline));
+    }
+    m_deadlines.insert(std::make_pair(deadline, session));
+
+    m_pendingCv.notify_one();
+}
+
+/**
+ * @brief remove a session from the list, for example because the session was closed. If the
+ *        session is flushed at the moment by the handler, this waits until the flush is finished.
+ *
+ * @param session pointer to the session, which should be removed
+ */
+void
+CoalescingHandler::removeSession(Session* session)
+{
+    std::unique_lock<std::mutex> lock(m_pendingMutex);
+
+    std::unordered_map<Session*, TimePoint>::iterator it;
+    it = m_pending.find(session);
+    if(it != m_pending.end())
+    {
+        m_deadlines.erase(std::make_pair(it->second, session));
+        m_pending.erase(it);
+    }
+
+    // session is removed within its own flush
+    if(m_currentFlushSession == session) {
+        return;
+    }
+
+    while(m_activeSession == session) {
+        m_idleCv.wait(lock);
+    }
+}
+
+/**
+ * @brief thread-loop, which waits until the next deadline is reached and flushes the
+ *        coalescing-buffer of all sessions with a reached deadline. While a session is flushed,
+ *        it can not be removed by other threads, so it can not be deleted in the meantime.
+ */
+void
+CoalescingHandler::run()
+{
+    while(m_abort == false)
+    {
+        applyGlobalAffinity(m_appliedAffinity);
+
+        std::unique_lock<std::mutex> lock(m_pendingMutex);
+
+        if(m_deadlines.empty())
+        {
+            m_pendingCv.wait_for(lock, std::chrono::milliseconds(100));
+            continue;
+        }
+
+        // wait until the next deadline is reached or a new session was added
+        m_pendingCv.wait_until(lock, m_deadlines.begin()->first);
+
+        const TimePoint now = std::chrono::steady_clock::now();
+        while(m_deadlines.empty() == false
+              && m_deadlines.begin()->first <= now)
+        {
+            Session* session = m_deadlines.begin()->second;
+            m_deadlines.erase(m_deadlines.begin());
+            m_pending.erase(session);
+
+            // flush outside of the lock, so a slow socket doesn't block the other sessions
+            m_activeSession = session;
+            lock.unlock();
+
+            m_currentFlushSession = session;
+            session->flushStreamData();
+            m_currentFlushSession = nullptr;
+
+            lock.lock();
+            m_activeSession = nullptr;
+            m_idleCv.notify_all();
+        }
+    }
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
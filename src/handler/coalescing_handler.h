@@ -0,0 +1,69 @@
+/**
+ * @file       coalescing_handler.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef COALESCING_HANDLER_H
+#define COALESCING_HANDLER_H
+
+#include <set>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+#include <libKitsunemimiCommon/threading/thread.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+
+class CoalescingHandler : public Kitsunemimi::Thread
+{
+public:
+    CoalescingHandler();
+    ~CoalescingHandler();
+
+    void addSession(Session* session,
+                    const uint32_t flushTimeout);
+    void removeSession(Session* session);
+
+protected:
+    void run();
+
+private:
+    uint64_t m_appliedAffinity = 0;
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    std::mutex m_pendingMutex;
+    std::condition_variable m_pendingCv;
+    std::condition_variable m_idleCv;
+    Session* m_activeSession = nullptr;
+    std::set<std::pair<TimePoint, Session*>> m_deadlines;
+    std::unordered_map<Session*, TimePoint> m_pending;
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // COALESCING_HANDLER_H
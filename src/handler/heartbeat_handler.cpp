@@ -0,0 +1,212 @@
+/**
+ * @file       heartbeat_handler.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include <handler/heartbeat_handler.h>
+
+#include <vector>
+
+#include <handler/session_handler.h>
+#include <multiblock_io.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+#include <thread_affinity.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+// session, which is checked at the moment by the current thread
+static thread_local Session* m_currentHeartbeatSession = nullptr;
+
+/**
+ * @brief constructor
+ */
+HeartbeatHandler::HeartbeatHandler() {}
+
+/**
+ * @brief destructor
+ */
+HeartbeatHandler::~HeartbeatHandler()
+{
+    std::unique_lock<std::mutex> lock(m_scheduleMutex);
+    m_schedule.clear();
+    m_sessions.clear();
+}
+
+/**
+ * @brief register a ready session for heartbeats. The first check is placed at a random point
+ *        within the heartbeat-interval of the session, so the heartbeats of all sessions are
+ *        spread over the interval instead of being send at once.
+ *
+ * @param session pointer to the session
+ */
+void
+HeartbeatHandler::addSession(Session* session)
+{
+    const uint32_t interval = session->m_heartbeatInterval;
+    if(interval == 0) {
+        return;
+    }
+
+    const uint64_t offset = MultiblockIO::getRandValue() % interval;
+    const TimePoint nextCheck = std::chrono::steady_clock::now()
+                                + std::chrono::milliseconds(offset);
+
+    std::unique_lock<std::mutex> lock(m_scheduleMutex);
+    scheduleSession(session, nextCheck);
+    m_scheduleCv.notify_one();
+}
+
+/**
+ * @brief remove a session, for example because the session was closed. If the session is
+ *        checked at the moment by another thread, this waits until the check is finished.
+ *
+ * @param session pointer to the session
+ */
+void
+HeartbeatHandler::removeSession(Session* session)
+{
+    std::unique_lock<std::mutex> lock(m_scheduleMutex);
+
+    std::unordered_map<Session*, TimePoint>::iterator it;
+    it = m_sessions.find(session);
+    if(it != m_sessions.end())
+    {
+        m_schedule.erase(std::make_pair(it->second, session));
+        m_sessions.erase(it);
+    }
+
+    if(m_activeSession != session) {
+        return;
+    }
+
+    // prevent rescheduling after the running check
+    m_activeRemoved = true;
+
+    // session is removed within its own check, for example by the error-callback
+    if(m_currentHeartbeatSession == session) {
+        return;
+    }
+
+    while(m_activeSession == session) {
+        m_idleCv.wait(lock);
+    }
+}
+
+/**
+ * @brief get current time for the traffic-timestamps of the sessions
+ *
+ * @return milliseconds of the steady clock
+ */
+uint64_t
+HeartbeatHandler::getCurrentTime()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @brief thread-loop, which waits until the next check of a session is reached. While a session
+ *        is checked, it can not be removed by other threads, so it can not be deleted in the
+ *        meantime.
+ */
+void
+HeartbeatHandler::run()
+{
+    while(m_abort == false)
+    {
+        applyGlobalAffinity(m_appliedAffinity);
+
+        std::unique_lock<std::mutex> lock(m_scheduleMutex);
+
+        if(m_schedule.empty())
+        {
+            m_scheduleCv.wait_for(lock, std::chrono::milliseconds(100));
+            continue;
+        }
+
+        // wait until the next check is reached or a new session was added
+        m_scheduleCv.wait_until(lock, m_schedule.begin()->first);
+
+        const TimePoint now = std::chrono::steady_clock::now();
+        while(m_schedule.empty() == false
+              && m_schedule.begin()->first <= now)
+        {
+            const TimePoint checkTime = m_schedule.begin()->first;
+            Session* session = m_schedule.begin()->second;
+            m_schedule.erase(m_schedule.begin());
+            m_sessions.erase(session);
+
+            // check session outside of the lock
+            m_activeSession = session;
+            m_activeRemoved = false;
+            lock.unlock();
+
+            m_currentHeartbeatSession = session;
+            session->checkHeartbeat();
+            m_currentHeartbeatSession = nullptr;
+
+            lock.lock();
+            m_activeSession = nullptr;
+            m_idleCv.notify_all();
+
+            // keep the offset of the session within the interval for the next check
+            const uint32_t interval = session->m_heartbeatInterval;
+            if(m_activeRemoved
+                    || interval == 0
+                    || m_sessions.find(session) != m_sessions.end())
+            {
+                continue;
+            }
+
+            TimePoint nextCheck = checkTime + std::chrono::milliseconds(interval);
+            if(nextCheck <= now) {
+                nextCheck = now + std::chrono::milliseconds(interval);
+            }
+            scheduleSession(session, nextCheck);
+        }
+    }
+}
+
+/**
+ * @brief set the time of the next check of a session
+ *
+ * @param session pointer to the session
+ * @param nextCheck time of the next check
+ */
+void
+HeartbeatHandler::scheduleSession(Session* session,
+                                  const TimePoint nextCheck)
+{
+    std::unordered_map<Session*, TimePoint>::iterator it;
+    it = m_sessions.find(session);
+    if(it != m_sessions.end()) {
+        m_schedule.erase(std::make_pair(it->second, session));
+    }
+
+    m_sessions[session] = nextCheck;
+    m_schedule.insert(std::make_pair(nextCheck, session));
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,74 @@
+/**
+ * @file       heartbeat_handler.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef HEARTBEAT_HANDLER_H
+#define HEARTBEAT_HANDLER_H
+
+#include <set>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+#include <libKitsunemimiCommon/threading/thread.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+
+class HeartbeatHandler : public Kitsunemimi::Thread
+{
+public:
+    HeartbeatHandler();
+    ~HeartbeatHandler();
+
+    void addSession(Session* session);
+    void removeSession(Session* session);
+
+    static uint64_t getCurrentTime();
+
+protected:
+    void run();
+
+private:
+    uint64_t m_appliedAffinity = 0;
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    std::mutex m_scheduleMutex;
+    std::condition_variable m_scheduleCv;
+    std::condition_variable m_idleCv;
+    Session* m_activeSession = nullptr;
+    bool m_activeRemoved = false;
+    std::set<std::pair<TimePoint, Session*>> m_schedule;
+    std::unordered_map<Session*, TimePoint> m_sessions;
+
+    void scheduleSession(Session* session,
+                         const TimePoint nextCheck);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // HEARTBEAT_HANDLER_H
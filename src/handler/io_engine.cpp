@@ -0,0 +1,395 @@
+/**
+ * @file       io_engine.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <handler/io_engine.h>
+
+#include <thread>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <multiblock_io.h>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+#include <thread_affinity.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+// multiblock-io, which is processed at the moment by the current thread
+static thread_local MultiblockIO* m_currentIo = nullptr;
+
+/**
+ * @brief constructor, which creates the epoll-instance and the event-fd to wake up the loop
+ */
+IoLoop::IoLoop()
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeUpFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if(m_epollFd >= 0
+            && m_wakeUpFd >= 0)
+    {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = m_wakeUpFd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeUpFd, &event);
+    }
+}
+
+/**
+ * @brief destructor
+ */
+IoLoop::~IoLoop()
+{
+    if(m_wakeUpFd >= 0) {
+        close(m_wakeUpFd);
+    }
+    if(m_epollFd >= 0) {
+        close(m_epollFd);
+    }
+}
+
+/**
+ * @brief check if the file-descriptors of the loop were created successfully
+ *
+ * @return true, if loop is usable, else false
+ */
+bool
+IoLoop::isValid() const
+{
+    return m_epollFd >= 0 && m_wakeUpFd >= 0;
+}
+
+/**
+ * @brief let the loop send the outgoing multiblock-messages of a session
+ *
+ * @param multiblockIo multiblock-io of the session
+ */
+void
+IoLoop::addMultiblockIo(MultiblockIO* multiblockIo)
+{
+    std::unique_lock<std::mutex> lock(m_ioMutex);
+    m_multiblockIos.push_back(multiblockIo);
+    multiblockIo->m_ioLoop = this;
+}
+
+/**
+ * @brief remove a multiblock-io from the loop. If the loop sends parts of the multiblock-io at
+ *        the moment, it waits until this turn is finished, so the object can be deleted
+ *        afterwards. Other multiblock-ios of the loop don't block the removal.
+ *
+ * @param multiblockIo multiblock-io of the session
+ */
+void
+IoLoop::removeMultiblockIo(MultiblockIO* multiblockIo)
+{
+    std::unique_lock<std::mutex> lock(m_ioMutex);
+
+    for(uint64_t i = 0; i < m_multiblockIos.size(); i++)
+    {
+        if(m_multiblockIos[i] == multiblockIo)
+        {
+            m_multiblockIos[i] = m_multiblockIos.back();
+            m_multiblockIos.pop_back();
+            multiblockIo->m_ioLoop = nullptr;
+            break;
+        }
+    }
+
+    // prevent, that the running round processes the multiblock-io later
+    for(uint64_t i = 0; i < m_roundIos.size(); i++)
+    {
+        if(m_roundIos[i] == multiblockIo) {
+            m_roundIos[i] = nullptr;
+        }
+    }
+
+    // multiblock-io is removed within its own turn, for example by a completion-callback
+    if(m_currentIo == multiblockIo) {
+        return;
+    }
+
+    while(m_activeIo == multiblockIo) {
+        m_idleCv.wait(lock);
+    }
+}
+
+/**
+ * @brief get number of multiblock-ios, which are handled by the loop
+ *
+ * @return number of multiblock-ios
+ */
+uint64_t
+IoLoop::getNumberOfMultiblockIos()
+{
+    std::unique_lock<std::mutex> lock(m_ioMutex);
+    return m_multiblockIos.size();
+}
+
+/**
+ * @brief wake up the loop, because there is new work
+ */
+void
+IoLoop::wakeUp()
+{
+    const uint64_t value = 1;
+    const ssize_t ret = write(m_wakeUpFd, &value, sizeof(value));
+    (void)ret;
+}
+
+/**
+ * @brief process one round over all multiblock-ios of the loop. The list is copied at the
+ *        beginning of the round and each multiblock-io sends its parts outside of the lock. A
+ *        session, whose socket is used by another thread at the moment, gives up its turn,
+ *        so it doesn't block the other sessions of the loop.
+ *
+ * @param skipped reference, which is set to true, if at least one session gave up its turn
+ *
+ * @return true, if at least one multiblock-io has send data, else false
+ */
+bool
+IoLoop::processMultiblockIos(bool &skipped)
+{
+    bool workDone = false;
+    std::unique_lock<std::mutex> lock(m_ioMutex);
+    m_roundIos = m_multiblockIos;
+
+    for(uint64_t i = 0; i < m_roundIos.size(); i++)
+    {
+        MultiblockIO* multiblockIo = m_roundIos[i];
+        if(multiblockIo == nullptr) {
+            continue;
+        }
+
+        if(multiblockIo->m_session->isSendBusy())
+        {
+            skipped = true;
+            continue;
+        }
+
+        m_activeIo = multiblockIo;
+        lock.unlock();
+
+        m_currentIo = multiblockIo;
+        workDone = multiblockIo->processOutgoing(false) || workDone;
+        m_currentIo = nullptr;
+
+        lock.lock();
+        m_activeIo = nullptr;
+        m_idleCv.notify_all();
+    }
+
+    m_roundIos.clear();
+
+    return workDone;
+}
+
+/**
+ * @brief event-loop, which processes the multiblock-ios as long as they have data to send and
+ *        waits for a wake-up otherwise
+ */
+void
+IoLoop::run()
+{
+    struct epoll_event events[16];
+
+    while(m_abort == false)
+    {
+        applyGlobalAffinity(m_appliedAffinity);
+
+        // send until all multiblock-messages are finished or wait for the receiver
+        bool skipped = false;
+        while(m_abort == false
+              && processMultiblockIos(skipped))
+        {
+            asm("");
+        }
+
+        // sessions, which gave up their turn, are retried soon, without spinning on the lock
+        const int timeout = skipped ? IO_LOOP_RETRY_TIMEOUT : IO_LOOP_TIMEOUT;
+        const int numberOfEvents = epoll_wait(m_epollFd, events, 16, timeout);
+        for(int i = 0; i < numberOfEvents; i++)
+        {
+            if(events[i].data.fd == m_wakeUpFd)
+            {
+                uint64_t value = 0;
+                const ssize_t ret = read(m_wakeUpFd, &value, sizeof(value));
+                (void)ret;
+            }
+        }
+    }
+}
+
+//==================================================================================================
+
+/**
+ * @brief constructor
+ */
+IoEngine::IoEngine()
+{
+    m_isActive = false;
+}
+
+/**
+ * @brief destructor
+ */
+IoEngine::~IoEngine()
+{
+    m_isActive = false;
+
+    std::unique_lock<std::mutex> lock(m_loopMutex);
+    for(uint32_t i = 0; i < m_loops.size(); i++)
+    {
+        m_loops[i]->stopThread();
+        delete m_loops[i];
+    }
+    m_loops.clear();
+}
+
+/**
+ * @brief start the loop-threads. After this, new sessions have no own thread for sending
+ *        multiblock-messages anymore.
+ *
+ * @param numberOfLoops number of loop-threads, or 0 to use one loop per cpu-core
+ *
+ * @return false, if loops were already started or can not be created, else true
+ */
+bool
+IoEngine::startLoops(const uint32_t numberOfLoops)
+{
+    std::unique_lock<std::mutex> lock(m_loopMutex);
+
+    if(m_loops.size() > 0) {
+        return false;
+    }
+
+    uint32_t numberOfThreads = numberOfLoops;
+    if(numberOfThreads == 0) {
+        numberOfThreads = std::thread::hardware_concurrency();
+    }
+    if(numberOfThreads == 0) {
+        numberOfThreads = 1;
+    }
+
+    for(uint32_t i = 0; i < numberOfThreads; i++)
+    {
+        IoLoop* loop = new IoLoop();
+        if(loop->isValid() == false)
+        {
+            delete loop;
+            for(uint32_t j = 0; j < m_loops.size(); j++)
+            {
+                m_loops[j]->stopThread();
+                delete m_loops[j];
+            }
+            m_loops.clear();
+            return false;
+        }
+
+        loop->startThread();
+        m_loops.push_back(loop);
+    }
+
+    m_isActive = true;
+
+    return true;
+}
+
+/**
+ * @brief check if the loops were started
+ *
+ * @return true, if active, else false
+ */
+bool
+IoEngine::isActive() const
+{
+    return m_isActive;
+}
+
+/**
+ * @brief assign a new session to one of the loops
+ *
+ * @param session new session
+ *
+ * @return false, if engine is not active, else true
+ */
+bool
+IoEngine::addSession(Session* session)
+{
+    std::unique_lock<std::mutex> lock(m_loopMutex);
+
+    if(m_isActive == false
+            || m_loops.size() == 0)
+    {
+        return false;
+    }
+
+    // sessions are distributed round-robin over the loops
+    m_loops[m_nextLoop]->addMultiblockIo(session->m_multiblockIo);
+    m_nextLoop = (m_nextLoop + 1) % static_cast<uint32_t>(m_loops.size());
+
+    return true;
+}
+
+/**
+ * @brief remove a session from its loop
+ *
+ * @param session session, which should be removed
+ */
+void
+IoEngine::removeSession(Session* session)
+{
+    IoLoop* loop = session->m_multiblockIo->m_ioLoop;
+    if(loop != nullptr) {
+        loop->removeMultiblockIo(session->m_multiblockIo);
+    }
+}
+
+/**
+ * @brief get statistics of the engine
+ *
+ * @return object with the number of loops and sessions
+ */
+IoEngineStats
+IoEngine::getStats()
+{
+    IoEngineStats stats;
+
+    std::unique_lock<std::mutex> lock(m_loopMutex);
+    stats.numberOfLoops = static_cast<uint32_t>(m_loops.size());
+    for(uint32_t i = 0; i < m_loops.size(); i++)
+    {
+        const uint64_t numberOfSessions = m_loops[i]->getNumberOfMultiblockIos();
+        stats.numberOfSessions += numberOfSessions;
+        if(numberOfSessions > stats.maxSessionsPerLoop) {
+            stats.maxSessionsPerLoop = numberOfSessions;
+        }
+    }
+
+    return stats;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,103 @@
+/**
+ * @file       io_engine.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef IO_ENGINE_H
+#define IO_ENGINE_H
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include <libKitsunemimiCommon/threading/thread.h>
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+
+// max time in milliseconds, which a loop waits for new events, before it checks for abort
+#define IO_LOOP_TIMEOUT 100
+// time in milliseconds, after which a loop retries sessions, whose socket was busy
+#define IO_LOOP_RETRY_TIMEOUT 1
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+class MultiblockIO;
+
+class IoLoop : public Kitsunemimi::Thread
+{
+public:
+    IoLoop();
+    ~IoLoop();
+
+    bool isValid() const;
+
+    void addMultiblockIo(MultiblockIO* multiblockIo);
+    void removeMultiblockIo(MultiblockIO* multiblockIo);
+    uint64_t getNumberOfMultiblockIos();
+
+    void wakeUp();
+
+protected:
+    void run();
+
+private:
+    uint64_t m_appliedAffinity = 0;
+    int m_epollFd = -1;
+    int m_wakeUpFd = -1;
+
+    // the multiblock-ios are send outside of the lock. Only the multiblock-io, which is in
+    // progress at the moment, can not be removed until its turn is finished.
+    std::mutex m_ioMutex;
+    std::condition_variable m_idleCv;
+    std::vector<MultiblockIO*> m_multiblockIos;
+    std::vector<MultiblockIO*> m_roundIos;
+    MultiblockIO* m_activeIo = nullptr;
+
+    bool processMultiblockIos(bool &skipped);
+};
+
+class IoEngine
+{
+public:
+    IoEngine();
+    ~IoEngine();
+
+    bool startLoops(const uint32_t numberOfLoops);
+    bool isActive() const;
+
+    bool addSession(Session* session);
+    void removeSession(Session* session);
+
+    IoEngineStats getStats();
+
+private:
+    std::atomic<bool> m_isActive;
+    std::mutex m_loopMutex;
+    std::vector<IoLoop*> m_loops;
+    uint32_t m_nextLoop = 0;
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // IO_ENGINE_H
@@ -22,6 +22,7 @@
 
 #include "message_blocker_handler.h"
 #include <libKitsunemimiSakuraNetwork/session.h>
+#include <thread_affinity.h>
 
 namespace Kitsunemimi
 {
@@ -42,199 +43,294 @@ MessageBlockerHandler::~MessageBlockerHandler()
 }
 
 /**
- * @brief MessageBlockerHandler::blockMessage
+ * @brief callback for blocking requests, which releases the thread waiting for the response
+ *
+ * @param target pointer to the RequestWaiter-object of the waiting thread
+ * @param data data-buffer with the response or nullptr in case of a timeout
+ */
+void
+MessageBlockerHandler::releaseRequestWaiter(void* target,
+                                            Session*,
+                                            const uint64_t,
+                                            DataBuffer* data)
+{
+    RequestWaiter* waiter = static_cast<RequestWaiter*>(target);
+
+    std::unique_lock<std::mutex> lock(waiter->cvMutex);
+    waiter->responseData = data;
+    waiter->released = true;
+    waiter->cv.notify_one();
+}
+
+/**
+ * @brief register a request, which waits for its response. It has to be registered before the
+ *        request is send, to avoid that the response comes before the registration.
  *
  * @param blockerId id ot identify the entry within the blocker-handler
- * @param blockerTimeout time until a timeout appear for the message in seconds
+ * @param blockerTimeout time until a timeout appear for the message in milliseconds
  * @param session pointer to the session for error-callback in case of a timeout
- * @return
+ * @param processResponse callback, which is called with the response or with nullptr in case
+ *                        of a timeout
+ * @param target additional pointer, which is given to the callback
+ *
+ * @return false, if blocker-id is already registered, else true
  */
-DataBuffer*
-MessageBlockerHandler::blockMessage(const uint64_t blockerId,
-                                    const uint64_t blockerTimeout,
-                                    Session* session)
+bool
+MessageBlockerHandler::addRequest(const uint64_t blockerId,
+                                  const uint64_t blockerTimeout,
+                                  Session* session,
+                                  void (*processResponse)(void*,
+                                                          Session*,
+                                                          const uint64_t,
+                                                          DataBuffer*),
+                                  void* target)
 {
-    // init new blocker entry
-    MessageBlocker* messageBlocker = new MessageBlocker();
-    messageBlocker->blockerId = blockerId;
-    messageBlocker->timer = blockerTimeout;
-    messageBlocker->session = session;
-
-    // add to waiting-list
-    spinLock();
-    m_messageList.push_back(messageBlocker);
-    spinUnlock();
-
-    // release thread
-    std::unique_lock<std::mutex> lock(messageBlocker->cvMutex);
-    messageBlocker->cv.wait(lock);
-
-    // remove from list and return result
-    spinLock();
-    DataBuffer* result = removeMessageFromList(blockerId);
-    spinUnlock();
-
-    return result;
+    MessageBlocker messageBlocker;
+    messageBlocker.blockerId = blockerId;
+    messageBlocker.deadline = std::chrono::steady_clock::now()
+                              + std::chrono::milliseconds(blockerTimeout);
+    messageBlocker.startTime = MetricsRecorder::getCurrentTime();
+    messageBlocker.session = session;
+    messageBlocker.processResponse = processResponse;
+    messageBlocker.target = target;
+
+    std::unique_lock<std::mutex> lock(m_pendingMutex);
+
+    if(m_pending.find(blockerId) != m_pending.end()) {
+        return false;
+    }
+
+    m_pending.insert(std::make_pair(blockerId, messageBlocker));
+    m_deadlines.insert(std::make_pair(messageBlocker.deadline, blockerId));
+
+    // wake up the thread, because the new deadline could be the next one
+    m_pendingCv.notify_one();
+
+    return true;
 }
 
 /**
- * @brief MessageBlockerHandler::releaseMessage
- * @param blockerId
- * @param data data-buffer, which comes from the other side and should be returned by the
- *             blocked thread, which called the request-method within the session
+ * @brief release a request by calling its callback with the response
  *
- * @return true, if blocker-id was found in the list of blocked threads
+ * @param blockerId id ot identify the entry within the blocker-handler
+ * @param data data-buffer, which comes from the other side and should be given to the
+ *             callback of the request
+ *
+ * @return true, if blocker-id was found in the list of waiting requests
  */
 bool
 MessageBlockerHandler::releaseMessage(const uint64_t blockerId,
                                       DataBuffer* data)
 {
-    bool result = false;
+    MessageBlocker messageBlocker;
+
+    {
+        std::unique_lock<std::mutex> lock(m_pendingMutex);
+
+        std::unordered_map<uint64_t, MessageBlocker>::iterator it;
+        it = m_pending.find(blockerId);
+        if(it == m_pending.end()) {
+            return releaseBatchSlot(blockerId, data);
+        }
+
+        messageBlocker = it->second;
+        m_deadlines.erase(std::make_pair(messageBlocker.deadline, blockerId));
+        m_pending.erase(it);
+    }
 
-    spinLock();
-    result = releaseMessageInList(blockerId, data);
-    spinUnlock();
+    const uint64_t latency = MetricsRecorder::getCurrentTime() - messageBlocker.startTime;
+    messageBlocker.session->m_metrics.addRequestLatency(latency);
 
-    return result;
+    // trigger callback outside of the lock
+    messageBlocker.processResponse(messageBlocker.target,
+                                   messageBlocker.session,
+                                   blockerId,
+                                   data);
+
+    return true;
 }
 
 /**
- * @brief AnswerHandler::run
+ * @brief register a batch of requests, whose blocker-ids are the base-id plus the position of
+ *        the request within the batch. The waiting thread handles the deadline of the batch
+ *        by itself.
+ *
+ * @param baseId blocker-id of the first request, which must be a multiple of
+ *               MAX_REQUEST_BATCH_SIZE
+ * @param batch batch with the slots for the responses
+ *
+ * @return false, if base-id is invalid or already registered, else true
  */
-void
-MessageBlockerHandler::run()
+bool
+MessageBlockerHandler::addRequestBatch(const uint64_t baseId,
+                                       RequestBatch* batch)
 {
-    while(!m_abort)
+    if(baseId == 0
+            || baseId % MAX_REQUEST_BATCH_SIZE != 0)
     {
-        makeTimerStep();
+        return false;
+    }
 
-        // sleep for 1 second
-        sleepThread(1000000);
+    std::unique_lock<std::mutex> lock(m_pendingMutex);
+
+    if(m_batches.find(baseId) != m_batches.end()) {
+        return false;
     }
+
+    m_batches.insert(std::make_pair(baseId, batch));
+
+    return true;
 }
 
 /**
- * @brief MessageBlockerHandler::releaseMessageInList
+ * @brief unregister a batch of requests. Responses, which arrive after this, are dropped.
  *
- * @param blockerId
- * @param data
+ * @param baseId blocker-id of the first request of the batch
+ */
+void
+MessageBlockerHandler::removeRequestBatch(const uint64_t baseId)
+{
+    std::unique_lock<std::mutex> lock(m_pendingMutex);
+    m_batches.erase(baseId);
+}
+
+/**
+ * @brief write a response into the slot of its request within a registered batch. The
+ *        pending-mutex must be hold by the caller.
+ *
+ * @param blockerId blocker-id of the request within the batch
+ * @param data data-buffer with the response
  *
- * @return
+ * @return false, if there is no batch for the blocker-id or the slot has already a response,
+ *         else true
  */
 bool
-MessageBlockerHandler::releaseMessageInList(const uint64_t blockerId,
-                                            DataBuffer* data)
+MessageBlockerHandler::releaseBatchSlot(const uint64_t blockerId,
+                                        DataBuffer* data)
 {
-    std::vector<MessageBlocker*>::iterator it;
-    for(it = m_messageList.begin();
-        it != m_messageList.end();
-        it++)
+    const uint64_t position = blockerId % MAX_REQUEST_BATCH_SIZE;
+
+    std::unordered_map<uint64_t, RequestBatch*>::iterator it;
+    it = m_batches.find(blockerId - position);
+    if(it == m_batches.end()) {
+        return false;
+    }
+
+    RequestBatch* batch = it->second;
+    if(position >= batch->numberOfRequests
+            || batch->slots[position].response != nullptr)
     {
-        MessageBlocker* tempItem = *it;
-        if(tempItem->blockerId == blockerId)
-        {
-            tempItem->responseData = data;
-            tempItem->cv.notify_one();
-            return true;
-        }
+        return false;
+    }
+
+    const uint64_t latency = MetricsRecorder::getCurrentTime() - batch->startTime;
+    batch->session->m_metrics.addRequestLatency(latency);
+
+    std::unique_lock<std::mutex> lock(batch->cvMutex);
+    batch->slots[position].response = data;
+    batch->numberOfResponses++;
+    if(batch->numberOfResponses == batch->numberOfRequests) {
+        batch->cv.notify_one();
     }
 
-    return false;
+    return true;
 }
 
 /**
- * @brief AnswerHandler::removeMessageFromList
- * @param blockerId
- * @return
+ * @brief thread-loop, which waits until the next deadline is reached
  */
-DataBuffer*
-MessageBlockerHandler::removeMessageFromList(const uint64_t blockerId)
+void
+MessageBlockerHandler::run()
 {
-    std::vector<MessageBlocker*>::iterator it;
-    for(it = m_messageList.begin();
-        it != m_messageList.end();
-        it++)
+    while(!m_abort)
     {
-        MessageBlocker* tempItem = *it;
-        if(tempItem->blockerId == blockerId)
-        {
-            if(m_messageList.size() > 1)
-            {
-                // swap with last and remove the last instead of erase the element direct
-                // because this was is faster
-                std::iter_swap(it, m_messageList.end() - 1);
-                m_messageList.pop_back();
-            }
-            else
-            {
-                m_messageList.clear();
-            }
+        applyGlobalAffinity(m_appliedAffinity);
 
-            // get data-buffer from the blocker-entry and delete the entry afterwards
-            DataBuffer* result = tempItem->responseData;
-            tempItem->responseData = nullptr;
-            delete tempItem;
+        {
+            std::unique_lock<std::mutex> lock(m_pendingMutex);
 
-            return result;
+            if(m_deadlines.empty()) {
+                m_pendingCv.wait_for(lock, std::chrono::milliseconds(100));
+            } else {
+                m_pendingCv.wait_until(lock, m_deadlines.begin()->first);
+            }
         }
-    }
 
-    return nullptr;
+        handleTimeouts();
+    }
 }
 
 /**
- * @brief AnswerHandler::clearList
+ * @brief remove all requests with reached deadline and trigger their callbacks
  */
 void
-MessageBlockerHandler::clearList()
+MessageBlockerHandler::handleTimeouts()
 {
-    spinLock();
+    std::vector<MessageBlocker> timeouts;
 
-    // release all threads
-    std::vector<MessageBlocker*>::iterator it;
-    for(it = m_messageList.begin();
-        it != m_messageList.end();
-        it++)
     {
-        MessageBlocker* tempItem = *it;
-        tempItem->cv.notify_one();
-        delete tempItem;
+        std::unique_lock<std::mutex> lock(m_pendingMutex);
+
+        const TimePoint now = std::chrono::steady_clock::now();
+        while(m_deadlines.empty() == false
+              && m_deadlines.begin()->first <= now)
+        {
+            const uint64_t blockerId = m_deadlines.begin()->second;
+            m_deadlines.erase(m_deadlines.begin());
+
+            std::unordered_map<uint64_t, MessageBlocker>::iterator it;
+            it = m_pending.find(blockerId);
+            if(it != m_pending.end())
+            {
+                timeouts.push_back(it->second);
+                m_pending.erase(it);
+            }
+        }
     }
 
-    // clear list
-    m_messageList.clear();
+    // trigger callbacks outside of the lock
+    for(uint64_t i = 0; i < timeouts.size(); i++)
+    {
+        const MessageBlocker* temp = &timeouts[i];
+        const std::string err = "TIMEOUT of request: "
+                                + std::to_string(temp->blockerId);
 
-    spinUnlock();
+        temp->session->m_metrics.addTimeout();
+        temp->session->m_processError(temp->session,
+                                      Session::errorCodes::MESSAGE_TIMEOUT,
+                                      err);
+        temp->processResponse(temp->target, temp->session, temp->blockerId, nullptr);
+    }
 }
 
 /**
- * @brief MessageBlockerHandler::makeTimerStep
+ * @brief release all waiting requests without response
  */
 void
-MessageBlockerHandler::makeTimerStep()
+MessageBlockerHandler::clearList()
 {
-    spinLock();
+    std::vector<MessageBlocker> remaining;
 
-    for(uint64_t i = 0; i < m_messageList.size(); i++)
     {
-        MessageBlocker* temp = m_messageList[i];
-        temp->timer -= 1;
+        std::unique_lock<std::mutex> lock(m_pendingMutex);
 
-        if(temp->timer == 0)
+        std::unordered_map<uint64_t, MessageBlocker>::iterator it;
+        for(it = m_pending.begin();
+            it != m_pending.end();
+            it++)
         {
-            removeMessageFromList(temp->blockerId);
-            releaseMessageInList(temp->blockerId, nullptr);
-
-            const std::string err = "TIMEOUT of request: "
-                                    + std::to_string(temp->blockerId);
-
-            temp->session->m_processError(temp->session,
-                                          Session::errorCodes::MESSAGE_TIMEOUT,
-                                          err);
+            remaining.push_back(it->second);
         }
+
+        m_pending.clear();
+        m_deadlines.clear();
     }
 
-    spinUnlock();
+    for(uint64_t i = 0; i < remaining.size(); i++)
+    {
+        const MessageBlocker* temp = &remaining[i];
+        temp->processResponse(temp->target, temp->session, temp->blockerId, nullptr);
+    }
 }
 
 } // namespace Sakura
@@ -24,9 +24,15 @@
 #define MESSAGE_BLOCKER_HANDLER_H
 
 #include <vector>
+#include <set>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
 #include <iostream>
 
 #include <libKitsunemimiCommon/threading/thread.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
 
 namespace Kitsunemimi
 {
@@ -40,33 +46,73 @@ public:
     MessageBlockerHandler();
     ~MessageBlockerHandler();
 
-    DataBuffer* blockMessage(const uint64_t blockerId,
-                             const uint64_t blockerTimeout,
-                             Session* session);
+    // waiter for blocking requests
+    struct RequestWaiter
+    {
+        std::mutex cvMutex;
+        std::condition_variable cv;
+        bool released = false;
+        DataBuffer* responseData = nullptr;
+    };
+
+    // batch of requests with a common base-id, where each response is written into the slot of
+    // its request, instead of registering each request on its own
+    struct RequestBatch
+    {
+        std::mutex cvMutex;
+        std::condition_variable cv;
+        Session* session = nullptr;
+        Session::RequestSlot* slots = nullptr;
+        uint32_t numberOfRequests = 0;
+        uint32_t numberOfResponses = 0;
+        uint64_t startTime = 0;
+    };
+
+    static void releaseRequestWaiter(void* target,
+                                     Session*,
+                                     const uint64_t,
+                                     DataBuffer* data);
+
+    bool addRequest(const uint64_t blockerId,
+                    const uint64_t blockerTimeout,
+                    Session* session,
+                    void (*processResponse)(void*, Session*, const uint64_t, DataBuffer*),
+                    void* target);
     bool releaseMessage(const uint64_t blockerId,
                         DataBuffer* data);
 
+    bool addRequestBatch(const uint64_t baseId,
+                         RequestBatch* batch);
+    void removeRequestBatch(const uint64_t baseId);
+
 protected:
     void run();
 
 private:
+    uint64_t m_appliedAffinity = 0;
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
     struct MessageBlocker
     {
         Session* session = nullptr;
         uint64_t blockerId = 0;
-        uint64_t timer = 0;
-        std::mutex cvMutex;
-        std::condition_variable cv;
-        DataBuffer* responseData = nullptr;
+        TimePoint deadline;
+        uint64_t startTime = 0;
+        void (*processResponse)(void*, Session*, const uint64_t, DataBuffer*) = nullptr;
+        void* target = nullptr;
     };
 
-    std::vector<MessageBlocker*> m_messageList;
+    std::mutex m_pendingMutex;
+    std::condition_variable m_pendingCv;
+    std::unordered_map<uint64_t, MessageBlocker> m_pending;
+    std::set<std::pair<TimePoint, uint64_t>> m_deadlines;
+    std::unordered_map<uint64_t, RequestBatch*> m_batches;
+
+    bool releaseBatchSlot(const uint64_t blockerId,
+                          DataBuffer* data);
 
-    bool releaseMessageInList(const uint64_t blockerId,
-                              DataBuffer* data);
-    DataBuffer* removeMessageFromList(const uint64_t blockerId);
     void clearList();
-    void makeTimerStep();
+    void handleTimeouts();
 };
 
 } // namespace Sakura
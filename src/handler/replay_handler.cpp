@@ -28,6 +28,7 @@
 
 #include <libKitsunemimiNetwork/abstract_socket.h>
 #include <libKitsunemimiPersistence/logger/logger.h>
+#include <thread_affinity.h>
 
 namespace Kitsunemimi
 {
@@ -37,7 +38,13 @@ namespace Sakura
 /**
  * @brief constructor
  */
-ReplyHandler::ReplyHandler() {}
+ReplyHandler::ReplyHandler()
+{
+    // default-timeout of 2 seconds for all message-types
+    for(uint32_t i = 0; i < 256; i++) {
+        m_timeoutSteps[i] = 2000 / REPLY_TIMER_STEP_SIZE;
+    }
+}
 
 /**
  * @brief destructor
@@ -45,7 +52,10 @@ ReplyHandler::ReplyHandler() {}
 ReplyHandler::~ReplyHandler()
 {
     spinLock();
-    m_messageList.clear();
+    m_messages.clear();
+    for(uint32_t i = 0; i < NUMBER_OF_TIMER_SLOTS; i++) {
+        m_timerSlots[i].clear();
+    }
     spinUnlock();
 }
 
@@ -82,9 +92,15 @@ ReplyHandler::addMessage(const uint8_t messageType,
     messageTime.completeMessageId = completeMessageId;
     messageTime.messageType = messageType;
     messageTime.session = session;
+    messageTime.sendTime = MetricsRecorder::getCurrentTime();
 
     spinLock();
-    m_messageList.push_back(messageTime);
+
+    // put the message into the slot of the timer-wheel, where the timeout will appear
+    messageTime.timeoutStep = m_currentStep + m_timeoutSteps[messageType];
+    m_timerSlots[messageTime.timeoutStep % NUMBER_OF_TIMER_SLOTS].push_back(completeMessageId);
+    m_messages[completeMessageId] = messageTime;
+
     spinUnlock();
 }
 
@@ -104,7 +120,9 @@ ReplyHandler::removeMessage(const uint32_t sessionId,
 }
 
 /**
- * @brief remove a message from the internal list
+ * @brief remove a message from the internal list, because its reply has arrived, and add the
+ *        round-trip-time to the metrics. The entry within the slot of the timer-wheel is only
+ *        skipped later, when the slot is processed.
  *
  * @param completeMessageId id of the message, which should be removed
  *
@@ -113,13 +131,30 @@ ReplyHandler::removeMessage(const uint32_t sessionId,
 bool
 ReplyHandler::removeMessage(const uint64_t completeMessageId)
 {
-    bool result = false;
+    MessageTime messageTime;
 
     spinLock();
-    result = removeMessageFromList(completeMessageId);
+
+    std::unordered_map<uint64_t, MessageTime>::iterator it;
+    it = m_messages.find(completeMessageId);
+    if(it == m_messages.end())
+    {
+        spinUnlock();
+        return false;
+    }
+
+    messageTime = it->second;
+    m_messages.erase(it);
+
     spinUnlock();
 
-    return result;
+    if(messageTime.ignoreResult == false)
+    {
+        const uint64_t duration = MetricsRecorder::getCurrentTime() - messageTime.sendTime;
+        messageTime.session->m_metrics.addReplyRoundTrip(duration);
+    }
+
+    return true;
 }
 
 /**
@@ -132,13 +167,13 @@ ReplyHandler::removeAllOfSession(const uint32_t sessionId)
 {
     spinLock();
 
-    std::vector<MessageTime>::iterator it;
-    for(it = m_messageList.begin();
-        it != m_messageList.end();
+    std::unordered_map<uint64_t, MessageTime>::iterator it;
+    for(it = m_messages.begin();
+        it != m_messages.end();
         it++)
     {
-        if((it->completeMessageId & 0xFFFFFFFF) == sessionId) {
-            it->ignoreResult = true;
+        if((it->first & 0xFFFFFFFF) == sessionId) {
+            it->second.ignoreResult = true;
         }
     }
 
@@ -146,39 +181,41 @@ ReplyHandler::removeAllOfSession(const uint32_t sessionId)
 }
 
 /**
- * @brief remove a message from the internal list
- *
- * @param messageId id of the message, which should be removed
+ * @brief set the timeout for messages of a specific type
  *
- * @return false, if message-id doesn't exist in the list, else true
+ * @param messageType type of the messages
+ * @param timeout time in milliseconds until a timeout appear for a message of the type
  */
-bool
-ReplyHandler::removeMessageFromList(const uint64_t completeMessageId)
+void
+ReplyHandler::setTimeout(const uint8_t messageType,
+                         const uint32_t timeout)
 {
-    std::vector<MessageTime>::iterator it;
-    for(it = m_messageList.begin();
-        it != m_messageList.end();
-        it++)
-    {
-        if(it->completeMessageId == completeMessageId)
-        {
-            if(m_messageList.size() > 1)
-            {
-                // swap with last and remove the last instead of erase the element direct
-                // because this was is faster
-                std::iter_swap(it, m_messageList.end() - 1);
-                m_messageList.pop_back();
-            }
-            else
-            {
-                m_messageList.clear();
-            }
-
-            return true;
-        }
+    // convert into timer-steps, where one step is the minimum
+    uint32_t numberOfSteps = (timeout + REPLY_TIMER_STEP_SIZE - 1) / REPLY_TIMER_STEP_SIZE;
+    if(numberOfSteps == 0) {
+        numberOfSteps = 1;
     }
 
-    return false;
+    spinLock();
+    m_timeoutSteps[messageType] = numberOfSteps;
+    spinUnlock();
+}
+
+/**
+ * @brief get the timeout for messages of a specific type
+ *
+ * @param messageType type of the messages
+ *
+ * @return time in milliseconds until a timeout appear for a message of the type
+ */
+uint32_t
+ReplyHandler::getTimeout(const uint8_t messageType)
+{
+    spinLock();
+    const uint32_t numberOfSteps = m_timeoutSteps[messageType];
+    spinUnlock();
+
+    return numberOfSteps * REPLY_TIMER_STEP_SIZE;
 }
 
 /**
@@ -187,63 +224,78 @@ ReplyHandler::removeMessageFromList(const uint64_t completeMessageId)
 void
 ReplyHandler::run()
 {
-    uint32_t counter = 0;
-
     while(!m_abort)
     {
-        sleepThread(100000);
-        counter += 1;
+        applyGlobalAffinity(m_appliedAffinity);
+
+        sleepThread(REPLY_TIMER_STEP_SIZE * 1000);
 
         if(m_abort) {
             break;
         }
 
         makeTimerStep();
-
-        if(counter % 10 == 0)
-        {
-            SessionHandler::m_sessionHandler->sendHeartBeats();
-            counter = 0;
-        }
     }
 }
 
 /**
- * @brief Increase the timer of all messages and handle timeouts
+ * @brief Go one step forward in the timer-wheel and handle all timeouts of the new slot
  */
 void
 ReplyHandler::makeTimerStep()
 {
+    std::vector<MessageTime> timeouts;
+
     spinLock();
 
-    for(uint64_t i = 0; i < m_messageList.size(); i++)
+    m_currentStep++;
+    const uint64_t slotId = m_currentStep % NUMBER_OF_TIMER_SLOTS;
+
+    std::vector<uint64_t> slot;
+    slot.swap(m_timerSlots[slotId]);
+
+    for(uint64_t i = 0; i < slot.size(); i++)
     {
-        MessageTime* temp = &m_messageList[i];
-        temp->timer += 0.1f;
+        std::unordered_map<uint64_t, MessageTime>::iterator it;
+        it = m_messages.find(slot.at(i));
 
-        if(temp->timer >= m_timeoutValue)
-        {
-            spinUnlock();
-            removeMessage(temp->completeMessageId);
-            if(temp->ignoreResult == false)
-            {
-                const std::string err = "TIMEOUT of message: "
-                                        + std::to_string(temp->completeMessageId)
-                                        + " with type: "
-                                        + std::to_string(temp->messageType);
-
-                temp->session->m_processError(temp->session,
-                                              Session::errorCodes::MESSAGE_TIMEOUT,
-                                              err);
-            }
-
-            spinLock();
+        // skip messages, which were already removed
+        if(it == m_messages.end()) {
+            continue;
+        }
 
-            break;
+        if(it->second.timeoutStep <= m_currentStep)
+        {
+            timeouts.push_back(it->second);
+            m_messages.erase(it);
+        }
+        else if(it->second.timeoutStep % NUMBER_OF_TIMER_SLOTS == slotId)
+        {
+            // timeout is in one of the next rounds of the wheel
+            m_timerSlots[slotId].push_back(slot.at(i));
         }
     }
 
     spinUnlock();
+
+    // trigger callbacks outside of the lock
+    for(uint64_t i = 0; i < timeouts.size(); i++)
+    {
+        const MessageTime* temp = &timeouts[i];
+        if(temp->ignoreResult) {
+            continue;
+        }
+
+        const std::string err = "TIMEOUT of message: "
+                                + std::to_string(temp->completeMessageId)
+                                + " with type: "
+                                + std::to_string(temp->messageType);
+
+        temp->session->m_metrics.addTimeout();
+        temp->session->m_processError(temp->session,
+                                      Session::errorCodes::MESSAGE_TIMEOUT,
+                                      err);
+    }
 }
 
 } // namespace Sakura
@@ -24,6 +24,7 @@
 #define REPLY_HANDLER_H
 
 #include <vector>
+#include <unordered_map>
 #include <iostream>
 
 #include <libKitsunemimiCommon/threading/thread.h>
@@ -34,6 +35,9 @@ namespace Sakura
 {
 class Session;
 
+#define REPLY_TIMER_STEP_SIZE 100  // milliseconds
+#define NUMBER_OF_TIMER_SLOTS 64
+
 class ReplyHandler : public Kitsunemimi::Thread
 {
 public:
@@ -55,24 +59,35 @@ public:
     bool removeMessage(const uint64_t completeMessageId);
     void removeAllOfSession(const uint32_t sessionId);
 
+    // config
+    void setTimeout(const uint8_t messageType,
+                    const uint32_t timeout);
+    uint32_t getTimeout(const uint8_t messageType);
+
 protected:
     void run();
 
 private:
+    uint64_t m_appliedAffinity = 0;
     struct MessageTime
     {
         uint64_t completeMessageId = 0;
-        float timer = 0.0f;
+        uint64_t timeoutStep = 0;
+        uint64_t sendTime = 0;
         uint8_t messageType = 0;
         Session* session = nullptr;
         bool ignoreResult = false;
     };
 
-    float m_timeoutValue = 2.0f;
-    std::vector<MessageTime> m_messageList;
+    // timeouts in number of timer-steps for each message-type
+    uint32_t m_timeoutSteps[256];
+
+    // timer-wheel
+    uint64_t m_currentStep = 0;
+    std::vector<uint64_t> m_timerSlots[NUMBER_OF_TIMER_SLOTS];
+    std::unordered_map<uint64_t, MessageTime> m_messages;
 
     void makeTimerStep();
-    bool removeMessageFromList(const uint64_t completeMessageId);
 };
 
 } // namespace Sakura
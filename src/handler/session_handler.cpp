@@ -22,9 +22,19 @@
 
 #include "session_handler.h"
 
+#include <cstring>
+#include <cstddef>
+
 #include <handler/reply_handler.h>
 #include <handler/message_blocker_handler.h>
+#include <handler/coalescing_handler.h>
+#include <handler/buffer_pool.h>
+#include <handler/callback_dispatcher.h>
+#include <handler/heartbeat_handler.h>
+#include <handler/io_engine.h>
+#include <handler/session_pool.h>
 #include <handler/session_handler.h>
+#include <payload_checksum.h>
 
 #include <libKitsunemimiSakuraNetwork/session.h>
 #include <libKitsunemimiSakuraNetwork/session_controller.h>
@@ -40,6 +50,13 @@ namespace Sakura
 // init static variables
 ReplyHandler* SessionHandler::m_replyHandler = nullptr;
 MessageBlockerHandler* SessionHandler::m_blockerHandler = nullptr;
+CoalescingHandler* SessionHandler::m_coalescingHandler = nullptr;
+BufferPool* SessionHandler::m_bufferPool = nullptr;
+CallbackDispatcher* SessionHandler::m_callbackDispatcher = nullptr;
+HeartbeatHandler* SessionHandler::m_heartbeatHandler = nullptr;
+IoEngine* SessionHandler::m_ioEngine = nullptr;
+SessionPool* SessionHandler::m_sessionPool = nullptr;
+MetricsRecorder* SessionHandler::m_globalMetrics = nullptr;
 SessionHandler* SessionHandler::m_sessionHandler = nullptr;
 
 /**
@@ -52,6 +69,12 @@ SessionHandler::SessionHandler(void (*processCreateSession)(Session*, const std:
     m_processCreateSession = processCreateSession;
     m_processCloseSession = processCloseSession;
     m_processError = processError;
+    m_sessionIdCounter = 0;
+    m_compressionEnabled = false;
+    m_streamFlowControlEnabled = false;
+    m_payloadChecksumEnabled = false;
+    m_compressionThreshold = 4096;
+    m_globalAffinityVersion = 0;
 
     if(m_replyHandler == nullptr)
     {
@@ -65,24 +88,39 @@ SessionHandler::SessionHandler(void (*processCreateSession)(Session*, const std:
         m_blockerHandler->startThread();
     }
 
-    // check if messages have the size of a multiple of 8
-    assert(sizeof(CommonMessageHeader) % 8 == 0);
-    assert(sizeof(CommonMessageFooter) % 8 == 0);
-    assert(sizeof(Session_Init_Start_Message) % 8 == 0);
-    assert(sizeof(Session_Init_Reply_Message) % 8 == 0);
-    assert(sizeof(Session_Close_Start_Message) % 8 == 0);
-    assert(sizeof(Session_Close_Reply_Message) % 8 == 0);
-    assert(sizeof(Heartbeat_Start_Message) % 8 == 0);
-    assert(sizeof(Heartbeat_Reply_Message) % 8 == 0);
-    assert(sizeof(Error_FalseVersion_Message) % 8 == 0);
-    assert(sizeof(Error_UnknownSession_Message) % 8 == 0);
-    assert(sizeof(Error_InvalidMessage_Message) % 8 == 0);
-    assert(sizeof(Data_StreamReply_Message) % 8 == 0);
-    assert(sizeof(Data_SingleBlockReply_Message) % 8 == 0);
-    assert(sizeof(Data_MultiInit_Message) % 8 == 0);
-    assert(sizeof(Data_MultiInitReply_Message) % 8 == 0);
-    assert(sizeof(Data_MultiFinish_Message) % 8 == 0);
-    assert(sizeof(Data_MultiAbortInit_Message) % 8 == 0);
+    if(m_coalescingHandler == nullptr)
+    {
+        m_coalescingHandler = new CoalescingHandler();
+        m_coalescingHandler->startThread();
+    }
+
+    if(m_bufferPool == nullptr) {
+        m_bufferPool = new BufferPool();
+    }
+
+    if(m_globalMetrics == nullptr) {
+        m_globalMetrics = new MetricsRecorder();
+    }
+
+    if(m_callbackDispatcher == nullptr) {
+        m_callbackDispatcher = new CallbackDispatcher();
+    }
+
+    if(m_heartbeatHandler == nullptr)
+    {
+        m_heartbeatHandler = new HeartbeatHandler();
+        m_heartbeatHandler->startThread();
+    }
+
+    if(m_ioEngine == nullptr) {
+        m_ioEngine = new IoEngine();
+    }
+
+    if(m_sessionPool == nullptr)
+    {
+        m_sessionPool = new SessionPool();
+        m_sessionPool->startThread();
+    }
 }
 
 /**
@@ -92,11 +130,18 @@ SessionHandler::~SessionHandler()
 {
     lockServerMap();
     m_servers.clear();
+    m_sharedMemoryServers.clear();
+    std::map<uint32_t, ServerContext*>::iterator it;
+    for(it = m_serverContexts.begin();
+        it != m_serverContexts.end();
+        it++)
+    {
+        delete it->second;
+    }
+    m_serverContexts.clear();
     unlockServerMap();
 
-    lockSessionMap();
     m_sessions.clear();
-    unlockSessionMap();
 
     if(m_replyHandler != nullptr)
     {
@@ -105,22 +150,52 @@ SessionHandler::~SessionHandler()
     }
 }
 
+/**
+ * @brief set the affinity of the threads, which are shared by all sessions. It is also the
+ *        affinity of all sessions without own policy. The threads apply the new policy by
+ *        themselves.
+ *
+ * @param policy new global affinity-policy
+ */
+void
+SessionHandler::setGlobalAffinity(const AffinityPolicy &policy)
+{
+    std::unique_lock<std::mutex> lock(m_affinityMutex);
+    m_globalAffinity = policy;
+    m_globalAffinityVersion++;
+}
+
+/**
+ * @brief get the global affinity-policy
+ *
+ * @param version reference for the version of the returned policy
+ *
+ * @return copy of the global affinity-policy
+ */
+AffinityPolicy
+SessionHandler::getGlobalAffinity(uint64_t &version)
+{
+    std::unique_lock<std::mutex> lock(m_affinityMutex);
+    version = m_globalAffinityVersion;
+    return m_globalAffinity;
+}
+
 /**
  * @brief add a new session the the internal list
  *
  * @param id id of the session, which should be added
  * @param session pointer to the session
+ *
+ * @return false, if the id is already in use, else true
  */
-void
+bool
 SessionHandler::addSession(const uint32_t id, Session* session)
 {
     session->m_processCreateSession = m_processCreateSession;
     session->m_processCloseSession = m_processCloseSession;
     session->m_processError = m_processError;
 
-    lockSessionMap();
-    m_sessions.insert(std::make_pair(id, session));
-    unlockSessionMap();
+    return m_sessions.addSession(id, session);
 }
 
 /**
@@ -131,64 +206,79 @@ SessionHandler::addSession(const uint32_t id, Session* session)
 Session*
 SessionHandler::removeSession(const uint32_t id)
 {
-    Session* ret = nullptr;
-
-    lockSessionMap();
-
-    std::map<uint32_t, Session*>::iterator it;
-    it = m_sessions.find(id);
+    return m_sessions.removeSession(id);
+}
 
-    if(it != m_sessions.end())
-    {
-        ret = it->second;
-        m_sessions.erase(it);
-    }
+/**
+ * @brief get a session by its id
+ *
+ * @param id id of the requested session
+ *
+ * @return pointer to the session, if found, else nullptr
+ */
+Session*
+SessionHandler::getSession(const uint32_t id) const
+{
+    return m_sessions.getSession(id);
+}
 
-    unlockSessionMap();
+/**
+ * @brief get a snapshot of all registered sessions
+ *
+ * @return list with all sessions
+ */
+std::vector<Session*>
+SessionHandler::getAllSessions() const
+{
+    return m_sessions.getAllSessions();
+}
 
-    return ret;
+/**
+ * @brief remove all sessions from the internal list, but doesn't close them
+ */
+void
+SessionHandler::removeAllSessions()
+{
+    m_sessions.clear();
 }
 
 /**
- * @brief increase the internal counter by one and returns the new counter-value
+ * @brief increase the internal counter by one and returns the new counter-value, where 0 is
+ *        skipped after an overflow of the counter
  *
- * @return id for the new session
+ * @return new counter-value
  */
 uint16_t
 SessionHandler::increaseSessionIdCounter()
 {
     uint16_t tempId = 0;
-
-    while (m_sessionIdCounter_lock.test_and_set(std::memory_order_acquire)) {
-        asm("");
+    do {
+        tempId = static_cast<uint16_t>(m_sessionIdCounter.fetch_add(1) + 1);
     }
-
-    m_sessionIdCounter++;
-    tempId = m_sessionIdCounter;
-
-    m_sessionIdCounter_lock.clear(std::memory_order_release);
+    while(tempId == 0);
 
     return tempId;
 }
 
 /**
- * @brief SessionHandler::lockSessionMap
+ * @brief get the part of the id of a new session on client-side. The server adds its own part
+ *        to this value, so the complete id is also unique on client-side, when it is connected
+ *        to multiple servers, which count independently from each other.
+ *
+ * @return value, which is not the client-part of the id of any registered session
  */
-void
-SessionHandler::lockSessionMap()
+uint16_t
+SessionHandler::getLocalSessionId()
 {
-    while (m_sessionMap_lock.test_and_set(std::memory_order_acquire)) {
-        asm("");
+    uint16_t tempId = 0;
+
+    // skip all values, which are still in use after an overflow of the counter
+    do {
+        tempId = increaseSessionIdCounter();
     }
-}
+    while(m_sessions.containsLocalPart(tempId));
 
-/**
- * @brief SessionHandler::unlockSessionMap
- */
-void
-SessionHandler::unlockSessionMap()
-{
-    m_sessionMap_lock.clear(std::memory_order_release);
+    return tempId;
 }
 
 /**
@@ -212,22 +302,25 @@ SessionHandler::unlockServerMap()
 }
 
 /**
- * @brief send a heartbeat to all registered sessions
+ * @brief get features, which are offered to the other side while initializing a new session
+ *
+ * @return bitmask with SESSION_FEATURE_* values
  */
-void
-SessionHandler::sendHeartBeats()
+uint32_t
+SessionHandler::getSupportedFeatures() const
 {
-    lockSessionMap();
-
-    std::map<uint32_t, Session*>::iterator it;
-    for(it = m_sessions.begin();
-        it != m_sessions.end();
-        it++)
-    {
-        it->second->sendHeartbeat();
+    uint32_t features = 0;
+    if(m_compressionEnabled) {
+        features |= SESSION_FEATURE_COMPRESSION;
+    }
+    if(m_streamFlowControlEnabled) {
+        features |= SESSION_FEATURE_STREAM_FLOW_CONTROL;
+    }
+    if(m_payloadChecksumEnabled) {
+        features |= SESSION_FEATURE_PAYLOAD_CHECKSUM;
     }
 
-    unlockSessionMap();
+    return features;
 }
 
 /**
@@ -245,6 +338,33 @@ SessionHandler::sendMessage(Session* session,
                             const CommonMessageHeader &header,
                             const void* data,
                             const uint64_t size)
+{
+    struct iovec segment;
+    segment.iov_base = const_cast<void*>(data);
+    segment.iov_len = size;
+
+    return sendMessage(session, header, &segment, 1);
+}
+
+/**
+ * @brief do everything for a message, which has to be done before it is written into the
+ *        socket: register it for the timeout of its reply, count it within the metrics and write
+ *        the checksum into its footer. Messages, which are collected by the caller for a common
+ *        write, must be prepared one by one with this function.
+ *
+ * @param session session, where the message should be send
+ * @param header reference to the header of the message
+ * @param segments list of segments, which together form the complete message
+ * @param numberOfSegments number of segments within the list
+ *
+ * @return false, if a checksum is necessary, but the footer is split over multiple segments,
+ *         so the checksum couldn't be written in place, else true
+ */
+bool
+SessionHandler::prepareMessage(Session* session,
+                               const CommonMessageHeader &header,
+                               const struct iovec* segments,
+                               const uint32_t numberOfSegments)
 {
     if(header.flags & 0x1)
     {
@@ -254,7 +374,98 @@ SessionHandler::sendMessage(Session* session,
                                                    session);
     }
 
-    return session->m_socket->sendMessage(data, size);
+    session->m_metrics.addSendMessage(header.type, header.totalMessageSize);
+
+    if(session->m_payloadChecksum == false) {
+        return true;
+    }
+
+    // the footer is written by the library itself at the end of the last segment, so the
+    // checksum is written there directly and the message is send without an additional segment
+    const struct iovec* lastSegment = &segments[numberOfSegments - 1];
+    if(lastSegment->iov_len < sizeof(CommonMessageFooter)) {
+        return false;
+    }
+
+    const uint32_t checksum = getSegmentsChecksum(segments,
+                                                  numberOfSegments,
+                                                  sizeof(CommonMessageHeader),
+                                                  header.totalMessageSize
+                                                  - sizeof(CommonMessageFooter));
+    uint8_t* footerPos = static_cast<uint8_t*>(lastSegment->iov_base)
+                         + lastSegment->iov_len
+                         - sizeof(CommonMessageFooter);
+    memcpy(footerPos + offsetof(CommonMessageFooter, additionalValues),
+           &checksum,
+           sizeof(uint32_t));
+
+    return true;
+}
+
+/**
+ * @brief send message, which is split into multiple segments (for example header, payload and
+ *        footer), over the socket of the session without building the complete message first
+ *
+ * @param session session, where the message should be send
+ * @param header reference to the header of the message
+ * @param segments list of segments, which together form the complete message
+ * @param numberOfSegments number of segments within the list
+ *
+ * @return true, if successful, else false
+ */
+bool
+SessionHandler::sendMessage(Session* session,
+                            const CommonMessageHeader &header,
+                            const struct iovec* segments,
+                            const uint32_t numberOfSegments)
+{
+    const bool prepared = prepareMessage(session, header, segments, numberOfSegments);
+
+    // only stream-messages are allowed to be collected within the coalescing-buffer
+    const bool coalesce = header.type == STREAM_DATA_TYPE
+                          && header.subType == DATA_STREAM_STATIC_SUBTYPE;
+
+    // all small messages except the payload-messages are sent in front of bulk-data, but small
+    // responses too, because there is a timeout waiting for them
+    const bool isPayload = coalesce
+                           || (header.type == SINGLEBLOCK_DATA_TYPE
+                               && header.subType == DATA_SINGLE_DATA_SUBTYPE
+                               && (header.flags & 0x8) == 0)
+                           || (header.type == MULTIBLOCK_DATA_TYPE
+                               && header.subType == DATA_MULTI_STATIC_SUBTYPE);
+    const bool control = isPayload == false
+                         && header.totalMessageSize <= SEND_BUFFER_SIZE;
+
+    if(prepared) {
+        return session->sendSegments(segments, numberOfSegments, coalesce, control);
+    }
+
+    // the footer is split over multiple segments, so it is replaced by a new footer
+    assert(numberOfSegments <= 3);
+    const uint64_t footerBegin = header.totalMessageSize - sizeof(CommonMessageFooter);
+    CommonMessageFooter footer;
+    footer.additionalValues = getSegmentsChecksum(segments,
+                                                  numberOfSegments,
+                                                  sizeof(CommonMessageHeader),
+                                                  footerBegin);
+
+    struct iovec checksumSegments[4];
+    uint32_t numberOfChecksumSegments = 0;
+    uint64_t position = 0;
+    for(uint32_t i = 0; i < numberOfSegments && position < footerBegin; i++)
+    {
+        checksumSegments[numberOfChecksumSegments] = segments[i];
+        if(position + segments[i].iov_len > footerBegin) {
+            checksumSegments[numberOfChecksumSegments].iov_len = footerBegin - position;
+        }
+        position += segments[i].iov_len;
+        numberOfChecksumSegments++;
+    }
+    checksumSegments[numberOfChecksumSegments].iov_base = &footer;
+    checksumSegments[numberOfChecksumSegments].iov_len = sizeof(CommonMessageFooter);
+    numberOfChecksumSegments++;
+
+    return session->sendSegments(checksumSegments, numberOfChecksumSegments, coalesce, control);
 }
 
 } // namespace Sakura
@@ -27,7 +27,12 @@
 #include <vector>
 #include <map>
 #include <atomic>
+#include <mutex>
+#include <sys/uio.h>
 #include <message_definitions.h>
+#include <handler/session_registry.h>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
 
 namespace Kitsunemimi
 {
@@ -39,7 +44,22 @@ namespace Sakura
 class Session;
 class ReplyHandler;
 class MessageBlockerHandler;
+class CoalescingHandler;
+class BufferPool;
+class CallbackDispatcher;
+class HeartbeatHandler;
+class IoEngine;
+class SessionPool;
+class MetricsRecorder;
 class SessionController;
+class SharedMemoryServer;
+
+// settings of a server, which are given to the sessions of its incoming connections
+struct ServerContext
+{
+    std::mutex mutex;
+    AffinityPolicy affinity;
+};
 
 class SessionHandler
 {
@@ -47,6 +67,13 @@ public:
 
     static Kitsunemimi::Sakura::ReplyHandler* m_replyHandler;
     static Kitsunemimi::Sakura::MessageBlockerHandler* m_blockerHandler;
+    static Kitsunemimi::Sakura::CoalescingHandler* m_coalescingHandler;
+    static Kitsunemimi::Sakura::BufferPool* m_bufferPool;
+    static Kitsunemimi::Sakura::CallbackDispatcher* m_callbackDispatcher;
+    static Kitsunemimi::Sakura::HeartbeatHandler* m_heartbeatHandler;
+    static Kitsunemimi::Sakura::IoEngine* m_ioEngine;
+    static Kitsunemimi::Sakura::SessionPool* m_sessionPool;
+    static Kitsunemimi::Sakura::MetricsRecorder* m_globalMetrics;
     static Kitsunemimi::Sakura::SessionController* m_sessionController;
     static Kitsunemimi::Sakura::SessionHandler* m_sessionHandler;
 
@@ -56,32 +83,57 @@ public:
     ~SessionHandler();
 
     // session-control
-    void addSession(const uint32_t id, Session* session);
+    bool addSession(const uint32_t id, Session* session);
     Session* removeSession(const uint32_t id);
-    void sendHeartBeats();
+    Session* getSession(const uint32_t id) const;
+    std::vector<Session*> getAllSessions() const;
+    void removeAllSessions();
 
     // counter
     uint16_t increaseSessionIdCounter();
+    uint16_t getLocalSessionId();
 
-    void lockSessionMap();
-    void unlockSessionMap();
     void lockServerMap();
     void unlockServerMap();
 
     // object-holder
-    std::map<uint32_t, Session*> m_sessions;
     std::map<uint32_t, Network::AbstractServer*> m_servers;
+    std::map<uint32_t, SharedMemoryServer*> m_sharedMemoryServers;
+    std::map<uint32_t, ServerContext*> m_serverContexts;
+
+    // affinity of the threads, which are shared by all sessions, and default for all sessions
+    std::atomic<uint64_t> m_globalAffinityVersion;
+    void setGlobalAffinity(const AffinityPolicy &policy);
+    AffinityPolicy getGlobalAffinity(uint64_t &version);
+
+    // compression of payloads for new sessions
+    std::atomic<bool> m_compressionEnabled;
+    std::atomic<bool> m_streamFlowControlEnabled;
+    std::atomic<bool> m_payloadChecksumEnabled;
+    std::atomic<uint32_t> m_compressionThreshold;
+    uint32_t getSupportedFeatures() const;
 
     bool sendMessage(Session *session,
                      const CommonMessageHeader &header,
                      const void* data,
                      const uint64_t size);
+    bool sendMessage(Session *session,
+                     const CommonMessageHeader &header,
+                     const struct iovec* segments,
+                     const uint32_t numberOfSegments);
+    bool prepareMessage(Session *session,
+                        const CommonMessageHeader &header,
+                        const struct iovec* segments,
+                        const uint32_t numberOfSegments);
 private:
+    SessionRegistry m_sessions;
+
     // counter
-    uint16_t m_sessionIdCounter = 0;
-    std::atomic_flag m_sessionMap_lock = ATOMIC_FLAG_INIT;
+    std::atomic<uint16_t> m_sessionIdCounter;
     std::atomic_flag m_serverMap_lock = ATOMIC_FLAG_INIT;
-    std::atomic_flag m_sessionIdCounter_lock = ATOMIC_FLAG_INIT;
+
+    std::mutex m_affinityMutex;
+    AffinityPolicy m_globalAffinity;
 
     // callbacks
     void (*m_processCreateSession)(Session*, const std::string);
@@ -0,0 +1,453 @@
+/**
+ * @file       session_pool.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include "session_pool.h"
+
+#include <chrono>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+#include <thread_affinity.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor
+ */
+SessionPool::SessionPool() {}
+
+/**
+ * @brief destructor
+ */
+SessionPool::~SessionPool()
+{
+    std::vector<Session*> idleSessions;
+
+    {
+        std::unique_lock<std::mutex> lock(m_poolMutex);
+
+        std::map<std::string, PoolEntry>::iterator it;
+        for(it = m_pools.begin();
+            it != m_pools.end();
+            it++)
+        {
+            idleSessions.insert(idleSessions.end(),
+                                it->second.idleSessions.begin(),
+                                it->second.idleSessions.end());
+        }
+
+        m_pools.clear();
+        m_acquiredSessions.clear();
+    }
+
+    closeSessions(idleSessions);
+}
+
+/**
+ * @brief add a pool for a target, which is filled in the background with ready sessions
+ *
+ * @param target transport and address of the server
+ * @param numberOfSessions number of ready sessions, which are kept for the target
+ *
+ * @return false, if number of sessions is 0, else true
+ */
+bool
+SessionPool::addPool(const SessionTarget &target,
+                     const uint32_t numberOfSessions)
+{
+    if(numberOfSessions == 0) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_poolMutex);
+
+    // an existing pool only gets the new size
+    PoolEntry* entry = &m_pools[getKey(target)];
+    entry->target = target;
+    entry->numberOfSessions = numberOfSessions;
+
+    m_poolCv.notify_one();
+
+    return true;
+}
+
+/**
+ * @brief remove the pool of a target and close its ready sessions. Sessions, which are in use,
+ *        are closed, when they are given back.
+ *
+ * @param target transport and address of the server
+ *
+ * @return false, if there is no pool for the target, else true
+ */
+bool
+SessionPool::removePool(const SessionTarget &target)
+{
+    std::vector<Session*> idleSessions;
+
+    {
+        std::unique_lock<std::mutex> lock(m_poolMutex);
+
+        std::map<std::string, PoolEntry>::iterator it;
+        it = m_pools.find(getKey(target));
+        if(it == m_pools.end()) {
+            return false;
+        }
+
+        idleSessions.assign(it->second.idleSessions.begin(), it->second.idleSessions.end());
+        m_pools.erase(it);
+    }
+
+    closeSessions(idleSessions);
+
+    return true;
+}
+
+/**
+ * @brief take a ready session of the pool. If there is no ready session left, a new one is
+ *        started directly by the calling thread.
+ *
+ * @param target transport and address of the server
+ *
+ * @return session, which has to be given back with releaseSession, or nullptr, if there is
+ *         no pool for the target or the session could not be started
+ */
+Session*
+SessionPool::acquireSession(const SessionTarget &target)
+{
+    const std::string key = getKey(target);
+    std::vector<Session*> unhealthySessions;
+    Session* session = nullptr;
+
+    {
+        std::unique_lock<std::mutex> lock(m_poolMutex);
+
+        std::map<std::string, PoolEntry>::iterator it;
+        it = m_pools.find(key);
+        if(it == m_pools.end()) {
+            return nullptr;
+        }
+
+        // skip sessions, which were closed by the other side in the meantime
+        std::deque<Session*>* idleSessions = &it->second.idleSessions;
+        while(idleSessions->empty() == false
+              && session == nullptr)
+        {
+            Session* candidate = idleSessions->front();
+            idleSessions->pop_front();
+            if(candidate->isHealthy()) {
+                session = candidate;
+            } else {
+                unhealthySessions.push_back(candidate);
+            }
+        }
+        m_stats.numberOfDiscardedSessions += unhealthySessions.size();
+
+        if(session != nullptr)
+        {
+            m_stats.hits++;
+            m_acquiredSessions.insert(std::make_pair(session, key));
+        }
+        else
+        {
+            m_stats.misses++;
+        }
+
+        // refill the pool in the background
+        m_poolCv.notify_one();
+    }
+
+    closeSessions(unhealthySessions);
+    if(session != nullptr) {
+        return session;
+    }
+
+    // pool is empty, so the caller has to wait for a new session
+    session = startSession(target);
+    if(session != nullptr)
+    {
+        std::unique_lock<std::mutex> lock(m_poolMutex);
+        m_acquiredSessions.insert(std::make_pair(session, key));
+    }
+
+    return session;
+}
+
+/**
+ * @brief give a session back to its pool. The session is only kept, if it is still healthy
+ *        and the pool is not already full, else it is closed.
+ *
+ * @param session session, which was taken by acquireSession
+ *
+ * @return true, if the session was put back into the pool, else false
+ */
+bool
+SessionPool::releaseSession(Session* session)
+{
+    bool keep = false;
+
+    {
+        std::unique_lock<std::mutex> lock(m_poolMutex);
+
+        std::map<Session*, std::string>::iterator acquiredIt;
+        acquiredIt = m_acquiredSessions.find(session);
+        if(acquiredIt == m_acquiredSessions.end()) {
+            return false;
+        }
+
+        std::map<std::string, PoolEntry>::iterator poolIt;
+        poolIt = m_pools.find(acquiredIt->second);
+        m_acquiredSessions.erase(acquiredIt);
+
+        if(poolIt != m_pools.end()
+                && poolIt->second.idleSessions.size() < poolIt->second.numberOfSessions
+                && session->isHealthy())
+        {
+            // used last, so it is given out first again, while it is still warm
+            poolIt->second.idleSessions.push_front(session);
+            keep = true;
+        }
+        else
+        {
+            m_stats.numberOfDiscardedSessions++;
+        }
+    }
+
+    if(keep == false) {
+        session->closeSession();
+    }
+
+    return keep;
+}
+
+/**
+ * @brief get statistics of all pools
+ *
+ * @return object with the number of ready and used sessions and the hits and misses
+ */
+SessionPoolStats
+SessionPool::getStats()
+{
+    std::unique_lock<std::mutex> lock(m_poolMutex);
+
+    SessionPoolStats result = m_stats;
+    result.numberOfPools = m_pools.size();
+    result.numberOfIdleSessions = 0;
+    result.numberOfAcquiredSessions = m_acquiredSessions.size();
+
+    std::map<std::string, PoolEntry>::const_iterator it;
+    for(it = m_pools.begin();
+        it != m_pools.end();
+        it++)
+    {
+        result.numberOfIdleSessions += it->second.idleSessions.size();
+    }
+
+    return result;
+}
+
+/**
+ * @brief thread-loop, which checks the ready sessions and refills the pools
+ */
+void
+SessionPool::run()
+{
+    while(m_abort == false)
+    {
+        applyGlobalAffinity(m_appliedAffinity);
+
+        {
+            std::unique_lock<std::mutex> lock(m_poolMutex);
+            m_poolCv.wait_for(lock, std::chrono::milliseconds(100));
+        }
+
+        removeUnhealthySessions();
+        while(m_abort == false
+              && refillPool())
+        {
+            asm("");
+        }
+    }
+}
+
+/**
+ * @brief create key of the pool of a target
+ *
+ * @param target transport and address of the server
+ *
+ * @return key of the pool
+ */
+std::string
+SessionPool::getKey(const SessionTarget &target)
+{
+    return std::to_string(target.transport)
+           + "|" + target.address
+           + "|" + std::to_string(target.port)
+           + "|" + target.certFile;
+}
+
+/**
+ * @brief start a new session for a target
+ *
+ * @param target transport and address of the server
+ *
+ * @return new session or nullptr, if the session could not be started
+ */
+Session*
+SessionPool::startSession(const SessionTarget &target)
+{
+    SessionController* controller = SessionController::m_sessionController;
+
+    switch(target.transport)
+    {
+        case SessionTarget::UNIX_DOMAIN:
+            return controller->startUnixDomainSession(target.address);
+        case SessionTarget::TCP:
+            return controller->startTcpSession(target.address, target.port);
+        case SessionTarget::TLS_TCP:
+            return controller->startTlsTcpSession(target.address,
+                                                  target.port,
+                                                  target.certFile,
+                                                  target.keyFile);
+        default:
+            break;
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief close sessions outside of the pool-lock
+ *
+ * @param sessions sessions to close
+ */
+void
+SessionPool::closeSessions(const std::vector<Session*> &sessions)
+{
+    for(uint64_t i = 0; i < sessions.size(); i++) {
+        sessions[i]->closeSession();
+    }
+}
+
+/**
+ * @brief remove all ready sessions, which were closed or don't answer the heartbeats anymore
+ */
+void
+SessionPool::removeUnhealthySessions()
+{
+    std::vector<Session*> unhealthySessions;
+
+    {
+        std::unique_lock<std::mutex> lock(m_poolMutex);
+
+        std::map<std::string, PoolEntry>::iterator it;
+        for(it = m_pools.begin();
+            it != m_pools.end();
+            it++)
+        {
+            std::deque<Session*>* idleSessions = &it->second.idleSessions;
+            std::deque<Session*>::iterator sessionIt = idleSessions->begin();
+            while(sessionIt != idleSessions->end())
+            {
+                if((*sessionIt)->isHealthy())
+                {
+                    sessionIt++;
+                    continue;
+                }
+
+                unhealthySessions.push_back(*sessionIt);
+                sessionIt = idleSessions->erase(sessionIt);
+            }
+        }
+
+        m_stats.numberOfDiscardedSessions += unhealthySessions.size();
+    }
+
+    closeSessions(unhealthySessions);
+}
+
+/**
+ * @brief start one new session for the first pool, which has less ready sessions than
+ *        requested. The session is started outside of the lock, because the handshake blocks.
+ *
+ * @return true, if a session was started, else false
+ */
+bool
+SessionPool::refillPool()
+{
+    std::string key = "";
+    SessionTarget target;
+
+    {
+        std::unique_lock<std::mutex> lock(m_poolMutex);
+
+        std::map<std::string, PoolEntry>::iterator it;
+        for(it = m_pools.begin();
+            it != m_pools.end();
+            it++)
+        {
+            PoolEntry* entry = &it->second;
+            if(entry->idleSessions.size() + entry->numberOfStarts < entry->numberOfSessions)
+            {
+                entry->numberOfStarts++;
+                key = it->first;
+                target = entry->target;
+                break;
+            }
+        }
+    }
+
+    if(key == "") {
+        return false;
+    }
+
+    Session* session = startSession(target);
+    const bool started = session != nullptr;
+
+    {
+        std::unique_lock<std::mutex> lock(m_poolMutex);
+
+        std::map<std::string, PoolEntry>::iterator it;
+        it = m_pools.find(key);
+        if(it != m_pools.end())
+        {
+            it->second.numberOfStarts--;
+            if(session != nullptr)
+            {
+                it->second.idleSessions.push_back(session);
+                session = nullptr;
+            }
+        }
+    }
+
+    // pool was removed in the meantime
+    if(session != nullptr) {
+        session->closeSession();
+    }
+
+    // stop refilling until the next check, while the server is not reachable
+    return started;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,87 @@
+/**
+ * @file       session_pool.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef SESSION_POOL_H
+#define SESSION_POOL_H
+
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include <libKitsunemimiCommon/threading/thread.h>
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+
+class SessionPool : public Kitsunemimi::Thread
+{
+public:
+    SessionPool();
+    ~SessionPool();
+
+    bool addPool(const SessionTarget &target,
+                 const uint32_t numberOfSessions);
+    bool removePool(const SessionTarget &target);
+
+    Session* acquireSession(const SessionTarget &target);
+    bool releaseSession(Session* session);
+
+    SessionPoolStats getStats();
+
+protected:
+    void run();
+
+private:
+    uint64_t m_appliedAffinity = 0;
+    struct PoolEntry
+    {
+        SessionTarget target;
+        uint32_t numberOfSessions = 0;
+        uint32_t numberOfStarts = 0;
+        std::deque<Session*> idleSessions;
+    };
+
+    std::mutex m_poolMutex;
+    std::condition_variable m_poolCv;
+    std::map<std::string, PoolEntry> m_pools;
+    std::map<Session*, std::string> m_acquiredSessions;
+    SessionPoolStats m_stats;
+
+    static std::string getKey(const SessionTarget &target);
+    static Session* startSession(const SessionTarget &target);
+    void closeSessions(const std::vector<Session*> &sessions);
+
+    void removeUnhealthySessions();
+    bool refillPool();
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // SESSION_POOL_H
@@ -0,0 +1,260 @@
+/**
+ * @file       session_registry.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include <handler/session_registry.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor
+ */
+SessionRegistry::SessionRegistry()
+{
+    for(uint32_t i = 0; i < NUMBER_OF_SESSION_SHARDS; i++) {
+        m_shards[i].sessions = std::make_shared<const SessionMap>();
+    }
+}
+
+/**
+ * @brief destructor
+ */
+SessionRegistry::~SessionRegistry() {}
+
+/**
+ * @brief add a session to the registry. Only the shard of the id is blocked for other
+ *        write-access, while the readers continue to use the old version of the shard.
+ *
+ * @param id id of the session
+ * @param session pointer to the session
+ *
+ * @return false, if id is already registered, else true
+ */
+bool
+SessionRegistry::addSession(const uint32_t id,
+                            Session* session)
+{
+    bool result = false;
+    Shard* shard = getShard(id);
+    while(shard->writeLock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::shared_ptr<const SessionMap> current = std::atomic_load(&shard->sessions);
+    if(current->find(id) == current->end())
+    {
+        // copy shard, modify the copy and publish it for new readers
+        std::shared_ptr<SessionMap> updated = std::make_shared<SessionMap>(*current);
+        updated->insert(std::make_pair(id, session));
+        std::atomic_store(&shard->sessions, std::shared_ptr<const SessionMap>(updated));
+        result = true;
+    }
+
+    shard->writeLock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief remove a session from the registry
+ *
+ * @param id id of the session
+ *
+ * @return pointer to the removed session, if found, else nullptr
+ */
+Session*
+SessionRegistry::removeSession(const uint32_t id)
+{
+    Session* result = nullptr;
+    Shard* shard = getShard(id);
+    while(shard->writeLock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::shared_ptr<const SessionMap> current = std::atomic_load(&shard->sessions);
+    SessionMap::const_iterator it = current->find(id);
+    if(it != current->end())
+    {
+        result = it->second;
+
+        // copy shard, modify the copy and publish it for new readers
+        std::shared_ptr<SessionMap> updated = std::make_shared<SessionMap>(*current);
+        updated->erase(id);
+        std::atomic_store(&shard->sessions, std::shared_ptr<const SessionMap>(updated));
+    }
+
+    shard->writeLock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief get a session from the registry without blocking the writers
+ *
+ * @param id id of the session
+ *
+ * @return pointer to the session, if found, else nullptr
+ */
+Session*
+SessionRegistry::getSession(const uint32_t id) const
+{
+    const std::shared_ptr<const SessionMap> current = std::atomic_load(&getShard(id)->sessions);
+
+    SessionMap::const_iterator it = current->find(id);
+    if(it != current->end()) {
+        return it->second;
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief check if an id is registered
+ *
+ * @param id id to check
+ *
+ * @return true, if id is in use, else false
+ */
+bool
+SessionRegistry::contains(const uint32_t id) const
+{
+    const std::shared_ptr<const SessionMap> current = std::atomic_load(&getShard(id)->sessions);
+    return current->find(id) != current->end();
+}
+
+/**
+ * @brief check if the lower 16 bit of any registered id, which are the part of the id, that was
+ *        assigned by the client-side of the session, are equal to a specific value
+ *
+ * @param localPart value to check
+ *
+ * @return true, if the value is in use, else false
+ */
+bool
+SessionRegistry::containsLocalPart(const uint16_t localPart) const
+{
+    for(uint32_t i = 0; i < NUMBER_OF_SESSION_SHARDS; i++)
+    {
+        const std::shared_ptr<const SessionMap> current = std::atomic_load(&m_shards[i].sessions);
+
+        SessionMap::const_iterator it;
+        for(it = current->begin();
+            it != current->end();
+            it++)
+        {
+            if((it->first & 0xFFFF) == localPart) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief get a snapshot of all registered sessions. Sessions, which are added or removed while
+ *        collecting the snapshot, are maybe not part of the result.
+ *
+ * @return list with all sessions
+ */
+std::vector<Session*>
+SessionRegistry::getAllSessions() const
+{
+    std::vector<Session*> result;
+
+    for(uint32_t i = 0; i < NUMBER_OF_SESSION_SHARDS; i++)
+    {
+        const std::shared_ptr<const SessionMap> current = std::atomic_load(&m_shards[i].sessions);
+
+        SessionMap::const_iterator it;
+        for(it = current->begin();
+            it != current->end();
+            it++)
+        {
+            result.push_back(it->second);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief get number of registered sessions
+ *
+ * @return number of sessions
+ */
+uint64_t
+SessionRegistry::size() const
+{
+    uint64_t result = 0;
+
+    for(uint32_t i = 0; i < NUMBER_OF_SESSION_SHARDS; i++) {
+        result += std::atomic_load(&m_shards[i].sessions)->size();
+    }
+
+    return result;
+}
+
+/**
+ * @brief remove all sessions from the registry
+ */
+void
+SessionRegistry::clear()
+{
+    for(uint32_t i = 0; i < NUMBER_OF_SESSION_SHARDS; i++)
+    {
+        Shard* shard = &m_shards[i];
+        while(shard->writeLock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+        std::atomic_store(&shard->sessions, std::make_shared<const SessionMap>());
+
+        shard->writeLock.clear(std::memory_order_release);
+    }
+}
+
+/**
+ * @brief get shard of a session-id
+ *
+ * @param id session-id
+ *
+ * @return pointer to the shard
+ */
+SessionRegistry::Shard*
+SessionRegistry::getShard(const uint32_t id)
+{
+    return &m_shards[id % NUMBER_OF_SESSION_SHARDS];
+}
+
+/**
+ * @brief get shard of a session-id
+ *
+ * @param id session-id
+ *
+ * @return pointer to the shard
+ */
+const SessionRegistry::Shard*
+SessionRegistry::getShard(const uint32_t id) const
+{
+    return &m_shards[id % NUMBER_OF_SESSION_SHARDS];
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
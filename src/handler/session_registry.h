@@ -0,0 +1,75 @@
+/**
+ * @file       session_registry.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef SESSION_REGISTRY_H
+#define SESSION_REGISTRY_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+
+// number of independent parts of the registry, which have their own lock for write-access
+#define NUMBER_OF_SESSION_SHARDS 64
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+
+class SessionRegistry
+{
+public:
+    SessionRegistry();
+    ~SessionRegistry();
+
+    bool addSession(const uint32_t id, Session* session);
+    Session* removeSession(const uint32_t id);
+    Session* getSession(const uint32_t id) const;
+    bool contains(const uint32_t id) const;
+    bool containsLocalPart(const uint16_t localPart) const;
+
+    std::vector<Session*> getAllSessions() const;
+    uint64_t size() const;
+    void clear();
+
+private:
+    typedef std::unordered_map<uint32_t, Session*> SessionMap;
+
+    struct Shard
+    {
+        std::atomic_flag writeLock = ATOMIC_FLAG_INIT;
+        std::shared_ptr<const SessionMap> sessions;
+    };
+
+    Shard m_shards[NUMBER_OF_SESSION_SHARDS];
+
+    Shard* getShard(const uint32_t id);
+    const Shard* getShard(const uint32_t id) const;
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // SESSION_REGISTRY_H
@@ -40,7 +40,41 @@ namespace Sakura
 
 #define MESSAGE_DELIMITER 1314472257
 #define MESSAGE_CACHE_SIZE (1024*1024)
+// max length of the text of an error-message
+#define MAX_ERROR_MESSAGE_SIZE 4096
 #define MAX_SINGLE_MESSAGE_SIZE (128*1024)
+#define SEND_BUFFER_SIZE (16*1024)
+// max number of additional connections of a session for parts of multiblock-messages and the
+// max time in milliseconds to wait for the confirmation of a new connection by the server
+#define MAX_NUMBER_OF_STRIPES 15
+#define STRIPE_CONFIRM_TIMEOUT 1000
+// max time in milliseconds, which an incoming message waits after its finish for the missing
+// parts over the additional connections, before it is dropped as incomplete
+#define DEFERRED_FINISH_TIMEOUT 10000
+// space in front of the payload of reserved messages, which is big enough for the headers of
+// stream- and singleblock-messages, and space behind the payload for padding and footer
+#define MESSAGE_HEADER_RESERVE 48
+#define MESSAGE_TAIL_RESERVE 16
+
+// flag within the header to mark compressed payloads
+#define COMPRESSED_PAYLOAD_FLAG 0x10
+
+// features, which are negotiated by the additional-values of the session-init-messages
+#define SESSION_FEATURE_COMPRESSION 0x1
+#define SESSION_FEATURE_STREAM_FLOW_CONTROL 0x2
+#define SESSION_FEATURE_PAYLOAD_CHECKSUM 0x4
+
+// initial credits in bytes for stream-messages, which always fit into the ring-buffer of the
+// receiver, and the number of consumed bytes, after which the receiver grants new credits
+#define STREAM_CREDIT_WINDOW (1024*1024)
+#define STREAM_CREDIT_THRESHOLD (STREAM_CREDIT_WINDOW / 4)
+// max time in milliseconds, which a stream-message waits for new credits
+#define STREAM_CREDIT_TIMEOUT 10000
+
+// max number of parts of a chunk-streamed multiblock-message, which are send without
+// acknowledgement of the receiver, and the number of parts after which the receiver acknowledges
+#define MULTIBLOCK_PART_WINDOW 32
+#define MULTIBLOCK_PART_ACK_INTERVAL (MULTIBLOCK_PART_WINDOW / 4)
 
 enum types
 {
@@ -60,6 +94,8 @@ enum session_subTypes
 
     SESSION_CLOSE_START_SUBTYPE = 3,
     SESSION_CLOSE_REPLY_SUBTYPE = 4,
+    SESSION_STRIPE_START_SUBTYPE = 5,
+    SESSION_STRIPE_REPLY_SUBTYPE = 6,
 };
 
 enum heartbeat_subTypes
@@ -79,6 +115,7 @@ enum stream_data_subTypes
 {
     DATA_STREAM_STATIC_SUBTYPE = 1,
     DATA_STREAM_REPLY_SUBTYPE = 2,
+    DATA_STREAM_CREDIT_SUBTYPE = 3,
 };
 
 enum singleblock_data_subTypes
@@ -95,6 +132,7 @@ enum multiblock_data_subTypes
     DATA_MULTI_FINISH_SUBTYPE = 4,
     DATA_MULTI_ABORT_INIT_SUBTYPE = 5,
     DATA_MULTI_ABORT_REPLY_SUBTYPE = 6,
+    DATA_MULTI_PART_ACK_SUBTYPE = 7,
 };
 
 //==================================================================================================
@@ -110,8 +148,12 @@ struct CommonMessageHeader
     uint8_t type = 0;
     uint8_t subType = 0;
     uint8_t flags = 0;   // 0x1 = reply required; 0x2 = is reply;
-                         // 0x4 = is request; 0x8 = is response
-    uint32_t additionalValues = 0;  // not used at the momment
+                         // 0x4 = is request; 0x8 = is response;
+                         // 0x10 = payload is compressed
+    uint32_t additionalValues = 0;  // session-init: supported features (SESSION_FEATURE_*);
+                                    // compressed payload: uncompressed payload-size
+                                    // stream and heartbeat: granted stream-credits in bytes
+                                    // multiblock-init-reply: window of unacknowledged parts
     uint32_t sessionId = 0;
     uint32_t messageId = 0;
     uint32_t totalMessageSize = 0;
@@ -125,10 +167,25 @@ struct CommonMessageHeader
  */
 struct CommonMessageFooter
 {
-    uint32_t additionalValues = 0;  // not used at the momment
+    uint32_t additionalValues = 0;  // crc32c behind the common header, if negotiated
     const uint32_t delimiter = MESSAGE_DELIMITER;
 } __attribute__((packed));
 
+/**
+ * @brief CommonMessageTail
+ *
+ * padding and footer, which are send together as last segment behind the payload of a message.
+ * Only the last padding-bytes, which are required to fill the payload up to a multiple of 8,
+ * are used as begin of the segment.
+ *
+ * tail-size = 16
+ */
+struct CommonMessageTail
+{
+    uint8_t padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    CommonMessageFooter commonEnd;
+} __attribute__((packed));
+
 //==================================================================================================
 
 /**
@@ -163,6 +220,7 @@ struct Session_Init_Reply_Message
     char sessionIdentifier[64];
     uint32_t sessionIdentifierSize = 0;
     uint8_t padding[4];
+    uint64_t stripeToken = 0;
     CommonMessageFooter commonEnd;
 
     Session_Init_Reply_Message()
@@ -216,40 +274,45 @@ struct Session_Close_Reply_Message
 
 } __attribute__((packed));
 
-//==================================================================================================
-
 /**
- * @brief Heartbeat_Start_Message
+ * @brief Session_Stripe_Start_Message
+ *
+ * first message over an additional connection, which binds the connection to an existing
+ * session to send parts of multiblock-messages over it
  */
-struct Heartbeat_Start_Message
+struct Session_Stripe_Start_Message
 {
     CommonMessageHeader commonHeader;
+    uint32_t sessionId = 0;
+    uint32_t stripeId = 0;
+    uint64_t stripeToken = 0;
     CommonMessageFooter commonEnd;
 
-    Heartbeat_Start_Message()
+    Session_Stripe_Start_Message()
     {
-        commonHeader.type = HEARTBEAT_TYPE;
-        commonHeader.subType = HEARTBEAT_START_SUBTYPE;
-        commonHeader.flags = 0x1;
-        commonHeader.totalMessageSize = sizeof(Heartbeat_Start_Message);
+        commonHeader.type = SESSION_TYPE;
+        commonHeader.subType = SESSION_STRIPE_START_SUBTYPE;
+        commonHeader.totalMessageSize = sizeof(Session_Stripe_Start_Message);
     }
 
 } __attribute__((packed));
 
 /**
- * @brief Heartbeat_Reply_Message
+ * @brief Session_Stripe_Reply_Message
  */
-struct Heartbeat_Reply_Message
+struct Session_Stripe_Reply_Message
 {
     CommonMessageHeader commonHeader;
+    uint32_t sessionId = 0;
+    uint32_t stripeId = 0;
     CommonMessageFooter commonEnd;
 
-    Heartbeat_Reply_Message()
+    Session_Stripe_Reply_Message()
     {
-        commonHeader.type = HEARTBEAT_TYPE;
-        commonHeader.subType = HEARTBEAT_REPLY_SUBTYPE;
+        commonHeader.type = SESSION_TYPE;
+        commonHeader.subType = SESSION_STRIPE_REPLY_SUBTYPE;
         commonHeader.flags = 0x2;
-        commonHeader.totalMessageSize = sizeof(Heartbeat_Reply_Message);
+        commonHeader.totalMessageSize = sizeof(Session_Stripe_Reply_Message);
     }
 
 } __attribute__((packed));
@@ -257,59 +320,60 @@ struct Heartbeat_Reply_Message
 //==================================================================================================
 
 /**
- * @brief Error_FalseVersion_Message
+ * @brief Heartbeat_Start_Message
  */
-struct Error_FalseVersion_Message
+struct Heartbeat_Start_Message
 {
     CommonMessageHeader commonHeader;
-    uint64_t messageSize = 0;
-    char message[MESSAGE_CACHE_SIZE];
     CommonMessageFooter commonEnd;
 
-    Error_FalseVersion_Message()
+    Heartbeat_Start_Message()
     {
-        commonHeader.type = ERROR_TYPE;
-        commonHeader.subType = ERROR_FALSE_VERSION_SUBTYPE;
-        commonHeader.totalMessageSize = sizeof(Error_FalseVersion_Message);
+        commonHeader.type = HEARTBEAT_TYPE;
+        commonHeader.subType = HEARTBEAT_START_SUBTYPE;
+        // no entry in the reply-handler, because the liveness is checked by the heartbeat-handler
+        commonHeader.flags = 0x0;
+        commonHeader.totalMessageSize = sizeof(Heartbeat_Start_Message);
     }
 
 } __attribute__((packed));
 
 /**
- * @brief Error_UnknownSession_Message
+ * @brief Heartbeat_Reply_Message
  */
-struct Error_UnknownSession_Message
+struct Heartbeat_Reply_Message
 {
     CommonMessageHeader commonHeader;
-    uint64_t messageSize = 0;
-    char message[MESSAGE_CACHE_SIZE];
     CommonMessageFooter commonEnd;
 
-    Error_UnknownSession_Message()
+    Heartbeat_Reply_Message()
     {
-        commonHeader.type = ERROR_TYPE;
-        commonHeader.subType = ERROR_UNKNOWN_SESSION_SUBTYPE;
-        commonHeader.totalMessageSize = sizeof(Error_UnknownSession_Message);
+        commonHeader.type = HEARTBEAT_TYPE;
+        commonHeader.subType = HEARTBEAT_REPLY_SUBTYPE;
+        commonHeader.flags = 0x2;
+        commonHeader.totalMessageSize = sizeof(Heartbeat_Reply_Message);
     }
 
 } __attribute__((packed));
 
+//==================================================================================================
 
 /**
- * @brief Error_InvalidMessage_Message
+ * @brief Error_Message_Header
+ *
+ * header of all error-messages, which is followed by the text of the error, padding and footer,
+ * so each message is only as big as its text
+ *
+ * header-size = 32
  */
-struct Error_InvalidMessage_Message
+struct Error_Message_Header
 {
     CommonMessageHeader commonHeader;
     uint64_t messageSize = 0;
-    char message[MESSAGE_CACHE_SIZE];
-    CommonMessageFooter commonEnd;
 
-    Error_InvalidMessage_Message()
+    Error_Message_Header()
     {
         commonHeader.type = ERROR_TYPE;
-        commonHeader.subType = ERROR_INVALID_MESSAGE_SUBTYPE;
-        commonHeader.totalMessageSize = sizeof(Error_InvalidMessage_Message);
     }
 
 } __attribute__((packed));
@@ -349,6 +413,23 @@ struct Data_StreamReply_Message
 
 } __attribute__((packed));
 
+/**
+ * @brief Data_StreamCredit_Message
+ */
+struct Data_StreamCredit_Message
+{
+    CommonMessageHeader commonHeader;
+    CommonMessageFooter commonEnd;
+
+    Data_StreamCredit_Message()
+    {
+        commonHeader.type = STREAM_DATA_TYPE;
+        commonHeader.subType = DATA_STREAM_CREDIT_SUBTYPE;
+        commonHeader.totalMessageSize = sizeof(Data_StreamCredit_Message);
+    }
+
+} __attribute__((packed));
+
 //==================================================================================================
 
 /**
@@ -512,8 +593,73 @@ struct Data_MultiAbortReply_Message
 
 } __attribute__((packed));
 
+/**
+ * @brief Data_MultiPartAck_Message
+ */
+struct Data_MultiPartAck_Message
+{
+    CommonMessageHeader commonHeader;
+    uint64_t multiblockId = 0;
+    uint32_t numberOfProcessedParts = 0;
+    uint8_t padding[4];
+    CommonMessageFooter commonEnd;
+
+    Data_MultiPartAck_Message()
+    {
+        commonHeader.type = MULTIBLOCK_DATA_TYPE;
+        commonHeader.subType = DATA_MULTI_PART_ACK_SUBTYPE;
+        commonHeader.totalMessageSize = sizeof(Data_MultiPartAck_Message);
+    }
+
+} __attribute__((packed));
+
 //==================================================================================================
 
+// check if messages have the size of a multiple of 8
+static_assert(sizeof(CommonMessageHeader) % 8 == 0, "invalid size of CommonMessageHeader");
+static_assert(sizeof(CommonMessageFooter) % 8 == 0, "invalid size of CommonMessageFooter");
+static_assert(sizeof(Session_Init_Start_Message) % 8 == 0,
+              "invalid size of Session_Init_Start_Message");
+static_assert(sizeof(Session_Init_Reply_Message) % 8 == 0,
+              "invalid size of Session_Init_Reply_Message");
+static_assert(sizeof(Session_Close_Start_Message) % 8 == 0,
+              "invalid size of Session_Close_Start_Message");
+static_assert(sizeof(Session_Close_Reply_Message) % 8 == 0,
+              "invalid size of Session_Close_Reply_Message");
+static_assert(sizeof(Session_Stripe_Start_Message) % 8 == 0,
+              "invalid size of Session_Stripe_Start_Message");
+static_assert(sizeof(Session_Stripe_Reply_Message) % 8 == 0,
+              "invalid size of Session_Stripe_Reply_Message");
+static_assert(sizeof(Heartbeat_Start_Message) % 8 == 0,
+              "invalid size of Heartbeat_Start_Message");
+static_assert(sizeof(Heartbeat_Reply_Message) % 8 == 0,
+              "invalid size of Heartbeat_Reply_Message");
+static_assert(sizeof(Error_Message_Header) % 8 == 0,
+              "invalid size of Error_Message_Header");
+static_assert(sizeof(Data_StreamReply_Message) % 8 == 0,
+              "invalid size of Data_StreamReply_Message");
+static_assert(sizeof(Data_StreamCredit_Message) % 8 == 0,
+              "invalid size of Data_StreamCredit_Message");
+static_assert(sizeof(Data_SingleBlockReply_Message) % 8 == 0,
+              "invalid size of Data_SingleBlockReply_Message");
+static_assert(sizeof(Data_MultiInit_Message) % 8 == 0,
+              "invalid size of Data_MultiInit_Message");
+static_assert(sizeof(Data_MultiInitReply_Message) % 8 == 0,
+              "invalid size of Data_MultiInitReply_Message");
+static_assert(sizeof(Data_MultiFinish_Message) % 8 == 0,
+              "invalid size of Data_MultiFinish_Message");
+static_assert(sizeof(Data_MultiAbortInit_Message) % 8 == 0,
+              "invalid size of Data_MultiAbortInit_Message");
+static_assert(sizeof(Data_MultiPartAck_Message) % 8 == 0,
+              "invalid size of Data_MultiPartAck_Message");
+
+// headers of reserved messages are written in front of the payload
+static_assert(sizeof(Data_Stream_Header) <= MESSAGE_HEADER_RESERVE,
+              "Data_Stream_Header doesn't fit into the reserved space");
+static_assert(sizeof(Data_SingleBlock_Header) <= MESSAGE_HEADER_RESERVE,
+              "Data_SingleBlock_Header doesn't fit into the reserved space");
+static_assert(MESSAGE_HEADER_RESERVE % 8 == 0, "invalid size of MESSAGE_HEADER_RESERVE");
+
 } // namespace Sakura
 } // namespace Kitsunemimi
 
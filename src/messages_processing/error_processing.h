@@ -43,7 +43,8 @@ namespace Sakura
 {
 
 /**
- * @brief send error-message to the other side
+ * @brief send error-message to the other side. The message is only as big as its text, which is
+ *        cut at MAX_ERROR_MESSAGE_SIZE.
  *
  * @param session pointer to the session
  * @param errorCode error-code enum to automatic identify the error-message by code
@@ -56,87 +57,56 @@ send_ErrorMessage(Session* session,
 {
     LOG_DEBUG("SEND error message");
 
+    Error_Message_Header header;
     switch(errorCode)
     {
-        //------------------------------------------------------------------------------------------
         case Session::errorCodes::FALSE_VERSION:
-        {
-            Error_FalseVersion_Message message;
-
-            // fill message
-            message.commonHeader.sessionId = session->sessionId();
-            message.commonHeader.messageId = session->increaseMessageIdCounter();
-            message.messageSize = errorMessage.size();
-
-            // check and copy message-content
-            if(message.messageSize > MAX_SINGLE_MESSAGE_SIZE-1) {
-                message.messageSize = MAX_SINGLE_MESSAGE_SIZE-1;
-            }
-            strncpy(message.message,
-                    errorMessage.c_str(),
-                    message.messageSize);
-
-            // send
-            SessionHandler::m_sessionHandler->sendMessage(session,
-                                                          message.commonHeader,
-                                                          &message,
-                                                          sizeof(message));
+            header.commonHeader.subType = ERROR_FALSE_VERSION_SUBTYPE;
             break;
-        }
-        //------------------------------------------------------------------------------------------
         case Session::errorCodes::UNKNOWN_SESSION:
-        {
-            Error_UnknownSession_Message message;
-
-            // fill message
-            message.commonHeader.sessionId = session->sessionId();
-            message.commonHeader.messageId = session->increaseMessageIdCounter();
-            message.messageSize = errorMessage.size();
-
-            // check and copy message-content
-            if(message.messageSize > MAX_SINGLE_MESSAGE_SIZE-1) {
-                message.messageSize = MAX_SINGLE_MESSAGE_SIZE-1;
-            }
-            strncpy(message.message,
-                    errorMessage.c_str(),
-                    message.messageSize);
-
-            // send
-            SessionHandler::m_sessionHandler->sendMessage(session,
-                                                          message.commonHeader,
-                                                          &message,
-                                                          sizeof(message));
+            header.commonHeader.subType = ERROR_UNKNOWN_SESSION_SUBTYPE;
             break;
-        }
-        //------------------------------------------------------------------------------------------
         case Session::errorCodes::INVALID_MESSAGE_SIZE:
-        {
-            Error_InvalidMessage_Message message;
-
-            // fill message
-            message.commonHeader.sessionId = session->sessionId();
-            message.commonHeader.messageId = session->increaseMessageIdCounter();
-            message.messageSize = errorMessage.size();
-
-            // check and copy message-content
-            if(message.messageSize > MAX_SINGLE_MESSAGE_SIZE-1) {
-                message.messageSize = MAX_SINGLE_MESSAGE_SIZE-1;
-            }
-            strncpy(message.message,
-                    errorMessage.c_str(),
-                    message.messageSize);
-
-            // send
-            SessionHandler::m_sessionHandler->sendMessage(session,
-                                                          message.commonHeader,
-                                                          &message,
-                                                          sizeof(message));
+            header.commonHeader.subType = ERROR_INVALID_MESSAGE_SUBTYPE;
             break;
-        }
-        //------------------------------------------------------------------------------------------
         default:
-            break;
+            return;
+    }
+
+    uint32_t size = static_cast<uint32_t>(errorMessage.size());
+    if(size > MAX_ERROR_MESSAGE_SIZE) {
+        size = MAX_ERROR_MESSAGE_SIZE;
     }
+
+    // bring message-size to a multiple of 8
+    const uint32_t padding = (8 - (size % 8)) % 8;
+    const uint32_t totalMessageSize = sizeof(Error_Message_Header)
+                                      + size
+                                      + padding
+                                      + sizeof(CommonMessageFooter);
+
+    // fill message
+    header.commonHeader.sessionId = session->sessionId();
+    header.commonHeader.messageId = session->increaseMessageIdCounter();
+    header.commonHeader.totalMessageSize = totalMessageSize;
+    header.commonHeader.payloadSize = size;
+    header.messageSize = size;
+
+    // build segments of the message without copy of the text
+    CommonMessageTail tail;
+    struct iovec segments[3];
+    segments[0].iov_base = &header;
+    segments[0].iov_len = sizeof(Error_Message_Header);
+    segments[1].iov_base = const_cast<char*>(errorMessage.c_str());
+    segments[1].iov_len = size;
+    segments[2].iov_base = &tail.padding[8 - padding];
+    segments[2].iov_len = padding + sizeof(CommonMessageFooter);
+
+    // send
+    SessionHandler::m_sessionHandler->sendMessage(session,
+                                                  header.commonHeader,
+                                                  segments,
+                                                  3);
 }
 
 /**
@@ -151,42 +121,37 @@ process_Error_Type(Session* session,
                    const CommonMessageHeader* header,
                    const void* rawMessage)
 {
+    uint8_t errorCode = Session::errorCodes::UNDEFINED_ERROR;
     switch(header->subType)
     {
-        //------------------------------------------------------------------------------------------
         case ERROR_FALSE_VERSION_SUBTYPE:
-            {
-                const Error_FalseVersion_Message* message =
-                    static_cast<const Error_FalseVersion_Message*>(rawMessage);
-                session->m_processError(session,
-                                        Session::errorCodes::FALSE_VERSION,
-                                        std::string(message->message, message->messageSize));
-                break;
-            }
-        //------------------------------------------------------------------------------------------
+            errorCode = Session::errorCodes::FALSE_VERSION;
+            break;
         case ERROR_UNKNOWN_SESSION_SUBTYPE:
-            {
-                const Error_UnknownSession_Message* message =
-                    static_cast<const Error_UnknownSession_Message*>(rawMessage);
-                session->m_processError(session,
-                                        Session::errorCodes::UNKNOWN_SESSION,
-                                        std::string(message->message, message->messageSize));
-                break;
-            }
-        //------------------------------------------------------------------------------------------
+            errorCode = Session::errorCodes::UNKNOWN_SESSION;
+            break;
         case ERROR_INVALID_MESSAGE_SUBTYPE:
-            {
-                const Error_InvalidMessage_Message* message =
-                    static_cast<const Error_InvalidMessage_Message*>(rawMessage);
-                session->m_processError(session,
-                                        Session::errorCodes::INVALID_MESSAGE_SIZE,
-                                        std::string(message->message, message->messageSize));
-                break;
-            }
-        //------------------------------------------------------------------------------------------
-        default:
+            errorCode = Session::errorCodes::INVALID_MESSAGE_SIZE;
             break;
+        default:
+            return;
+    }
+
+    // the text must be within the message, because the size comes from the other side
+    const Error_Message_Header* message = static_cast<const Error_Message_Header*>(rawMessage);
+    if(header->totalMessageSize < sizeof(Error_Message_Header) + sizeof(CommonMessageFooter)
+            || message->messageSize > header->totalMessageSize
+                                      - sizeof(Error_Message_Header)
+                                      - sizeof(CommonMessageFooter))
+    {
+        LOG_ERROR("invalid size of error-message");
+        return;
     }
+
+    const char* text = static_cast<const char*>(rawMessage) + sizeof(Error_Message_Header);
+    session->m_processError(session,
+                            errorCode,
+                            std::string(text, message->messageSize));
 }
 
 } // namespace Sakura
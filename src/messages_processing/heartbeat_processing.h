@@ -58,8 +58,12 @@ send_Heartbeat_Start(Session* session)
 
     // fill message
     message.commonHeader.sessionId = session->sessionId();
+    message.commonHeader.additionalValues = session->takePendingStreamCredits();
     message.commonHeader.messageId = session->increaseMessageIdCounter();
 
+    // start measurement of the round-trip-time
+    session->m_heartbeatSendTime = MetricsRecorder::getCurrentTime();
+
     // send
     SessionHandler::m_sessionHandler->sendMessage(session,
                                                   message.commonHeader,
@@ -81,6 +85,7 @@ send_Heartbeat_Reply(Session* session,
 
     // fill message
     message.commonHeader.sessionId = session->sessionId();
+    message.commonHeader.additionalValues = session->takePendingStreamCredits();
     message.commonHeader.messageId = messageId;
 
     // send
@@ -104,14 +109,20 @@ process_Heartbeat_Start(Session* session,
 }
 
 /**
- * @brief handle the reply-message, but do nothing here, because it is only important, that the
- *        message is arrived to be handled by the timer-thread
+ * @brief handle the reply-message. It is only important, that the message is arrived and
+ *        updated the time of the last incoming traffic, so there is only the measurement of the
+ *        round-trip-time here.
+ *
+ * @param session pointer to the session
  */
 inline void
-process_Heartbeat_Reply(Session*,
+process_Heartbeat_Reply(Session* session,
                         const Heartbeat_Reply_Message*)
 {
-    return;
+    const uint64_t sendTime = session->m_heartbeatSendTime.exchange(0);
+    if(sendTime != 0) {
+        session->m_metrics.addHeartbeatRoundTrip(MetricsRecorder::getCurrentTime() - sendTime);
+    }
 }
 
 /**
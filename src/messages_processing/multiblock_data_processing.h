@@ -25,6 +25,9 @@
 
 #include <message_definitions.h>
 #include <handler/session_handler.h>
+#include <handler/buffer_pool.h>
+#include <handler/callback_dispatcher.h>
+#include <payload_compression.h>
 #include <multiblock_io.h>
 
 #include <libKitsunemimiNetwork/abstract_socket.h>
@@ -50,7 +53,8 @@ inline void
 send_Data_Multi_Init(Session* session,
                      const uint64_t multiblockId,
                      const uint64_t requestedSize,
-                     const bool answerExpected)
+                     const bool answerExpected,
+                     const bool isResponse)
 {
     Data_MultiInit_Message message;
 
@@ -62,6 +66,9 @@ send_Data_Multi_Init(Session* session,
     if(answerExpected) {
         message.commonHeader.flags |= 0x4;
     }
+    if(isResponse) {
+        message.commonHeader.flags |= 0x8;
+    }
 
     SessionHandler::m_sessionHandler->sendMessage(session,
                                                   message.commonHeader,
@@ -76,13 +83,15 @@ inline void
 send_Data_Multi_Init_Reply(Session* session,
                            const uint64_t multiblockId,
                            const uint32_t messageId,
-                           const uint8_t status)
+                           const uint8_t status,
+                           const uint32_t partWindow = 0)
 {
     Data_MultiInitReply_Message message;
 
     // fill message
     message.commonHeader.sessionId = session->sessionId();
     message.commonHeader.messageId = messageId;
+    message.commonHeader.additionalValues = partWindow;
     message.multiblockId = multiblockId;
     message.status = status;
 
@@ -101,19 +110,29 @@ send_Data_Multi_Static(Session* session,
                        const uint32_t totalPartNumber,
                        const uint32_t partId,
                        const void* data,
-                       const uint32_t size)
+                       uint32_t size)
 {
-    uint8_t messageBuffer[MESSAGE_CACHE_SIZE];
+    CommonMessageTail tail;
+    Data_MultiBlock_Header message;
+
+    // compress part, if negotiated for the session
+    const void* compressedData = nullptr;
+    uint32_t compressedSize = 0;
+    if(compressPayload(session, data, size, compressedData, compressedSize))
+    {
+        message.commonHeader.flags |= COMPRESSED_PAYLOAD_FLAG;
+        message.commonHeader.additionalValues = size;
+        data = compressedData;
+        size = compressedSize;
+    }
 
     // bring message-size to a multiple of 8
+    const uint32_t padding = (8 - (size % 8)) % 8;
     const uint32_t totalMessageSize = sizeof(Data_MultiBlock_Header)
                                       + size
-                                      + (8-(size % 8)) % 8  // fill up to a multiple of 8
+                                      + padding
                                       + sizeof(CommonMessageFooter);
 
-    CommonMessageFooter end;
-    Data_MultiBlock_Header message;
-
     // fill message
     message.commonHeader.sessionId = session->sessionId();
     message.commonHeader.messageId = session->increaseMessageIdCounter();
@@ -123,17 +142,19 @@ send_Data_Multi_Static(Session* session,
     message.totalPartNumber = totalPartNumber;
     message.partId = partId;
 
-    // fill buffer to build the complete message
-    memcpy(&messageBuffer[0], &message, sizeof(Data_MultiBlock_Header));
-    memcpy(&messageBuffer[sizeof(Data_MultiBlock_Header)], data, size);
-    memcpy(&messageBuffer[(totalMessageSize - sizeof(CommonMessageFooter))],
-           &end,
-           sizeof(CommonMessageFooter));
+    // build segments of the message without copy of the payload
+    struct iovec segments[3];
+    segments[0].iov_base = &message;
+    segments[0].iov_len = sizeof(Data_MultiBlock_Header);
+    segments[1].iov_base = const_cast<void*>(data);
+    segments[1].iov_len = size;
+    segments[2].iov_base = &tail.padding[8 - padding];
+    segments[2].iov_len = padding + sizeof(CommonMessageFooter);
 
     SessionHandler::m_sessionHandler->sendMessage(session,
                                                   message.commonHeader,
-                                                  messageBuffer,
-                                                  totalMessageSize);
+                                                  segments,
+                                                  3);
 }
 
 /**
@@ -199,6 +220,27 @@ send_Data_Multi_Abort_Reply(Session* session,
                                                   sizeof(message));
 }
 
+/**
+ * @brief send_Data_Multi_Part_Ack
+ */
+inline void
+send_Data_Multi_Part_Ack(Session* session,
+                         const uint64_t multiblockId,
+                         const uint32_t numberOfProcessedParts)
+{
+    Data_MultiPartAck_Message message;
+
+    message.commonHeader.sessionId = session->sessionId();
+    message.commonHeader.messageId = session->increaseMessageIdCounter();
+    message.multiblockId = multiblockId;
+    message.numberOfProcessedParts = numberOfProcessedParts;
+
+    SessionHandler::m_sessionHandler->sendMessage(session,
+                                                  message.commonHeader,
+                                                  &message,
+                                                  sizeof(message));
+}
+
 /**
  * @brief process_Data_Multi_Init
  */
@@ -206,14 +248,21 @@ inline void
 process_Data_Multi_Init(Session* session,
                         const Data_MultiInit_Message* message)
 {
+    // only standalone-messages are chunk-streamed, because requests and responses need the
+    // complete buffer
+    const bool chunked = session->m_processMultiblockPart != nullptr
+                         && (message->commonHeader.flags & (0x4 | 0x8)) == 0;
+
     const bool ret = session->m_multiblockIo->createIncomingBuffer(message->multiblockId,
-                                                                   message->totalSize);
+                                                                   message->totalSize,
+                                                                   chunked);
     if(ret)
     {
         send_Data_Multi_Init_Reply(session,
                                    message->multiblockId,
                                    message->commonHeader.messageId,
-                                   Data_MultiInitReply_Message::OK);
+                                   Data_MultiInitReply_Message::OK,
+                                   chunked ? MULTIBLOCK_PART_WINDOW : 0);
     }
     else
     {
@@ -233,7 +282,8 @@ process_Data_Multi_Init_Reply(Session* session,
 {
     if(message->status == Data_MultiInitReply_Message::OK)
     {
-        session->m_multiblockIo->makeOutgoingReady(message->multiblockId);
+        session->m_multiblockIo->makeOutgoingReady(message->multiblockId,
+                                                   message->commonHeader.additionalValues);
     }
     else
     {
@@ -244,6 +294,186 @@ process_Data_Multi_Init_Reply(Session* session,
     }
 }
 
+/**
+ * @brief give a complete incoming multiblock-message to the application
+ *
+ * @param session pointer to the session
+ * @param multiblockId id of the multiblock-message
+ * @param flags flags of the header of the finish-message
+ * @param blockerId blocker-id of the finish-message
+ */
+inline void
+finishIncomingMessage(Session* session,
+                      const uint64_t multiblockId,
+                      const uint8_t flags,
+                      const uint64_t blockerId)
+{
+    MultiblockIO::MultiblockMessage buffer =
+            session->m_multiblockIo->getIncomingBuffer(multiblockId);
+
+    // parts over the other connections of a striped session can still be on the way, so the
+    // finish is processed together with the last part
+    if(session->m_multiblockIo->isIncomingComplete(buffer) == false
+            && session->m_numberOfStripes.load(std::memory_order_relaxed) != 0)
+    {
+        if(session->m_multiblockIo->deferIncomingFinish(multiblockId, flags, blockerId)) {
+            return;
+        }
+        buffer = session->m_multiblockIo->getIncomingBuffer(multiblockId);
+    }
+
+    // check if all parts of the message were received
+    if(session->m_multiblockIo->isIncomingComplete(buffer) == false)
+    {
+        session->m_multiblockIo->removeIncomingMessage(multiblockId);
+        SessionHandler::m_bufferPool->releaseBuffer(buffer.multiBlockBuffer);
+
+        // trigger callback
+        session->m_processError(session,
+                                Session::errorCodes::MULTIBLOCK_FAILED,
+                                "received incomplete multi-block-Message");
+        return;
+    }
+
+    // parts of chunk-streamed messages were already given to the application
+    if(buffer.isChunked)
+    {
+        session->m_multiblockIo->removeIncomingMessage(multiblockId);
+        return;
+    }
+
+    // check if normal standalone-message or if message is response
+    if(flags & 0x8)
+    {
+        // release thread, which is related to the blocker-id
+        SessionHandler::m_callbackDispatcher->dispatchIncomingData(session,
+                                                                   blockerId,
+                                                                   buffer.multiBlockBuffer,
+                                                                   true);
+    }
+    else
+    {
+        // trigger callback
+        SessionHandler::m_callbackDispatcher->dispatchIncomingData(session,
+                                                                   multiblockId,
+                                                                   buffer.multiBlockBuffer,
+                                                                   false);
+    }
+
+    session->m_multiblockIo->removeIncomingMessage(multiblockId);
+}
+
+/**
+ * @brief process all finishes, which were handed over by the additional connections of the
+ *        session. The receive-mutex of the session must be hold by the caller.
+ *
+ * @param session pointer to the primary session
+ */
+inline void
+processStripeFinishes(Session* session)
+{
+    while(true)
+    {
+        while(session->m_stripeFinishes_lock.test_and_set(std::memory_order_acquire)) {
+            asm("");
+        }
+        if(session->m_stripeFinishes.size() == 0)
+        {
+            session->m_stripeFinishes_lock.clear(std::memory_order_release);
+            return;
+        }
+        const Session::StripeFinish finish = session->m_stripeFinishes.front();
+        session->m_stripeFinishes.pop_front();
+        session->m_stripeFinishes_lock.clear(std::memory_order_release);
+
+        finishIncomingMessage(session, finish.multiblockId, finish.flags, finish.blockerId);
+    }
+}
+
+/**
+ * @brief check if there are handed over finishes, which are not processed
+ *
+ * @param session pointer to the primary session
+ *
+ * @return true, if there are waiting finishes, else false
+ */
+inline bool
+hasStripeFinishes(Session* session)
+{
+    while(session->m_stripeFinishes_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    const bool result = session->m_stripeFinishes.size() != 0;
+    session->m_stripeFinishes_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief hand over a finish, which was completed by the thread of an additional connection, to
+ *        the primary connection. If the receiving thread of the primary connection is busy, it
+ *        processes the finish before it releases its receive-mutex, else the finish is processed
+ *        directly while holding the receive-mutex.
+ *
+ * @param session pointer to the primary session
+ * @param multiblockId id of the multiblock-message
+ * @param flags flags of the finish-message
+ * @param blockerId blocker-id of the finish-message
+ */
+inline void
+handOverStripeFinish(Session* session,
+                     const uint64_t multiblockId,
+                     const uint8_t flags,
+                     const uint64_t blockerId)
+{
+    Session::StripeFinish finish;
+    finish.multiblockId = multiblockId;
+    finish.flags = flags;
+    finish.blockerId = blockerId;
+
+    while(session->m_stripeFinishes_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    session->m_stripeFinishes.push_back(finish);
+    session->m_stripeFinishes_lock.clear(std::memory_order_release);
+
+    while(hasStripeFinishes(session)
+          && session->m_receiveMutex.try_lock())
+    {
+        processStripeFinishes(session);
+        session->m_receiveMutex.unlock();
+    }
+}
+
+/**
+ * @brief drop incoming messages, which still miss parts a long time after their finish, for
+ *        example because the additional connection of the parts was broken. The receive-mutex
+ *        is only tried, so the error-callbacks never run in parallel to the other callbacks of
+ *        the session and a busy receiving thread is not blocked. The messages are checked again
+ *        with the next call in this case.
+ *
+ * @param session pointer to the primary session
+ */
+inline void
+expireDeferredFinishes(Session* session)
+{
+    if(session->m_receiveMutex.try_lock() == false) {
+        return;
+    }
+
+    const std::vector<MultiblockIO::MultiblockMessage> expired =
+            session->m_multiblockIo->takeExpiredFinishes(DEFERRED_FINISH_TIMEOUT);
+
+    for(uint64_t i = 0; i < expired.size(); i++)
+    {
+        SessionHandler::m_bufferPool->releaseBuffer(expired[i].multiBlockBuffer);
+
+        // trigger callback
+        session->m_processError(session,
+                                Session::errorCodes::MULTIBLOCK_FAILED,
+                                "received incomplete multi-block-Message: missing parts after "
+                                + std::to_string(DEFERRED_FINISH_TIMEOUT) + " ms");
+    }
+
+    session->m_receiveMutex.unlock();
+}
+
 /**
  * @brief process_Data_Multi_Static
  */
@@ -253,10 +483,33 @@ process_Data_Multiblock(Session* session,
                         const void* rawMessage)
 {
     const uint8_t* payloadData = static_cast<const uint8_t*>(rawMessage)
-                                 + sizeof(Data_SingleBlock_Header);
+                                 + sizeof(Data_MultiBlock_Header);
+    uint32_t uncompressedSize = 0;
+    if(message->commonHeader.flags & COMPRESSED_PAYLOAD_FLAG) {
+        uncompressedSize = message->commonHeader.additionalValues;
+    }
+
     session->m_multiblockIo->writeIntoIncomingBuffer(message->multiblockId,
+                                                     message->partId,
                                                      payloadData,
-                                                     message->commonHeader.payloadSize);
+                                                     message->commonHeader.payloadSize,
+                                                     uncompressedSize);
+
+    // finish the message, if its finish was received before the last part
+    uint8_t flags = 0;
+    uint64_t blockerId = 0;
+    if(session->m_numberOfStripes.load(std::memory_order_relaxed) != 0
+            && session->m_multiblockIo->takeDeferredFinish(message->multiblockId,
+                                                           flags,
+                                                           blockerId))
+    {
+        // the thread of an additional connection must not trigger the callbacks of the session
+        if(Session::m_receivingSession != session) {
+            handOverStripeFinish(session, message->multiblockId, flags, blockerId);
+        } else {
+            finishIncomingMessage(session, message->multiblockId, flags, blockerId);
+        }
+    }
 }
 
 /**
@@ -266,25 +519,10 @@ inline void
 process_Data_Multi_Finish(Session* session,
                           const Data_MultiFinish_Message* message)
 {
-    MultiblockIO::MultiblockMessage buffer =
-            session->m_multiblockIo->getIncomingBuffer(message->multiblockId);
-
-    // check if normal standalone-message or if message is response
-    if(message->commonHeader.flags & 0x8)
-    {
-        // release thread, which is related to the blocker-id
-        SessionHandler::m_blockerHandler->releaseMessage(message->blockerId,
-                                                         buffer.multiBlockBuffer);
-    }
-    else
-    {
-        // trigger callback
-        session->m_processStandaloneData(session,
-                                         message->multiblockId,
-                                         buffer.multiBlockBuffer);
-    }
-
-    session->m_multiblockIo->removeIncomingMessage(message->multiblockId);
+    finishIncomingMessage(session,
+                          message->multiblockId,
+                          message->commonHeader.flags,
+                          message->blockerId);
 }
 
 /**
@@ -312,6 +550,17 @@ process_Data_Multi_Abort_Reply(Session* session,
     session->m_multiblockIo->removeIncomingMessage(message->multiblockId);
 }
 
+/**
+ * @brief process_Data_Multi_Part_Ack
+ */
+inline void
+process_Data_Multi_Part_Ack(Session* session,
+                            const Data_MultiPartAck_Message* message)
+{
+    session->m_multiblockIo->acknowledgeOutgoingParts(message->multiblockId,
+                                                      message->numberOfProcessedParts);
+}
+
 /**
  * @brief process messages of multiblock-message-type
  *
@@ -375,6 +624,14 @@ process_MultiBlock_Data_Type(Session* session,
                 break;
             }
         //------------------------------------------------------------------------------------------
+        case DATA_MULTI_PART_ACK_SUBTYPE:
+            {
+                const Data_MultiPartAck_Message* message =
+                    static_cast<const Data_MultiPartAck_Message*>(rawMessage);
+                process_Data_Multi_Part_Ack(session, message);
+                break;
+            }
+        //------------------------------------------------------------------------------------------
         default:
             break;
     }
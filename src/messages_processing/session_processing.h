@@ -34,6 +34,8 @@
 
 #include <libKitsunemimiPersistence/logger/logger.h>
 
+#include <random>
+
 using Kitsunemimi::RingBuffer;
 using Kitsunemimi::Network::AbstractSocket;
 
@@ -61,6 +63,8 @@ send_Session_Init_Start(Session* session,
     message.commonHeader.sessionId = session->sessionId();
     message.commonHeader.messageId = session->increaseMessageIdCounter();
     message.clientSessionId = session->sessionId();
+    message.commonHeader.additionalValues =
+            SessionHandler::m_sessionHandler->getSupportedFeatures();
     message.sessionIdentifierSize = static_cast<uint32_t>(sessionIdentifier.size());
     memcpy(message.sessionIdentifier,
            sessionIdentifier.c_str(),
@@ -82,13 +86,17 @@ send_Session_Init_Start(Session* session,
  * @param completeSessionId completed session-id based on the id of the server and the client
  * @param sessionIdentifier custom value, which is sended within the init-message to pre-identify
  *                          the message on server-side
+ * @param features features, which are supported by both sides of the session
+ * @param stripeToken secret, which the client needs for additional connections of the session
  */
 inline void
 send_Session_Init_Reply(Session* session,
                         const uint32_t initialSessionId,
                         const uint32_t messageId,
                         const uint32_t completeSessionId,
-                        const std::string &sessionIdentifier)
+                        const std::string &sessionIdentifier,
+                        const uint32_t features,
+                        const uint64_t stripeToken)
 {
     LOG_DEBUG("SEND session init reply");
 
@@ -99,6 +107,8 @@ send_Session_Init_Reply(Session* session,
     message.commonHeader.messageId = messageId;
     message.completeSessionId = completeSessionId;
     message.clientSessionId = initialSessionId;
+    message.commonHeader.additionalValues = features;
+    message.stripeToken = stripeToken;
 
     message.sessionIdentifierSize = static_cast<uint32_t>(sessionIdentifier.size());
     memcpy(message.sessionIdentifier,
@@ -165,6 +175,83 @@ send_Session_Close_Reply(Session* session,
                                                   sizeof(message));
 }
 
+/**
+ * @brief send_Session_Stripe_Start
+ *
+ * @param session pointer to the session of the additional connection
+ * @param stripeId number of the additional connection
+ */
+inline void
+send_Session_Stripe_Start(Session* session,
+                          const uint32_t stripeId)
+{
+    LOG_DEBUG("SEND session stripe start");
+
+    Session_Stripe_Start_Message message;
+
+    // fill message
+    message.commonHeader.sessionId = session->sessionId();
+    message.commonHeader.messageId = session->increaseMessageIdCounter();
+    message.sessionId = session->sessionId();
+    message.stripeId = stripeId;
+    message.stripeToken = session->m_stripeToken;
+
+    // send
+    SessionHandler::m_sessionHandler->sendMessage(session,
+                                                  message.commonHeader,
+                                                  &message,
+                                                  sizeof(message));
+}
+
+/**
+ * @brief send_Session_Stripe_Reply
+ *
+ * @param session pointer to the session of the additional connection
+ * @param messageId id of the original incoming message
+ * @param stripeId number of the additional connection
+ */
+inline void
+send_Session_Stripe_Reply(Session* session,
+                          const uint32_t messageId,
+                          const uint32_t stripeId)
+{
+    LOG_DEBUG("SEND session stripe reply");
+
+    Session_Stripe_Reply_Message message;
+
+    // fill message
+    message.commonHeader.sessionId = session->sessionId();
+    message.commonHeader.messageId = messageId;
+    message.sessionId = session->sessionId();
+    message.stripeId = stripeId;
+
+    // send
+    SessionHandler::m_sessionHandler->sendMessage(session,
+                                                  message.commonHeader,
+                                                  &message,
+                                                  sizeof(message));
+}
+
+/**
+ * @brief create a random secret for the additional connections of a session, because the
+ *        session-ids are only a counter and can be guessed by every other client
+ *
+ * @return new token, which is never 0
+ */
+inline uint64_t
+createStripeToken()
+{
+    std::random_device device;
+    uint64_t token = 0;
+    while(token == 0)
+    {
+        token = static_cast<uint64_t>(device()) << 32;
+        token |= static_cast<uint64_t>(device());
+    }
+
+    return token;
+}
+
 /**
  * @brief process_Session_Init_Start
  *
@@ -177,14 +264,29 @@ process_Session_Init_Start(Session* session,
 {
     LOG_DEBUG("process session init start");
 
-    // get and calculate session-id
+    // the server adds its own part to the part of the client-side
     const uint32_t clientSessionId = message->clientSessionId;
-    const uint16_t serverSessionId = SessionHandler::m_sessionHandler->increaseSessionIdCounter();
-    const uint32_t sessionId = clientSessionId + (serverSessionId * 0x10000);
     const std::string sessionIdentifier(message->sessionIdentifier, message->sessionIdentifierSize);
 
+    // negotiate features, which are supported by both sides
+    const uint32_t features = message->commonHeader.additionalValues
+                              & SessionHandler::m_sessionHandler->getSupportedFeatures();
+    session->m_compressPayload = (features & SESSION_FEATURE_COMPRESSION) != 0;
+    session->m_payloadChecksum = (features & SESSION_FEATURE_PAYLOAD_CHECKSUM) != 0;
+    session->initStreamFlowControl((features & SESSION_FEATURE_STREAM_FLOW_CONTROL) != 0);
+    session->m_stripeToken = createStripeToken();
+
+    // the part of the client is only unique for the client, so the part of the server is
+    // increased until the complete id is not used by another session of the server
+    uint32_t sessionId = 0;
+    do
+    {
+        const uint16_t serverSessionId = SessionHandler::m_sessionHandler->increaseSessionIdCounter();
+        sessionId = (clientSessionId & 0xFFFF) + (serverSessionId * 0x10000);
+    }
+    while(SessionHandler::m_sessionHandler->addSession(sessionId, session) == false);
+
     // create new session and make it ready
-    SessionHandler::m_sessionHandler->addSession(sessionId, session);
     session->connectiSession(sessionId);
     session->makeSessionReady(sessionId, sessionIdentifier);
 
@@ -193,7 +295,9 @@ process_Session_Init_Start(Session* session,
                             clientSessionId,
                             message->commonHeader.messageId,
                             sessionId,
-                            sessionIdentifier);
+                            sessionIdentifier,
+                            features,
+                            session->m_stripeToken);
 }
 
 /**
@@ -212,9 +316,29 @@ process_Session_Init_Reply(Session* session,
     const uint32_t initialId = message->clientSessionId;
     const std::string sessionIdentifier(message->sessionIdentifier, message->sessionIdentifierSize);
 
+    // use the features, which were accepted by the server
+    session->m_compressPayload = (message->commonHeader.additionalValues
+                                  & SESSION_FEATURE_COMPRESSION) != 0;
+    session->m_payloadChecksum = (message->commonHeader.additionalValues
+                                  & SESSION_FEATURE_PAYLOAD_CHECKSUM) != 0;
+    session->initStreamFlowControl((message->commonHeader.additionalValues
+                                    & SESSION_FEATURE_STREAM_FLOW_CONTROL) != 0);
+    session->m_stripeToken = message->stripeToken;
+
     // readd session under the new complete session-id and make session ready
     SessionHandler::m_sessionHandler->removeSession(initialId);
-    SessionHandler::m_sessionHandler->addSession(completeSessionId, session);
+    if(SessionHandler::m_sessionHandler->addSession(completeSessionId, session) == false)
+    {
+        const std::string err = "session-id " + std::to_string(completeSessionId)
+                                + " is already in use";
+        LOG_ERROR(err);
+        session->m_processError(session, Session::errorCodes::UNDEFINED_ERROR, err);
+
+        // release the waiting client, which checks the state of the session
+        session->disconnectSession();
+        session->m_cv.notify_one();
+        return;
+    }
     // TODO: handle return-value of makeSessionReady
     session->makeSessionReady(completeSessionId, sessionIdentifier);
 }
@@ -257,6 +381,68 @@ process_Session_Close_Reply(Session* session,
     session->disconnectSession();
 }
 
+/**
+ * @brief bind a new incoming connection as additional connection to the existing session,
+ *        which is requested by the client
+ *
+ * @param session pointer to the session of the new connection
+ * @param message pointer to the complete message within the message-ring-buffer
+ */
+inline void
+process_Session_Stripe_Start(Session* session,
+                             const Session_Stripe_Start_Message* message)
+{
+    LOG_DEBUG("process session stripe start");
+
+    // only the peer of the primary connection knows the token, which was sent with the
+    // init-reply, and the new connection must use the same transport
+    Session* primary = SessionHandler::m_sessionHandler->getSession(message->sessionId);
+    if(primary == nullptr
+            || primary->isClientSide()
+            || primary->m_stripePrimary != nullptr
+            || session->m_stripePrimary != nullptr
+            || primary->m_stripeToken == 0
+            || message->stripeToken != primary->m_stripeToken
+            || primary->m_socket == nullptr
+            || session->m_socket == nullptr
+            || primary->m_socket->getType() != session->m_socket->getType())
+    {
+        LOG_ERROR("invalid stripe-request for session: " + std::to_string(message->sessionId));
+
+        // the new connection was never connected as session, so only the socket is closed
+        if(session->m_socket != nullptr) {
+            session->m_socket->closeSocket();
+        }
+        return;
+    }
+
+    // use the same session-id and features like the primary connection
+    session->connectiSession(primary->sessionId());
+    session->m_compressPayload = primary->m_compressPayload;
+    session->m_payloadChecksum = primary->m_payloadChecksum;
+    session->m_stripePrimary = primary;
+
+    // reply first, so it is send before the first part over the new connection
+    send_Session_Stripe_Reply(session, message->commonHeader.messageId, message->stripeId);
+    primary->addStripe(session);
+}
+
+/**
+ * @brief release the client, which waits for the confirmation of the additional connection
+ *
+ * @param session pointer to the session of the additional connection
+ */
+inline void
+process_Session_Stripe_Reply(Session* session,
+                             const Session_Stripe_Reply_Message*)
+{
+    LOG_DEBUG("process session stripe reply");
+
+    std::unique_lock<std::mutex> lock(session->m_cvMutex);
+    session->m_stripeConfirmed = true;
+    session->m_cv.notify_all();
+}
+
 /**
  * @brief process messages of session-type
  *
@@ -308,6 +494,22 @@ process_Session_Type(Session* session,
                 break;
             }
         //------------------------------------------------------------------------------------------
+        case SESSION_STRIPE_START_SUBTYPE:
+            {
+                const Session_Stripe_Start_Message* message =
+                    static_cast<const Session_Stripe_Start_Message*>(rawMessage);
+                process_Session_Stripe_Start(session, message);
+                break;
+            }
+        //------------------------------------------------------------------------------------------
+        case SESSION_STRIPE_REPLY_SUBTYPE:
+            {
+                const Session_Stripe_Reply_Message* message =
+                    static_cast<const Session_Stripe_Reply_Message*>(rawMessage);
+                process_Session_Stripe_Reply(session, message);
+                break;
+            }
+        //------------------------------------------------------------------------------------------
         default:
             break;
     }
@@ -23,8 +23,13 @@
 #ifndef SINGLE_DATA_PROCESSING_H
 #define SINGLE_DATA_PROCESSING_H
 
+#include <new>
+
 #include <message_definitions.h>
 #include <handler/session_handler.h>
+#include <handler/buffer_pool.h>
+#include <handler/callback_dispatcher.h>
+#include <payload_compression.h>
 #include <multiblock_io.h>
 
 #include <libKitsunemimiNetwork/abstract_socket.h>
@@ -53,17 +58,27 @@ send_Data_SingleBlock(Session* session,
                       uint32_t size,
                       const uint64_t blockerId=0)
 {
-    uint8_t messageBuffer[MESSAGE_CACHE_SIZE];
+    CommonMessageTail tail;
+    Data_SingleBlock_Header header;
+
+    // compress payload, if negotiated for the session
+    const void* compressedData = nullptr;
+    uint32_t compressedSize = 0;
+    if(compressPayload(session, data, size, compressedData, compressedSize))
+    {
+        header.commonHeader.flags |= COMPRESSED_PAYLOAD_FLAG;
+        header.commonHeader.additionalValues = size;
+        data = compressedData;
+        size = compressedSize;
+    }
 
     // bring message-size to a multiple of 8
+    const uint32_t padding = (8 - (size % 8)) % 8;
     const uint32_t totalMessageSize = sizeof(Data_SingleBlock_Header)
                                       + size
-                                      + (8-(size % 8)) % 8  // fill up to a multiple of 8
+                                      + padding
                                       + sizeof(CommonMessageFooter);
 
-    CommonMessageFooter end;
-    Data_SingleBlock_Header header;
-
     // fill message
     header.commonHeader.sessionId = session->sessionId();
     header.commonHeader.messageId = session->increaseMessageIdCounter();
@@ -75,20 +90,151 @@ send_Data_SingleBlock(Session* session,
         header.commonHeader.flags |= 0x8;
     }
 
-    // fill buffer with all parts of the message
-    memcpy(&messageBuffer[0], &header, sizeof(Data_SingleBlock_Header));
-    memcpy(&messageBuffer[sizeof(Data_SingleBlock_Header)], data, size);
-    memcpy(&messageBuffer[(totalMessageSize - sizeof(CommonMessageFooter))],
-           &end,
-           sizeof(CommonMessageFooter));
+    // build segments of the message without copy of the payload
+    struct iovec segments[3];
+    segments[0].iov_base = &header;
+    segments[0].iov_len = sizeof(Data_SingleBlock_Header);
+    segments[1].iov_base = const_cast<void*>(data);
+    segments[1].iov_len = size;
+    segments[2].iov_base = &tail.padding[8 - padding];
+    segments[2].iov_len = padding + sizeof(CommonMessageFooter);
 
     // send
     SessionHandler::m_sessionHandler->sendMessage(session,
                                                   header.commonHeader,
-                                                  &messageBuffer,
+                                                  segments,
+                                                  3);
+}
+
+/**
+ * @brief send a singleblock-message, whose payload was written into reserved memory, where
+ *        header, padding and footer are written directly around the payload
+ *
+ * @param session pointer to the session
+ * @param multiblockId id of the message
+ * @param payload pointer to the payload with at least MESSAGE_HEADER_RESERVE bytes in front and
+ *                MESSAGE_TAIL_RESERVE bytes behind the payload
+ * @param size size of the payload
+ * @param blockerId blocker-id of the request, if the message is a response, else 0
+ */
+inline void
+send_Data_SingleBlock_InPlace(Session* session,
+                              const uint64_t multiblockId,
+                              uint8_t* payload,
+                              const uint32_t size,
+                              const uint64_t blockerId=0)
+{
+    // compressed payloads are written into another buffer, so there is nothing to fill in place
+    if(session->m_compressPayload)
+    {
+        send_Data_SingleBlock(session, multiblockId, payload, size, blockerId);
+        return;
+    }
+
+    const uint32_t padding = (8 - (size % 8)) % 8;
+    const uint32_t totalMessageSize = sizeof(Data_SingleBlock_Header)
+                                      + size
+                                      + padding
+                                      + sizeof(CommonMessageFooter);
+
+    // fill header in front of the payload
+    Data_SingleBlock_Header* header = reinterpret_cast<Data_SingleBlock_Header*>(
+                                          payload - sizeof(Data_SingleBlock_Header));
+    new(header) Data_SingleBlock_Header();
+    header->commonHeader.sessionId = session->sessionId();
+    header->commonHeader.messageId = session->increaseMessageIdCounter();
+    header->commonHeader.totalMessageSize = totalMessageSize;
+    header->commonHeader.payloadSize = size;
+    header->blockerId = blockerId;
+    header->multiblockId = multiblockId;
+    if(blockerId != 0) {
+        header->commonHeader.flags |= 0x8;
+    }
+
+    // fill padding and footer behind the payload
+    memset(payload + size, 0, padding);
+    new(payload + size + padding) CommonMessageFooter();
+
+    // send
+    SessionHandler::m_sessionHandler->sendMessage(session,
+                                                  header->commonHeader,
+                                                  header,
                                                   totalMessageSize);
 }
 
+/**
+ * @brief send the requests of a batch as singleblock-messages, where as many messages as
+ *        possible are written together with one write into the socket. Requests with a payload
+ *        bigger than MAX_SINGLE_MESSAGE_SIZE are skipped, because they are multiblock-messages.
+ *
+ * @param session pointer to the session
+ * @param requests list of requests
+ * @param numberOfRequests number of requests within the list
+ * @param baseId id of the first request, where each request has the base-id plus its position
+ *               within the list as id
+ */
+inline void
+send_Data_SingleBlock_Batch(Session* session,
+                            const Session::RequestSlot* requests,
+                            const uint32_t numberOfRequests,
+                            const uint64_t baseId)
+{
+    // each message has its own footer, where its checksum is written
+    CommonMessageTail tails[MAX_REQUEST_BATCH_SIZE];
+    Data_SingleBlock_Header headers[MAX_REQUEST_BATCH_SIZE];
+    struct iovec segments[3 * MAX_REQUEST_BATCH_SIZE];
+    uint32_t numberOfSegments = 0;
+    uint64_t frameSize = 0;
+
+    for(uint32_t i = 0; i < numberOfRequests && i < MAX_REQUEST_BATCH_SIZE; i++)
+    {
+        if(requests[i].size > MAX_SINGLE_MESSAGE_SIZE) {
+            continue;
+        }
+
+        const uint32_t size = static_cast<uint32_t>(requests[i].size);
+        const uint32_t padding = (8 - (size % 8)) % 8;
+        const uint32_t totalMessageSize = sizeof(Data_SingleBlock_Header)
+                                          + size
+                                          + padding
+                                          + sizeof(CommonMessageFooter);
+
+        // send the collected messages, if the new one doesn't fit into the same write
+        if(numberOfSegments != 0
+                && frameSize + totalMessageSize > SEND_BUFFER_SIZE)
+        {
+            session->sendSegments(segments, numberOfSegments, false);
+            numberOfSegments = 0;
+            frameSize = 0;
+        }
+
+        // fill message
+        Data_SingleBlock_Header* header = &headers[i];
+        header->commonHeader.sessionId = session->sessionId();
+        header->commonHeader.messageId = session->increaseMessageIdCounter();
+        header->commonHeader.totalMessageSize = totalMessageSize;
+        header->commonHeader.payloadSize = size;
+        header->multiblockId = baseId + i;
+
+        segments[numberOfSegments].iov_base = header;
+        segments[numberOfSegments].iov_len = sizeof(Data_SingleBlock_Header);
+        segments[numberOfSegments + 1].iov_base = const_cast<void*>(requests[i].data);
+        segments[numberOfSegments + 1].iov_len = size;
+        segments[numberOfSegments + 2].iov_base = &tails[i].padding[8 - padding];
+        segments[numberOfSegments + 2].iov_len = padding + sizeof(CommonMessageFooter);
+        SessionHandler::m_sessionHandler->prepareMessage(session,
+                                                         header->commonHeader,
+                                                         &segments[numberOfSegments],
+                                                         3);
+        numberOfSegments += 3;
+        frameSize += totalMessageSize;
+    }
+
+    if(numberOfSegments != 0) {
+        session->sendSegments(segments, numberOfSegments, false);
+    }
+}
+
 /**
  * @brief send_Data_SingleBlock_Reply
  */
@@ -117,30 +263,53 @@ process_Data_SingleBlock(Session* session,
                          const Data_SingleBlock_Header* header,
                          const void* rawMessage)
 {
-    // prepare buffer for payload
-    const uint32_t allocateBlocks = (header->commonHeader.payloadSize / 4096) + 1;
-    DataBuffer* buffer = new DataBuffer(allocateBlocks, 4096);
-
     // get pointer to the beginning of the payload
     const uint8_t* payloadData = static_cast<const uint8_t*>(rawMessage)
                                  + sizeof(Data_SingleBlock_Header);
 
-    // copy messagy-payload into buffer
-    addData_DataBuffer(*buffer, payloadData, header->commonHeader.payloadSize);
+    DataBuffer* buffer = nullptr;
+    if(header->commonHeader.flags & COMPRESSED_PAYLOAD_FLAG)
+    {
+        // decompress payload directly into the buffer
+        const uint32_t uncompressedSize = header->commonHeader.additionalValues;
+        buffer = SessionHandler::m_bufferPool->getBuffer(uncompressedSize);
+        if(decompressPayload(session,
+                             buffer->data,
+                             uncompressedSize,
+                             payloadData,
+                             header->commonHeader.payloadSize) == false)
+        {
+            SessionHandler::m_bufferPool->releaseBuffer(buffer);
+            session->m_processError(session,
+                                    Session::errorCodes::INVALID_MESSAGE_SIZE,
+                                    "failed to decompress singleblock-message");
+            return;
+        }
+        buffer->bufferPosition = uncompressedSize;
+    }
+    else
+    {
+        // copy messagy-payload into buffer
+        buffer = SessionHandler::m_bufferPool->getBuffer(header->commonHeader.payloadSize);
+        addData_DataBuffer(*buffer, payloadData, header->commonHeader.payloadSize);
+    }
 
     // check if normal standalone-message or if message is response
     if(header->commonHeader.flags & 0x8)
     {
         // release thread, which is related to the blocker-id
-        SessionHandler::m_blockerHandler->releaseMessage(header->blockerId,
-                                                         buffer);
+        SessionHandler::m_callbackDispatcher->dispatchIncomingData(session,
+                                                                   header->blockerId,
+                                                                   buffer,
+                                                                   true);
     }
     else
     {
         // trigger callback
-        session->m_processStandaloneData(session,
-                                         header->multiblockId,
-                                         buffer);
+        SessionHandler::m_callbackDispatcher->dispatchIncomingData(session,
+                                                                   header->multiblockId,
+                                                                   buffer,
+                                                                   false);
     }
 
     // send reply, if requested
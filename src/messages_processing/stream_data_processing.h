@@ -23,6 +23,8 @@
 #ifndef STREAM_DATA_PROCESSING_H
 #define STREAM_DATA_PROCESSING_H
 
+#include <new>
+
 #include <message_definitions.h>
 #include <handler/session_handler.h>
 #include <multiblock_io.h>
@@ -43,6 +45,22 @@ namespace Kitsunemimi
 namespace Sakura
 {
 
+/**
+ * @brief get the total size of a stream-message
+ *
+ * @param payloadSize size of the payload
+ *
+ * @return size of the message with header, padding and footer
+ */
+inline uint32_t
+getStreamMessageSize(const uint32_t payloadSize)
+{
+    return sizeof(Data_Stream_Header)
+           + payloadSize
+           + (8 - (payloadSize % 8)) % 8  // fill up to a multiple of 8
+           + sizeof(CommonMessageFooter);
+}
+
 /**
  * @brief send_Data_Stream_Static
  */
@@ -69,6 +87,7 @@ send_Data_Stream(Session* session,
     header.commonHeader.totalMessageSize = totalMessageSize;
     header.commonHeader.payloadSize = size;
     header.commonHeader.flags = static_cast<uint8_t>(replyExpected) * 0x1;
+    header.commonHeader.additionalValues = session->takePendingStreamCredits();
 
     uint8_t* dataPtr = static_cast<uint8_t*>(data->data);
     // fill buffer to build the complete message
@@ -93,15 +112,14 @@ send_Data_Stream(Session* session,
                  const uint32_t size,
                  const bool replyExpected)
 {
-    uint8_t messageBuffer[MESSAGE_CACHE_SIZE];
-
     // bring message-size to a multiple of 8
+    const uint32_t padding = (8 - (size % 8)) % 8;
     const uint32_t totalMessageSize = sizeof(Data_Stream_Header)
                                       + size
-                                      + (8 - (size % 8)) % 8  // fill up to a multiple of 8
+                                      + padding
                                       + sizeof(CommonMessageFooter);
 
-    CommonMessageFooter end;
+    CommonMessageTail tail;
     Data_Stream_Header header;
 
     // fill message
@@ -110,18 +128,64 @@ send_Data_Stream(Session* session,
     header.commonHeader.totalMessageSize = totalMessageSize;
     header.commonHeader.payloadSize = size;
     header.commonHeader.flags = static_cast<uint8_t>(replyExpected) * 0x1;
+    header.commonHeader.additionalValues = session->takePendingStreamCredits();
 
-    // fill buffer to build the complete message
-    memcpy(&messageBuffer[0], &header, sizeof(Data_Stream_Header));
-    memcpy(&messageBuffer[sizeof(Data_Stream_Header)], data, size);
-    memcpy(&messageBuffer[(totalMessageSize - sizeof(CommonMessageFooter))],
-           &end,
-           sizeof(CommonMessageFooter));
+    // build segments of the message without copy of the payload
+    struct iovec segments[3];
+    segments[0].iov_base = &header;
+    segments[0].iov_len = sizeof(Data_Stream_Header);
+    segments[1].iov_base = const_cast<void*>(data);
+    segments[1].iov_len = size;
+    segments[2].iov_base = &tail.padding[8 - padding];
+    segments[2].iov_len = padding + sizeof(CommonMessageFooter);
 
     // send
     return SessionHandler::m_sessionHandler->sendMessage(session,
                                                          header.commonHeader,
-                                                         messageBuffer,
+                                                         segments,
+                                                         3);
+}
+
+/**
+ * @brief send a stream-message, whose payload was written into reserved memory, where header,
+ *        padding and footer are written directly around the payload
+ *
+ * @param session pointer to the session
+ * @param payload pointer to the payload with at least MESSAGE_HEADER_RESERVE bytes in front and
+ *                MESSAGE_TAIL_RESERVE bytes behind the payload
+ * @param size size of the payload
+ * @param replyExpected if true, the other side sends a reply-message to check timeouts
+ *
+ * @return false, if sending failed, else true
+ */
+inline bool
+send_Data_Stream_InPlace(Session* session,
+                         uint8_t* payload,
+                         const uint32_t size,
+                         const bool replyExpected)
+{
+    const uint32_t padding = (8 - (size % 8)) % 8;
+    const uint32_t totalMessageSize = getStreamMessageSize(size);
+
+    // fill header in front of the payload
+    Data_Stream_Header* header = reinterpret_cast<Data_Stream_Header*>(
+                                     payload - sizeof(Data_Stream_Header));
+    new(header) Data_Stream_Header();
+    header->commonHeader.sessionId = session->sessionId();
+    header->commonHeader.messageId = session->increaseMessageIdCounter();
+    header->commonHeader.totalMessageSize = totalMessageSize;
+    header->commonHeader.payloadSize = size;
+    header->commonHeader.flags = static_cast<uint8_t>(replyExpected) * 0x1;
+    header->commonHeader.additionalValues = session->takePendingStreamCredits();
+
+    // fill padding and footer behind the payload
+    memset(payload + size, 0, padding);
+    new(payload + size + padding) CommonMessageFooter();
+
+    // send
+    return SessionHandler::m_sessionHandler->sendMessage(session,
+                                                         header->commonHeader,
+                                                         header,
                                                          totalMessageSize);
 }
 
@@ -137,6 +201,7 @@ send_Data_Stream_Reply(Session* session,
     // fill message
     message.commonHeader.sessionId = session->sessionId();
     message.commonHeader.messageId = messageId;
+    message.commonHeader.additionalValues = session->takePendingStreamCredits();
 
     // send
     SessionHandler::m_sessionHandler->sendMessage(session,
@@ -145,6 +210,66 @@ send_Data_Stream_Reply(Session* session,
                                                   sizeof(message));
 }
 
+/**
+ * @brief grant all collected credits for stream-messages to the other side
+ *
+ * @param session pointer to the session
+ */
+inline void
+send_Data_Stream_Credit(Session* session)
+{
+    Data_StreamCredit_Message message;
+
+    // fill message
+    message.commonHeader.sessionId = session->sessionId();
+    message.commonHeader.messageId = session->increaseMessageIdCounter();
+    message.commonHeader.additionalValues = session->takePendingStreamCredits();
+
+    // credits were already send together with another message
+    if(message.commonHeader.additionalValues == 0) {
+        return;
+    }
+
+    // send
+    SessionHandler::m_sessionHandler->sendMessage(session,
+                                                  message.commonHeader,
+                                                  &message,
+                                                  sizeof(message));
+}
+
+/**
+ * @brief give all collected stream-messages to the batch-callback
+ *
+ * @param session pointer to the session
+ * @param processStreamBatch batch-callback, which was loaded once by the caller, because it can
+ *                           be changed by another thread at any time
+ */
+inline void
+flushStreamBatch(Session* session,
+                 void (*processStreamBatch)(Session*, const Session::StreamSpan*, const uint64_t))
+{
+    if(session->m_streamBatchSize == 0) {
+        return;
+    }
+
+    if(processStreamBatch != nullptr)
+    {
+        processStreamBatch(session, session->m_streamBatch, session->m_streamBatchSize);
+    }
+    else
+    {
+        // batch-callback was removed while collecting, so the single callback gets the payloads
+        for(uint64_t i = 0; i < session->m_streamBatchSize; i++)
+        {
+            session->m_processStreamData(session,
+                                         session->m_streamBatch[i].data,
+                                         session->m_streamBatch[i].size);
+        }
+    }
+
+    session->m_streamBatchSize = 0;
+}
+
 /**
  * @brief process_Data_Stream_Static
  */
@@ -157,15 +282,41 @@ process_Data_Stream(Session* session,
     const uint8_t* payloadData = static_cast<const uint8_t*>(rawMessage)
                                  + sizeof(Data_Stream_Header);
 
-    // trigger callback
-    session->m_processStreamData(session,
-                                 static_cast<const void*>(payloadData),
-                                 header->commonHeader.payloadSize);
+    // trigger callback or collect the payload for the batch-callback, which is triggered, when
+    // the receive-buffer was processed
+    void (*processStreamBatch)(Session*, const Session::StreamSpan*, const uint64_t) =
+            session->m_processStreamBatch;
+    if(processStreamBatch != nullptr)
+    {
+        Session::StreamSpan* span = &session->m_streamBatch[session->m_streamBatchSize];
+        span->data = static_cast<const void*>(payloadData);
+        span->size = header->commonHeader.payloadSize;
+        session->m_streamBatchSize++;
+
+        if(session->m_streamBatchSize == STREAM_BATCH_SIZE) {
+            flushStreamBatch(session, processStreamBatch);
+        }
+    }
+    else
+    {
+        // payloads, which were collected before the batch-callback was removed, come first
+        flushStreamBatch(session, nullptr);
+        session->m_processStreamData(session,
+                                     static_cast<const void*>(payloadData),
+                                     header->commonHeader.payloadSize);
+    }
+
+    // space of the message within the ring-buffer can be given back to the other side
+    const bool grantCredits = session->consumeStreamMessage(header->commonHeader.totalMessageSize);
 
     // send reply if necessary
     if(header->commonHeader.flags & 0x1) {
         send_Data_Stream_Reply(session, header->commonHeader.messageId);
     }
+
+    if(grantCredits) {
+        send_Data_Stream_Credit(session);
+    }
 }
 
 /**
@@ -209,6 +360,10 @@ process_Stream_Data_Type(Session* session,
                 break;
             }
         //------------------------------------------------------------------------------------------
+        case DATA_STREAM_CREDIT_SUBTYPE:
+            // the granted credits are already taken from the header by processMessage
+            break;
+        //------------------------------------------------------------------------------------------
         default:
             break;
     }
@@ -22,9 +22,18 @@
 
 #include "multiblock_io.h"
 
+#include <random>
+#include <thread>
+#include <chrono>
+#include <sys/mman.h>
+
 #include <libKitsunemimiSakuraNetwork/session.h>
 #include <libKitsunemimiPersistence/logger/logger.h>
 #include <messages_processing/multiblock_data_processing.h>
+#include <handler/buffer_pool.h>
+#include <handler/io_engine.h>
+#include <handler/heartbeat_handler.h>
+#include <payload_compression.h>
 
 namespace Kitsunemimi
 {
@@ -35,6 +44,7 @@ MultiblockIO::MultiblockIO(Session* session)
     : Kitsunemimi::Thread()
 {
     m_session = session;
+    m_ioLoop = nullptr;
 }
 
 /**
@@ -45,6 +55,8 @@ MultiblockIO::MultiblockIO(Session* session)
  * @param size total size of the payload of the message (no header)
  * @param answerExpected true, if message is a request-message
  * @param blockerId blocker-id in case that the message is a response
+ * @param multiblockId predefined id for the new multiblock-message. If 0, a new id is created.
+ * @param priority number of parts, which are send in each round of the scheduler
  *
  * @return
  */
@@ -52,22 +64,30 @@ std::pair<DataBuffer*, uint64_t>
 MultiblockIO::createOutgoingBuffer(const void* data,
                                    const uint64_t size,
                                    const bool answerExpected,
-                                   const uint64_t blockerId)
+                                   const uint64_t blockerId,
+                                   const uint64_t multiblockId,
+                                   const uint32_t priority)
 {
     std::pair<DataBuffer*, uint64_t> result;
 
-    // calculate required number of blocks to allocate within the buffer
-    const uint32_t numberOfBlocks = static_cast<uint32_t>(size / 4096) + 1;
-
     // set or create id
-    const uint64_t newMultiblockId = getRandValue();
+    uint64_t newMultiblockId = multiblockId;
+    if(newMultiblockId == 0) {
+        newMultiblockId = getRandValue();
+    }
 
     // init new multiblock-message
     MultiblockMessage newMultiblockMessage;
-    newMultiblockMessage.multiBlockBuffer = new Kitsunemimi::DataBuffer(numberOfBlocks);
+    newMultiblockMessage.multiBlockBuffer = SessionHandler::m_bufferPool->getBuffer(size);
     newMultiblockMessage.messageSize = size;
     newMultiblockMessage.multiblockId = newMultiblockId;
     newMultiblockMessage.blockerId = blockerId;
+    newMultiblockMessage.numberOfPackages = static_cast<uint32_t>((size + MAX_SINGLE_MESSAGE_SIZE - 1)
+                                                                  / MAX_SINGLE_MESSAGE_SIZE);
+    newMultiblockMessage.priority = priority;
+    if(newMultiblockMessage.priority == 0) {
+        newMultiblockMessage.priority = 1;
+    }
 
     // check if memory allocation was successful
     if(newMultiblockMessage.multiBlockBuffer == nullptr)
@@ -81,12 +101,13 @@ MultiblockIO::createOutgoingBuffer(const void* data,
     Kitsunemimi::addData_DataBuffer(*newMultiblockMessage.multiBlockBuffer, data, size);
 
     // put buffer into message-queue to be send in the background
-    while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_outgoingMutex.lock();
     m_outgoing.push_back(newMultiblockMessage);
-    m_outgoing_lock.clear(std::memory_order_release);
+    m_session->m_metrics.updateMultiblockQueueDepth(m_outgoing.size());
+    m_outgoingMutex.unlock();
 
     // send init-message to initialize the transfer for the data
-    send_Data_Multi_Init(m_session, newMultiblockId, size, answerExpected);
+    send_Data_Multi_Init(m_session, newMultiblockId, size, answerExpected, blockerId != 0);
 
     result.second = newMultiblockId;
 
@@ -94,27 +115,100 @@ MultiblockIO::createOutgoingBuffer(const void* data,
 }
 
 /**
- * @brief create new buffer for the message
+ * @brief initialize multiblock-message, which sends its parts directly from memory of the
+ *        caller or from a memory-mapped file, without copy into a data-buffer
+ *
+ * @param data payload of the message to send, which must be valid until the message is finished
+ * @param size total size of the payload of the message (no header)
+ * @param priority number of parts, which are send in each round of the scheduler
+ * @param mappedRegion memory-mapping, which should be unmapped after the message is finished,
+ *                     or nullptr if the memory is owned by the caller
+ * @param mappedSize size of the memory-mapping
+ * @param processCompletion callback, which is triggered, when the memory is not used anymore,
+ *                          with the target, session, multiblock-id and if the message was send
+ *                          completely, or nullptr
+ * @param completionTarget first argument of the completion-callback
+ * @param blockerId blocker-id of the request, if the message is a response, else 0
+ *
+ * @return id of the new multiblock-message
+ */
+uint64_t
+MultiblockIO::createOutgoingReference(const void* data,
+                                      const uint64_t size,
+                                      const uint32_t priority,
+                                      void* mappedRegion,
+                                      const uint64_t mappedSize,
+                                      void (*processCompletion)(void*,
+                                                                Session*,
+                                                                const uint64_t,
+                                                                const bool),
+                                      void* completionTarget,
+                                      const uint64_t blockerId)
+{
+    const uint64_t newMultiblockId = getRandValue();
+
+    // init new multiblock-message
+    MultiblockMessage newMultiblockMessage;
+    newMultiblockMessage.externalData = static_cast<const uint8_t*>(data);
+    newMultiblockMessage.mappedRegion = mappedRegion;
+    newMultiblockMessage.mappedSize = mappedSize;
+    newMultiblockMessage.processCompletion = processCompletion;
+    newMultiblockMessage.completionTarget = completionTarget;
+    newMultiblockMessage.messageSize = size;
+    newMultiblockMessage.multiblockId = newMultiblockId;
+    newMultiblockMessage.blockerId = blockerId;
+    newMultiblockMessage.numberOfPackages = static_cast<uint32_t>((size + MAX_SINGLE_MESSAGE_SIZE - 1)
+                                                                  / MAX_SINGLE_MESSAGE_SIZE);
+    newMultiblockMessage.priority = priority;
+    if(newMultiblockMessage.priority == 0) {
+        newMultiblockMessage.priority = 1;
+    }
+
+    // put message into message-queue to be send in the background
+    m_outgoingMutex.lock();
+    m_outgoing.push_back(newMultiblockMessage);
+    m_session->m_metrics.updateMultiblockQueueDepth(m_outgoing.size());
+    m_outgoingMutex.unlock();
+
+    // send init-message to initialize the transfer for the data
+    send_Data_Multi_Init(m_session, newMultiblockId, size, false, blockerId != 0);
+
+    return newMultiblockId;
+}
+
+/**
+ * @brief create new buffer for the message. The buffer is allocated with the complete size of
+ *        the message, so the incoming parts can be written directly to their final position.
+ *        Chunk-streamed messages have no buffer, because each part is given directly to the
+ *        part-callback of the session.
  *
  * @param multiblockId id of the multiblock-message
  * @param size size for the new buffer
+ * @param chunked true to deliver the parts by the part-callback instead of a complete buffer
  *
  * @return false, if allocation failed, else true
  */
 bool
 MultiblockIO::createIncomingBuffer(const uint64_t multiblockId,
-                                   const uint64_t size)
+                                   const uint64_t size,
+                                   const bool chunked)
 {
-    const uint32_t numberOfBlocks = static_cast<uint32_t>(size / 4096) + 1;
-
     // init new multiblock-message
     MultiblockMessage newMultiblockMessage;
-    newMultiblockMessage.multiBlockBuffer = new Kitsunemimi::DataBuffer(numberOfBlocks);
+    if(chunked == false) {
+        newMultiblockMessage.multiBlockBuffer = SessionHandler::m_bufferPool->getBuffer(size);
+    }
+    newMultiblockMessage.isChunked = chunked;
     newMultiblockMessage.messageSize = size;
     newMultiblockMessage.multiblockId = multiblockId;
+    newMultiblockMessage.numberOfPackages = static_cast<uint32_t>((size + MAX_SINGLE_MESSAGE_SIZE - 1)
+                                                                  / MAX_SINGLE_MESSAGE_SIZE);
+    newMultiblockMessage.receivedPackages.resize((newMultiblockMessage.numberOfPackages / 64) + 1, 0);
 
     // check if memory allocation was successful
-    if(newMultiblockMessage.multiBlockBuffer == nullptr) {
+    if(newMultiblockMessage.multiBlockBuffer == nullptr
+            && chunked == false)
+    {
         return false;
     }
 
@@ -132,17 +226,20 @@ MultiblockIO::createIncomingBuffer(const uint64_t multiblockId,
  * @brief toggle flag in multi-block buffer to register, that the handshake was complete
  *
  * @param multiblockId id of the multiblock-message
+ * @param partWindow max number of parts, which are send before the receiver acknowledges
+ *                   them, or 0 for no limit
  *
  * @return flase, if id is unknown, else true
  */
 bool
-MultiblockIO::makeOutgoingReady(const uint64_t multiblockId)
+MultiblockIO::makeOutgoingReady(const uint64_t multiblockId,
+                                const uint32_t partWindow)
 {
     bool found = false;
 
-    while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    std::unique_lock<std::mutex> lock(m_outgoingMutex);
 
-    std::deque<MultiblockMessage>::iterator it;
+    std::list<MultiblockMessage>::iterator it;
     for(it = m_outgoing.begin();
         it != m_outgoing.end();
         it++)
@@ -150,62 +247,205 @@ MultiblockIO::makeOutgoingReady(const uint64_t multiblockId)
         if(it->multiblockId == multiblockId)
         {
             it->isReady = true;
+            it->partWindow = partWindow;
             found = true;
         }
     }
 
-    m_outgoing_lock.clear(std::memory_order_release);
+    // wake up the sender-thread, which waits for ready messages
+    if(found) {
+        notifyOutgoing();
+    }
+
+    return found;
+}
 
+/**
+ * @brief register the parts of an outgoing chunk-streamed message, which were processed by
+ *        the receiver, so the next parts of the window can be send
+ *
+ * @param multiblockId id of the multiblock-message
+ * @param numberOfParts total number of parts, which were processed by the receiver
+ *
+ * @return flase, if id is unknown, else true
+ */
+bool
+MultiblockIO::acknowledgeOutgoingParts(const uint64_t multiblockId,
+                                       const uint32_t numberOfParts)
+{
+    bool found = false;
+
+    std::unique_lock<std::mutex> lock(m_outgoingMutex);
+
+    std::list<MultiblockMessage>::iterator it;
+    for(it = m_outgoing.begin();
+        it != m_outgoing.end();
+        it++)
+    {
+        if(it->multiblockId == multiblockId)
+        {
+            if(numberOfParts > it->acknowledgedPackages) {
+                it->acknowledgedPackages = numberOfParts;
+            }
+            found = true;
+        }
+    }
+
+    // wake up the sender-thread, which waits for acknowledged parts
     if(found) {
-        continueThread();
+        notifyOutgoing();
     }
 
     return found;
 }
 
 /**
- * @brief send multi-block message
+ * @brief wake up the own sender-thread or the loop of the io-engine, which sends the messages
+ */
+void
+MultiblockIO::notifyOutgoing()
+{
+    m_outgoingCv.notify_one();
+
+    IoLoop* loop = m_ioLoop.load();
+    if(loop != nullptr) {
+        loop->wakeUp();
+    }
+}
+
+/**
+ * @brief check if the sender-thread can send parts of a message at the moment
  *
- * @param messageBuffer message to send
+ * @param messageBuffer outgoing message to check
  *
- * @return false, if sending message failed, else true
+ * @return true, if the message is ready and its window allows new parts, else false
  */
 bool
-MultiblockIO::sendOutgoingData(const MultiblockMessage& messageBuffer)
+MultiblockIO::isSendable(const MultiblockMessage &messageBuffer) const
 {
-    // counter values
-    uint64_t totalSize = messageBuffer.messageSize;
-    uint64_t currentMessageSize = 0;
-    uint32_t partCounter = 0;
+    if(messageBuffer.isReady == false) {
+        return false;
+    }
 
-    // static values
-    const uint32_t totalPartNumber = static_cast<uint32_t>(totalSize / MAX_SINGLE_MESSAGE_SIZE) + 1;
-    const uint8_t* dataPointer = getBlock_DataBuffer(*messageBuffer.multiBlockBuffer, 0);
+    return messageBuffer.abort
+           || messageBuffer.partWindow == 0
+           || messageBuffer.courrentPackage >= messageBuffer.numberOfPackages
+           || messageBuffer.courrentPackage < messageBuffer.acknowledgedPackages
+                                              + messageBuffer.partWindow;
+}
 
-    while(totalSize != 0
-          && m_aborCurrentMessage == false)
+/**
+ * @brief change the priority of an outgoing multiblock-message
+ *
+ * @param multiblockId id of the multiblock-message
+ * @param priority number of parts, which are send in each round of the scheduler
+ *
+ * @return flase, if id is unknown, else true
+ */
+bool
+MultiblockIO::setOutgoingPriority(const uint64_t multiblockId,
+                                  const uint32_t priority)
+{
+    bool found = false;
+
+    std::unique_lock<std::mutex> lock(m_outgoingMutex);
+
+    std::list<MultiblockMessage>::iterator it;
+    for(it = m_outgoing.begin();
+        it != m_outgoing.end();
+        it++)
     {
+        if(it->multiblockId == multiblockId)
+        {
+            it->priority = priority;
+            if(it->priority == 0) {
+                it->priority = 1;
+            }
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+/**
+ * @brief send the next parts of a multi-block message
+ *
+ * @param messageBuffer message to send
+ * @param numberOfParts maximum number of parts to send
+ * @param abort abort-flag of the message, which was copied under the lock of the queue
+ * @param acknowledgedPackages number of parts, which were acknowledged by the receiver,
+ *                             copied under the lock of the queue
+ *
+ * @return true, if all parts of the message are send or the message was aborted, else false
+ */
+bool
+MultiblockIO::sendOutgoingParts(MultiblockMessage &messageBuffer,
+                                const uint32_t numberOfParts,
+                                const bool abort,
+                                const uint32_t acknowledgedPackages)
+{
+    const uint8_t* dataPointer = messageBuffer.externalData;
+    if(dataPointer == nullptr) {
+        dataPointer = getBlock_DataBuffer(*messageBuffer.multiBlockBuffer, 0);
+    }
+
+    for(uint32_t i = 0; i < numberOfParts; i++)
+    {
+        if(abort
+                || messageBuffer.courrentPackage >= messageBuffer.numberOfPackages)
+        {
+            return true;
+        }
+
+        // wait for the receiver, when all parts of the window are in flight
+        if(messageBuffer.partWindow != 0
+                && messageBuffer.courrentPackage >= acknowledgedPackages
+                                                    + messageBuffer.partWindow)
+        {
+            return false;
+        }
+
         // get message-size base on the rest
-        currentMessageSize = MAX_SINGLE_MESSAGE_SIZE;
-        if(totalSize <= MAX_SINGLE_MESSAGE_SIZE) {
-            currentMessageSize = totalSize;
+        const uint64_t offset = static_cast<uint64_t>(messageBuffer.courrentPackage)
+                                * MAX_SINGLE_MESSAGE_SIZE;
+        uint64_t currentMessageSize = messageBuffer.messageSize - offset;
+        if(currentMessageSize > MAX_SINGLE_MESSAGE_SIZE) {
+            currentMessageSize = MAX_SINGLE_MESSAGE_SIZE;
+        }
+
+        // distribute parts over all connections of the session, except for chunk-streamed
+        // messages, where the receiver has to get the parts in order
+        Session* connection = m_session;
+        if(messageBuffer.partWindow == 0) {
+            connection = m_session->getStripe(messageBuffer.courrentPackage);
         }
-        totalSize -= currentMessageSize;
 
         // send single packet
         // TODO: check return value
-        send_Data_Multi_Static(m_session,
+        send_Data_Multi_Static(connection,
                                messageBuffer.multiblockId,
-                               totalPartNumber,
-                               partCounter,
-                               dataPointer + (MAX_SINGLE_MESSAGE_SIZE * partCounter),
+                               messageBuffer.numberOfPackages,
+                               messageBuffer.courrentPackage,
+                               dataPointer + offset,
                                static_cast<uint32_t>(currentMessageSize));
 
-        partCounter++;
+        messageBuffer.courrentPackage++;
     }
 
-    // send final message to other side
-    if(m_aborCurrentMessage == false)
+    return abort
+           || messageBuffer.courrentPackage >= messageBuffer.numberOfPackages;
+}
+
+/**
+ * @brief send final message of a multi-block message to the other side and delete its buffer
+ *
+ * @param messageBuffer message, which is complete or aborted
+ */
+void
+MultiblockIO::finishOutgoingMessage(const MultiblockMessage &messageBuffer)
+{
+    if(messageBuffer.abort == false)
     {
         // TODO: check return value
         send_Data_Multi_Finish(m_session,
@@ -219,15 +459,35 @@ MultiblockIO::sendOutgoingData(const MultiblockMessage& messageBuffer)
                                     messageBuffer.multiblockId,
                                     m_session->increaseMessageIdCounter());
     }
-    m_aborCurrentMessage = false;
 
-    // remove message from outgoing buffer
-    while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
-    delete messageBuffer.multiBlockBuffer;
-    m_outgoing.pop_front();
-    m_outgoing_lock.clear(std::memory_order_release);
+    releaseOutgoingPayload(messageBuffer, messageBuffer.abort == false);
+}
 
-    return true;
+/**
+ * @brief give the payload of an outgoing message back, after it is not used anymore. This is
+ *        the copy within the buffer-pool, the memory-mapping of a file or the memory of the
+ *        caller, which is notified by the completion-callback.
+ *
+ * @param messageBuffer message, which is finished, aborted or removed
+ * @param success true, if all parts of the message were send
+ */
+void
+MultiblockIO::releaseOutgoingPayload(const MultiblockMessage &messageBuffer,
+                                     const bool success)
+{
+    SessionHandler::m_bufferPool->releaseBuffer(messageBuffer.multiBlockBuffer);
+
+    if(messageBuffer.mappedRegion != nullptr) {
+        munmap(messageBuffer.mappedRegion, messageBuffer.mappedSize);
+    }
+
+    if(messageBuffer.processCompletion != nullptr)
+    {
+        messageBuffer.processCompletion(messageBuffer.completionTarget,
+                                        m_session,
+                                        messageBuffer.multiblockId,
+                                        success);
+    }
 }
 
 /**
@@ -242,7 +502,7 @@ MultiblockIO::getIncomingBuffer(const uint64_t multiblockId)
 {
     MultiblockMessage tempBuffer;
 
-    while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    while(m_incoming_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
 
     std::map<uint64_t, MultiblockMessage>::iterator it;
     it = m_incoming.find(multiblockId);
@@ -257,30 +517,233 @@ MultiblockIO::getIncomingBuffer(const uint64_t multiblockId)
 }
 
 /**
- * @brief append data to the data-buffer for the multiblock-message
+ * @brief write a part of a multiblock-message to its position within the data-buffer of the
+ *        message. The parts can arrive in any order.
  *
  * @param multiblockId id of the multiblock-message
+ * @param partId id of the part, which defines the position within the buffer
  * @param data pointer to the data
  * @param size number of bytes
+ * @param uncompressedSize size of the decompressed part, if the data are compressed, or 0 if
+ *                         the data are uncompressed
  *
- * @return false, if session is not in the multiblock-transfer-state
+ * @return false, if message-id is unknown, the part doesn't fit into the message or
+ *         decompression failed, else true
  */
 bool
 MultiblockIO::writeIntoIncomingBuffer(const uint64_t multiblockId,
+                                      const uint32_t partId,
                                       const void* data,
-                                      const uint64_t size)
+                                      const uint64_t size,
+                                      const uint32_t uncompressedSize)
+{
+    while(m_incoming_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    // use cached message, if the part belongs to the same message like the last one
+    MultiblockMessage* message = nullptr;
+    if(m_activeIncoming != nullptr
+            && m_activeIncomingId == multiblockId)
+    {
+        message = m_activeIncoming;
+    }
+    else
+    {
+        std::map<uint64_t, MultiblockMessage>::iterator it;
+        it = m_incoming.find(multiblockId);
+        if(it != m_incoming.end())
+        {
+            message = &it->second;
+            m_activeIncoming = message;
+            m_activeIncomingId = multiblockId;
+        }
+    }
+
+    // check if part is valid for the message
+    const uint64_t partSize = uncompressedSize != 0 ? uncompressedSize : size;
+    const uint64_t offset = static_cast<uint64_t>(partId) * MAX_SINGLE_MESSAGE_SIZE;
+    if(message == nullptr
+            || partId >= message->numberOfPackages
+            || offset + partSize > message->messageSize)
+    {
+        m_incoming_lock.clear(std::memory_order_release);
+        return false;
+    }
+
+    // give part of chunk-streamed message directly to the application outside of the lock
+    if(message->isChunked)
+    {
+        const uint64_t mask = 1ull << (partId % 64);
+        if((message->receivedPackages[partId / 64] & mask) != 0)
+        {
+            m_incoming_lock.clear(std::memory_order_release);
+            return true;
+        }
+
+        message->receivedPackages[partId / 64] |= mask;
+        message->numberOfReceivedPackages++;
+        const uint32_t numberOfReceivedParts = message->numberOfReceivedPackages;
+        const bool isLast = numberOfReceivedParts == message->numberOfPackages;
+        m_incoming_lock.clear(std::memory_order_release);
+
+        return deliverIncomingPart(multiblockId,
+                                   offset,
+                                   data,
+                                   size,
+                                   uncompressedSize,
+                                   numberOfReceivedParts,
+                                   isLast);
+    }
+
+    // write part to its final position
+    uint8_t* target = static_cast<uint8_t*>(message->multiBlockBuffer->data);
+    if(uncompressedSize != 0)
+    {
+        if(decompressPayload(m_session,
+                             &target[offset],
+                             uncompressedSize,
+                             data,
+                             static_cast<uint32_t>(size)) == false)
+        {
+            m_incoming_lock.clear(std::memory_order_release);
+            return false;
+        }
+    }
+    else
+    {
+        memcpy(&target[offset], data, size);
+    }
+
+    // register part within the bitmap
+    const uint64_t mask = 1ull << (partId % 64);
+    if((message->receivedPackages[partId / 64] & mask) == 0)
+    {
+        message->receivedPackages[partId / 64] |= mask;
+        message->numberOfReceivedPackages++;
+    }
+
+    // set buffer-position, when the message is complete
+    if(message->numberOfReceivedPackages == message->numberOfPackages) {
+        message->multiBlockBuffer->bufferPosition = message->messageSize;
+    }
+
+    m_incoming_lock.clear(std::memory_order_release);
+
+    return true;
+}
+
+/**
+ * @brief give a part of a chunk-streamed message to the part-callback of the session and
+ *        acknowledge the processed parts to the sender, so it can send the next parts
+ *
+ * @param multiblockId id of the multiblock-message
+ * @param offset position of the part within the complete message
+ * @param data pointer to the data
+ * @param size number of bytes
+ * @param uncompressedSize size of the decompressed part, if the data are compressed, or 0 if
+ *                         the data are uncompressed
+ * @param numberOfReceivedParts number of parts of the message, including this one
+ * @param isLast true, if this is the last missing part of the message
+ *
+ * @return false, if decompression failed, else true
+ */
+bool
+MultiblockIO::deliverIncomingPart(const uint64_t multiblockId,
+                                  const uint64_t offset,
+                                  const void* data,
+                                  const uint64_t size,
+                                  const uint32_t uncompressedSize,
+                                  const uint32_t numberOfReceivedParts,
+                                  const bool isLast)
+{
+    const void* partData = data;
+    uint64_t partSize = size;
+
+    // decompress into a buffer, which is reused for all parts
+    if(uncompressedSize != 0)
+    {
+        if(m_chunkBuffer.size() < MAX_SINGLE_MESSAGE_SIZE) {
+            m_chunkBuffer.resize(MAX_SINGLE_MESSAGE_SIZE);
+        }
+
+        if(decompressPayload(m_session,
+                             m_chunkBuffer.data(),
+                             uncompressedSize,
+                             data,
+                             static_cast<uint32_t>(size)) == false)
+        {
+            return false;
+        }
+
+        partData = m_chunkBuffer.data();
+        partSize = uncompressedSize;
+    }
+
+    if(m_session->m_processMultiblockPart != nullptr)
+    {
+        m_session->m_processMultiblockPart(m_session,
+                                           multiblockId,
+                                           offset,
+                                           partData,
+                                           partSize,
+                                           isLast);
+    }
+
+    // the sender only gets new parts of the window, after the callback has returned, so a slow
+    // application slows down the sender
+    if(isLast == false
+            && numberOfReceivedParts % MULTIBLOCK_PART_ACK_INTERVAL == 0)
+    {
+        send_Data_Multi_Part_Ack(m_session, multiblockId, numberOfReceivedParts);
+    }
+
+    return true;
+}
+
+/**
+ * @brief check if all parts of an incoming message were received
+ *
+ * @param messageBuffer incoming message to check
+ *
+ * @return true, if message is complete, else false
+ */
+bool
+MultiblockIO::isIncomingComplete(const MultiblockMessage &messageBuffer) const
+{
+    return (messageBuffer.multiBlockBuffer != nullptr || messageBuffer.isChunked)
+           && messageBuffer.numberOfReceivedPackages == messageBuffer.numberOfPackages;
+}
+
+/**
+ * @brief store the finish of an incoming message, which is not complete yet. This happens for
+ *        striped sessions, where the parts over the other connections can arrive after the
+ *        finish over the primary connection.
+ *
+ * @param multiblockId id of the multiblock-message
+ * @param flags flags of the header of the finish-message
+ * @param blockerId blocker-id of the finish-message
+ *
+ * @return false, if message-id is unknown or the message is already complete, else true
+ */
+bool
+MultiblockIO::deferIncomingFinish(const uint64_t multiblockId,
+                                  const uint8_t flags,
+                                  const uint64_t blockerId)
 {
     bool result = false;
-    while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    while(m_incoming_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
 
     std::map<uint64_t, MultiblockMessage>::iterator it;
     it = m_incoming.find(multiblockId);
 
-    if(it != m_incoming.end())
+    if(it != m_incoming.end()
+            && isIncomingComplete(it->second) == false)
     {
-        result = Kitsunemimi::addData_DataBuffer(*it->second.multiBlockBuffer,
-                                                 data,
-                                                 size);
+        it->second.finishReceived = true;
+        it->second.finishFlags = flags;
+        it->second.finishBlockerId = blockerId;
+        it->second.finishTime = HeartbeatHandler::getCurrentTime();
+        result = true;
     }
 
     m_incoming_lock.clear(std::memory_order_release);
@@ -289,9 +752,86 @@ MultiblockIO::writeIntoIncomingBuffer(const uint64_t multiblockId,
 }
 
 /**
- * @brief remove message form the outgoing-message-buffer
+ * @brief take the stored finish of an incoming message, after its last part was received
  *
- * @param multiblockId it of the multiblock-message
+ * @param multiblockId id of the multiblock-message
+ * @param flags reference for the flags of the stored finish-message
+ * @param blockerId reference for the blocker-id of the stored finish-message
+ *
+ * @return true, if the message is complete and its finish was stored before, else false
+ */
+bool
+MultiblockIO::takeDeferredFinish(const uint64_t multiblockId,
+                                 uint8_t &flags,
+                                 uint64_t &blockerId)
+{
+    bool result = false;
+
+    while(m_incoming_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::map<uint64_t, MultiblockMessage>::iterator it;
+    it = m_incoming.find(multiblockId);
+
+    if(it != m_incoming.end()
+            && it->second.finishReceived
+            && isIncomingComplete(it->second))
+    {
+        it->second.finishReceived = false;
+        flags = it->second.finishFlags;
+        blockerId = it->second.finishBlockerId;
+        result = true;
+    }
+
+    m_incoming_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief remove all incoming messages, whose finish was stored for longer than the allowed
+ *        time, because their missing parts will never arrive, for example because the
+ *        additional connection, which transferred them, was broken
+ *
+ * @param timeout max time in milliseconds since the arrival of the finish
+ *
+ * @return list of the removed messages, whose buffers have to be released by the caller
+ */
+std::vector<MultiblockIO::MultiblockMessage>
+MultiblockIO::takeExpiredFinishes(const uint64_t timeout)
+{
+    std::vector<MultiblockMessage> result;
+    const uint64_t now = HeartbeatHandler::getCurrentTime();
+
+    while(m_incoming_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::map<uint64_t, MultiblockMessage>::iterator it = m_incoming.begin();
+    while(it != m_incoming.end())
+    {
+        if(it->second.finishReceived == false
+                || now - it->second.finishTime < timeout)
+        {
+            it++;
+            continue;
+        }
+
+        if(m_activeIncoming == &it->second) {
+            m_activeIncoming = nullptr;
+        }
+
+        result.push_back(it->second);
+        it = m_incoming.erase(it);
+    }
+
+    m_incoming_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief remove message form the outgoing-message-buffer. If the message is currently in
+ *        progress of sending, it is only marked as aborted and removed by the sender-thread.
+ *
+ * @param multiblockId it of the multiblock-message or 0 to remove all messages
  *
  * @return true, if multiblock-id was found within the buffer, else false
  */
@@ -299,29 +839,40 @@ bool
 MultiblockIO::removeOutgoingMessage(const uint64_t multiblockId)
 {
     bool result = false;
-    while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    std::vector<MultiblockMessage> removedMessages;
+    std::unique_lock<std::mutex> lock(m_outgoingMutex);
 
-    std::deque<MultiblockMessage>::iterator it;
-    for(it = m_outgoing.begin();
-        it != m_outgoing.end();
-        it++)
+    std::list<MultiblockMessage>::iterator it = m_outgoing.begin();
+    while(it != m_outgoing.end())
     {
-        if(it->multiblockId == multiblockId)
+        if(multiblockId != 0
+                && it->multiblockId != multiblockId)
         {
-            if(it->currentSend)
-            {
-                m_aborCurrentMessage = true;
-            }
-            else
-            {
-                m_outgoing.erase(it);
-                delete it->multiBlockBuffer;
-                result = true;
-            }
+            it++;
+            continue;
+        }
+
+        result = true;
+
+        if(it->currentSend)
+        {
+            it->abort = true;
+            it++;
+        }
+        else
+        {
+            removedMessages.push_back(*it);
+            it = m_outgoing.erase(it);
         }
     }
 
-    m_outgoing_lock.clear(std::memory_order_release);
+    m_session->m_metrics.updateMultiblockQueueDepth(m_outgoing.size());
+    lock.unlock();
+
+    // completion-callbacks are triggered outside of the lock, so they can send new messages
+    for(uint64_t i = 0; i < removedMessages.size(); i++) {
+        releaseOutgoingPayload(removedMessages[i], false);
+    }
 
     return result;
 }
@@ -338,18 +889,18 @@ bool
 MultiblockIO::removeIncomingMessage(const uint64_t multiblockId)
 {
     bool result = false;
-    while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    while(m_incoming_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
 
     std::map<uint64_t, MultiblockMessage>::iterator it;
     it = m_incoming.find(multiblockId);
 
     if(it != m_incoming.end())
     {
-        if(it->second.currentSend) {
-            m_aborCurrentMessage = true;
-        } else {
-            m_incoming.erase(it);
+        if(m_activeIncoming == &it->second) {
+            m_activeIncoming = nullptr;
         }
+
+        m_incoming.erase(it);
         result = true;
     }
 
@@ -359,64 +910,129 @@ MultiblockIO::removeIncomingMessage(const uint64_t multiblockId)
 }
 
 /**
- * @brief generate a new random 64bit-value, which is not 0
+ * @brief generate a new random 64bit-value, which is not 0. Each thread has its own
+ *        xorshift-generator, so there is no shared lock like in rand().
  *
  * @return new 64bit-value
  */
 uint64_t
 MultiblockIO::getRandValue()
 {
+    thread_local uint64_t state = 0;
+
+    // init state of the generator with the first call within the thread
+    if(state == 0)
+    {
+        std::random_device randomDevice;
+        state = (static_cast<uint64_t>(randomDevice()) << 32) ^ randomDevice();
+        state ^= std::hash<std::thread::id>()(std::this_thread::get_id());
+        state ^= static_cast<uint64_t>(
+                    std::chrono::steady_clock::now().time_since_epoch().count());
+        if(state == 0) {
+            state = 0x9E3779B97F4A7C15ull;
+        }
+    }
+
     uint64_t newId = 0;
 
     // 0 is the undefined value and should never be allowed
-    while(newId == 0) {
-        newId = (static_cast<uint64_t>(rand()) << 32) | static_cast<uint64_t>(rand());
+    while(newId == 0)
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        newId = state * 0x2545F4914F6CDD1Dull;
     }
 
     return newId;
 }
 
 /**
- * @brief Main-loop to send data async, if some exist within the outgoing-message-buffer. If no
- *        messages exist within the buffer, the loop is blocked until the next incoming
- *        init-reply-message.
+ * @brief Main-loop to send data async, if some exist within the outgoing-message-buffer. Only
+ *        used, if the session is not handled by the io-engine.
  */
 void
 MultiblockIO::run()
 {
     while(m_abort == false)
     {
-        MultiblockMessage tempBuffer;
-        while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+        if(m_session->getAffinityVersion() != m_session->m_sendAffinityVersion) {
+            m_session->applySendAffinity();
+        }
 
-        if(m_outgoing.empty() == false)
-        {
-            tempBuffer = m_outgoing.front();
+        processOutgoing(true);
+    }
+}
 
-            if(tempBuffer.isReady)
-            {
-                tempBuffer.currentSend = true;
-            }
-            else
-            {
-                m_outgoing.pop_front();
-                m_outgoing.push_back(tempBuffer);
-            }
+/**
+ * @brief send the next parts of the first sendable message of the outgoing-message-buffer. The
+ *        parts of all ready messages are send interleaved, where each message can send as
+ *        many parts in a row, as its priority allows.
+ *
+ * @param wait true to wait for the next incoming init-reply-message or acknowledgement of
+ *             parts, if no message is ready at the moment
+ *
+ * @return true, if parts were send, else false
+ */
+bool
+MultiblockIO::processOutgoing(const bool wait)
+{
+    std::unique_lock<std::mutex> lock(m_outgoingMutex);
 
-            m_outgoing_lock.clear(std::memory_order_release);
-        }
-        else
-        {
-            // if buffer is emply, then block the thread
-            m_outgoing_lock.clear(std::memory_order_release);
-            blockThread();
+    // get first ready message of the queue, which is not waiting for acknowledged parts
+    std::list<MultiblockMessage>::iterator it;
+    for(it = m_outgoing.begin();
+        it != m_outgoing.end();
+        it++)
+    {
+        if(isSendable(*it)) {
+            break;
         }
+    }
 
-        // if a valid message was taken, then send the message
-        if(tempBuffer.multiBlockBuffer != nullptr) {
-            sendOutgoingData(tempBuffer);
+    // if no message is ready, then block the thread
+    if(it == m_outgoing.end())
+    {
+        if(wait) {
+            m_outgoingCv.wait_for(lock, std::chrono::milliseconds(100));
         }
+        return false;
     }
+
+    // send parts of the message outside of the lock. Other entries can be added or removed
+    // in the meantime, without invalidating the reference into the list. The fields, which are
+    // changed by other threads, are copied once for the whole quantum, so an abort or new
+    // acknowledged parts are seen with the next turn of the message.
+    MultiblockMessage* message = &(*it);
+    message->currentSend = true;
+    const uint32_t numberOfParts = message->priority;
+    const bool abort = message->abort;
+    const uint32_t acknowledgedPackages = message->acknowledgedPackages;
+    lock.unlock();
+
+    const bool finished = sendOutgoingParts(*message,
+                                            numberOfParts,
+                                            abort,
+                                            acknowledgedPackages);
+
+    lock.lock();
+    message->currentSend = false;
+    if(finished)
+    {
+        const MultiblockMessage finishedMessage = *message;
+        m_outgoing.erase(it);
+        m_session->m_metrics.updateMultiblockQueueDepth(m_outgoing.size());
+        lock.unlock();
+
+        finishOutgoingMessage(finishedMessage);
+    }
+    else
+    {
+        // move message to the end of the queue to give the next ready message its turn
+        m_outgoing.splice(m_outgoing.end(), m_outgoing, it);
+    }
+
+    return true;
 }
 
 } // namespace Sakura
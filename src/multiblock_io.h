@@ -27,9 +27,12 @@
 #include <assert.h>
 #include <atomic>
 #include <utility>
-#include <deque>
+#include <list>
 #include <map>
 #include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
 
 #include <libKitsunemimiCommon/buffer/data_buffer.h>
 #include <libKitsunemimiCommon/threading/thread.h>
@@ -39,6 +42,7 @@ namespace Kitsunemimi
 namespace Sakura
 {
 class Session;
+class IoLoop;
 
 class MultiblockIO
         : public Kitsunemimi::Thread
@@ -49,53 +53,135 @@ public:
     {
         bool isReady = false;
         bool currentSend = false;
+        bool abort = false;
+        uint32_t priority = 1;
         uint64_t blockerId = 0;
         uint64_t multiblockId = 0;
         uint64_t messageSize = 0;
         uint32_t numberOfPackages = 0;
         uint32_t courrentPackage = 0;
         Kitsunemimi::DataBuffer* multiBlockBuffer = nullptr;
+
+        // payload, which is owned by the caller or mapped from a file, instead of a copy
+        const uint8_t* externalData = nullptr;
+        void* mappedRegion = nullptr;
+        uint64_t mappedSize = 0;
+        void (*processCompletion)(void*, Session*, const uint64_t, const bool) = nullptr;
+        void* completionTarget = nullptr;
+
+        // chunk-streaming, where the parts are delivered directly instead of a complete buffer
+        bool isChunked = false;
+        uint32_t partWindow = 0;
+        uint32_t acknowledgedPackages = 0;
+
+        // bitmap of the already received parts of an incoming message
+        uint32_t numberOfReceivedPackages = 0;
+        std::vector<uint64_t> receivedPackages;
+
+        // finish, which arrived over the primary connection before all parts over the other
+        // connections of a striped session
+        bool finishReceived = false;
+        uint8_t finishFlags = 0;
+        uint64_t finishBlockerId = 0;
+        uint64_t finishTime = 0;
     };
 
     MultiblockIO(Session* session);
 
     Session* m_session = nullptr;
 
+    // loop of the io-engine, which sends the messages instead of the own thread
+    std::atomic<IoLoop*> m_ioLoop;
+
     // create
     std::pair<DataBuffer*, uint64_t> createOutgoingBuffer(const void* data,
                                                           const uint64_t size,
                                                           const bool answerExpected=false,
-                                                          const uint64_t blockerId=0);
+                                                          const uint64_t blockerId=0,
+                                                          const uint64_t multiblockId=0,
+                                                          const uint32_t priority=1);
+    uint64_t createOutgoingReference(const void* data,
+                                     const uint64_t size,
+                                     const uint32_t priority,
+                                     void* mappedRegion,
+                                     const uint64_t mappedSize,
+                                     void (*processCompletion)(void*,
+                                                               Session*,
+                                                               const uint64_t,
+                                                               const bool),
+                                     void* completionTarget,
+                                     const uint64_t blockerId=0);
     bool createIncomingBuffer(const uint64_t multiblockId,
-                              const uint64_t size);
+                              const uint64_t size,
+                              const bool chunked = false);
 
     // process outgoing
-    bool makeOutgoingReady(const uint64_t multiblockId);
-    bool sendOutgoingData(const MultiblockMessage &messageBuffer);
+    bool makeOutgoingReady(const uint64_t multiblockId,
+                           const uint32_t partWindow = 0);
+    bool acknowledgeOutgoingParts(const uint64_t multiblockId,
+                                  const uint32_t numberOfParts);
+    bool setOutgoingPriority(const uint64_t multiblockId,
+                             const uint32_t priority);
 
     // process incoming
     MultiblockMessage getIncomingBuffer(const uint64_t multiblockId);
     bool writeIntoIncomingBuffer(const uint64_t multiblockId,
+                                 const uint32_t partId,
                                  const void* data,
-                                 const uint64_t size);
+                                 const uint64_t size,
+                                 const uint32_t uncompressedSize = 0);
+    bool isIncomingComplete(const MultiblockMessage &messageBuffer) const;
+    bool deferIncomingFinish(const uint64_t multiblockId,
+                             const uint8_t flags,
+                             const uint64_t blockerId);
+    bool takeDeferredFinish(const uint64_t multiblockId,
+                            uint8_t &flags,
+                            uint64_t &blockerId);
+    std::vector<MultiblockMessage> takeExpiredFinishes(const uint64_t timeout);
 
     // remove
     bool removeOutgoingMessage(const uint64_t multiblockId=0);
     bool removeIncomingMessage(const uint64_t multiblockId);
 
-    uint64_t getRandValue();
+    static uint64_t getRandValue();
+
+    bool processOutgoing(const bool wait);
 
 protected:
     void run();
 
 private:
-    bool m_aborCurrentMessage = false;
-
-    std::atomic_flag m_outgoing_lock = ATOMIC_FLAG_INIT;
-    std::deque<MultiblockMessage> m_outgoing;
+    std::mutex m_outgoingMutex;
+    std::condition_variable m_outgoingCv;
+    std::list<MultiblockMessage> m_outgoing;
+
+    void notifyOutgoing();
+    bool isSendable(const MultiblockMessage &messageBuffer) const;
+    bool sendOutgoingParts(MultiblockMessage &messageBuffer,
+                           const uint32_t numberOfParts,
+                           const bool abort,
+                           const uint32_t acknowledgedPackages);
+    void finishOutgoingMessage(const MultiblockMessage &messageBuffer);
+    void releaseOutgoingPayload(const MultiblockMessage &messageBuffer,
+                                const bool success);
 
     std::atomic_flag m_incoming_lock = ATOMIC_FLAG_INIT;
     std::map<uint64_t, MultiblockMessage> m_incoming;
+
+    // cache of the last used incoming message to avoid a map-lookup for each part
+    uint64_t m_activeIncomingId = 0;
+    MultiblockMessage* m_activeIncoming = nullptr;
+
+    // target for decompressed parts of chunk-streamed messages
+    std::vector<uint8_t> m_chunkBuffer;
+
+    bool deliverIncomingPart(const uint64_t multiblockId,
+                             const uint64_t offset,
+                             const void* data,
+                             const uint64_t size,
+                             const uint32_t uncompressedSize,
+                             const uint32_t numberOfReceivedParts,
+                             const bool isLast);
 };
 
 } // namespace Sakura
@@ -0,0 +1,297 @@
+/**
+ * @file       payload_checksum.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include <payload_checksum.h>
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+// reflected polynomial of crc32c (castagnoli), which is also used by the cpu-instructions
+#define CRC32C_POLYNOMIAL 0x82F63B78
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief lookup-table for the software-calculation
+ */
+struct Crc32cTable
+{
+    uint32_t values[256];
+
+    Crc32cTable()
+    {
+        for(uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t value = i;
+            for(uint32_t bit = 0; bit < 8; bit++) {
+                value = (value >> 1) ^ (CRC32C_POLYNOMIAL & (0 - (value & 1)));
+            }
+            values[i] = value;
+        }
+    }
+};
+
+/**
+ * @brief calculate crc32c without special cpu-instructions
+ *
+ * @param crc inverted crc of the data before
+ * @param data pointer to the data
+ * @param size number of bytes
+ *
+ * @return inverted crc
+ */
+static uint32_t
+crc32cSoftware(uint32_t crc,
+               const uint8_t* data,
+               uint64_t size)
+{
+    static const Crc32cTable table;
+
+    while(size > 0)
+    {
+        crc = table.values[(crc ^ *data) & 0xFF] ^ (crc >> 8);
+        data++;
+        size--;
+    }
+
+    return crc;
+}
+
+#if defined(__x86_64__)
+
+/**
+ * @brief calculate crc32c with the sse4.2-instructions
+ *
+ * @param crc inverted crc of the data before
+ * @param data pointer to the data
+ * @param size number of bytes
+ *
+ * @return inverted crc
+ */
+__attribute__((target("sse4.2")))
+static uint32_t
+crc32cHardware(uint32_t crc,
+               const uint8_t* data,
+               uint64_t size)
+{
+    uint64_t crc64 = crc;
+    while(size >= 8)
+    {
+        uint64_t value = 0;
+        memcpy(&value, data, 8);
+        crc64 = _mm_crc32_u64(crc64, value);
+        data += 8;
+        size -= 8;
+    }
+
+    crc = static_cast<uint32_t>(crc64);
+    while(size > 0)
+    {
+        crc = _mm_crc32_u8(crc, *data);
+        data++;
+        size--;
+    }
+
+    return crc;
+}
+
+/**
+ * @brief check if the cpu supports the sse4.2-instructions
+ */
+static bool
+checkHardwareSupport()
+{
+    return __builtin_cpu_supports("sse4.2");
+}
+
+#elif defined(__aarch64__)
+
+/**
+ * @brief calculate crc32c with the crc-instructions of armv8
+ *
+ * @param crc inverted crc of the data before
+ * @param data pointer to the data
+ * @param size number of bytes
+ *
+ * @return inverted crc
+ */
+__attribute__((target("+crc")))
+static uint32_t
+crc32cHardware(uint32_t crc,
+               const uint8_t* data,
+               uint64_t size)
+{
+    while(size >= 8)
+    {
+        uint64_t value = 0;
+        memcpy(&value, data, 8);
+        crc = __crc32cd(crc, value);
+        data += 8;
+        size -= 8;
+    }
+
+    while(size > 0)
+    {
+        crc = __crc32cb(crc, *data);
+        data++;
+        size--;
+    }
+
+    return crc;
+}
+
+/**
+ * @brief check if the cpu supports the crc-instructions of armv8
+ */
+static bool
+checkHardwareSupport()
+{
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+
+#else
+
+// no special instructions available for other architectures
+static uint32_t
+crc32cHardware(uint32_t crc,
+               const uint8_t* data,
+               uint64_t size)
+{
+    return crc32cSoftware(crc, data, size);
+}
+
+static bool
+checkHardwareSupport()
+{
+    return false;
+}
+
+#endif
+
+/**
+ * @brief check if the crc32c is calculated by special cpu-instructions
+ *
+ * @return true, if the cpu supports sse4.2 or the crc-instructions of armv8, else false
+ */
+bool
+isHardwareChecksumAvailable()
+{
+    static const bool available = checkHardwareSupport();
+    return available;
+}
+
+/**
+ * @brief calculate the crc32c of a block of data
+ *
+ * @param crc crc of the data before, to continue the calculation over multiple blocks, or 0 for
+ *            the first block
+ * @param data pointer to the data
+ * @param size number of bytes
+ *
+ * @return crc32c of all data until now
+ */
+uint32_t
+crc32c(uint32_t crc,
+       const void* data,
+       const uint64_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    crc = ~crc;
+    if(isHardwareChecksumAvailable()) {
+        crc = crc32cHardware(crc, bytes, size);
+    } else {
+        crc = crc32cSoftware(crc, bytes, size);
+    }
+
+    return ~crc;
+}
+
+/**
+ * @brief calculate the crc32c of a block of data always without special cpu-instructions, for
+ *        example to compare the result with the calculation by the cpu
+ *
+ * @param crc crc of the data before, to continue the calculation over multiple blocks, or 0 for
+ *            the first block
+ * @param data pointer to the data
+ * @param size number of bytes
+ *
+ * @return crc32c of all data until now
+ */
+uint32_t
+crc32cWithoutHardware(uint32_t crc,
+                      const void* data,
+                      const uint64_t size)
+{
+    return ~crc32cSoftware(~crc, static_cast<const uint8_t*>(data), size);
+}
+
+/**
+ * @brief calculate the crc32c of a range of a message, which is split into multiple segments
+ *
+ * @param segments list of segments, which together form the complete message
+ * @param numberOfSegments number of segments within the list
+ * @param begin position of the first byte of the range within the message
+ * @param end position behind the last byte of the range within the message
+ *
+ * @return crc32c of the range
+ */
+uint32_t
+getSegmentsChecksum(const struct iovec* segments,
+                    const uint32_t numberOfSegments,
+                    const uint64_t begin,
+                    const uint64_t end)
+{
+    uint32_t crc = 0;
+    uint64_t position = 0;
+
+    for(uint32_t i = 0; i < numberOfSegments && position < end; i++)
+    {
+        const uint64_t segmentEnd = position + segments[i].iov_len;
+        const uint64_t rangeBegin = begin > position ? begin : position;
+        const uint64_t rangeEnd = end < segmentEnd ? end : segmentEnd;
+
+        if(rangeBegin < rangeEnd)
+        {
+            const uint8_t* data = static_cast<const uint8_t*>(segments[i].iov_base);
+            crc = crc32c(crc, &data[rangeBegin - position], rangeEnd - rangeBegin);
+        }
+
+        position = segmentEnd;
+    }
+
+    return crc;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
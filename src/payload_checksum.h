@@ -0,0 +1,50 @@
+/**
+ * @file       payload_checksum.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef PAYLOAD_CHECKSUM_H
+#define PAYLOAD_CHECKSUM_H
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+uint32_t crc32c(uint32_t crc,
+                const void* data,
+                const uint64_t size);
+uint32_t crc32cWithoutHardware(uint32_t crc,
+                               const void* data,
+                               const uint64_t size);
+uint32_t getSegmentsChecksum(const struct iovec* segments,
+                             const uint32_t numberOfSegments,
+                             const uint64_t begin,
+                             const uint64_t end);
+bool isHardwareChecksumAvailable();
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // PAYLOAD_CHECKSUM_H
@@ -0,0 +1,140 @@
+/**
+ * @file       payload_compression.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef PAYLOAD_COMPRESSION_H
+#define PAYLOAD_COMPRESSION_H
+
+#include <stdint.h>
+#include <vector>
+#include <chrono>
+
+#include <lz4.h>
+
+#include <handler/session_handler.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief compress the payload of a singleblock-message or of a part of a multiblock-message, if
+ *        compression was negotiated for the session and the payload is not smaller than the
+ *        threshold
+ *
+ * @param session session, which sends the payload
+ * @param data pointer to the uncompressed payload
+ * @param size size of the uncompressed payload
+ * @param result pointer to the compressed payload, which is only valid until the next call
+ *               within the same thread
+ * @param resultSize size of the compressed payload
+ *
+ * @return true, if payload was compressed, false, if the payload has to be send uncompressed
+ */
+inline bool
+compressPayload(Session* session,
+                const void* data,
+                const uint32_t size,
+                const void* &result,
+                uint32_t &resultSize)
+{
+    if(session->m_compressPayload == false
+            || size < SessionHandler::m_sessionHandler->m_compressionThreshold)
+    {
+        return false;
+    }
+
+    // buffer for the compressed data, which is reused for all messages of the thread
+    thread_local std::vector<char> compressBuffer;
+    const int maxSize = LZ4_compressBound(static_cast<int>(size));
+    if(compressBuffer.size() < static_cast<uint64_t>(maxSize)) {
+        compressBuffer.resize(static_cast<uint64_t>(maxSize));
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const int compressedSize = LZ4_compress_fast(static_cast<const char*>(data),
+                                                 compressBuffer.data(),
+                                                 static_cast<int>(size),
+                                                 maxSize,
+                                                 1);
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    const uint64_t duration = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+    // send uncompressed, if compression doesn't reduce the size
+    const bool useCompressed = compressedSize > 0
+                               && static_cast<uint32_t>(compressedSize) < size;
+
+    session->updateCompressionStats(size,
+                                    useCompressed ? static_cast<uint32_t>(compressedSize) : size,
+                                    duration,
+                                    true);
+
+    if(useCompressed == false) {
+        return false;
+    }
+
+    result = compressBuffer.data();
+    resultSize = static_cast<uint32_t>(compressedSize);
+
+    return true;
+}
+
+/**
+ * @brief decompress a received payload
+ *
+ * @param session session, which has received the payload
+ * @param target target-buffer for the decompressed data
+ * @param targetSize expected size of the decompressed data
+ * @param data pointer to the compressed payload
+ * @param size size of the compressed payload
+ *
+ * @return true, if successful and the decompressed data have the expected size, else false
+ */
+inline bool
+decompressPayload(Session* session,
+                  void* target,
+                  const uint32_t targetSize,
+                  const void* data,
+                  const uint32_t size)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const int decompressedSize = LZ4_decompress_safe(static_cast<const char*>(data),
+                                                     static_cast<char*>(target),
+                                                     static_cast<int>(size),
+                                                     static_cast<int>(targetSize));
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    const uint64_t duration = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+    session->updateCompressionStats(targetSize, size, duration, false);
+
+    return decompressedSize >= 0
+           && static_cast<uint32_t>(decompressedSize) == targetSize;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // PAYLOAD_COMPRESSION_H
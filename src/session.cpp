@@ -23,6 +23,12 @@
 #include <libKitsunemimiSakuraNetwork/session.h>
 #include <libKitsunemimiNetwork/abstract_socket.h>
 
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <messages_processing/session_processing.h>
 #include <messages_processing/heartbeat_processing.h>
 #include <messages_processing/stream_data_processing.h>
@@ -30,6 +36,13 @@
 #include <messages_processing/singleblock_data_processing.h>
 
 #include <multiblock_io.h>
+#include <handler/coalescing_handler.h>
+#include <handler/buffer_pool.h>
+#include <handler/callback_dispatcher.h>
+#include <handler/heartbeat_handler.h>
+#include <handler/io_engine.h>
+#include <thread_affinity.h>
+#include <shared_memory/shared_memory_channel.h>
 
 #include <libKitsunemimiPersistence/logger/logger.h>
 
@@ -51,16 +64,42 @@ namespace Kitsunemimi
 namespace Sakura
 {
 
+thread_local Session* Session::m_receivingSession = nullptr;
+
 /**
  * @brief constructor
  *
  * @param socket pointer to socket
  */
 Session::Session(Network::AbstractSocket* socket)
+    : m_metrics(SessionHandler::m_globalMetrics)
 {
+    m_messageIdCounter = 0;
+    m_forwardedMessages = 0;
+    m_forwardedBytes = 0;
+    m_forwardingWrites = 0;
+    m_queuedForwardMessages = 0;
+    m_numberOfQueuedForwards = 0;
+    m_heartbeatInterval = 1000;
+    m_heartbeatMissThreshold = 2;
+    m_missedHeartbeats = 0;
+    m_lastInboundTraffic = HeartbeatHandler::getCurrentTime();
+    m_heartbeatSendTime = 0;
+    m_streamCredits = 0;
+    m_pendingStreamCredits = 0;
+    m_numberOfStripes = 0;
+    m_affinityVersion = 0;
+    m_connectionSendBytes = 0;
+    m_activeSenders = 0;
+    m_connectionReceivedBytes = 0;
     m_multiblockIo = new MultiblockIO(this);
-    m_multiblockIo->startThread();
+
+    // multiblock-messages are send by a loop of the io-engine, if started, else by an own thread
+    if(SessionHandler::m_ioEngine->addSession(this) == false) {
+        m_multiblockIo->startThread();
+    }
     m_socket = socket;
+    m_sendBuffer = new uint8_t[SEND_BUFFER_SIZE];
 
     initStatemachine();
 }
@@ -71,13 +110,34 @@ Session::Session(Network::AbstractSocket* socket)
 Session::~Session()
 {
     closeSession(false);
+    closeStripes();
+    SessionHandler::m_coalescingHandler->removeSession(this);
+    SessionHandler::m_callbackDispatcher->removeSession(this);
+    SessionHandler::m_heartbeatHandler->removeSession(this);
+    SessionHandler::m_ioEngine->removeSession(this);
+
+    lockSend(true);
+    delete[] m_sendBuffer;
+    m_sendBuffer = nullptr;
+    delete[] m_coalescingBuffer;
+    m_coalescingBuffer = nullptr;
+    unlockSend();
+
+    // sessions of the additional connections are owned by the primary session
+    for(uint64_t i = 0; i < m_stripes.size(); i++) {
+        delete m_stripes[i];
+    }
+    m_stripes.clear();
 }
 
 /**
- * @brief Session::sendStreamData
- * @param stackBuffer
- * @param replyExpected
- * @return
+ * @brief send each block of a stack-buffer as stream-message. With active flow-control, it
+ *        blocks until the other side has granted enough credits for each block.
+ *
+ * @param stackBuffer stack-buffer with the blocks, which should be send
+ * @param replyExpected if true, the other side sends a reply-message to check timeouts
+ *
+ * @return false if session is NOT ready to send or no credits were granted in time, else true
  */
 bool
 Session::sendStreamData(StackBuffer &stackBuffer,
@@ -90,6 +150,13 @@ Session::sendStreamData(StackBuffer &stackBuffer,
             it != stackBuffer.blocks.end();
             it++)
         {
+            const uint32_t payloadSize = static_cast<uint32_t>((*it)->bufferPosition)
+                                         - sizeof(CommonMessageFooter)
+                                         - sizeof(Data_Stream_Header);
+            if(acquireStreamCredits(getStreamMessageSize(payloadSize), true) == false) {
+                return false;
+            }
+
             send_Data_Stream(this, (*it), replyExpected);
         }
 
@@ -100,268 +167,1427 @@ Session::sendStreamData(StackBuffer &stackBuffer,
 }
 
 /**
- * @brief send data as stream
+ * @brief send data as stream. With active flow-control, it blocks until the other side has
+ *        granted enough credits.
  *
  * @param data data-pointer
  * @param size number of bytes
  * @param replyExpected if true, the other side sends a reply-message to check timeouts
  *
- * @return false if session is NOT ready to send, else true
+ * @return false if session is NOT ready to send or no credits were granted in time, else true
  */
 bool
 Session::sendStreamData(const void* data,
                         const uint64_t size,
                         const bool replyExpected)
 {
-    if(m_statemachine.isInState(ACTIVE))
+    return sendStreamMessages(data, size, replyExpected, true);
+}
+
+/**
+ * @brief send data as stream without blocking. With active flow-control, nothing is send, if
+ *        the other side has not granted enough credits for the complete data.
+ *
+ * @param data data-pointer
+ * @param size number of bytes
+ * @param replyExpected if true, the other side sends a reply-message to check timeouts
+ *
+ * @return false if session is NOT ready to send or there are not enough credits at the moment
+ *         (check with getStreamCredits), else true
+ */
+bool
+Session::trySendStreamData(const void* data,
+                           const uint64_t size,
+                           const bool replyExpected)
+{
+    return sendStreamMessages(data, size, replyExpected, false);
+}
+
+/**
+ * @brief split data into stream-messages and send them
+ *
+ * @param data data-pointer
+ * @param size number of bytes
+ * @param replyExpected if true, the other side sends a reply-message to check timeouts
+ * @param wait true to wait for credits of each message, false to take the credits for all
+ *             messages at once or to send nothing
+ *
+ * @return false if session is NOT ready to send or there were not enough credits, else true
+ */
+bool
+Session::sendStreamMessages(const void* data,
+                            const uint64_t size,
+                            const bool replyExpected,
+                            const bool wait)
+{
+    if(m_statemachine.isInState(ACTIVE) == false) {
+        return false;
+    }
+
+    // without waiting, the credits for all messages have to be available at once
+    if(wait == false)
     {
-        uint64_t totalSize = size;
-        uint64_t currentMessageSize = 0;
-        uint32_t partCounter = 0;
-        bool result = true;
+        const uint64_t numberOfFullMessages = size / MAX_SINGLE_MESSAGE_SIZE;
+        const uint32_t rest = static_cast<uint32_t>(size % MAX_SINGLE_MESSAGE_SIZE);
+        uint64_t credits = numberOfFullMessages * getStreamMessageSize(MAX_SINGLE_MESSAGE_SIZE);
+        if(rest != 0) {
+            credits += getStreamMessageSize(rest);
+        }
 
-        while(totalSize != 0)
+        if(credits > STREAM_CREDIT_WINDOW
+                || acquireStreamCredits(static_cast<uint32_t>(credits), false) == false)
         {
-            currentMessageSize = MAX_SINGLE_MESSAGE_SIZE;
-            if(totalSize <= MAX_SINGLE_MESSAGE_SIZE) {
-                currentMessageSize = totalSize;
-            }
-            totalSize -= currentMessageSize;
+            return false;
+        }
+    }
 
-            const uint8_t* dataPointer = static_cast<const uint8_t*>(data);
+    const uint8_t* dataPointer = static_cast<const uint8_t*>(data);
+    uint64_t totalSize = size;
+    uint64_t position = 0;
+    bool result = true;
 
-            bool ret =  send_Data_Stream(this,
-                                         dataPointer + (MAX_SINGLE_MESSAGE_SIZE * partCounter),
-                                         static_cast<uint32_t>(currentMessageSize),
-                                         replyExpected);
-            result = result && ret;
+    while(totalSize != 0)
+    {
+        uint32_t currentMessageSize = MAX_SINGLE_MESSAGE_SIZE;
+        if(totalSize <= MAX_SINGLE_MESSAGE_SIZE) {
+            currentMessageSize = static_cast<uint32_t>(totalSize);
         }
 
-        return result;
+        if(wait
+                && acquireStreamCredits(getStreamMessageSize(currentMessageSize), true) == false)
+        {
+            return false;
+        }
+
+        const bool ret = send_Data_Stream(this,
+                                          dataPointer + position,
+                                          currentMessageSize,
+                                          replyExpected);
+        result = result && ret;
+
+        totalSize -= currentMessageSize;
+        position += currentMessageSize;
     }
 
-    return false;
+    return result;
 }
 
 /**
- * @brief send data a multi-block-message
+ * @brief check if flow-control of stream-messages was negotiated for the session
  *
- * @param data data-pointer
- * @param size number of bytes
+ * @return true, if both sides of the session have enabled flow-control, else false
+ */
+bool
+Session::isStreamFlowControlActive() const
+{
+    return m_streamFlowControl;
+}
+
+/**
+ * @brief get the number of bytes, which can be send as stream-messages at the moment, before
+ *        the other side has to grant new credits
  *
- * @return
+ * @return number of bytes of available credits
  */
-uint64_t
-Session::sendStandaloneData(const void* data,
-                            const uint64_t size)
+int64_t
+Session::getStreamCredits() const
 {
-    if(m_statemachine.isInState(ACTIVE))
+    return m_streamCredits.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief initialize the flow-control of stream-messages while initializing the session
+ *
+ * @param enable true, if both sides support flow-control
+ */
+void
+Session::initStreamFlowControl(const bool enable)
+{
+    m_streamCredits = STREAM_CREDIT_WINDOW;
+    m_pendingStreamCredits = 0;
+    m_streamFlowControl = enable;
+}
+
+/**
+ * @brief take credits for a new stream-message
+ *
+ * @param numberOfBytes total size of the stream-message
+ * @param wait true to wait until the other side grants new credits
+ *
+ * @return true, if credits were taken or flow-control is not active, false if there were not
+ *         enough credits and waiting was disabled, failed or timed out
+ */
+bool
+Session::acquireStreamCredits(const uint32_t numberOfBytes,
+                              const bool wait)
+{
+    if(m_streamFlowControl == false) {
+        return true;
+    }
+
+    int64_t current = m_streamCredits.load(std::memory_order_relaxed);
+    while(current >= numberOfBytes)
     {
-        if(size <= MAX_SINGLE_MESSAGE_SIZE)
+        if(m_streamCredits.compare_exchange_weak(current, current - numberOfBytes)) {
+            return true;
+        }
+    }
+
+    if(wait == false) {
+        return false;
+    }
+
+    // the receiving thread of the session can not wait, because it has to process the credits
+    if(m_receivingSession == this)
+    {
+        m_streamCredits.fetch_sub(numberOfBytes);
+        return true;
+    }
+
+    const std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(STREAM_CREDIT_TIMEOUT);
+
+    std::unique_lock<std::mutex> lock(m_creditMutex);
+    while(true)
+    {
+        current = m_streamCredits.load(std::memory_order_relaxed);
+        if(current >= numberOfBytes)
         {
-            const uint64_t singleblockId = m_multiblockIo->getRandValue();
-            send_Data_SingleBlock(this, singleblockId, data, size);
-            return singleblockId;
+            if(m_streamCredits.compare_exchange_weak(current, current - numberOfBytes)) {
+                return true;
+            }
+            continue;
         }
-        else
+
+        if(m_statemachine.isInState(ACTIVE) == false) {
+            return false;
+        }
+
+        if(m_creditCv.wait_until(lock, deadline) == std::cv_status::timeout
+                && m_streamCredits.load() < numberOfBytes)
         {
-            std::pair<DataBuffer*, uint64_t> result;
-            result = m_multiblockIo->createOutgoingBuffer(data, size, false);
-            return result.second;
+            lock.unlock();
+            m_metrics.addTimeout();
+            m_processError(this,
+                           Session::errorCodes::MESSAGE_TIMEOUT,
+                           "TIMEOUT while waiting for stream-credits");
+            return false;
         }
     }
-
-    return 0;
 }
 
 /**
- * @brief Session::sendRequest
- * @param data
- * @param size
- * @param timeout
- * @return
+ * @brief add credits, which were granted by the other side, and wake up waiting senders
+ *
+ * @param numberOfBytes number of granted bytes
  */
-DataBuffer*
-Session::sendRequest(const void *data,
-                     const uint64_t size,
-                     const uint64_t timeout)
+void
+Session::addStreamCredits(const uint32_t numberOfBytes)
 {
-    if(m_statemachine.isInState(ACTIVE))
+    m_streamCredits.fetch_add(numberOfBytes);
+
     {
-        uint64_t id = 0;
+        std::unique_lock<std::mutex> lock(m_creditMutex);
+        m_creditCv.notify_all();
+    }
 
-        if(size <= MAX_SINGLE_MESSAGE_SIZE)
-        {
-            id = m_multiblockIo->getRandValue();
-            send_Data_SingleBlock(this,
-                                  id,
-                                  data,
-                                  static_cast<uint32_t>(size));
-        }
-        else
-        {
-            std::pair<DataBuffer*, uint64_t> result;
-            result = m_multiblockIo->createOutgoingBuffer(data, size, true);
-            id = result.second;
-        }
+    // forwarded messages of the linked session are only retried with new credits
+    if(m_numberOfQueuedForwards.load() != 0) {
+        sendQueuedForwards();
+    }
+}
 
-        return SessionHandler::m_blockerHandler->blockMessage(id, timeout, this);
+/**
+ * @brief add forwarded messages of the linked session, which have to wait for the stream-credits
+ *        of this session, to the end of the queue and send as much as possible directly
+ *
+ * @param queuedForwards complete messages with already patched session-id
+ */
+void
+Session::queueForwards(std::vector<QueuedForward> &queuedForwards)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_queuedForwardsMutex);
+        for(QueuedForward &queuedForward : queuedForwards) {
+            m_queuedForwards.push_back(std::move(queuedForward));
+        }
+        m_numberOfQueuedForwards = m_queuedForwards.size();
     }
 
-    return nullptr;
+    // credits could be granted while the messages were collected
+    sendQueuedForwards();
 }
 
 /**
- * @brief Session::sendResponse
- * @param data
- * @param size
- * @param blockerId
- * @return
+ * @brief send the queued messages of the linked session in order, until a stream-message has no
+ *        credits anymore. The credits of sent stream-messages are given back to the other side
+ *        of the linked session.
  */
-uint64_t
-Session::sendResponse(const void *data,
-                      const uint64_t size,
-                      const uint64_t blockerId)
+void
+Session::sendQueuedForwards()
 {
-    if(m_statemachine.isInState(ACTIVE))
+    std::unique_lock<std::mutex> lock(m_queuedForwardsMutex);
+
+    Session* linkedSession = getLinkedSession();
+    bool grantCredits = false;
+
+    while(m_queuedForwards.empty() == false)
     {
-        if(size < MAX_SINGLE_MESSAGE_SIZE)
+        QueuedForward &queuedForward = m_queuedForwards.front();
+        const uint32_t messageSize = static_cast<uint32_t>(queuedForward.message.size());
+        if(queuedForward.needsCredits
+                && acquireStreamCredits(messageSize, false) == false)
         {
-            const uint64_t singleblockId = m_multiblockIo->getRandValue();
-            send_Data_SingleBlock(this,
-                                  singleblockId,
-                                  data,
-                                  static_cast<uint32_t>(size),
-                                  blockerId);
-            return singleblockId;
+            break;
         }
-        else
+
+        struct iovec segment;
+        segment.iov_base = queuedForward.message.data();
+        segment.iov_len = queuedForward.message.size();
+        sendSegments(&segment, 1);
+
+        if(queuedForward.needsCredits
+                && linkedSession != nullptr)
         {
-            std::pair<DataBuffer*, uint64_t> result;
-            result = m_multiblockIo->createOutgoingBuffer(data, size, false, blockerId);
-            return result.second;
+            grantCredits = linkedSession->consumeStreamMessage(messageSize) || grantCredits;
         }
+
+        m_queuedForwards.pop_front();
     }
 
-    return 0;
+    m_numberOfQueuedForwards = m_queuedForwards.size();
+    lock.unlock();
+
+    if(grantCredits) {
+        send_Data_Stream_Credit(linkedSession);
+    }
 }
 
 /**
- * @brief abort a multi-block-message
+ * @brief register a processed incoming stream-message, whose space within the ring-buffer can
+ *        be given back to the other side
  *
- * @param multiblockMessageId id of the multi-block-message, which should be aborted
+ * @param numberOfBytes total size of the processed stream-message
+ *
+ * @return true, if enough credits are collected for a separate credit-message, else false
  */
-void
-Session::abortMessages(const uint64_t multiblockMessageId)
+bool
+Session::consumeStreamMessage(const uint32_t numberOfBytes)
 {
-    if(m_multiblockIo->removeOutgoingMessage(multiblockMessageId) == false) {
-        send_Data_Multi_Abort_Init(this, multiblockMessageId);
+    if(m_streamFlowControl == false) {
+        return false;
     }
+
+    const uint32_t pending = m_pendingStreamCredits.fetch_add(numberOfBytes) + numberOfBytes;
+    return pending >= STREAM_CREDIT_THRESHOLD;
 }
 
 /**
- * @brief Session::setStreamMessageCallback
- * @param streamDataTarget
+ * @brief take all collected credits to piggyback them on an outgoing message
+ *
+ * @return number of bytes, which are granted to the other side
+ */
+uint32_t
+Session::takePendingStreamCredits()
+{
+    if(m_streamFlowControl == false) {
+        return 0;
+    }
+
+    return m_pendingStreamCredits.exchange(0);
+}
+
+/**
+ * @brief enable or disable the coalescing of stream-messages. If enabled, small stream-messages
+ *        are collected within a buffer of the session and send together, when the threshold or
+ *        the timeout is reached, or when flushStreamData is called.
+ *
+ * @param flushThreshold number of bytes, until the collected messages are send. 0 disables the
+ *                       coalescing and sends all already collected messages.
+ * @param flushTimeout maximum time in microseconds, which a collected message has to wait
+ *
+ * @return false, if threshold is too big, else true
+ */
+bool
+Session::setStreamCoalescing(const uint32_t flushThreshold,
+                             const uint32_t flushTimeout)
+{
+    if(flushThreshold > MESSAGE_CACHE_SIZE) {
+        return false;
+    }
+
+    lockSend(true);
+
+    // send collected messages before the buffer is changed
+    flushCoalescingBuffer();
+
+    delete[] m_coalescingBuffer;
+    m_coalescingBuffer = nullptr;
+    if(flushThreshold != 0) {
+        m_coalescingBuffer = new uint8_t[flushThreshold];
+    }
+
+    m_coalescingThreshold = flushThreshold;
+    m_coalescingTimeout = flushTimeout;
+
+    unlockSend();
+
+    return true;
+}
+
+/**
+ * @brief send all stream-messages, which are collected within the coalescing-buffer
+ *
+ * @return false, if sending failed, else true
+ */
+bool
+Session::flushStreamData()
+{
+    lockSend(false);
+    const bool result = flushCoalescingBuffer();
+    unlockSend();
+
+    return result;
+}
+
+/**
+ * @brief give the buffer of a received standalone-message or response back to the buffer-pool,
+ *        when it is not used anymore. The buffer must not be used after calling this function.
+ *
+ * @param buffer buffer to release
  */
 void
-Session::setStreamMessageCallback(void (*processStreamData)(Session*,
-                                                            const void*,
-                                                            const uint64_t))
+Session::releaseBuffer(DataBuffer* buffer)
 {
-    m_processStreamData = processStreamData;
+    SessionHandler::m_bufferPool->releaseBuffer(buffer);
 }
 
 /**
- * @brief Session::setStandaloneMessageCallback
- * @param standaloneDataTarget
+ * @brief check if compression of payloads was negotiated for the session
+ *
+ * @return true, if both sides of the session have enabled compression, else false
+ */
+bool
+Session::isCompressionActive() const
+{
+    return m_compressPayload;
+}
+
+/**
+ * @brief check if the checksum of all messages was negotiated for the session
+ *
+ * @return true, if both sides of the session have enabled the checksum, else false
+ */
+bool
+Session::isPayloadChecksumActive() const
+{
+    return m_payloadChecksum;
+}
+
+/**
+ * @brief get statistics of the compression of payloads of singleblock- and multiblock-messages
+ *
+ * @return copy of the statistics
+ */
+Session::CompressionStats
+Session::getCompressionStats()
+{
+    while(m_compressionStats_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    const CompressionStats result = m_compressionStats;
+    m_compressionStats_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief update statistics of the compression
+ *
+ * @param uncompressedSize size of the payload before compression or after decompression
+ * @param compressedSize size of the compressed payload
+ * @param duration time in nanoseconds for the compression or decompression
+ * @param isCompression true for compression of an outgoing payload, false for decompression of
+ *                      an incoming payload
  */
 void
-Session::setStandaloneMessageCallback(void (*processStandaloneData)(Session*,
-                                                                    const uint64_t,
-                                                                    DataBuffer*))
+Session::updateCompressionStats(const uint32_t uncompressedSize,
+                                const uint32_t compressedSize,
+                                const uint64_t duration,
+                                const bool isCompression)
 {
-    m_processStandaloneData = processStandaloneData;
+    while(m_compressionStats_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    if(isCompression)
+    {
+        m_compressionStats.numberOfCompressions++;
+        m_compressionStats.uncompressedSendBytes += uncompressedSize;
+        m_compressionStats.compressedSendBytes += compressedSize;
+        m_compressionStats.compressionTime += duration;
+    }
+    else
+    {
+        m_compressionStats.numberOfDecompressions++;
+        m_compressionStats.uncompressedReceivedBytes += uncompressedSize;
+        m_compressionStats.compressedReceivedBytes += compressedSize;
+        m_compressionStats.decompressionTime += duration;
+    }
+
+    m_compressionStats_lock.clear(std::memory_order_release);
 }
 
 /**
- * @brief Session::setErrorCallback
- * @param errorTarget
+ * @brief get statistics of the coalescing of stream-messages
+ *
+ * @return copy of the statistics
+ */
+Session::CoalescingStats
+Session::getCoalescingStats()
+{
+    lockSend(true);
+    const CoalescingStats result = m_coalescingStats;
+    unlockSend();
+
+    return result;
+}
+
+/**
+ * @brief send data a multi-block-message
+ *
+ * @param data data-pointer
+ * @param size number of bytes
+ * @param priority number of parts, which are send in a row, when the message is interleaved
+ *                 with other multiblock-messages. Only used for multiblock-messages.
+ *
+ * @return id of the message, or 0 if session is NOT ready to send
+ */
+uint64_t
+Session::sendStandaloneData(const void* data,
+                            const uint64_t size,
+                            const uint32_t priority)
+{
+    if(m_statemachine.isInState(ACTIVE))
+    {
+        if(size <= MAX_SINGLE_MESSAGE_SIZE)
+        {
+            const uint64_t singleblockId = m_multiblockIo->getRandValue();
+            send_Data_SingleBlock(this, singleblockId, data, size);
+            return singleblockId;
+        }
+        else
+        {
+            std::pair<DataBuffer*, uint64_t> result;
+            result = m_multiblockIo->createOutgoingBuffer(data, size, false, 0, 0, priority);
+            return result.second;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief completion-callback of multiblock-messages, which were send from a reserved buffer
+ *
+ * @param target reserved buffer, which is given back to the pool
+ */
+void
+releaseReservedBuffer(void* target,
+                      Session*,
+                      const uint64_t,
+                      const bool)
+{
+    SessionHandler::m_bufferPool->releaseBuffer(static_cast<DataBuffer*>(target));
+}
+
+/**
+ * @brief reserve memory for a new message, where the payload can be written directly before it
+ *        is committed as stream-, standalone- or response-message. Space for the header in front
+ *        and the footer behind the payload is already reserved, so the message is send without
+ *        copy of the payload. Each reservation must be given to exactly one commit- or
+ *        discard-call.
+ *
+ * @param capacity max size of the payload, which will be written into the reservation
+ *
+ * @return reservation with the pointer, where the payload should be written
+ */
+Session::MessageReservation
+Session::reserveMessage(const uint64_t capacity)
+{
+    MessageReservation reservation;
+    reservation.buffer = SessionHandler::m_bufferPool->getBuffer(MESSAGE_HEADER_RESERVE
+                                                                 + capacity
+                                                                 + MESSAGE_TAIL_RESERVE);
+    reservation.payload = static_cast<uint8_t*>(reservation.buffer->data) + MESSAGE_HEADER_RESERVE;
+    reservation.capacity = capacity;
+
+    return reservation;
+}
+
+/**
+ * @brief send the payload of a reservation as stream-message. With active flow-control, it
+ *        blocks until the other side has granted enough credits. Payloads bigger than a single
+ *        message are split into multiple stream-messages.
+ *
+ * @param reservation reservation, which is released by this call in any case
+ * @param size size of the payload, which was written into the reservation
+ * @param replyExpected if true, the other side sends a reply-message to check timeouts
+ *
+ * @return false if session is NOT ready to send, the size is bigger than the reserved capacity
+ *         or no credits were granted in time, else true
+ */
+bool
+Session::commitStreamData(MessageReservation &reservation,
+                          const uint64_t size,
+                          const bool replyExpected)
+{
+    bool result = false;
+
+    if(reservation.buffer != nullptr
+            && size <= reservation.capacity)
+    {
+        if(size > MAX_SINGLE_MESSAGE_SIZE)
+        {
+            result = sendStreamMessages(reservation.payload, size, replyExpected, true);
+        }
+        else if(m_statemachine.isInState(ACTIVE)
+                && acquireStreamCredits(getStreamMessageSize(static_cast<uint32_t>(size)), true))
+        {
+            result = send_Data_Stream_InPlace(this,
+                                              reservation.payload,
+                                              static_cast<uint32_t>(size),
+                                              replyExpected);
+        }
+    }
+
+    discardMessage(reservation);
+
+    return result;
+}
+
+/**
+ * @brief send the payload of a reservation as standalone-message
+ *
+ * @param reservation reservation, which is released by this call in any case
+ * @param size size of the payload, which was written into the reservation
+ * @param priority number of parts, which are send in a row, when the message is interleaved
+ *                 with other multiblock-messages. Only used for multiblock-messages.
+ *
+ * @return id of the message, or 0 if session is NOT ready to send or the size is bigger than
+ *         the reserved capacity
+ */
+uint64_t
+Session::commitStandaloneData(MessageReservation &reservation,
+                              const uint64_t size,
+                              const uint32_t priority)
+{
+    return commitSingleOrMultiblock(reservation, size, priority, 0);
+}
+
+/**
+ * @brief send the payload of a reservation as response of a request
+ *
+ * @param reservation reservation, which is released by this call in any case
+ * @param size size of the payload, which was written into the reservation
+ * @param blockerId id of the request, which should be answered
+ *
+ * @return id of the message, or 0 if session is NOT ready to send or the size is bigger than
+ *         the reserved capacity
+ */
+uint64_t
+Session::commitResponse(MessageReservation &reservation,
+                        const uint64_t size,
+                        const uint64_t blockerId)
+{
+    return commitSingleOrMultiblock(reservation, size, 1, blockerId);
+}
+
+/**
+ * @brief give a reservation back without sending it
+ *
+ * @param reservation reservation, which should be released
+ */
+void
+Session::discardMessage(MessageReservation &reservation)
+{
+    if(reservation.buffer != nullptr) {
+        SessionHandler::m_bufferPool->releaseBuffer(reservation.buffer);
+    }
+
+    reservation.buffer = nullptr;
+    reservation.payload = nullptr;
+    reservation.capacity = 0;
+}
+
+/**
+ * @brief send the payload of a reservation as singleblock-message or, if too big, as
+ *        multiblock-message, which sends its parts directly from the reserved buffer and gives
+ *        it back to the pool, when the message is finished
+ *
+ * @param reservation reservation, which is released by this call in any case
+ * @param size size of the payload, which was written into the reservation
+ * @param priority priority of the multiblock-message
+ * @param blockerId id of the request, if the message is a response, else 0
+ *
+ * @return id of the message, or 0 if session is NOT ready to send or the size is bigger than
+ *         the reserved capacity
+ */
+uint64_t
+Session::commitSingleOrMultiblock(MessageReservation &reservation,
+                                  const uint64_t size,
+                                  const uint32_t priority,
+                                  const uint64_t blockerId)
+{
+    if(reservation.buffer == nullptr
+            || size > reservation.capacity
+            || m_statemachine.isInState(ACTIVE) == false)
+    {
+        discardMessage(reservation);
+        return 0;
+    }
+
+    if(size <= MAX_SINGLE_MESSAGE_SIZE)
+    {
+        const uint64_t singleblockId = m_multiblockIo->getRandValue();
+        send_Data_SingleBlock_InPlace(this,
+                                      singleblockId,
+                                      reservation.payload,
+                                      static_cast<uint32_t>(size),
+                                      blockerId);
+        discardMessage(reservation);
+        return singleblockId;
+    }
+
+    // the buffer is owned by the multiblock-message from now on
+    DataBuffer* buffer = reservation.buffer;
+    const uint8_t* payload = reservation.payload;
+    reservation.buffer = nullptr;
+    discardMessage(reservation);
+
+    return m_multiblockIo->createOutgoingReference(payload,
+                                                   size,
+                                                   priority,
+                                                   nullptr,
+                                                   0,
+                                                   &releaseReservedBuffer,
+                                                   buffer,
+                                                   blockerId);
+}
+
+/**
+ * @brief send data as standalone-message directly from the memory of the caller without copy.
+ *        The memory must not be changed or freed, until the completion-callback was triggered.
+ *
+ * @param data data-pointer
+ * @param size number of bytes
+ * @param processCompletion callback with the target, session, message-id and a flag, which is
+ *                          false, if the message was aborted. It is triggered by the
+ *                          multiblock-thread of the session or, for messages, which fit into a
+ *                          single message, before this function returns.
+ * @param target first argument of the completion-callback
+ * @param priority number of parts, which are send in a row, when the message is interleaved
+ *                 with other multiblock-messages. Only used for multiblock-messages.
+ *
+ * @return id of the message, or 0 if session is NOT ready to send, in which case the callback
+ *         is not triggered
+ */
+uint64_t
+Session::sendStandaloneDataNoCopy(const void* data,
+                                  const uint64_t size,
+                                  void (*processCompletion)(void*,
+                                                            Session*,
+                                                            const uint64_t,
+                                                            const bool),
+                                  void* target,
+                                  const uint32_t priority)
+{
+    if(m_statemachine.isInState(ACTIVE) == false) {
+        return 0;
+    }
+
+    // singleblock-messages are send synchronously from the memory of the caller
+    if(size <= MAX_SINGLE_MESSAGE_SIZE)
+    {
+        const uint64_t singleblockId = m_multiblockIo->getRandValue();
+        send_Data_SingleBlock(this, singleblockId, data, size);
+        if(processCompletion != nullptr) {
+            processCompletion(target, this, singleblockId, true);
+        }
+        return singleblockId;
+    }
+
+    return m_multiblockIo->createOutgoingReference(data,
+                                                   size,
+                                                   priority,
+                                                   nullptr,
+                                                   0,
+                                                   processCompletion,
+                                                   target);
+}
+
+/**
+ * @brief send a file as standalone-message
+ *
+ * @param filePath path to the file
+ * @param offset position within the file, where the message should start
+ * @param length number of bytes to send, or 0 to send the rest of the file after the offset
+ * @param priority number of parts, which are send in a row, when the message is interleaved
+ *                 with other multiblock-messages
+ *
+ * @return id of the message, or 0 if session is NOT ready to send or the file can not be read
+ */
+uint64_t
+Session::sendFile(const std::string &filePath,
+                  const uint64_t offset,
+                  const uint64_t length,
+                  const uint32_t priority)
+{
+    const int fileDescriptor = open(filePath.c_str(), O_RDONLY);
+    if(fileDescriptor < 0)
+    {
+        LOG_ERROR("can not open file to send: " + filePath);
+        return 0;
+    }
+
+    // the memory-mapping of the file stays valid after closing the file
+    const uint64_t result = sendFile(fileDescriptor, offset, length, priority);
+    close(fileDescriptor);
+
+    return result;
+}
+
+/**
+ * @brief send a part of an open file as standalone-message. The file is mapped into memory and
+ *        the parts of the message are send directly from the mapping, so the file is never
+ *        copied into a buffer. The mapping is removed, after the message is finished or aborted.
+ *
+ * @param fileDescriptor file-descriptor of a file, which is open for reading. It can be closed
+ *                       after the function returns.
+ * @param offset position within the file, where the message should start
+ * @param length number of bytes to send, or 0 to send the rest of the file after the offset
+ * @param priority number of parts, which are send in a row, when the message is interleaved
+ *                 with other multiblock-messages
+ *
+ * @return id of the message, or 0 if session is NOT ready to send, the range is empty or not
+ *         within the file, or the file can not be mapped
+ */
+uint64_t
+Session::sendFile(const int fileDescriptor,
+                  const uint64_t offset,
+                  const uint64_t length,
+                  const uint32_t priority)
+{
+    if(m_statemachine.isInState(ACTIVE) == false) {
+        return 0;
+    }
+
+    // check requested range
+    struct stat fileStat;
+    if(fstat(fileDescriptor, &fileStat) != 0) {
+        return 0;
+    }
+    const uint64_t fileSize = static_cast<uint64_t>(fileStat.st_size);
+    uint64_t size = length;
+    if(size == 0 && offset < fileSize) {
+        size = fileSize - offset;
+    }
+    if(size == 0
+            || offset + size > fileSize)
+    {
+        return 0;
+    }
+
+    // offset of a memory-mapping must be a multiple of the page-size
+    const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    const uint64_t mappingOffset = offset - (offset % pageSize);
+    const uint64_t mappingSize = size + (offset - mappingOffset);
+    void* mapping = mmap(nullptr,
+                         mappingSize,
+                         PROT_READ,
+                         MAP_PRIVATE,
+                         fileDescriptor,
+                         static_cast<off_t>(mappingOffset));
+    if(mapping == MAP_FAILED)
+    {
+        LOG_ERROR("can not map file to send into memory");
+        return 0;
+    }
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+
+    const uint8_t* data = static_cast<const uint8_t*>(mapping) + (offset - mappingOffset);
+
+    // singleblock-messages are send synchronously from the mapping
+    if(size <= MAX_SINGLE_MESSAGE_SIZE)
+    {
+        const uint64_t singleblockId = m_multiblockIo->getRandValue();
+        send_Data_SingleBlock(this, singleblockId, data, size);
+        munmap(mapping, mappingSize);
+        return singleblockId;
+    }
+
+    return m_multiblockIo->createOutgoingReference(data,
+                                                   size,
+                                                   priority,
+                                                   mapping,
+                                                   mappingSize,
+                                                   nullptr,
+                                                   nullptr);
+}
+
+/**
+ * @brief send a request and block the thread until the response arrived
+ *
+ * @param data data-pointer
+ * @param size number of bytes
+ * @param timeout time in seconds until a timeout appear for the request
+ *
+ * @return data-buffer with the response, or nullptr in case of a failure or timeout
+ */
+DataBuffer*
+Session::sendRequest(const void *data,
+                     const uint64_t size,
+                     const uint64_t timeout)
+{
+    MessageBlockerHandler::RequestWaiter waiter;
+
+    const uint64_t id = sendRequestAsync(data,
+                                         size,
+                                         timeout * 1000,
+                                         &MessageBlockerHandler::releaseRequestWaiter,
+                                         &waiter);
+    if(id == 0) {
+        return nullptr;
+    }
+
+    // wait until the callback was triggered by the response or by a timeout
+    std::unique_lock<std::mutex> lock(waiter.cvMutex);
+    while(waiter.released == false) {
+        waiter.cv.wait(lock);
+    }
+
+    return waiter.responseData;
+}
+
+/**
+ * @brief send a request without blocking the thread. The response is given to the callback,
+ *        which is triggered by the thread, which has received the response. In case of a
+ *        timeout, the callback is triggered with nullptr as response.
+ *
+ * @param data data-pointer
+ * @param size number of bytes
+ * @param timeout time in milliseconds until a timeout appear for the request
+ * @param processResponse callback for the response
+ * @param target additional pointer, which is given to the callback
+ *
+ * @return id of the request, or 0 if session is NOT ready to send
+ */
+uint64_t
+Session::sendRequestAsync(const void* data,
+                          const uint64_t size,
+                          const uint64_t timeout,
+                          void (*processResponse)(void*,
+                                                  Session*,
+                                                  const uint64_t,
+                                                  DataBuffer*),
+                          void* target)
+{
+    if(m_statemachine.isInState(ACTIVE) == false) {
+        return 0;
+    }
+
+    // register request before sending, because the response can come faster than expected
+    const uint64_t id = m_multiblockIo->getRandValue();
+    const bool ret = SessionHandler::m_blockerHandler->addRequest(id,
+                                                                  timeout,
+                                                                  this,
+                                                                  processResponse,
+                                                                  target);
+    if(ret == false) {
+        return 0;
+    }
+
+    if(size <= MAX_SINGLE_MESSAGE_SIZE)
+    {
+        send_Data_SingleBlock(this,
+                              id,
+                              data,
+                              static_cast<uint32_t>(size));
+    }
+    else
+    {
+        m_multiblockIo->createOutgoingBuffer(data, size, true, 0, id);
+    }
+
+    return id;
+}
+
+/**
+ * @brief send a batch of requests and block the thread until all responses arrived or the
+ *        timeout is reached. All requests are registered together and the small requests are
+ *        written together into the socket, so the batch needs only one round-trip.
+ *
+ * @param requests list of requests, where the response of each request is written into its
+ *                 slot. Slots without response are nullptr after the call.
+ * @param numberOfRequests number of requests within the list (max MAX_REQUEST_BATCH_SIZE)
+ * @param timeout time in milliseconds until the call returns with the already received
+ *                responses
+ *
+ * @return number of received responses, or 0 if session is NOT ready to send
+ */
+uint32_t
+Session::sendRequestBatch(RequestSlot* requests,
+                          const uint32_t numberOfRequests,
+                          const uint64_t timeout)
+{
+    if(numberOfRequests == 0
+            || numberOfRequests > MAX_REQUEST_BATCH_SIZE
+            || m_statemachine.isInState(ACTIVE) == false)
+    {
+        return 0;
+    }
+
+    for(uint32_t i = 0; i < numberOfRequests; i++) {
+        requests[i].response = nullptr;
+    }
+
+    // register whole batch before sending, because the responses can come faster than expected
+    MessageBlockerHandler::RequestBatch batch;
+    batch.session = this;
+    batch.slots = requests;
+    batch.numberOfRequests = numberOfRequests;
+    batch.startTime = MetricsRecorder::getCurrentTime();
+
+    uint64_t baseId = 0;
+    do
+    {
+        baseId = m_multiblockIo->getRandValue();
+        baseId -= baseId % MAX_REQUEST_BATCH_SIZE;
+    }
+    while(SessionHandler::m_blockerHandler->addRequestBatch(baseId, &batch) == false);
+
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+                                                           + std::chrono::milliseconds(timeout);
+
+    // requests, which can not be framed together, are send on their own
+    for(uint32_t i = 0; i < numberOfRequests; i++)
+    {
+        if(requests[i].size > MAX_SINGLE_MESSAGE_SIZE)
+        {
+            m_multiblockIo->createOutgoingBuffer(requests[i].data,
+                                                 requests[i].size,
+                                                 true,
+                                                 0,
+                                                 baseId + i);
+        }
+        else if(m_compressPayload)
+        {
+            send_Data_SingleBlock(this,
+                                  baseId + i,
+                                  requests[i].data,
+                                  static_cast<uint32_t>(requests[i].size));
+        }
+    }
+    if(m_compressPayload == false) {
+        send_Data_SingleBlock_Batch(this, requests, numberOfRequests, baseId);
+    }
+
+    // wait until all responses arrived or the deadline is reached
+    {
+        std::unique_lock<std::mutex> lock(batch.cvMutex);
+        batch.cv.wait_until(lock, deadline, [&batch] {
+            return batch.numberOfResponses == batch.numberOfRequests;
+        });
+    }
+
+    // no response is written into the slots anymore after the batch is removed
+    SessionHandler::m_blockerHandler->removeRequestBatch(baseId);
+
+    const uint32_t numberOfResponses = batch.numberOfResponses;
+    if(numberOfResponses != numberOfRequests) {
+        m_metrics.addTimeout();
+    }
+
+    return numberOfResponses;
+}
+
+/**
+ * @brief Session::sendResponse
+ * @param data
+ * @param size
+ * @param blockerId
+ * @return
+ */
+uint64_t
+Session::sendResponse(const void *data,
+                      const uint64_t size,
+                      const uint64_t blockerId)
+{
+    if(m_statemachine.isInState(ACTIVE))
+    {
+        if(size < MAX_SINGLE_MESSAGE_SIZE)
+        {
+            const uint64_t singleblockId = m_multiblockIo->getRandValue();
+            send_Data_SingleBlock(this,
+                                  singleblockId,
+                                  data,
+                                  static_cast<uint32_t>(size),
+                                  blockerId);
+            return singleblockId;
+        }
+        else
+        {
+            std::pair<DataBuffer*, uint64_t> result;
+            result = m_multiblockIo->createOutgoingBuffer(data, size, false, blockerId);
+            return result.second;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief change the priority of a multiblock-message, which is not completely send
+ *
+ * @param multiblockMessageId id of the multi-block-message
+ * @param priority number of parts, which are send in a row, when the message is interleaved
+ *                 with other multiblock-messages
+ *
+ * @return false, if message is not in the outgoing-queue, else true
+ */
+bool
+Session::setMultiblockPriority(const uint64_t multiblockMessageId,
+                               const uint32_t priority)
+{
+    return m_multiblockIo->setOutgoingPriority(multiblockMessageId, priority);
+}
+
+/**
+ * @brief abort a multi-block-message
+ *
+ * @param multiblockMessageId id of the multi-block-message, which should be aborted
+ */
+void
+Session::abortMessages(const uint64_t multiblockMessageId)
+{
+    if(m_multiblockIo->removeOutgoingMessage(multiblockMessageId) == false) {
+        send_Data_Multi_Abort_Init(this, multiblockMessageId);
+    }
+}
+
+/**
+ * @brief Session::setStreamMessageCallback
+ * @param streamDataTarget
+ */
+void
+Session::setStreamMessageCallback(void (*processStreamData)(Session*,
+                                                            const void*,
+                                                            const uint64_t))
+{
+    m_processStreamData = processStreamData;
+}
+
+/**
+ * @brief set a callback, which gets the payloads of multiple incoming stream-messages at once
+ *        instead of one call per message. All stream-messages, which are complete within the
+ *        receive-buffer, are collected, until STREAM_BATCH_SIZE is reached or another
+ *        message-type is received, so the order to other callbacks is preserved. The payloads
+ *        are only valid until the callback returns. If set, the single stream-callback is not
+ *        triggered anymore.
+ *
+ * @param processStreamBatch callback with session, array of payloads and number of payloads,
+ *                           or nullptr to use the single stream-callback again
+ */
+void
+Session::setStreamBatchCallback(void (*processStreamBatch)(Session*,
+                                                           const StreamSpan*,
+                                                           const uint64_t))
+{
+    m_processStreamBatch = processStreamBatch;
+}
+
+/**
+ * @brief Session::setStandaloneMessageCallback
+ * @param standaloneDataTarget
+ */
+void
+Session::setStandaloneMessageCallback(void (*processStandaloneData)(Session*,
+                                                                    const uint64_t,
+                                                                    DataBuffer*))
+{
+    m_processStandaloneData = processStandaloneData;
+}
+
+/**
+ * @brief Session::setErrorCallback
+ * @param errorTarget
+ */
+void
+Session::setErrorCallback(void (*processError)(Session*,
+                                               const uint8_t,
+                                               const std::string))
+{
+    m_processError = processError;
+}
+
+/**
+ * @brief enable chunk-streaming for incoming standalone multiblock-messages. Instead of
+ *        allocating a buffer for the complete message and triggering the standalone-callback at
+ *        the end, each part is given to this callback directly after it was received, so the
+ *        memory-usage of the receiver is independent of the message-size. The sender can only
+ *        send a limited window of parts, before the callback has processed them, so a slow
+ *        callback slows down the sender. The callback is triggered by the receiving thread of
+ *        the session, so it should not block longer than the heartbeat-timeout. Requests,
+ *        responses and messages, which were already initialized before, are not affected.
+ *
+ * @param processMultiblockPart callback with session, multiblock-id, offset of the part within
+ *                              the message, pointer to the part, size of the part and a flag,
+ *                              which is true for the last part of the message, or nullptr to
+ *                              disable chunk-streaming again
+ */
+void
+Session::setMultiblockPartCallback(void (*processMultiblockPart)(Session*,
+                                                                 const uint64_t,
+                                                                 const uint64_t,
+                                                                 const void*,
+                                                                 const uint64_t,
+                                                                 const bool))
+{
+    m_processMultiblockPart = processMultiblockPart;
+}
+
+/**
+ * @brief close the session inclusive multiblock-messages, statemachine, message to the other side
+ *        and close the socket
+ *
+ * @param replyExpected true, to expect a reply-message
+ *
+ * @return true, if all was successful, else false
+ */
+bool
+Session::closeSession(const bool replyExpected)
+{
+    LOG_DEBUG("close session with id " + std::to_string(m_sessionId));
+    if(m_statemachine.isInState(SESSION_READY))
+    {
+        SessionHandler::m_replyHandler->removeAllOfSession(m_sessionId);
+        m_multiblockIo->removeOutgoingMessage(0);
+        if(replyExpected)
+        {
+            send_Session_Close_Start(this, true);
+            return true;
+        }
+        else
+        {
+            send_Session_Close_Start(this, false);
+            return endSession();
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief getter for the id of the session
+ *
+ * @return session-id
+ */
+uint32_t
+Session::sessionId() const
+{
+    return m_sessionId;
+}
+
+/**
+ * @brief check if session is client- or server-side
+ *
+ * @return true, if session is on client-side, else false
+ */
+bool
+Session::isClientSide() const
+{
+    if(m_sharedMemory != nullptr) {
+        return m_sharedMemory->isClientSide();
+    }
+
+    return m_socket->isClientSide();
+}
+
+/**
+ * @brief Session::getLinkedSession
+ * @return
+ */
+Session*
+Session::getLinkedSession()
+{
+    Session* result = nullptr;
+
+    while (m_linkSession_lock.test_and_set(std::memory_order_acquire))  {
+        asm("");
+    }
+    result = m_linkedSession;
+    m_linkSession_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief get statistics of the messages, which were received by this session and forwarded to
+ *        the linked session
+ *
+ * @return copy of the counters
+ */
+Session::ForwardingStats
+Session::getForwardingStats() const
+{
+    ForwardingStats result;
+    result.numberOfMessages = m_forwardedMessages;
+    result.numberOfBytes = m_forwardedBytes;
+    result.numberOfWrites = m_forwardingWrites;
+    result.numberOfQueuedMessages = m_queuedForwardMessages;
+
+    return result;
+}
+
+/**
+ * @brief get the number of additional connections, over which the parts of multiblock-messages
+ *        are distributed
+ *
+ * @return number of additional connections, without the primary connection
+ */
+uint32_t
+Session::getNumberOfStripes() const
+{
+    return m_numberOfStripes;
+}
+
+/**
+ * @brief get the number of bytes, which were send and received over each connection of the
+ *        session, to compare the throughput of the connections
+ *
+ * @return list with the primary connection at the first position, followed by the additional
+ *         connections
+ */
+std::vector<Session::StripeStats>
+Session::getStripeStats()
+{
+    std::vector<StripeStats> result;
+
+    StripeStats primaryStats;
+    primaryStats.sendBytes = m_connectionSendBytes;
+    primaryStats.receivedBytes = m_connectionReceivedBytes;
+    result.push_back(primaryStats);
+
+    while(m_stripes_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    for(uint64_t i = 0; i < m_stripes.size(); i++)
+    {
+        StripeStats stripeStats;
+        stripeStats.sendBytes = m_stripes[i]->m_connectionSendBytes;
+        stripeStats.receivedBytes = m_stripes[i]->m_connectionReceivedBytes;
+        result.push_back(stripeStats);
+    }
+    m_stripes_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief register an additional connection, which is already confirmed by the other side
+ *
+ * @param stripe session of the additional connection, which is owned by this session from now
  */
 void
-Session::setErrorCallback(void (*processError)(Session*,
-                                               const uint8_t,
-                                               const std::string))
+Session::addStripe(Session* stripe)
 {
-    m_processError = processError;
+    while(m_stripes_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_stripes.push_back(stripe);
+    m_numberOfStripes = static_cast<uint32_t>(m_stripes.size());
+    m_stripes_lock.clear(std::memory_order_release);
 }
 
 /**
- * @brief close the session inclusive multiblock-messages, statemachine, message to the other side
- *        and close the socket
+ * @brief get the connection for a part of a multiblock-message, where the parts are distributed
+ *        round-robin over the primary and all additional connections
  *
- * @param replyExpected true, to expect a reply-message
+ * @param partId id of the part within the multiblock-message
  *
- * @return true, if all was successful, else false
+ * @return session of the connection, which is this session, if there are no additional
+ *         connections
  */
-bool
-Session::closeSession(const bool replyExpected)
+Session*
+Session::getStripe(const uint32_t partId)
 {
-    LOG_DEBUG("close session with id " + std::to_string(m_sessionId));
-    if(m_statemachine.isInState(SESSION_READY))
-    {
-        SessionHandler::m_replyHandler->removeAllOfSession(m_sessionId);
-        m_multiblockIo->removeOutgoingMessage(0);
-        if(replyExpected)
-        {
-            send_Session_Close_Start(this, true);
-            return true;
-        }
-        else
-        {
-            send_Session_Close_Start(this, false);
-            return endSession();
-        }
+    const uint32_t numberOfStripes = m_numberOfStripes.load(std::memory_order_relaxed);
+    if(numberOfStripes == 0) {
+        return this;
     }
 
-    return false;
+    const uint32_t pos = partId % (numberOfStripes + 1);
+    if(pos == 0) {
+        return this;
+    }
+
+    while(m_stripes_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    Session* stripe = m_stripes[pos - 1];
+    m_stripes_lock.clear(std::memory_order_release);
+
+    return stripe;
 }
 
 /**
- * @brief getter for the id of the session
- *
- * @return session-id
+ * @brief disconnect all additional connections, so only the primary connection is used. The
+ *        sessions of the connections are kept for the statistics until this session is deleted.
  */
-uint32_t
-Session::sessionId() const
+void
+Session::closeStripes()
 {
-    return m_sessionId;
+    while(m_stripes_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_numberOfStripes = 0;
+    const std::vector<Session*> stripes = m_stripes;
+    m_stripes_lock.clear(std::memory_order_release);
+
+    for(uint64_t i = 0; i < stripes.size(); i++) {
+        stripes[i]->disconnectStripe();
+    }
 }
 
 /**
- * @brief check if session is client- or server-side
+ * @brief disconnect an additional connection and wait until the thread of its socket has
+ *        stopped. Afterwards no callback with this session as target can run anymore, so the
+ *        session can be deleted.
  *
- * @return true, if session is on client-side, else false
+ * @return false, if the session was already disconnected, else true
  */
 bool
-Session::isClientSide() const
+Session::disconnectStripe()
 {
-    return m_socket->isClientSide();
+    LOG_DEBUG("CALL stripe disconnect: " + std::to_string(m_sessionId));
+
+    if(m_statemachine.goToNextState(DISCONNECT) == false) {
+        return false;
+    }
+
+    m_socket->closeSocket();
+
+    // the own thread can not be joined, if the connection is closed within its own callback
+    if(m_receivingSession != this) {
+        m_socket->stopThread();
+    }
+
+    m_socket->scheduleThreadForDeletion();
+
+    return true;
 }
 
 /**
- * @brief Session::getLinkedSession
- * @return
+ * @brief get counters for send and received messages and bytes for each message-type, the
+ *        number of timeouts, fill-levels of the buffers and histograms of round-trip-times and
+ *        request-latencies. All values are read without lock, so it is cheap enough to be
+ *        polled regularly.
+ *
+ * @return snapshot of the metrics of the session
  */
-Session*
-Session::getLinkedSession()
+SessionMetrics
+Session::getMetrics() const
 {
-    Session* result = nullptr;
-
-    while (m_linkSession_lock.test_and_set(std::memory_order_acquire))  {
-        asm("");
-    }
-    result = m_linkedSession;
-    m_linkSession_lock.clear(std::memory_order_release);
+    SessionMetrics result;
+    m_metrics.getSnapshot(result);
 
     return result;
 }
@@ -385,7 +1611,9 @@ Session::connectiSession(const uint32_t sessionId)
     if(m_statemachine.isInState(NOT_CONNECTED))
     {
         // connect socket
-        if(m_socket->initClientSide() == false)
+        const bool connected = m_sharedMemory != nullptr ? m_sharedMemory->initClientSide()
+                                                          : m_socket->initClientSide();
+        if(connected == false)
         {
             m_cv.notify_one();
             return false;
@@ -398,7 +1626,11 @@ Session::connectiSession(const uint32_t sessionId)
             return false;
         }
         m_sessionId = sessionId;
-        m_socket->startThread();
+        if(m_sharedMemory != nullptr) {
+            m_sharedMemory->startThread();
+        } else {
+            m_socket->startThread();
+        }
 
         return true;
     }
@@ -428,6 +1660,9 @@ Session::makeSessionReady(const uint32_t sessionId,
         m_sessionId = sessionId;
         m_sessionIdentifier = sessionIdentifier;
 
+        m_lastInboundTraffic = HeartbeatHandler::getCurrentTime();
+        SessionHandler::m_heartbeatHandler->addSession(this);
+
         m_processCreateSession(this, m_sessionIdentifier);
 
         // release blocked session on client-side
@@ -441,6 +1676,17 @@ Session::makeSessionReady(const uint32_t sessionId,
     return false;
 }
 
+/**
+ * @brief check if the initial message-transfer of the session was successful
+ *
+ * @return true, if session is in ready-state, else false
+ */
+bool
+Session::isSessionReady()
+{
+    return m_statemachine.isInState(SESSION_READY);
+}
+
 /**
  * @brief stop the session to prevent it from all data-transfers. Delete the session from the
  *        session-handler and close the socket.
@@ -459,6 +1705,7 @@ Session::endSession()
     {
         m_processCloseSession(this, m_sessionIdentifier);
         SessionHandler::m_sessionHandler->removeSession(m_sessionId);
+        SessionHandler::m_heartbeatHandler->removeSession(this);
         return disconnectSession();
     }
 
@@ -477,6 +1724,21 @@ Session::disconnectSession()
     LOG_DEBUG("CALL session disconnect: " + std::to_string(m_sessionId));
 
     if(m_statemachine.goToNextState(DISCONNECT))  {
+        // release senders, which wait for stream-credits
+        {
+            std::unique_lock<std::mutex> lock(m_creditMutex);
+            m_creditCv.notify_all();
+        }
+
+        closeStripes();
+
+        if(m_sharedMemory != nullptr)
+        {
+            m_sharedMemory->closeChannel();
+            m_sharedMemory->scheduleThreadForDeletion();
+            return true;
+        }
+
         const bool ret = m_socket->closeSocket();
         if(ret == false) {
             return false;
@@ -491,20 +1753,412 @@ Session::disconnectSession()
 }
 
 /**
- * @brief send a heartbeat-message
+ * @brief check the liveness of the session. If there was incoming traffic within the
+ *        heartbeat-interval, the other side is alive and no heartbeat is necessary. Otherwise a
+ *        heartbeat is send and, if there was no answer to more than the allowed number of
+ *        heartbeats, a timeout-error is reported. Incoming messages, which wait too long for
+ *        parts of a broken additional connection, are dropped too.
  *
  * @return true, if session is ready, else false
  */
 bool
-Session::sendHeartbeat()
+Session::checkHeartbeat()
 {
-    if(m_statemachine.isInState(SESSION_READY))
+    if(m_statemachine.isInState(SESSION_READY) == false) {
+        return false;
+    }
+
+    // finishes of messages, whose parts were lost together with an additional connection
+    expireDeferredFinishes(this);
+
+    const uint64_t now = HeartbeatHandler::getCurrentTime();
+    const uint64_t lastTraffic = m_lastInboundTraffic;
+    const uint64_t silence = now > lastTraffic ? now - lastTraffic : 0;
+
+    // normal traffic is enough to show, that the other side is alive
+    if(silence < m_heartbeatInterval)
     {
-        send_Heartbeat_Start(this);
+        m_missedHeartbeats = 0;
         return true;
     }
 
-    return false;
+    const uint32_t missedHeartbeats = m_missedHeartbeats.fetch_add(1) + 1;
+    if(missedHeartbeats > m_heartbeatMissThreshold)
+    {
+        m_metrics.addTimeout();
+        m_processError(this,
+                       Session::errorCodes::MESSAGE_TIMEOUT,
+                       "TIMEOUT of heartbeat: no incoming traffic for "
+                       + std::to_string(silence) + " ms");
+        m_missedHeartbeats = 0;
+    }
+
+    send_Heartbeat_Start(this);
+
+    return true;
+}
+
+/**
+ * @brief check if the session can be used for new transfers, for example before a pooled
+ *        session is given out again
+ *
+ * @return true, if the session is active and the other side has shown within the allowed
+ *         number of heartbeat-intervals, that it is alive, else false
+ */
+bool
+Session::isHealthy()
+{
+    if(m_statemachine.isInState(ACTIVE) == false) {
+        return false;
+    }
+
+    const uint32_t interval = m_heartbeatInterval;
+    if(interval == 0) {
+        return true;
+    }
+
+    const uint64_t now = HeartbeatHandler::getCurrentTime();
+    const uint64_t lastTraffic = m_lastInboundTraffic;
+    const uint64_t silence = now > lastTraffic ? now - lastTraffic : 0;
+
+    return silence <= static_cast<uint64_t>(interval) * (m_heartbeatMissThreshold + 1);
+}
+
+/**
+ * @brief configure the heartbeats of the session
+ *
+ * @param interval time in milliseconds without incoming traffic, after which a heartbeat is
+ *                 send. 0 disables the heartbeats of the session.
+ * @param missThreshold number of heartbeats without any incoming traffic, which are tolerated
+ *                      before a timeout-error is reported
+ *
+ * @return false, if session is not ready, else true
+ */
+bool
+Session::setHeartbeat(const uint32_t interval,
+                      const uint32_t missThreshold)
+{
+    if(m_statemachine.isInState(SESSION_READY) == false) {
+        return false;
+    }
+
+    m_heartbeatMissThreshold = missThreshold;
+    m_heartbeatInterval = interval;
+    m_missedHeartbeats = 0;
+
+    if(interval == 0) {
+        SessionHandler::m_heartbeatHandler->removeSession(this);
+    } else {
+        SessionHandler::m_heartbeatHandler->addSession(this);
+    }
+
+    return true;
+}
+
+/**
+ * @brief set the cores for the receiving and sending thread of the session and the numa-node
+ *        for its buffers. The threads apply the policy by themselves with their next message,
+ *        so the call doesn't block.
+ *
+ * @param policy new affinity-policy. A policy without cores and numa-node resets the session
+ *               to the global policy.
+ */
+void
+Session::setAffinity(const AffinityPolicy &policy)
+{
+    while(m_affinity_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_affinity = policy;
+    m_affinityVersion++;
+    m_affinity_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief get the affinity-policy, which is used for the session
+ *
+ * @return policy of the session, or the global policy, if the session has no own policy
+ */
+AffinityPolicy
+Session::getAffinity()
+{
+    while(m_affinity_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    const AffinityPolicy policy = m_affinity;
+    m_affinity_lock.clear(std::memory_order_release);
+
+    if(policy.cores.size() != 0
+            || policy.numaNode >= 0)
+    {
+        return policy;
+    }
+
+    uint64_t version = 0;
+    return SessionHandler::m_sessionHandler->getGlobalAffinity(version);
+}
+
+/**
+ * @brief get the version of the affinity of the session, which changes with each new policy of
+ *        the session or new global policy
+ *
+ * @return current version
+ */
+uint64_t
+Session::getAffinityVersion() const
+{
+    return m_affinityVersion.load(std::memory_order_relaxed)
+           + SessionHandler::m_sessionHandler->m_globalAffinityVersion.load(
+               std::memory_order_relaxed);
+}
+
+/**
+ * @brief pin the receiving thread of the session and move the receive- and send-buffers of the
+ *        session to the numa-node of the policy. Must be called by the receiving thread.
+ *
+ * @param recvBuffer ring-buffer of the socket with the incoming data
+ */
+void
+Session::applyReceiveAffinity(RingBuffer* recvBuffer)
+{
+    const uint64_t version = getAffinityVersion();
+    const AffinityPolicy policy = getAffinity();
+
+    setThreadAffinity(policy.cores);
+
+    const int32_t numaNode = getNumaNode(policy);
+    if(numaNode >= 0)
+    {
+        bindToNumaNode(recvBuffer->data, recvBuffer->totalBufferSize, numaNode);
+
+        lockSend(true);
+        bindToNumaNode(m_sendBuffer, SEND_BUFFER_SIZE, numaNode);
+        bindToNumaNode(m_coalescingBuffer, m_coalescingThreshold, numaNode);
+        unlockSend();
+    }
+
+    m_receiveAffinityVersion = version;
+}
+
+/**
+ * @brief pin the own sending thread of the multiblock-messages of the session. Must be called
+ *        by the sending thread.
+ */
+void
+Session::applySendAffinity()
+{
+    const uint64_t version = getAffinityVersion();
+    setThreadAffinity(getAffinity().cores);
+    m_sendAffinityVersion = version;
+}
+
+/**
+ * @brief send the segments of a message as one continuous message over the socket. Small
+ *        messages are gathered within the send-buffer of the session, to send them with only one
+ *        call. Bigger messages are written segment by segment, so the payload is never copied.
+ *        The send-lock is hold for the whole message, so messages of different threads can not
+ *        be mixed up on the socket. Control-messages get the lock before bulk-data, so they
+ *        have to wait at most for one message of bulk-data, which is already written.
+ *
+ * @param segments list of segments, which together form the complete message
+ * @param numberOfSegments number of segments within the list
+ * @param coalesce true to collect the message within the coalescing-buffer, if enabled
+ * @param control true for small control- and reply-messages, which should overtake bulk-data
+ *
+ * @return false, if sending failed, else true
+ */
+bool
+Session::sendSegments(const struct iovec* segments,
+                      const uint32_t numberOfSegments,
+                      const bool coalesce,
+                      const bool control)
+{
+    bool result = true;
+    uint64_t totalSize = 0;
+    for(uint32_t i = 0; i < numberOfSegments; i++)
+    {
+        totalSize += segments[i].iov_len;
+    }
+    m_connectionSendBytes.fetch_add(totalSize, std::memory_order_relaxed);
+
+    const uint64_t queueStart = MetricsRecorder::getCurrentTime();
+    lockSend(control);
+    m_metrics.addSendQueueDelay(control, MetricsRecorder::getCurrentTime() - queueStart);
+
+    if(coalesce
+            && m_coalescingThreshold != 0
+            && totalSize <= m_coalescingThreshold)
+    {
+        // send collected messages first, if the new one doesn't fit anymore into the buffer
+        if(m_coalescingBufferSize + totalSize > m_coalescingThreshold) {
+            result = flushCoalescingBuffer();
+        }
+
+        const bool isFirst = m_coalescingBufferSize == 0;
+        for(uint32_t i = 0; i < numberOfSegments; i++)
+        {
+            memcpy(&m_coalescingBuffer[m_coalescingBufferSize],
+                   segments[i].iov_base,
+                   segments[i].iov_len);
+            m_coalescingBufferSize += static_cast<uint32_t>(segments[i].iov_len);
+        }
+        m_coalescingFrames++;
+
+        if(m_coalescingBufferSize == m_coalescingThreshold) {
+            result = flushCoalescingBuffer() && result;
+        }
+
+        const bool registerTimeout = isFirst && m_coalescingBufferSize != 0;
+        const uint32_t timeout = m_coalescingTimeout;
+        unlockSend();
+
+        // register outside of the send-lock, so other senders don't wait for the handler-lock
+        if(registerTimeout) {
+            SessionHandler::m_coalescingHandler->addSession(this, timeout);
+        }
+
+        return result;
+    }
+
+    // send collected stream-messages first to keep the order of the messages
+    if(m_coalescingBufferSize != 0) {
+        result = flushCoalescingBuffer();
+    }
+
+    if(m_sharedMemory != nullptr)
+    {
+        // all segments are copied directly into the shared ring
+        result = m_sharedMemory->sendSegments(segments, numberOfSegments);
+    }
+    else if(numberOfSegments == 1)
+    {
+        // message is already complete and can be send directly
+        result = m_socket->sendMessage(segments[0].iov_base, segments[0].iov_len);
+    }
+    else if(totalSize <= SEND_BUFFER_SIZE)
+    {
+        // gather small messages to avoid one syscall per segment
+        uint64_t position = 0;
+        for(uint32_t i = 0; i < numberOfSegments; i++)
+        {
+            memcpy(&m_sendBuffer[position], segments[i].iov_base, segments[i].iov_len);
+            position += segments[i].iov_len;
+        }
+        result = m_socket->sendMessage(m_sendBuffer, totalSize);
+    }
+    else
+    {
+        // send big messages segment by segment without copy of the payload
+        for(uint32_t i = 0; i < numberOfSegments; i++)
+        {
+            if(m_socket->sendMessage(segments[i].iov_base, segments[i].iov_len) == false)
+            {
+                result = false;
+                break;
+            }
+        }
+    }
+
+    unlockSend();
+
+    return result;
+}
+
+/**
+ * @brief get the send-lock of the session. Waiting threads sleep on a condition-variable
+ *        instead of spinning. Control-messages get the lock before bulk-data, which waits as
+ *        long as control-messages are waiting.
+ *
+ * @param control true for control-messages and short operations without socket-write, which
+ *                should overtake bulk-data
+ */
+void
+Session::lockSend(const bool control)
+{
+    m_activeSenders.fetch_add(1, std::memory_order_relaxed);
+
+    std::unique_lock<std::mutex> lock(m_sendMutex);
+    if(control)
+    {
+        m_waitingControlMessages++;
+        m_controlCv.wait(lock, [this] { return m_sendBusy == false; });
+        m_waitingControlMessages--;
+    }
+    else
+    {
+        m_bulkCv.wait(lock, [this] {
+            return m_sendBusy == false && m_waitingControlMessages == 0;
+        });
+    }
+    m_sendBusy = true;
+}
+
+/**
+ * @brief release the send-lock and wake up the next waiting control-message or, if there is
+ *        none, the next waiting bulk-data
+ */
+void
+Session::unlockSend()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_sendMutex);
+        m_sendBusy = false;
+        if(m_waitingControlMessages != 0) {
+            m_controlCv.notify_one();
+        } else {
+            m_bulkCv.notify_one();
+        }
+    }
+
+    m_activeSenders.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief check if another thread writes to the socket of the session at the moment or waits
+ *        for it, so a new message would have to wait too
+ *
+ * @return true, if the socket is busy, else false
+ */
+bool
+Session::isSendBusy() const
+{
+    return m_activeSenders.load(std::memory_order_relaxed) != 0;
+}
+
+/**
+ * @brief send the content of the coalescing-buffer and update the statistics. The send-lock
+ *        must be hold by the caller.
+ *
+ * @return false, if sending failed, else true
+ */
+bool
+Session::flushCoalescingBuffer()
+{
+    if(m_coalescingBufferSize == 0) {
+        return true;
+    }
+
+    bool result = false;
+    if(m_sharedMemory != nullptr)
+    {
+        struct iovec segment;
+        segment.iov_base = m_coalescingBuffer;
+        segment.iov_len = m_coalescingBufferSize;
+        result = m_sharedMemory->sendSegments(&segment, 1);
+    }
+    else
+    {
+        result = m_socket->sendMessage(m_coalescingBuffer, m_coalescingBufferSize);
+    }
+
+    // update statistics
+    m_coalescingStats.numberOfFlushes++;
+    m_coalescingStats.numberOfFrames += m_coalescingFrames;
+    m_coalescingStats.lastFramesPerFlush = m_coalescingFrames;
+    if(m_coalescingFrames > m_coalescingStats.maxFramesPerFlush) {
+        m_coalescingStats.maxFramesPerFlush = m_coalescingFrames;
+    }
+
+    m_coalescingBufferSize = 0;
+    m_coalescingFrames = 0;
+
+    return result;
 }
 
 /**
@@ -544,16 +2198,7 @@ Session::initStatemachine()
 uint32_t
 Session::increaseMessageIdCounter()
 {
-    uint32_t tempId = 0;
-    while (m_messageIdCounter_lock.test_and_set(std::memory_order_acquire))  {
-        asm("");
-    }
-
-    m_messageIdCounter++;
-    tempId = m_messageIdCounter;
-
-    m_messageIdCounter_lock.clear(std::memory_order_release);
-    return tempId;
+    return m_messageIdCounter.fetch_add(1, std::memory_order_relaxed) + 1;
 }
 
 } // namespace Sakura
@@ -22,9 +22,17 @@
 
 #include <libKitsunemimiSakuraNetwork/session_controller.h>
 
+#include <chrono>
+
 #include <handler/reply_handler.h>
 #include <handler/message_blocker_handler.h>
 #include <handler/session_handler.h>
+#include <handler/buffer_pool.h>
+#include <handler/callback_dispatcher.h>
+#include <handler/io_engine.h>
+#include <handler/session_pool.h>
+#include <shared_memory/shared_memory_server.h>
+#include <shared_memory/shared_memory_channel.h>
 #include <callbacks.h>
 #include <messages_processing/session_processing.h>
 
@@ -92,9 +100,12 @@ SessionController::~SessionController()
 uint32_t
 SessionController::addUnixDomainServer(const std::string &socketFile)
 {
-    Network::UnixDomainServer* server = new Network::UnixDomainServer(this,
+    ServerContext* context = new ServerContext();
+    Network::UnixDomainServer* server = new Network::UnixDomainServer(context,
                                                                       &processConnection_Callback);
-    if(server->initServer(socketFile) == false) {
+    if(server->initServer(socketFile) == false)
+    {
+        delete context;
         return 0;
     }
     server->startThread();
@@ -103,6 +114,7 @@ SessionController::addUnixDomainServer(const std::string &socketFile)
     m_serverIdCounter++;
     sessionHandler->lockServerMap();
     sessionHandler->m_servers.insert(std::make_pair(m_serverIdCounter, server));
+    sessionHandler->m_serverContexts.insert(std::make_pair(m_serverIdCounter, context));
     sessionHandler->unlockServerMap();
 
     return m_serverIdCounter;
@@ -118,9 +130,12 @@ SessionController::addUnixDomainServer(const std::string &socketFile)
 uint32_t
 SessionController::addTcpServer(const uint16_t port)
 {
-    Network::TcpServer* server = new Network::TcpServer(this,
+    ServerContext* context = new ServerContext();
+    Network::TcpServer* server = new Network::TcpServer(context,
                                                         &processConnection_Callback);
-    if(server->initServer(port) == false) {
+    if(server->initServer(port) == false)
+    {
+        delete context;
         return 0;
     }
     server->startThread();
@@ -129,6 +144,7 @@ SessionController::addTcpServer(const uint16_t port)
     m_serverIdCounter++;
     sessionHandler->lockServerMap();
     sessionHandler->m_servers.insert(std::make_pair(m_serverIdCounter, server));
+    sessionHandler->m_serverContexts.insert(std::make_pair(m_serverIdCounter, context));
     sessionHandler->unlockServerMap();
 
     return m_serverIdCounter;
@@ -148,11 +164,14 @@ SessionController::addTlsTcpServer(const uint16_t port,
                                    const std::string &certFile,
                                    const std::string &keyFile)
 {
-    Network::TlsTcpServer* server = new Network::TlsTcpServer(this,
+    ServerContext* context = new ServerContext();
+    Network::TlsTcpServer* server = new Network::TlsTcpServer(context,
                                                               &processConnection_Callback,
                                                               certFile,
                                                               keyFile);
-    if(server->initServer(port) == false) {
+    if(server->initServer(port) == false)
+    {
+        delete context;
         return 0;
     }
     server->startThread();
@@ -162,6 +181,40 @@ SessionController::addTlsTcpServer(const uint16_t port,
     sessionHandler->lockServerMap();
     sessionHandler->m_servers.insert(std::pair<uint32_t, Network::AbstractServer*>(
                                      m_serverIdCounter, server));
+    sessionHandler->m_serverContexts.insert(std::make_pair(m_serverIdCounter, context));
+    sessionHandler->unlockServerMap();
+
+    return m_serverIdCounter;
+}
+
+/**
+ * @brief add new server for sessions over shared memory, which can only be used by clients on
+ *        the same host. The unix-domain-socket is only used to hand over the shared memory and
+ *        to detect the end of the other side.
+ *
+ * @param socketFile file-path for the unix-domain-socket of the server
+ *
+ * @return id of the new server if sussessful, else return 0
+ */
+uint32_t
+SessionController::addSharedMemoryServer(const std::string &socketFile)
+{
+    ServerContext* context = new ServerContext();
+    SharedMemoryServer* server = new SharedMemoryServer(context,
+                                                        &processSharedMemoryConnection_Callback);
+    if(server->initServer(socketFile) == false)
+    {
+        delete server;
+        delete context;
+        return 0;
+    }
+    server->startThread();
+
+    SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
+    m_serverIdCounter++;
+    sessionHandler->lockServerMap();
+    sessionHandler->m_sharedMemoryServers.insert(std::make_pair(m_serverIdCounter, server));
+    sessionHandler->m_serverContexts.insert(std::make_pair(m_serverIdCounter, context));
     sessionHandler->unlockServerMap();
 
     return m_serverIdCounter;
@@ -198,6 +251,20 @@ SessionController::closeServer(const uint32_t id)
         return true;
     }
 
+    std::map<uint32_t, SharedMemoryServer*>::iterator sharedMemoryIt;
+    sharedMemoryIt = sessionHandler->m_sharedMemoryServers.find(id);
+
+    if(sharedMemoryIt != sessionHandler->m_sharedMemoryServers.end())
+    {
+        SharedMemoryServer* server = sharedMemoryIt->second;
+        server->closeServer();
+        server->scheduleThreadForDeletion();
+        sessionHandler->m_sharedMemoryServers.erase(sharedMemoryIt);
+        sessionHandler->unlockServerMap();
+
+        return true;
+    }
+
     sessionHandler->unlockServerMap();
 
     return false;
@@ -220,6 +287,14 @@ SessionController::cloesAllServers()
         it->second->closeServer();
     }
 
+    std::map<uint32_t, SharedMemoryServer*>::iterator sharedMemoryIt;
+    for(sharedMemoryIt = sessionHandler->m_sharedMemoryServers.begin();
+        sharedMemoryIt != sessionHandler->m_sharedMemoryServers.end();
+        sharedMemoryIt++)
+    {
+        sharedMemoryIt->second->closeServer();
+    }
+
     sessionHandler->unlockServerMap();
 }
 
@@ -247,16 +322,32 @@ SessionController::startUnixDomainSession(const std::string &socketFile,
  * @param address ip-address of the server
  * @param port port where the server is listening
  * @param sessionIdentifier additional identifier as help for an upper processing-layer
+ * @param numberOfConnections number of tcp-connections of the session. The parts of large
+ *                            multiblock-messages are distributed over all connections.
  *
  * @return true, if session was successfully created and connected, else false
  */
 Session*
 SessionController::startTcpSession(const std::string &address,
                                    const uint16_t port,
-                                   const std::string &sessionIdentifier)
+                                   const std::string &sessionIdentifier,
+                                   const uint32_t numberOfConnections)
 {
     Network::TcpSocket* tcpSocket = new Network::TcpSocket(address, port);
-    return startSession(tcpSocket, sessionIdentifier);
+    Session* session = startSession(tcpSocket, sessionIdentifier);
+    if(session == nullptr) {
+        return nullptr;
+    }
+
+    // additional connections are optional, so a failed one is only logged
+    for(uint32_t i = 1; i < numberOfConnections && i <= MAX_NUMBER_OF_STRIPES; i++)
+    {
+        if(startStripe(session, new Network::TcpSocket(address, port), i) == false) {
+            LOG_WARNING("failed to start additional tcp-connection " + std::to_string(i));
+        }
+    }
+
+    return session;
 }
 
 /**
@@ -267,6 +358,8 @@ SessionController::startTcpSession(const std::string &address,
  * @param certFile path to the certificate-file
  * @param keyFile path to the key-file
  * @param sessionIdentifier additional identifier as help for an upper processing-layer
+ * @param numberOfConnections number of tls-tcp-connections of the session. The parts of large
+ *                            multiblock-messages are distributed over all connections.
  *
  * @return true, if session was successfully created and connected, else false
  */
@@ -275,41 +368,74 @@ SessionController::startTlsTcpSession(const std::string &address,
                                       const uint16_t port,
                                       const std::string &certFile,
                                       const std::string &keyFile,
-                                      const std::string &sessionIdentifier)
+                                      const std::string &sessionIdentifier,
+                                      const uint32_t numberOfConnections)
 {
     Network::TlsTcpSocket* tlsTcpSocket = new Network::TlsTcpSocket(address,
                                                                     port,
                                                                     certFile,
                                                                     keyFile);
-    return startSession(tlsTcpSocket, sessionIdentifier);
+    Session* session = startSession(tlsTcpSocket, sessionIdentifier);
+    if(session == nullptr) {
+        return nullptr;
+    }
+
+    // additional connections are optional, so a failed one is only logged
+    for(uint32_t i = 1; i < numberOfConnections && i <= MAX_NUMBER_OF_STRIPES; i++)
+    {
+        Network::TlsTcpSocket* stripeSocket = new Network::TlsTcpSocket(address,
+                                                                        port,
+                                                                        certFile,
+                                                                        keyFile);
+        if(startStripe(session, stripeSocket, i) == false) {
+            LOG_WARNING("failed to start additional tls-tcp-connection " + std::to_string(i));
+        }
+    }
+
+    return session;
 }
 
 /**
- * @brief get a session by its id
+ * @brief start new session over shared memory
  *
- * @param id id of the requested session
+ * @param socketFile socket-file-path, where the shared-memory-server is listening
+ * @param sessionIdentifier additional identifier as help for an upper processing-layer
  *
- * @return pointer to the session, if found, else nullptr
+ * @return true, if session was successfully created and connected, else false
  */
 Session*
-SessionController::getSession(const uint32_t id)
+SessionController::startSharedMemorySession(const std::string &socketFile,
+                                            const std::string &sessionIdentifier)
 {
-    SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
-    sessionHandler->lockSessionMap();
+    // precheck
+    if(sessionIdentifier.size() > 64) {
+        return nullptr;
+    }
 
-    std::map<uint32_t, Session*>::iterator it;
-    it = sessionHandler->m_sessions.find(id);
+    SharedMemoryChannel* channel = new SharedMemoryChannel(socketFile);
+    Session* newSession = new Session(nullptr);
+    newSession->m_sharedMemory = channel;
+    channel->setMessageCallback(newSession, &processMessage_callback);
 
-    if(it != sessionHandler->m_sessions.end())
-    {
-        Session* session = it->second;
-        sessionHandler->unlockSessionMap();
-        return session;
+    Session* result = connectSession(newSession, sessionIdentifier);
+    if(result == nullptr) {
+        delete channel;
     }
 
-    sessionHandler->unlockSessionMap();
+    return result;
+}
 
-    return nullptr;
+/**
+ * @brief get a session by its id
+ *
+ * @param id id of the requested session
+ *
+ * @return pointer to the session, if found, else nullptr
+ */
+Session*
+SessionController::getSession(const uint32_t id)
+{
+    return SessionHandler::m_sessionHandler->getSession(id);
 }
 
 /**
@@ -322,20 +448,11 @@ SessionController::getSession(const uint32_t id)
 bool
 SessionController::closeSession(const uint32_t id)
 {
-    SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
-    sessionHandler->lockSessionMap();
-
-    std::map<uint32_t, Session*>::iterator it;
-    it = SessionHandler::m_sessionHandler->m_sessions.find(id);
-
-    if(it != SessionHandler::m_sessionHandler->m_sessions.end())
-    {
-        sessionHandler->unlockSessionMap();
-        return it->second->closeSession(true);
+    Session* session = SessionHandler::m_sessionHandler->getSession(id);
+    if(session != nullptr) {
+        return session->closeSession(true);
     }
 
-    sessionHandler->unlockSessionMap();
-
     return false;
 }
 
@@ -345,23 +462,14 @@ SessionController::closeSession(const uint32_t id)
 void
 SessionController::closeAllSession()
 {
-    SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
-
-    // copy to avoid problems, when the close-process reduce the list, while there is a iteration
-    // over the same list
-    sessionHandler->lockSessionMap();
-    std::map<uint32_t, Session*> copy = SessionHandler::m_sessionHandler->m_sessions;
-    sessionHandler->unlockSessionMap();
-
-    std::map<uint32_t, Session*>::iterator it;
-    for(it = copy.begin();
-        it != copy.end();
-        it++)
-    {
-        it->second->closeSession();
+    // snapshot to avoid problems, when the close-process reduce the list, while there is a
+    // iteration over the same list
+    const std::vector<Session*> sessions = SessionHandler::m_sessionHandler->getAllSessions();
+    for(uint64_t i = 0; i < sessions.size(); i++) {
+        sessions[i]->closeSession();
     }
 
-    SessionHandler::m_sessionHandler->m_sessions.clear();
+    SessionHandler::m_sessionHandler->removeAllSessions();
 }
 
 /**
@@ -386,11 +494,12 @@ SessionController::linkSessions(Session* session1, Session* session2)
     }
 
     // check and link sessions
-    if(session1->m_linkedSession != nullptr
-            || session2->m_linkedSession != nullptr)
+    if(session1->m_linkedSession == nullptr
+            && session2->m_linkedSession == nullptr)
     {
-        session1->m_linkedSession = session2->m_linkedSession;
-        session2->m_linkedSession = session1->m_linkedSession;
+        session1->m_linkedSession = session2;
+        session2->m_linkedSession = session1;
+        result = true;
     }
 
     // releads spin-locks
@@ -439,6 +548,335 @@ SessionController::unlinkSession(Session* session)
     return true;
 }
 
+/**
+ * @brief enable or disable the compression of payloads of singleblock- and multiblock-messages
+ *        for new sessions. Compression is only used for a session, when both sides have enabled
+ *        it, while the session is initialized. Existing sessions are not affected.
+ *
+ * @param enable true to offer compression for new sessions
+ * @param threshold payloads (or single parts of multiblock-messages) smaller than this number of
+ *                  bytes are send uncompressed
+ */
+void
+SessionController::setCompression(const bool enable,
+                                  const uint32_t threshold)
+{
+    SessionHandler::m_sessionHandler->m_compressionThreshold = threshold;
+    SessionHandler::m_sessionHandler->m_compressionEnabled = enable;
+}
+
+/**
+ * @brief enable or disable the credit-based flow-control of stream-messages for new sessions.
+ *        The receiver grants credits for the space within its ring-buffer, which was freed by
+ *        processing stream-messages, so the sender never overwrites unprocessed data. It is only
+ *        used for a session, when both sides have enabled it, while the session is initialized.
+ *        Existing sessions are not affected.
+ *
+ * @param enable true to offer flow-control for new sessions
+ */
+void
+SessionController::setStreamFlowControl(const bool enable)
+{
+    SessionHandler::m_sessionHandler->m_streamFlowControlEnabled = enable;
+}
+
+/**
+ * @brief enable or disable a crc32c-checksum for all messages of new sessions, which is
+ *        calculated over everything behind the common header of a message and checked by the
+ *        receiver. It is only used for a session, when both sides have enabled it, while the
+ *        session is initialized. Existing sessions are not affected.
+ *
+ * @param enable true to offer the checksum for new sessions
+ */
+void
+SessionController::setPayloadChecksum(const bool enable)
+{
+    SessionHandler::m_sessionHandler->m_payloadChecksumEnabled = enable;
+}
+
+// the public reply-types are the message-types of the protocol
+static_assert(static_cast<int>(SessionController::SESSION_REPLY)
+              == static_cast<int>(SESSION_TYPE), "invalid SESSION_REPLY");
+static_assert(static_cast<int>(SessionController::HEARTBEAT_REPLY)
+              == static_cast<int>(HEARTBEAT_TYPE), "invalid HEARTBEAT_REPLY");
+static_assert(static_cast<int>(SessionController::STREAM_REPLY)
+              == static_cast<int>(STREAM_DATA_TYPE), "invalid STREAM_REPLY");
+static_assert(static_cast<int>(SessionController::SINGLEBLOCK_REPLY)
+              == static_cast<int>(SINGLEBLOCK_DATA_TYPE), "invalid SINGLEBLOCK_REPLY");
+static_assert(static_cast<int>(SessionController::MULTIBLOCK_REPLY)
+              == static_cast<int>(MULTIBLOCK_DATA_TYPE), "invalid MULTIBLOCK_REPLY");
+
+/**
+ * @brief check if a type of the public list of reply-types is valid
+ *
+ * @param replyType type to check
+ *
+ * @return true, if replies of messages of this type are checked for timeouts, else false
+ */
+static bool
+isValidReplyType(const uint8_t replyType)
+{
+    switch(replyType)
+    {
+        case SessionController::SESSION_REPLY:
+        case SessionController::HEARTBEAT_REPLY:
+        case SessionController::STREAM_REPLY:
+        case SessionController::SINGLEBLOCK_REPLY:
+        case SessionController::MULTIBLOCK_REPLY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief set the time, how long is waited for the reply of a message of a specific type, before
+ *        the error-callback is triggered with a timeout. The timeout is rounded up to the steps
+ *        of the reply-timer and is used for all messages, which are send afterwards.
+ *
+ * @param replyType type of the messages (see replyTypes)
+ * @param timeout timeout in milliseconds
+ *
+ * @return false, if the type is invalid, else true
+ */
+bool
+SessionController::setReplyTimeout(const uint8_t replyType,
+                                   const uint32_t timeout)
+{
+    if(isValidReplyType(replyType) == false) {
+        return false;
+    }
+
+    SessionHandler::m_replyHandler->setTimeout(replyType, timeout);
+
+    return true;
+}
+
+/**
+ * @brief get the time, how long is waited for the reply of a message of a specific type
+ *
+ * @param replyType type of the messages (see replyTypes)
+ *
+ * @return 0, if the type is invalid, else the timeout in milliseconds
+ */
+uint32_t
+SessionController::getReplyTimeout(const uint8_t replyType)
+{
+    if(isValidReplyType(replyType) == false) {
+        return 0;
+    }
+
+    return SessionHandler::m_replyHandler->getTimeout(replyType);
+}
+
+/**
+ * @brief get statistics of the pool for the buffers of received messages
+ *
+ * @return object with the number of hits and misses and the number of held bytes
+ */
+BufferPoolStats
+SessionController::getBufferPoolStats()
+{
+    return SessionHandler::m_bufferPool->getStats();
+}
+
+/**
+ * @brief start worker-threads, which trigger the callbacks for incoming standalone-messages,
+ *        requests and responses instead of the receiving thread of the socket. The order of the
+ *        callbacks within a session is preserved. Stream-messages are still processed by the
+ *        receiving thread, because their data are not copied out of the receive-buffer.
+ *
+ * @param numberOfWorkers number of worker-threads
+ *
+ * @return false, if number is 0 or dispatcher was already started, else true
+ */
+bool
+SessionController::startCallbackDispatcher(const uint32_t numberOfWorkers)
+{
+    return SessionHandler::m_callbackDispatcher->startWorkers(numberOfWorkers);
+}
+
+/**
+ * @brief get statistics of the callback-dispatcher
+ *
+ * @return object with the queue-depth and the latency (in microseconds) between receiving a
+ *         message and triggering its callback
+ */
+DispatcherStats
+SessionController::getDispatcherStats()
+{
+    return SessionHandler::m_callbackDispatcher->getStats();
+}
+
+/**
+ * @brief start a fixed number of event-loop-threads, which send the multiblock-messages of all
+ *        new sessions, instead of one sender-thread per session. The sessions are distributed
+ *        over the loops. It should be called before the first server or session is created,
+ *        because existing sessions keep their own thread.
+ *
+ * @param numberOfLoops number of loop-threads, or 0 for one loop per cpu-core
+ *
+ * @return false, if engine was already started or the loops can not be created, else true
+ */
+bool
+SessionController::startIoEngine(const uint32_t numberOfLoops)
+{
+    return SessionHandler::m_ioEngine->startLoops(numberOfLoops);
+}
+
+/**
+ * @brief get statistics of the io-engine
+ *
+ * @return object with the number of loops and the number of sessions, which are handled by them
+ */
+IoEngineStats
+SessionController::getIoEngineStats()
+{
+    return SessionHandler::m_ioEngine->getStats();
+}
+
+/**
+ * @brief add a pool, which keeps ready sessions to a server, so new sessions don't wait for
+ *        the connect and the handshake. The pool is filled in the background. Calling it again
+ *        for the same target changes the number of sessions.
+ *
+ * @param target transport and address of the server
+ * @param numberOfSessions number of ready sessions, which are kept for the target
+ *
+ * @return false, if number of sessions is 0, else true
+ */
+bool
+SessionController::addSessionPool(const SessionTarget &target,
+                                  const uint32_t numberOfSessions)
+{
+    return SessionHandler::m_sessionPool->addPool(target, numberOfSessions);
+}
+
+/**
+ * @brief remove the pool of a target and close its ready sessions
+ *
+ * @param target transport and address of the server
+ *
+ * @return false, if there is no pool for the target, else true
+ */
+bool
+SessionController::removeSessionPool(const SessionTarget &target)
+{
+    return SessionHandler::m_sessionPool->removePool(target);
+}
+
+/**
+ * @brief take a ready session out of the pool of a target. If the pool is empty, a new session
+ *        is started directly.
+ *
+ * @param target transport and address of the server
+ *
+ * @return session, which has to be given back with releaseSession, or nullptr, if there is
+ *         no pool for the target or the session could not be started
+ */
+Session*
+SessionController::acquireSession(const SessionTarget &target)
+{
+    return SessionHandler::m_sessionPool->acquireSession(target);
+}
+
+/**
+ * @brief give a session back to its pool. It is closed, if it is not healthy anymore or the
+ *        pool is already full.
+ *
+ * @param session session, which was taken by acquireSession
+ *
+ * @return true, if the session was put back into the pool, else false
+ */
+bool
+SessionController::releaseSession(Session* session)
+{
+    return SessionHandler::m_sessionPool->releaseSession(session);
+}
+
+/**
+ * @brief get statistics of all session-pools
+ *
+ * @return object with the number of ready and used sessions and the hits and misses
+ */
+SessionPoolStats
+SessionController::getSessionPoolStats()
+{
+    return SessionHandler::m_sessionPool->getStats();
+}
+
+/**
+ * @brief set the cores for all threads, which are shared by all sessions, like the handler-
+ *        threads and the io-engine. The policy is also the default for all sessions without
+ *        an own policy. The threads apply the new policy by themselves with the next cycle.
+ *
+ * @param policy new global affinity-policy. Without cores all threads can run on all cores
+ *               again.
+ */
+void
+SessionController::setGlobalAffinity(const AffinityPolicy &policy)
+{
+    SessionHandler::m_sessionHandler->setGlobalAffinity(policy);
+}
+
+/**
+ * @brief set the affinity-policy for all new sessions, which are accepted by a server.
+ *        Already existing sessions of the server are not changed.
+ *
+ * @param serverId id of the server
+ * @param policy new affinity-policy for the sessions of the server
+ *
+ * @return false, if server-id doesn't exist, else true
+ */
+bool
+SessionController::setServerAffinity(const uint32_t serverId,
+                                     const AffinityPolicy &policy)
+{
+    SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
+    sessionHandler->lockServerMap();
+
+    std::map<uint32_t, ServerContext*>::iterator it;
+    it = sessionHandler->m_serverContexts.find(serverId);
+    if(it == sessionHandler->m_serverContexts.end())
+    {
+        sessionHandler->unlockServerMap();
+        return false;
+    }
+
+    ServerContext* context = it->second;
+    context->mutex.lock();
+    context->affinity = policy;
+    context->mutex.unlock();
+
+    sessionHandler->unlockServerMap();
+
+    return true;
+}
+
+/**
+ * @brief get the metrics of all sessions together. Counters and histograms contain also the
+ *        values of already closed sessions. The current fill-levels are the sum over all
+ *        existing sessions.
+ *
+ * @return snapshot of the global metrics
+ */
+SessionMetrics
+SessionController::getGlobalMetrics()
+{
+    SessionMetrics result;
+    SessionHandler::m_globalMetrics->getSnapshot(result);
+
+    const std::vector<Session*> sessions = SessionHandler::m_sessionHandler->getAllSessions();
+    for(uint64_t i = 0; i < sessions.size(); i++)
+    {
+        const SessionMetrics sessionMetrics = sessions[i]->getMetrics();
+        result.ringBufferUsage += sessionMetrics.ringBufferUsage;
+        result.multiblockQueueDepth += sessionMetrics.multiblockQueueDepth;
+    }
+
+    return result;
+}
+
 /**
  * @brief start a new session
  *
@@ -458,9 +896,25 @@ SessionController::startSession(Network::AbstractSocket *socket,
 
     // create new session
     Session* newSession = new Session(socket);
-    const uint32_t newId = SessionHandler::m_sessionHandler->increaseSessionIdCounter();
     socket->setMessageCallback(newSession, &processMessage_callback);
 
+    return connectSession(newSession, sessionIdentifier);
+}
+
+/**
+ * @brief connect a new session and wait until the initial message-transfer is done
+ *
+ * @param newSession new session, which should be connected
+ * @param sessionIdentifier additional identifier as help for an upper processing-layer
+ *
+ * @return the session, if it was successfully connected, else nullptr
+ */
+Session*
+SessionController::connectSession(Session* newSession,
+                                  const std::string &sessionIdentifier)
+{
+    const uint32_t newId = SessionHandler::m_sessionHandler->getLocalSessionId();
+
     // connect session
     if(newSession->connectiSession(newId))
     {
@@ -470,6 +924,11 @@ SessionController::startSession(Network::AbstractSocket *socket,
         std::unique_lock<std::mutex> lock(newSession->m_cvMutex);
         newSession->m_cv.wait(lock);
 
+        // the session was rejected while processing the init-reply
+        if(newSession->isSessionReady() == false) {
+            return nullptr;
+        }
+
         return newSession;
     }
     else
@@ -481,6 +940,58 @@ SessionController::startSession(Network::AbstractSocket *socket,
     return nullptr;
 }
 
+/**
+ * @brief connect an additional connection to an existing session and wait until the server has
+ *        confirmed it
+ *
+ * @param primary session, which gets the additional connection
+ * @param socket socket of the additional connection
+ * @param stripeId number of the additional connection
+ *
+ * @return true, if the connection was confirmed and added to the session, else false
+ */
+bool
+SessionController::startStripe(Session* primary,
+                               Network::AbstractSocket* socket,
+                               const uint32_t stripeId)
+{
+    Session* stripe = new Session(socket);
+    socket->setMessageCallback(stripe, &processMessage_callback);
+    stripe->m_stripePrimary = primary;
+    stripe->m_stripeToken = primary->m_stripeToken;
+    stripe->m_compressPayload = primary->m_compressPayload;
+    stripe->m_payloadChecksum = primary->m_payloadChecksum;
+
+    if(stripe->connectiSession(primary->sessionId()) == false)
+    {
+        delete stripe;
+        return false;
+    }
+
+    // lock before sending, so the reply can not be processed before the wait begins
+    bool confirmed = false;
+    {
+        std::unique_lock<std::mutex> lock(stripe->m_cvMutex);
+        send_Session_Stripe_Start(stripe, stripeId);
+        confirmed = stripe->m_cv.wait_for(lock,
+                                          std::chrono::milliseconds(STRIPE_CONFIRM_TIMEOUT),
+                                          [stripe] { return stripe->m_stripeConfirmed; });
+    }
+
+    // the late reply can still arrive, so the stripe is only deleted, after its socket-thread
+    // has stopped
+    if(confirmed == false)
+    {
+        stripe->disconnectStripe();
+        delete stripe;
+        return false;
+    }
+
+    primary->addStripe(stripe);
+
+    return true;
+}
+
 //==================================================================================================
 
 } // namespace Sakura
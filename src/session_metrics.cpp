@@ -0,0 +1,384 @@
+/**
+ * @file       session_metrics.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <libKitsunemimiSakuraNetwork/session_metrics.h>
+
+#include <chrono>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief raise an atomic value to a new maximum
+ *
+ * @param target atomic value, which should be updated
+ * @param value new value
+ */
+inline void
+updateMaximum(std::atomic<uint64_t> &target,
+              const uint64_t value)
+{
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while(value > current
+          && target.compare_exchange_weak(current, value, std::memory_order_relaxed) == false)
+    {
+        asm("");
+    }
+}
+
+/**
+ * @brief get the average of all values of the histogram
+ *
+ * @return average in microseconds
+ */
+uint64_t
+LatencyHistogram::getAverage() const
+{
+    if(numberOfValues == 0) {
+        return 0;
+    }
+
+    return sum / numberOfValues;
+}
+
+/**
+ * @brief get the upper bound of the bucket, which contains the requested percentile
+ *
+ * @param percentile requested percentile between 0.0 and 1.0 (for example 0.99 for p99)
+ *
+ * @return upper bound of the bucket in microseconds, but never more than the max-value
+ */
+uint64_t
+LatencyHistogram::getPercentile(const double percentile) const
+{
+    if(numberOfValues == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(percentile * static_cast<double>(numberOfValues));
+    if(rank >= numberOfValues) {
+        rank = numberOfValues - 1;
+    }
+
+    uint64_t counter = 0;
+    for(uint32_t i = 0; i < NUMBER_OF_LATENCY_BUCKETS; i++)
+    {
+        counter += buckets[i];
+        if(counter > rank)
+        {
+            const uint64_t upperBound = i == 0 ? 0 : (1ULL << i) - 1;
+            return upperBound < max ? upperBound : max;
+        }
+    }
+
+    return max;
+}
+
+/**
+ * @brief constructor
+ */
+AtomicHistogram::AtomicHistogram()
+{
+    for(uint32_t i = 0; i < NUMBER_OF_LATENCY_BUCKETS; i++) {
+        m_buckets[i] = 0;
+    }
+    m_numberOfValues = 0;
+    m_sum = 0;
+    m_max = 0;
+}
+
+/**
+ * @brief add a new value to the histogram
+ *
+ * @param value new value in microseconds
+ */
+void
+AtomicHistogram::addValue(const uint64_t value)
+{
+    uint32_t bucket = 0;
+    if(value != 0) {
+        bucket = 64 - static_cast<uint32_t>(__builtin_clzll(value));
+    }
+    if(bucket >= NUMBER_OF_LATENCY_BUCKETS) {
+        bucket = NUMBER_OF_LATENCY_BUCKETS - 1;
+    }
+
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_numberOfValues.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+    updateMaximum(m_max, value);
+}
+
+/**
+ * @brief copy the current state of the histogram. The values are read without lock, so the
+ *        snapshot is not exactly consistent, while values are added at the same time.
+ *
+ * @param histogram reference to the resulting histogram
+ */
+void
+AtomicHistogram::getSnapshot(LatencyHistogram &histogram) const
+{
+    for(uint32_t i = 0; i < NUMBER_OF_LATENCY_BUCKETS; i++) {
+        histogram.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+    histogram.numberOfValues = m_numberOfValues.load(std::memory_order_relaxed);
+    histogram.sum = m_sum.load(std::memory_order_relaxed);
+    histogram.max = m_max.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief constructor
+ *
+ * @param parent recorder, which should get all counter-updates and histogram-values too
+ */
+MetricsRecorder::MetricsRecorder(MetricsRecorder* parent)
+{
+    m_parent = parent;
+
+    for(uint32_t i = 0; i < NUMBER_OF_METRIC_MESSAGE_TYPES; i++)
+    {
+        m_sendMessages[i] = 0;
+        m_sendBytes[i] = 0;
+        m_receivedMessages[i] = 0;
+        m_receivedBytes[i] = 0;
+    }
+    m_numberOfTimeouts = 0;
+    m_numberOfChecksumErrors = 0;
+
+    m_ringBufferUsage = 0;
+    m_maxRingBufferUsage = 0;
+    m_multiblockQueueDepth = 0;
+    m_maxMultiblockQueueDepth = 0;
+}
+
+/**
+ * @brief get current time for the measurement of durations
+ *
+ * @return time of the steady-clock in microseconds
+ */
+uint64_t
+MetricsRecorder::getCurrentTime()
+{
+    const std::chrono::steady_clock::duration now =
+            std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+}
+
+/**
+ * @brief count a send message
+ *
+ * @param messageType type of the message
+ * @param size total size of the message in bytes
+ */
+void
+MetricsRecorder::addSendMessage(const uint8_t messageType,
+                                const uint64_t size)
+{
+    const uint8_t id = messageType < NUMBER_OF_METRIC_MESSAGE_TYPES ? messageType : 0;
+    m_sendMessages[id].fetch_add(1, std::memory_order_relaxed);
+    m_sendBytes[id].fetch_add(size, std::memory_order_relaxed);
+
+    if(m_parent != nullptr) {
+        m_parent->addSendMessage(messageType, size);
+    }
+}
+
+/**
+ * @brief count a received message
+ *
+ * @param messageType type of the message
+ * @param size total size of the message in bytes
+ */
+void
+MetricsRecorder::addReceivedMessage(const uint8_t messageType,
+                                    const uint64_t size)
+{
+    const uint8_t id = messageType < NUMBER_OF_METRIC_MESSAGE_TYPES ? messageType : 0;
+    m_receivedMessages[id].fetch_add(1, std::memory_order_relaxed);
+    m_receivedBytes[id].fetch_add(size, std::memory_order_relaxed);
+
+    if(m_parent != nullptr) {
+        m_parent->addReceivedMessage(messageType, size);
+    }
+}
+
+/**
+ * @brief count a timeout of a reply, request or heartbeat
+ */
+void
+MetricsRecorder::addTimeout()
+{
+    m_numberOfTimeouts.fetch_add(1, std::memory_order_relaxed);
+
+    if(m_parent != nullptr) {
+        m_parent->addTimeout();
+    }
+}
+
+/**
+ * @brief count a received message, which was dropped, because of a wrong checksum
+ */
+void
+MetricsRecorder::addChecksumError()
+{
+    m_numberOfChecksumErrors.fetch_add(1, std::memory_order_relaxed);
+
+    if(m_parent != nullptr) {
+        m_parent->addChecksumError();
+    }
+}
+
+/**
+ * @brief add the time between sending a message and receiving its reply
+ *
+ * @param duration round-trip-time in microseconds
+ */
+void
+MetricsRecorder::addReplyRoundTrip(const uint64_t duration)
+{
+    m_replyRoundTrip.addValue(duration);
+
+    if(m_parent != nullptr) {
+        m_parent->addReplyRoundTrip(duration);
+    }
+}
+
+/**
+ * @brief add the time between sending a heartbeat and receiving its reply
+ *
+ * @param duration round-trip-time in microseconds
+ */
+void
+MetricsRecorder::addHeartbeatRoundTrip(const uint64_t duration)
+{
+    m_heartbeatRoundTrip.addValue(duration);
+
+    if(m_parent != nullptr) {
+        m_parent->addHeartbeatRoundTrip(duration);
+    }
+}
+
+/**
+ * @brief add the time between sending a request and receiving its response
+ *
+ * @param duration latency in microseconds
+ */
+void
+MetricsRecorder::addRequestLatency(const uint64_t duration)
+{
+    m_requestLatency.addValue(duration);
+
+    if(m_parent != nullptr) {
+        m_parent->addRequestLatency(duration);
+    }
+}
+
+/**
+ * @brief add the time, which a message has waited for the socket
+ *
+ * @param control true for control- and reply-messages, false for bulk-data
+ * @param duration delay in microseconds
+ */
+void
+MetricsRecorder::addSendQueueDelay(const bool control,
+                                   const uint64_t duration)
+{
+    if(control) {
+        m_controlQueueDelay.addValue(duration);
+    } else {
+        m_bulkQueueDelay.addValue(duration);
+    }
+
+    if(m_parent != nullptr) {
+        m_parent->addSendQueueDelay(control, duration);
+    }
+}
+
+/**
+ * @brief update the fill-level of the ring-buffer for incoming data. The parent only gets the
+ *        maximum, because the current value is only meaningful for a single session.
+ *
+ * @param usage number of bytes within the ring-buffer
+ */
+void
+MetricsRecorder::updateRingBufferUsage(const uint64_t usage)
+{
+    m_ringBufferUsage.store(usage, std::memory_order_relaxed);
+    updateMaximum(m_maxRingBufferUsage, usage);
+
+    if(m_parent != nullptr) {
+        updateMaximum(m_parent->m_maxRingBufferUsage, usage);
+    }
+}
+
+/**
+ * @brief update the number of outgoing multiblock-messages. The parent only gets the maximum,
+ *        because the current value is only meaningful for a single session.
+ *
+ * @param depth number of multiblock-messages within the outgoing queue
+ */
+void
+MetricsRecorder::updateMultiblockQueueDepth(const uint64_t depth)
+{
+    m_multiblockQueueDepth.store(depth, std::memory_order_relaxed);
+    updateMaximum(m_maxMultiblockQueueDepth, depth);
+
+    if(m_parent != nullptr) {
+        updateMaximum(m_parent->m_maxMultiblockQueueDepth, depth);
+    }
+}
+
+/**
+ * @brief copy all counters and histograms without any lock
+ *
+ * @param metrics reference to the resulting metrics
+ */
+void
+MetricsRecorder::getSnapshot(SessionMetrics &metrics) const
+{
+    for(uint32_t i = 0; i < NUMBER_OF_METRIC_MESSAGE_TYPES; i++)
+    {
+        metrics.sendMessages[i] = m_sendMessages[i].load(std::memory_order_relaxed);
+        metrics.sendBytes[i] = m_sendBytes[i].load(std::memory_order_relaxed);
+        metrics.receivedMessages[i] = m_receivedMessages[i].load(std::memory_order_relaxed);
+        metrics.receivedBytes[i] = m_receivedBytes[i].load(std::memory_order_relaxed);
+    }
+    metrics.numberOfTimeouts = m_numberOfTimeouts.load(std::memory_order_relaxed);
+    metrics.numberOfChecksumErrors = m_numberOfChecksumErrors.load(std::memory_order_relaxed);
+
+    metrics.ringBufferUsage = m_ringBufferUsage.load(std::memory_order_relaxed);
+    metrics.maxRingBufferUsage = m_maxRingBufferUsage.load(std::memory_order_relaxed);
+    metrics.multiblockQueueDepth = m_multiblockQueueDepth.load(std::memory_order_relaxed);
+    metrics.maxMultiblockQueueDepth = m_maxMultiblockQueueDepth.load(std::memory_order_relaxed);
+
+    m_replyRoundTrip.getSnapshot(metrics.replyRoundTrip);
+    m_heartbeatRoundTrip.getSnapshot(metrics.heartbeatRoundTrip);
+    m_requestLatency.getSnapshot(metrics.requestLatency);
+    m_controlQueueDelay.getSnapshot(metrics.controlQueueDelay);
+    m_bulkQueueDelay.getSnapshot(metrics.bulkQueueDelay);
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,562 @@
+/**
+ * @file       shared_memory_channel.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <shared_memory/shared_memory_channel.h>
+
+#include <new>
+#include <climits>
+#include <algorithm>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include <libKitsunemimiPersistence/logger/logger.h>
+
+// the atomics are shared between processes, which is only possible without internal locks
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "64-bit atomics must be lock-free");
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "32-bit atomics must be lock-free");
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief wait until the value of a shared atomic was changed by the other process
+ *
+ * @param address address of the atomic within the shared memory
+ * @param expected value, which was read before
+ * @param timeout max time to wait in milliseconds
+ */
+inline void
+futexWait(std::atomic<uint32_t>* address,
+          const uint32_t expected,
+          const uint32_t timeout)
+{
+    struct timespec waitTime;
+    waitTime.tv_sec = timeout / 1000;
+    waitTime.tv_nsec = static_cast<long>(timeout % 1000) * 1000000;
+
+    // no private futex, because the memory is shared with another process
+    syscall(SYS_futex,
+            reinterpret_cast<uint32_t*>(address),
+            FUTEX_WAIT,
+            expected,
+            &waitTime,
+            nullptr,
+            0);
+}
+
+/**
+ * @brief wake up the process, which waits on a shared atomic
+ *
+ * @param address address of the atomic within the shared memory
+ */
+inline void
+futexWake(std::atomic<uint32_t>* address)
+{
+    syscall(SYS_futex,
+            reinterpret_cast<uint32_t*>(address),
+            FUTEX_WAKE,
+            INT_MAX,
+            nullptr,
+            nullptr,
+            0);
+}
+
+/**
+ * @brief get the size of the control-block, which is a multiple of the page-size
+ *
+ * @return size of the control-block in bytes
+ */
+inline uint64_t
+getHeaderSize()
+{
+    return ((sizeof(SharedMemoryHeader) + 4095) / 4096) * 4096;
+}
+
+/**
+ * @brief constructor for the client-side
+ *
+ * @param socketFile path to the unix-domain-socket of the shared-memory-server
+ */
+SharedMemoryChannel::SharedMemoryChannel(const std::string &socketFile)
+{
+    m_socketFile = socketFile;
+    m_isClientSide = true;
+}
+
+/**
+ * @brief constructor for the server-side
+ *
+ * @param controlSocket accepted connection of the unix-domain-socket of the server
+ */
+SharedMemoryChannel::SharedMemoryChannel(const int controlSocket)
+{
+    m_controlSocket = controlSocket;
+    m_isClientSide = false;
+}
+
+/**
+ * @brief destructor
+ */
+SharedMemoryChannel::~SharedMemoryChannel()
+{
+    closeChannel();
+
+    if(m_region != nullptr)
+    {
+        // give the ring-buffer back its own memory, which is freed by its destructor
+        m_recvView.data = m_recvViewData;
+        m_recvView.totalBufferSize = m_recvViewSize;
+        munmap(m_region, m_regionSize);
+        m_region = nullptr;
+    }
+
+    if(m_controlSocket >= 0)
+    {
+        close(m_controlSocket);
+        m_controlSocket = -1;
+    }
+}
+
+/**
+ * @brief set callback for incoming messages
+ *
+ * @param target first argument of the callback, which is the session
+ * @param processMessage callback, which gets the complete incoming data within the ring and
+ *                       returns the number of processed bytes
+ */
+void
+SharedMemoryChannel::setMessageCallback(void* target,
+                                        uint64_t (*processMessage)(void*,
+                                                                   RingBuffer*,
+                                                                   Network::AbstractSocket*))
+{
+    m_target = target;
+    m_processMessage = processMessage;
+}
+
+/**
+ * @brief connect to the shared-memory-server and map the shared memory, which is send by the
+ *        server over the unix-domain-socket
+ *
+ * @return false, if connection failed or the shared memory is invalid, else true
+ */
+bool
+SharedMemoryChannel::initClientSide()
+{
+    if(m_region != nullptr) {
+        return true;
+    }
+
+    // connect control-socket
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(m_socketFile.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    strncpy(address.sun_path, m_socketFile.c_str(), sizeof(address.sun_path) - 1);
+
+    m_controlSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(m_controlSocket < 0) {
+        return false;
+    }
+    if(connect(m_controlSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        LOG_ERROR("can not connect to shared-memory-server: " + m_socketFile);
+        return false;
+    }
+
+    // receive file-descriptor of the shared memory together with its size
+    uint64_t regionSize = 0;
+    struct iovec payload;
+    payload.iov_base = &regionSize;
+    payload.iov_len = sizeof(regionSize);
+
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    if(recvmsg(m_controlSocket, &message, MSG_WAITALL) != sizeof(regionSize)) {
+        return false;
+    }
+
+    struct cmsghdr* controlMessage = CMSG_FIRSTHDR(&message);
+    if(controlMessage == nullptr
+            || controlMessage->cmsg_level != SOL_SOCKET
+            || controlMessage->cmsg_type != SCM_RIGHTS)
+    {
+        return false;
+    }
+
+    int memoryFd = -1;
+    memcpy(&memoryFd, CMSG_DATA(controlMessage), sizeof(int));
+
+    m_regionSize = regionSize;
+    const bool ret = mapRegion(memoryFd);
+    close(memoryFd);
+
+    if(ret == false
+            || m_header->magic != SHARED_MEMORY_MAGIC
+            || getHeaderSize() + 2 * m_header->ringSize != m_regionSize)
+    {
+        LOG_ERROR("received invalid shared memory from server: " + m_socketFile);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief create the shared memory for a new connection and send it to the client
+ *
+ * @return false, if the shared memory can not be created or send, else true
+ */
+bool
+SharedMemoryChannel::initServerSide()
+{
+    m_regionSize = getHeaderSize() + 2 * SHARED_MEMORY_RING_SIZE;
+
+    const int memoryFd = static_cast<int>(syscall(SYS_memfd_create,
+                                                  "sakura-shared-memory",
+                                                  MFD_CLOEXEC));
+    if(memoryFd < 0) {
+        return false;
+    }
+
+    if(ftruncate(memoryFd, static_cast<off_t>(m_regionSize)) != 0
+            || mapRegion(memoryFd) == false)
+    {
+        close(memoryFd);
+        return false;
+    }
+
+    // init control-block, before the client can see it
+    new(m_region) SharedMemoryHeader();
+    m_header->closed = 0;
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        m_header->rings[i].head = 0;
+        m_header->rings[i].tail = 0;
+        m_header->rings[i].dataSignal = 0;
+        m_header->rings[i].spaceSignal = 0;
+        m_header->rings[i].consumerWaiting = 0;
+        m_header->rings[i].producerWaiting = 0;
+    }
+
+    // send file-descriptor of the shared memory together with its size
+    uint64_t regionSize = m_regionSize;
+    struct iovec payload;
+    payload.iov_base = &regionSize;
+    payload.iov_len = sizeof(regionSize);
+
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    struct cmsghdr* controlMessage = CMSG_FIRSTHDR(&message);
+    controlMessage->cmsg_level = SOL_SOCKET;
+    controlMessage->cmsg_type = SCM_RIGHTS;
+    controlMessage->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(controlMessage), &memoryFd, sizeof(int));
+
+    const bool ret = sendmsg(m_controlSocket, &message, MSG_NOSIGNAL) == sizeof(regionSize);
+    close(memoryFd);
+
+    return ret;
+}
+
+/**
+ * @brief map the shared memory and set the pointers to the rings of both directions
+ *
+ * @param memoryFd file-descriptor of the shared memory
+ *
+ * @return false, if mapping failed, else true
+ */
+bool
+SharedMemoryChannel::mapRegion(const int memoryFd)
+{
+    if(m_regionSize <= getHeaderSize()) {
+        return false;
+    }
+
+    void* region = mmap(nullptr,
+                        m_regionSize,
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED,
+                        memoryFd,
+                        0);
+    if(region == MAP_FAILED) {
+        return false;
+    }
+
+    m_region = region;
+    m_header = static_cast<SharedMemoryHeader*>(region);
+
+    const uint64_t ringSize = (m_regionSize - getHeaderSize()) / 2;
+    uint8_t* firstRing = static_cast<uint8_t*>(region) + getHeaderSize();
+    uint8_t* secondRing = firstRing + ringSize;
+
+    if(m_isClientSide)
+    {
+        m_sendRing = &m_header->rings[1];
+        m_sendData = secondRing;
+        m_recvRing = &m_header->rings[0];
+        m_recvData = firstRing;
+    }
+    else
+    {
+        m_sendRing = &m_header->rings[0];
+        m_sendData = firstRing;
+        m_recvRing = &m_header->rings[1];
+        m_recvData = secondRing;
+    }
+
+    // let the ring-buffer point to the shared ring, so the messages are processed in place
+    m_recvViewData = m_recvView.data;
+    m_recvViewSize = m_recvView.totalBufferSize;
+    m_recvView.data = m_recvData;
+    m_recvView.totalBufferSize = ringSize;
+    m_recvView.readPosition = 0;
+    m_recvView.usedSize = 0;
+
+    return true;
+}
+
+/**
+ * @brief check side of the channel
+ *
+ * @return true, if the channel was created by the client, else false
+ */
+bool
+SharedMemoryChannel::isClientSide() const
+{
+    return m_isClientSide;
+}
+
+/**
+ * @brief check if the other side still exists, which closes the control-socket at the latest,
+ *        when its process ends
+ *
+ * @return false, if control-socket was closed by the other side, else true
+ */
+bool
+SharedMemoryChannel::isPeerAlive() const
+{
+    struct pollfd pollEntry;
+    pollEntry.fd = m_controlSocket;
+    pollEntry.events = POLLIN | POLLRDHUP;
+    pollEntry.revents = 0;
+
+    if(poll(&pollEntry, 1, 0) < 0) {
+        return false;
+    }
+
+    return (pollEntry.revents & (POLLHUP | POLLRDHUP | POLLERR)) == 0;
+}
+
+/**
+ * @brief copy a message into the sending ring. If the ring is full, it waits until the
+ *        other side has processed enough data. Must not be called by multiple threads at the
+ *        same time, which is ensured by the send-lock of the session.
+ *
+ * @param segments segments of the message
+ * @param numberOfSegments number of segments
+ *
+ * @return false, if the channel is closed or the message is bigger than the ring, else true
+ */
+bool
+SharedMemoryChannel::sendSegments(const struct iovec* segments,
+                                  const uint32_t numberOfSegments)
+{
+    if(m_header == nullptr) {
+        return false;
+    }
+
+    const uint64_t ringSize = m_header->ringSize;
+    uint64_t totalSize = 0;
+    for(uint32_t i = 0; i < numberOfSegments; i++) {
+        totalSize += segments[i].iov_len;
+    }
+    if(totalSize > ringSize) {
+        return false;
+    }
+
+    SharedMemoryRing* ring = m_sendRing;
+    const uint64_t head = ring->head.load(std::memory_order_relaxed);
+
+    // wait until the other side has processed enough data
+    while(ringSize - (head - ring->tail.load(std::memory_order_acquire)) < totalSize)
+    {
+        if(m_header->closed.load() != 0
+                || isPeerAlive() == false)
+        {
+            return false;
+        }
+
+        const uint32_t signal = ring->spaceSignal.load();
+        ring->producerWaiting.store(1);
+        if(ringSize - (head - ring->tail.load()) < totalSize) {
+            futexWait(&ring->spaceSignal, signal, SHARED_MEMORY_WAIT_TIMEOUT);
+        }
+        ring->producerWaiting.store(0);
+    }
+
+    if(m_header->closed.load() != 0) {
+        return false;
+    }
+
+    // copy segments into the ring, which can be wrapped around its end
+    uint64_t position = head;
+    for(uint32_t i = 0; i < numberOfSegments; i++)
+    {
+        const uint8_t* source = static_cast<const uint8_t*>(segments[i].iov_base);
+        const uint64_t size = segments[i].iov_len;
+        const uint64_t start = position % ringSize;
+        const uint64_t firstPart = std::min(size, ringSize - start);
+
+        memcpy(&m_sendData[start], source, firstPart);
+        memcpy(m_sendData, source + firstPart, size - firstPart);
+        position += size;
+    }
+
+    // publish the message and wake up the other side, if it waits for data
+    ring->head.store(position, std::memory_order_release);
+    ring->dataSignal.fetch_add(1);
+    if(ring->consumerWaiting.load() != 0) {
+        futexWake(&ring->dataSignal);
+    }
+
+    return true;
+}
+
+/**
+ * @brief close the channel for both sides and wake up all waiting threads
+ *
+ * @return false, if channel was not connected or is already closed, else true
+ */
+bool
+SharedMemoryChannel::closeChannel()
+{
+    if(m_header == nullptr
+            || m_header->closed.exchange(1) != 0)
+    {
+        return false;
+    }
+
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        m_header->rings[i].dataSignal.fetch_add(1);
+        futexWake(&m_header->rings[i].dataSignal);
+        m_header->rings[i].spaceSignal.fetch_add(1);
+        futexWake(&m_header->rings[i].spaceSignal);
+    }
+
+    shutdown(m_controlSocket, SHUT_RDWR);
+
+    return true;
+}
+
+/**
+ * @brief receive-loop, which gives the incoming data directly within the shared ring to the
+ *        message-callback, so stream-messages are processed without copy. The space is only
+ *        given back to the other side, after the callback has processed the messages.
+ */
+void
+SharedMemoryChannel::run()
+{
+    if(m_header == nullptr) {
+        return;
+    }
+
+    SharedMemoryRing* ring = m_recvRing;
+    const uint64_t ringSize = m_header->ringSize;
+
+    while(m_abort == false)
+    {
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        const uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+
+        // process all complete messages
+        uint64_t processedBytes = 0;
+        if(head != tail
+                && m_processMessage != nullptr)
+        {
+            m_recvView.readPosition = tail % ringSize;
+            m_recvView.usedSize = head - tail;
+            processedBytes = m_processMessage(m_target, &m_recvView, nullptr);
+        }
+
+        if(processedBytes > 0)
+        {
+            ring->tail.store(tail + processedBytes, std::memory_order_release);
+            ring->spaceSignal.fetch_add(1);
+            if(ring->producerWaiting.load() != 0) {
+                futexWake(&ring->spaceSignal);
+            }
+            continue;
+        }
+
+        // no complete message left, so stop, if the channel was closed
+        if(m_header->closed.load() != 0) {
+            break;
+        }
+
+        // wait for new data of the other side
+        const uint32_t signal = ring->dataSignal.load();
+        ring->consumerWaiting.store(1);
+        if(ring->head.load() == head) {
+            futexWait(&ring->dataSignal, signal, SHARED_MEMORY_WAIT_TIMEOUT);
+        }
+        ring->consumerWaiting.store(0);
+
+        if(ring->head.load() == head
+                && isPeerAlive() == false)
+        {
+            break;
+        }
+    }
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,126 @@
+/**
+ * @file       shared_memory_channel.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef SHARED_MEMORY_CHANNEL_H
+#define SHARED_MEMORY_CHANNEL_H
+
+#include <string>
+#include <atomic>
+#include <stdint.h>
+
+#include <libKitsunemimiCommon/threading/thread.h>
+#include <libKitsunemimiCommon/buffer/ring_buffer.h>
+
+struct iovec;
+
+// size of each of the two rings within the shared memory. Messages are at most
+// MAX_SINGLE_MESSAGE_SIZE plus header, so messages, which are wrapped around the end of the
+// ring, always fit into the overflow-buffer of the ring-buffer, which is used for them.
+#define SHARED_MEMORY_RING_SIZE (2*1024*1024)
+// max time in milliseconds to wait for the other side, before it is checked, if it still exists
+#define SHARED_MEMORY_WAIT_TIMEOUT 100
+#define SHARED_MEMORY_MAGIC 0x53484D31
+
+namespace Kitsunemimi
+{
+namespace Network {
+class AbstractSocket;
+}
+namespace Sakura
+{
+
+// ring for one direction with a single producer and a single consumer
+struct SharedMemoryRing
+{
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint32_t> dataSignal;
+    std::atomic<uint32_t> spaceSignal;
+    std::atomic<uint32_t> consumerWaiting;
+    std::atomic<uint32_t> producerWaiting;
+};
+
+// control-block at the beginning of the shared memory
+struct SharedMemoryHeader
+{
+    uint32_t magic = SHARED_MEMORY_MAGIC;
+    uint32_t version = 1;
+    uint64_t ringSize = SHARED_MEMORY_RING_SIZE;
+    std::atomic<uint32_t> closed;
+    // 0 = server to client, 1 = client to server
+    SharedMemoryRing rings[2];
+};
+
+class SharedMemoryChannel
+        : public Kitsunemimi::Thread
+{
+public:
+    SharedMemoryChannel(const std::string &socketFile);
+    SharedMemoryChannel(const int controlSocket);
+    ~SharedMemoryChannel();
+
+    void setMessageCallback(void* target,
+                            uint64_t (*processMessage)(void*,
+                                                       RingBuffer*,
+                                                       Network::AbstractSocket*));
+
+    bool initClientSide();
+    bool initServerSide();
+    bool isClientSide() const;
+
+    bool sendSegments(const struct iovec* segments,
+                      const uint32_t numberOfSegments);
+    bool closeChannel();
+
+protected:
+    void run();
+
+private:
+    std::string m_socketFile = "";
+    bool m_isClientSide = false;
+    int m_controlSocket = -1;
+
+    // mapping of the shared memory
+    void* m_region = nullptr;
+    uint64_t m_regionSize = 0;
+    SharedMemoryHeader* m_header = nullptr;
+    SharedMemoryRing* m_sendRing = nullptr;
+    SharedMemoryRing* m_recvRing = nullptr;
+    uint8_t* m_sendData = nullptr;
+    uint8_t* m_recvData = nullptr;
+
+    // view on the receiving ring, which is given to the message-callback
+    RingBuffer m_recvView;
+    uint8_t* m_recvViewData = nullptr;
+    uint64_t m_recvViewSize = 0;
+
+    void* m_target = nullptr;
+    uint64_t (*m_processMessage)(void*, RingBuffer*, Network::AbstractSocket*) = nullptr;
+
+    bool mapRegion(const int memoryFd);
+    bool isPeerAlive() const;
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // SHARED_MEMORY_CHANNEL_H
@@ -0,0 +1,160 @@
+/**
+ * @file       shared_memory_server.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <shared_memory/shared_memory_server.h>
+#include <shared_memory/shared_memory_channel.h>
+
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <libKitsunemimiPersistence/logger/logger.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor
+ *
+ * @param target first argument of the connection-callback
+ * @param processConnection callback for each new channel, which is already initialized
+ */
+SharedMemoryServer::SharedMemoryServer(void* target,
+                                       void (*processConnection)(void*, SharedMemoryChannel*))
+{
+    m_target = target;
+    m_processConnection = processConnection;
+}
+
+/**
+ * @brief destructor
+ */
+SharedMemoryServer::~SharedMemoryServer()
+{
+    closeServer();
+}
+
+/**
+ * @brief create the unix-domain-socket, over which the clients get their shared memory
+ *
+ * @param socketFile path to the socket-file
+ *
+ * @return false, if socket can not be created, else true
+ */
+bool
+SharedMemoryServer::initServer(const std::string &socketFile)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(socketFile.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    strncpy(address.sun_path, socketFile.c_str(), sizeof(address.sun_path) - 1);
+
+    m_serverSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(m_serverSocket < 0) {
+        return false;
+    }
+
+    // remove old socket-file of a previous run
+    unlink(socketFile.c_str());
+
+    if(bind(m_serverSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+            || listen(m_serverSocket, 5) < 0)
+    {
+        LOG_ERROR("can not create shared-memory-server: " + socketFile);
+        close(m_serverSocket);
+        m_serverSocket = -1;
+        return false;
+    }
+
+    m_socketFile = socketFile;
+
+    return true;
+}
+
+/**
+ * @brief stop accepting new connections and remove the socket-file. Already existing channels
+ *        are not affected.
+ *
+ * @return false, if server was already closed, else true
+ */
+bool
+SharedMemoryServer::closeServer()
+{
+    if(m_serverSocket < 0) {
+        return false;
+    }
+
+    m_abort = true;
+    shutdown(m_serverSocket, SHUT_RDWR);
+    close(m_serverSocket);
+    m_serverSocket = -1;
+    unlink(m_socketFile.c_str());
+
+    return true;
+}
+
+/**
+ * @brief accept-loop, which creates a new shared memory for each incoming connection
+ */
+void
+SharedMemoryServer::run()
+{
+    while(m_abort == false)
+    {
+        struct pollfd pollEntry;
+        pollEntry.fd = m_serverSocket;
+        pollEntry.events = POLLIN;
+        pollEntry.revents = 0;
+
+        const int ret = poll(&pollEntry, 1, SHARED_MEMORY_ACCEPT_TIMEOUT);
+        if(ret <= 0
+                || m_abort)
+        {
+            continue;
+        }
+
+        const int controlSocket = accept4(m_serverSocket, nullptr, nullptr, SOCK_CLOEXEC);
+        if(controlSocket < 0) {
+            continue;
+        }
+
+        SharedMemoryChannel* channel = new SharedMemoryChannel(controlSocket);
+        if(channel->initServerSide() == false)
+        {
+            LOG_ERROR("can not create shared memory for new connection");
+            delete channel;
+            continue;
+        }
+
+        m_processConnection(m_target, channel);
+    }
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,64 @@
+/**
+ * @file       shared_memory_server.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef SHARED_MEMORY_SERVER_H
+#define SHARED_MEMORY_SERVER_H
+
+#include <string>
+
+#include <libKitsunemimiCommon/threading/thread.h>
+
+// max time in milliseconds to wait for new connections, before it is checked for abort
+#define SHARED_MEMORY_ACCEPT_TIMEOUT 100
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class SharedMemoryChannel;
+
+class SharedMemoryServer
+        : public Kitsunemimi::Thread
+{
+public:
+    SharedMemoryServer(void* target,
+                       void (*processConnection)(void*, SharedMemoryChannel*));
+    ~SharedMemoryServer();
+
+    bool initServer(const std::string &socketFile);
+    bool closeServer();
+
+protected:
+    void run();
+
+private:
+    std::string m_socketFile = "";
+    int m_serverSocket = -1;
+
+    void* m_target = nullptr;
+    void (*m_processConnection)(void*, SharedMemoryChannel*) = nullptr;
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // SHARED_MEMORY_SERVER_H
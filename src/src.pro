@@ -20,7 +20,7 @@ LIBS += -L../../libKitsunemimiPersistence/src/debug -lKitsunemimiPersistence
 LIBS += -L../../libKitsunemimiPersistence/src/release -lKitsunemimiPersistence
 INCLUDEPATH += ../../libKitsunemimiPersistence/include
 
-LIBS +=  -lssl -lcrypt
+LIBS +=  -lssl -lcrypt -llz4
 
 INCLUDEPATH += $$PWD \
                $$PWD/../include
@@ -28,8 +28,10 @@ INCLUDEPATH += $$PWD \
 HEADERS += \
     ../include/libKitsunemimiSakuraNetwork/session.h \
     ../include/libKitsunemimiSakuraNetwork/session_controller.h \
+    ../include/libKitsunemimiSakuraNetwork/session_metrics.h \
     callbacks.h \
     message_definitions.h \
+    payload_compression.h \
     messages_processing/session_processing.h \
     messages_processing/heartbeat_processing.h \
     messages_processing/error_processing.h \
@@ -39,14 +41,37 @@ HEADERS += \
     multiblock_io.h \
     handler/reply_handler.h \
     handler/message_blocker_handler.h \
+    handler/coalescing_handler.h \
+    handler/buffer_pool.h \
+    handler/session_registry.h \
+    handler/callback_dispatcher.h \
+    handler/heartbeat_handler.h \
+    handler/io_engine.h \
+    handler/session_pool.h \
+    thread_affinity.h \
+    payload_checksum.h \
+    shared_memory/shared_memory_channel.h \
+    shared_memory/shared_memory_server.h \
     messages_processing/stream_data_processing.h \
     messages_processing/singleblock_data_processing.h
 
 SOURCES += \
     session.cpp \
     session_constroller.cpp \
+    session_metrics.cpp \
     handler/session_handler.cpp \
     multiblock_io.cpp \
     handler/replay_handler.cpp \
-    handler/message_blocker_handler.cpp
+    handler/message_blocker_handler.cpp \
+    handler/coalescing_handler.cpp \
+    handler/buffer_pool.cpp \
+    handler/session_registry.cpp \
+    handler/callback_dispatcher.cpp \
+    handler/heartbeat_handler.cpp \
+    handler/io_engine.cpp \
+    handler/session_pool.cpp \
+    thread_affinity.cpp \
+    payload_checksum.cpp \
+    shared_memory/shared_memory_channel.cpp \
+    shared_memory/shared_memory_server.cpp
 
@@ -0,0 +1,189 @@
+/**
+ * @file       thread_affinity.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <thread_affinity.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <string>
+#include <cstdlib>
+
+#include <handler/session_handler.h>
+
+// memory-policy of the mbind-syscall, which are defined in numaif.h of libnuma
+#define NUMA_MPOL_PREFERRED 1
+#define NUMA_MPOL_MF_MOVE (1 << 1)
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief pin the calling thread to a set of cores
+ *
+ * @param cores ids of the cores, where the thread is allowed to run. If empty, the thread is
+ *              allowed to run on all cores again.
+ *
+ * @return false, if a core-id is invalid or the pinning failed, else true
+ */
+bool
+setThreadAffinity(const std::vector<uint32_t> &cores)
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+
+    if(cores.size() == 0)
+    {
+        const long numberOfCores = sysconf(_SC_NPROCESSORS_CONF);
+        for(long i = 0; i < numberOfCores && i < CPU_SETSIZE; i++) {
+            CPU_SET(static_cast<size_t>(i), &cpuSet);
+        }
+    }
+
+    for(uint64_t i = 0; i < cores.size(); i++)
+    {
+        if(cores[i] >= CPU_SETSIZE) {
+            return false;
+        }
+        CPU_SET(cores[i], &cpuSet);
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) == 0;
+}
+
+/**
+ * @brief get the numa-node for the buffers of a policy
+ *
+ * @param policy affinity-policy
+ *
+ * @return numa-node of the policy, if set, else the node of the first core of the policy, or
+ *         -1, if the policy has no cores or the node is unknown
+ */
+int32_t
+getNumaNode(const AffinityPolicy &policy)
+{
+    if(policy.numaNode >= 0) {
+        return policy.numaNode;
+    }
+
+    if(policy.cores.size() == 0) {
+        return -1;
+    }
+
+    // the directory of each core contains a link with the name of its node
+    const std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(policy.cores[0]);
+    DIR* dir = opendir(path.c_str());
+    if(dir == nullptr) {
+        return -1;
+    }
+
+    int32_t result = -1;
+    struct dirent* entry = nullptr;
+    while((entry = readdir(dir)) != nullptr)
+    {
+        const std::string name = entry->d_name;
+        if(name.size() > 4
+                && name.compare(0, 4, "node") == 0
+                && name.find_first_not_of("0123456789", 4) == std::string::npos)
+        {
+            result = static_cast<int32_t>(std::atoi(&entry->d_name[4]));
+            break;
+        }
+    }
+    closedir(dir);
+
+    return result;
+}
+
+/**
+ * @brief move the pages of a buffer to a numa-node and allocate new pages there. Only the
+ *        pages, which are completely within the buffer, are moved, because the rest of the
+ *        pages can belong to other objects.
+ *
+ * @param data pointer to the buffer
+ * @param size size of the buffer in bytes
+ * @param numaNode target numa-node
+ *
+ * @return false, if the node is invalid or the syscall failed, else true
+ */
+bool
+bindToNumaNode(void* data,
+               const uint64_t size,
+               const int32_t numaNode)
+{
+    if(numaNode < 0
+            || numaNode >= 64)
+    {
+        return false;
+    }
+
+    const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    const uint64_t begin = reinterpret_cast<uint64_t>(data);
+    const uint64_t alignedBegin = ((begin + pageSize - 1) / pageSize) * pageSize;
+    const uint64_t alignedEnd = ((begin + size) / pageSize) * pageSize;
+    if(data == nullptr
+            || alignedEnd <= alignedBegin)
+    {
+        return true;
+    }
+
+    unsigned long nodeMask = 1ul << numaNode;
+    const long ret = syscall(SYS_mbind,
+                             reinterpret_cast<void*>(alignedBegin),
+                             alignedEnd - alignedBegin,
+                             NUMA_MPOL_PREFERRED,
+                             &nodeMask,
+                             sizeof(nodeMask) * 8 + 1,
+                             NUMA_MPOL_MF_MOVE);
+
+    return ret == 0;
+}
+
+/**
+ * @brief pin the calling thread to the cores of the global affinity-policy, if the policy was
+ *        changed since the last call. Used by the threads, which are shared by all sessions.
+ *
+ * @param appliedVersion version of the policy, which was applied to the thread before
+ */
+void
+applyGlobalAffinity(uint64_t &appliedVersion)
+{
+    SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
+    if(sessionHandler == nullptr
+            || sessionHandler->m_globalAffinityVersion.load(std::memory_order_relaxed)
+               == appliedVersion)
+    {
+        return;
+    }
+
+    uint64_t version = 0;
+    const AffinityPolicy policy = sessionHandler->getGlobalAffinity(version);
+    setThreadAffinity(policy.cores);
+    appliedVersion = version;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
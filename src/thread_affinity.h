@@ -0,0 +1,46 @@
+/**
+ * @file       thread_affinity.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef THREAD_AFFINITY_H
+#define THREAD_AFFINITY_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+bool setThreadAffinity(const std::vector<uint32_t> &cores);
+int32_t getNumaNode(const AffinityPolicy &policy);
+bool bindToNumaNode(void* data,
+                    const uint64_t size,
+                    const int32_t numaNode);
+void applyGlobalAffinity(uint64_t &appliedVersion);
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // THREAD_AFFINITY_H
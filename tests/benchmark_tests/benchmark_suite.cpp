@@ -0,0 +1,799 @@
+/**
+ * @file    benchmark_suite.cpp
+ *
+ * @author  Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include "benchmark_suite.h"
+
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+
+#include <libKitsunemimiCommon/buffer/data_buffer.h>
+#include <libKitsunemimiCommon/buffer/stack_buffer.h>
+#include <libKitsunemimiCommon/common_items/table_item.h>
+
+// size of the header of a stream-message, which is written in front of the data of a stack-block
+#define STACK_BLOCK_HEADER_SIZE 24
+// size of the footer of a stream-message, which is written behind the data of a stack-block
+#define STACK_BLOCK_FOOTER_SIZE 8
+// stack-blocks are send as one stream-message, so they can not be bigger than a single message
+#define MAX_STACK_BLOCK_PAYLOAD (128*1024)
+// number of requests, which are send together by the request_batch-transfer
+#define SUITE_REQUEST_BATCH_SIZE 16
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+BenchmarkSuite* BenchmarkSuite::m_instance = nullptr;
+
+/**
+ * @brief stream-callback, which measures the one-way-latency on server-side
+ */
+void
+suiteStreamCallback(Session* session,
+                    const void* data,
+                    const uint64_t dataSize)
+{
+    BenchmarkSuite* suite = BenchmarkSuite::m_instance;
+    if(session->isClientSide()) {
+        return;
+    }
+
+    if(dataSize >= sizeof(BenchmarkSuite::MessagePrefix))
+    {
+        BenchmarkSuite::MessagePrefix prefix;
+        memcpy(&prefix, data, sizeof(BenchmarkSuite::MessagePrefix));
+
+        // the map is not modified while messages are transfered, so no lock is necessary
+        std::unordered_map<Session*, BenchmarkSuite::ReceiverSlot*>::iterator it;
+        it = suite->m_receivers.find(session);
+        if(it != suite->m_receivers.end()) {
+            it->second->latencies.push_back(BenchmarkSuite::getCurrentTime() - prefix.sendTime);
+        }
+    }
+
+    suite->addReceivedBytes(dataSize);
+}
+
+/**
+ * @brief standalone-callback, which answers requests and standalone-messages on server-side and
+ *        releases the waiting sender on client-side
+ */
+void
+suiteStandaloneCallback(Session* session,
+                        const uint64_t blockerId,
+                        DataBuffer* data)
+{
+    BenchmarkSuite* suite = BenchmarkSuite::m_instance;
+
+    BenchmarkSuite::MessagePrefix prefix;
+    if(data->bufferPosition >= sizeof(BenchmarkSuite::MessagePrefix)) {
+        memcpy(&prefix, data->data, sizeof(BenchmarkSuite::MessagePrefix));
+    }
+    session->releaseBuffer(data);
+
+    if(session->isClientSide() == false)
+    {
+        // send only the prefix back to keep the measurement independent of the answer
+        if(blockerId != 0) {
+            session->sendResponse(&prefix, sizeof(prefix), blockerId);
+        } else {
+            session->sendStandaloneData(&prefix, sizeof(prefix));
+        }
+
+        return;
+    }
+
+    // answer of a standalone-message
+    if(prefix.senderId >= suite->m_senders.size()) {
+        return;
+    }
+
+    BenchmarkSuite::SenderSlot* slot = suite->m_senders[prefix.senderId];
+    slot->latencies.push_back(BenchmarkSuite::getCurrentTime() - prefix.sendTime);
+
+    std::unique_lock<std::mutex> lock(slot->cvMutex);
+    slot->replied = true;
+    slot->cv.notify_one();
+}
+
+/**
+ * @brief errorCallback
+ */
+void
+suiteErrorCallback(Session*,
+                   const uint8_t,
+                   const std::string message)
+{
+    std::cout<<"ERROR: "<<message<<std::endl;
+}
+
+/**
+ * @brief register the server-side sessions
+ */
+void
+suiteSessionCreateCallback(Session* session,
+                           const std::string)
+{
+    BenchmarkSuite* suite = BenchmarkSuite::m_instance;
+
+    session->setStreamMessageCallback(&suiteStreamCallback);
+    session->setStandaloneMessageCallback(&suiteStandaloneCallback);
+
+    if(session->isClientSide() == false)
+    {
+        std::unique_lock<std::mutex> lock(suite->m_setupMutex);
+        suite->m_receivers.insert(std::make_pair(session, new BenchmarkSuite::ReceiverSlot()));
+        suite->m_setupCv.notify_all();
+    }
+}
+
+/**
+ * @brief sessionCloseCallback
+ */
+void
+suiteSessionCloseCallback(Session*,
+                          const std::string)
+{
+}
+
+/**
+ * @brief constructor
+ *
+ * @param config configuration of the suite
+ */
+BenchmarkSuite::BenchmarkSuite(const Config &config)
+{
+    m_instance = this;
+    m_config = config;
+    m_receivedBytes = 0;
+
+    if(m_config.payloadSizes.size() == 0) {
+        m_config.payloadSizes = getDefaultPayloadSizes();
+    }
+
+    m_controller = new SessionController(&suiteSessionCreateCallback,
+                                         &suiteSessionCloseCallback,
+                                         &suiteErrorCallback);
+    m_controller->setPayloadChecksum(m_config.payloadChecksum);
+}
+
+/**
+ * @brief destructor
+ */
+BenchmarkSuite::~BenchmarkSuite()
+{
+    stopSessions();
+    delete m_controller;
+}
+
+/**
+ * @brief get default sizes of the payload, which are around the limit of 128 KiB between
+ *        singleblock- and multiblock-messages
+ *
+ * @return list of sizes in bytes
+ */
+std::vector<uint64_t>
+BenchmarkSuite::getDefaultPayloadSizes()
+{
+    std::vector<uint64_t> sizes;
+    sizes.push_back(1024);
+    sizes.push_back(16*1024);
+    sizes.push_back(64*1024);
+    sizes.push_back(128*1024 - 64);
+    sizes.push_back(128*1024);
+    sizes.push_back(128*1024 + 64);
+    sizes.push_back(256*1024);
+    sizes.push_back(1024*1024);
+    sizes.push_back(4*1024*1024);
+
+    return sizes;
+}
+
+/**
+ * @brief get current time for the latency-measurement
+ *
+ * @return time of the steady-clock in microseconds
+ */
+uint64_t
+BenchmarkSuite::getCurrentTime()
+{
+    const std::chrono::steady_clock::duration now =
+            std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+}
+
+/**
+ * @brief count received stream-data and wake up the measurement, when all data are arrived
+ *
+ * @param numberOfBytes number of received bytes
+ */
+void
+BenchmarkSuite::addReceivedBytes(const uint64_t numberOfBytes)
+{
+    const uint64_t before = m_receivedBytes.fetch_add(numberOfBytes);
+    if(before < m_expectedBytes
+            && before + numberOfBytes >= m_expectedBytes)
+    {
+        std::unique_lock<std::mutex> lock(m_runMutex);
+        m_runCv.notify_all();
+    }
+}
+
+/**
+ * @brief run all combinations of socket-types, transfer-types and payload-sizes
+ *
+ * @return false, if a measurement failed, else true
+ */
+bool
+BenchmarkSuite::runSuite()
+{
+    bool result = true;
+
+    for(uint32_t s = 0; s < m_config.sockets.size(); s++)
+    {
+        const std::string socket = m_config.sockets.at(s);
+        if(startSessions(socket) == false)
+        {
+            std::cout<<"ERROR: failed to start sessions for socket-type "<<socket<<std::endl;
+            stopSessions();
+            result = false;
+            continue;
+        }
+
+        for(uint32_t t = 0; t < m_config.transferTypes.size(); t++)
+        {
+            for(uint32_t p = 0; p < m_config.payloadSizes.size(); p++)
+            {
+                result = runMeasurement(socket,
+                                        m_config.transferTypes.at(t),
+                                        m_config.payloadSizes.at(p)) && result;
+            }
+        }
+
+        stopSessions();
+    }
+
+    printResults();
+
+    return writeJson() && result;
+}
+
+/**
+ * @brief start the server and all client-sessions for a socket-type and wait until the
+ *        server-side of all sessions is registered
+ *
+ * @param socket socket-type (tcp, uds, tls or shm)
+ *
+ * @return false, if server or a session could not be created, else true
+ */
+bool
+BenchmarkSuite::startSessions(const std::string &socket)
+{
+    const std::string socketFile = "/tmp/sock_benchmark.uds";
+    const std::string sharedMemoryFile = "/tmp/sock_benchmark.shm";
+
+    if(socket == "tcp") {
+        m_serverId = m_controller->addTcpServer(m_config.port);
+    } else if(socket == "tls") {
+        m_serverId = m_controller->addTlsTcpServer(m_config.port,
+                                                   m_config.certFile,
+                                                   m_config.keyFile);
+    } else if(socket == "shm") {
+        m_serverId = m_controller->addSharedMemoryServer(sharedMemoryFile);
+    } else {
+        m_serverId = m_controller->addUnixDomainServer(socketFile);
+    }
+
+    if(m_serverId == 0) {
+        return false;
+    }
+    usleep(10000);
+
+    for(uint32_t i = 0; i < m_config.numberOfSessions; i++)
+    {
+        Session* session = nullptr;
+        if(socket == "tcp")
+        {
+            session = m_controller->startTcpSession("127.0.0.1", m_config.port);
+        }
+        else if(socket == "tls")
+        {
+            session = m_controller->startTlsTcpSession("127.0.0.1",
+                                                       m_config.port,
+                                                       m_config.certFile,
+                                                       m_config.keyFile);
+        }
+        else if(socket == "shm")
+        {
+            session = m_controller->startSharedMemorySession(sharedMemoryFile);
+        }
+        else
+        {
+            session = m_controller->startUnixDomainSession(socketFile);
+        }
+
+        if(session == nullptr) {
+            return false;
+        }
+        m_clientSessions.push_back(session);
+    }
+
+    // wait for the server-side of the sessions
+    std::unique_lock<std::mutex> lock(m_setupMutex);
+    const bool complete = m_setupCv.wait_for(lock,
+                                             std::chrono::seconds(10),
+                                             [this]
+    {
+        return m_receivers.size() >= m_config.numberOfSessions;
+    });
+    if(complete == false) {
+        return false;
+    }
+
+    // create sender-slots for all threads of all sessions
+    for(uint32_t i = 0; i < m_clientSessions.size(); i++)
+    {
+        for(uint32_t t = 0; t < m_config.senderThreads; t++)
+        {
+            SenderSlot* slot = new SenderSlot();
+            slot->id = m_senders.size();
+            slot->session = m_clientSessions.at(i);
+            m_senders.push_back(slot);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief close all sessions and the server of the current socket-type
+ */
+void
+BenchmarkSuite::stopSessions()
+{
+    for(uint32_t i = 0; i < m_clientSessions.size(); i++) {
+        m_clientSessions.at(i)->closeSession();
+    }
+    m_clientSessions.clear();
+    usleep(100000);
+
+    if(m_serverId != 0)
+    {
+        m_controller->closeServer(m_serverId);
+        m_serverId = 0;
+    }
+
+    std::unique_lock<std::mutex> lock(m_setupMutex);
+
+    for(uint32_t i = 0; i < m_senders.size(); i++) {
+        delete m_senders.at(i);
+    }
+    m_senders.clear();
+
+    std::unordered_map<Session*, ReceiverSlot*>::iterator it;
+    for(it = m_receivers.begin();
+        it != m_receivers.end();
+        it++)
+    {
+        delete it->second;
+    }
+    m_receivers.clear();
+}
+
+/**
+ * @brief send messages of one sender-thread
+ *
+ * @param slot sender-slot of the thread
+ * @param transferType type of the transfer
+ * @param payloadSize size of the payload of each message
+ * @param numberOfMessages number of messages, which should be send by the thread
+ */
+void
+BenchmarkSuite::sendMessages(SenderSlot* slot,
+                             const std::string &transferType,
+                             const uint64_t payloadSize,
+                             const uint64_t numberOfMessages)
+{
+    MessagePrefix prefix;
+    prefix.senderId = slot->id;
+    uint8_t* buffer = &slot->buffer[0];
+
+    if(transferType == "stream")
+    {
+        for(uint64_t i = 0; i < numberOfMessages; i++)
+        {
+            prefix.sendTime = getCurrentTime();
+            memcpy(buffer, &prefix, sizeof(MessagePrefix));
+            slot->session->sendStreamData(buffer, payloadSize);
+        }
+    }
+
+    if(transferType == "stack_stream")
+    {
+        const uint64_t blockSize = STACK_BLOCK_HEADER_SIZE
+                                   + payloadSize
+                                   + STACK_BLOCK_FOOTER_SIZE;
+        StackBuffer stackBuffer;
+        DataBuffer* block = new DataBuffer(static_cast<uint32_t>((blockSize + 4095) / 4096));
+        block->bufferPosition = blockSize;
+        stackBuffer.blocks.push_back(block);
+
+        uint8_t* blockData = static_cast<uint8_t*>(block->data);
+        for(uint64_t i = 0; i < numberOfMessages; i++)
+        {
+            prefix.sendTime = getCurrentTime();
+            memcpy(&blockData[STACK_BLOCK_HEADER_SIZE], &prefix, sizeof(MessagePrefix));
+            slot->session->sendStreamData(stackBuffer);
+        }
+
+        stackBuffer.blocks.clear();
+        delete block;
+    }
+
+    if(transferType == "standalone")
+    {
+        for(uint64_t i = 0; i < numberOfMessages; i++)
+        {
+            {
+                std::unique_lock<std::mutex> lock(slot->cvMutex);
+                slot->replied = false;
+            }
+
+            prefix.sendTime = getCurrentTime();
+            memcpy(buffer, &prefix, sizeof(MessagePrefix));
+            slot->session->sendStandaloneData(buffer, payloadSize);
+
+            std::unique_lock<std::mutex> lock(slot->cvMutex);
+            const bool replied = slot->cv.wait_for(lock,
+                                                   std::chrono::seconds(10),
+                                                   [slot] { return slot->replied; });
+            if(replied == false)
+            {
+                std::cout<<"ERROR: no answer for standalone-message"<<std::endl;
+                break;
+            }
+        }
+    }
+
+    if(transferType == "request")
+    {
+        for(uint64_t i = 0; i < numberOfMessages; i++)
+        {
+            const uint64_t start = getCurrentTime();
+            prefix.sendTime = start;
+            memcpy(buffer, &prefix, sizeof(MessagePrefix));
+
+            DataBuffer* response = slot->session->sendRequest(buffer, payloadSize, 10);
+            if(response == nullptr)
+            {
+                std::cout<<"ERROR: no response for request"<<std::endl;
+                break;
+            }
+
+            slot->latencies.push_back(getCurrentTime() - start);
+            slot->session->releaseBuffer(response);
+        }
+    }
+
+    if(transferType == "request_batch")
+    {
+        // all requests of a batch use the same payload
+        Session::RequestSlot requests[SUITE_REQUEST_BATCH_SIZE];
+        uint64_t numberOfSendMessages = 0;
+        while(numberOfSendMessages < numberOfMessages)
+        {
+            const uint32_t numberOfRequests = static_cast<uint32_t>(
+                    std::min(static_cast<uint64_t>(SUITE_REQUEST_BATCH_SIZE),
+                             numberOfMessages - numberOfSendMessages));
+            for(uint32_t i = 0; i < numberOfRequests; i++)
+            {
+                requests[i].data = buffer;
+                requests[i].size = payloadSize;
+            }
+
+            const uint64_t start = getCurrentTime();
+            prefix.sendTime = start;
+            memcpy(buffer, &prefix, sizeof(MessagePrefix));
+
+            const uint32_t numberOfResponses = slot->session->sendRequestBatch(requests,
+                                                                               numberOfRequests,
+                                                                               10000);
+            const uint64_t latency = getCurrentTime() - start;
+            for(uint32_t i = 0; i < numberOfRequests; i++)
+            {
+                if(requests[i].response != nullptr)
+                {
+                    slot->latencies.push_back(latency);
+                    slot->session->releaseBuffer(requests[i].response);
+                }
+            }
+
+            if(numberOfResponses != numberOfRequests)
+            {
+                std::cout<<"ERROR: no response for all requests of the batch"<<std::endl;
+                break;
+            }
+
+            numberOfSendMessages += numberOfRequests;
+        }
+    }
+}
+
+/**
+ * @brief run a single measurement with all sessions and sender-threads
+ *
+ * @param socket socket-type
+ * @param transferType type of the transfer
+ * @param payloadSize size of the payload of each message
+ *
+ * @return false, if not all data were transfered, else true
+ */
+bool
+BenchmarkSuite::runMeasurement(const std::string &socket,
+                               const std::string &transferType,
+                               const uint64_t payloadSize)
+{
+    const bool isStream = transferType == "stream" || transferType == "stack_stream";
+
+    if(payloadSize < sizeof(MessagePrefix)
+            || (transferType == "stack_stream" && payloadSize > MAX_STACK_BLOCK_PAYLOAD))
+    {
+        std::cout<<"skip "<<transferType<<" with payload-size "<<payloadSize<<std::endl;
+        return true;
+    }
+
+    // split the volume over all threads
+    const uint64_t numberOfThreads = m_senders.size();
+    uint64_t numberOfMessages = m_config.volume / payloadSize;
+    numberOfMessages = std::max(numberOfMessages, numberOfThreads);
+    const uint64_t messagesPerThread = (numberOfMessages + numberOfThreads - 1) / numberOfThreads;
+    numberOfMessages = messagesPerThread * numberOfThreads;
+
+    // reset state of the last measurement
+    for(uint64_t i = 0; i < m_senders.size(); i++)
+    {
+        m_senders.at(i)->latencies.clear();
+        m_senders.at(i)->buffer.resize(payloadSize);
+    }
+    std::unordered_map<Session*, ReceiverSlot*>::iterator it;
+    for(it = m_receivers.begin();
+        it != m_receivers.end();
+        it++)
+    {
+        it->second->latencies.clear();
+    }
+    m_expectedBytes = numberOfMessages * payloadSize;
+    m_receivedBytes = 0;
+
+    std::cout<<socket<<" "<<transferType<<" "<<payloadSize<<" bytes"<<std::endl;
+
+    // send
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for(uint64_t i = 0; i < m_senders.size(); i++)
+    {
+        SenderSlot* slot = m_senders.at(i);
+        threads.push_back(std::thread([this, slot, transferType, payloadSize, messagesPerThread]()
+        {
+            sendMessages(slot, transferType, payloadSize, messagesPerThread);
+        }));
+    }
+    for(uint64_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+
+    // stream-messages have no answer, so wait until all data are arrived
+    bool complete = true;
+    if(isStream)
+    {
+        std::unique_lock<std::mutex> lock(m_runMutex);
+        complete = m_runCv.wait_for(lock,
+                                    std::chrono::seconds(120),
+                                    [this] { return m_receivedBytes >= m_expectedBytes; });
+    }
+
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    // collect latencies
+    std::vector<uint64_t> latencies;
+    if(isStream)
+    {
+        for(it = m_receivers.begin();
+            it != m_receivers.end();
+            it++)
+        {
+            latencies.insert(latencies.end(),
+                             it->second->latencies.begin(),
+                             it->second->latencies.end());
+        }
+    }
+    else
+    {
+        for(uint64_t i = 0; i < m_senders.size(); i++)
+        {
+            latencies.insert(latencies.end(),
+                             m_senders.at(i)->latencies.begin(),
+                             m_senders.at(i)->latencies.end());
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    // messages with answer are counted by their number of latencies
+    if(isStream == false) {
+        complete = latencies.size() == numberOfMessages;
+    }
+
+    Result result;
+    result.socket = socket;
+    result.transferType = transferType;
+    result.payloadSize = payloadSize;
+    result.numberOfMessages = numberOfMessages;
+    result.numberOfBytes = m_expectedBytes;
+    result.duration = std::chrono::duration<double>(end - start).count();
+    result.throughput = (static_cast<double>(m_expectedBytes) / 1000000000.0) / result.duration;
+    result.latencyType = isStream ? "one-way" : "round-trip";
+    result.p50 = getPercentile(latencies, 0.5);
+    result.p99 = getPercentile(latencies, 0.99);
+    result.p999 = getPercentile(latencies, 0.999);
+    result.max = latencies.size() == 0 ? 0 : latencies.back();
+    m_results.push_back(result);
+
+    if(complete == false) {
+        std::cout<<"ERROR: not all messages were transfered"<<std::endl;
+    }
+
+    return complete;
+}
+
+/**
+ * @brief get a percentile of a sorted list
+ *
+ * @param sortedValues sorted list of values
+ * @param percentile requested percentile between 0.0 and 1.0
+ *
+ * @return value of the percentile or 0, if list is empty
+ */
+uint64_t
+BenchmarkSuite::getPercentile(const std::vector<uint64_t> &sortedValues,
+                              const double percentile)
+{
+    if(sortedValues.size() == 0) {
+        return 0;
+    }
+
+    uint64_t pos = static_cast<uint64_t>(percentile * static_cast<double>(sortedValues.size()));
+    if(pos >= sortedValues.size()) {
+        pos = sortedValues.size() - 1;
+    }
+
+    return sortedValues.at(pos);
+}
+
+/**
+ * @brief print all results as table
+ */
+void
+BenchmarkSuite::printResults()
+{
+    TableItem table;
+    table.addColumn("socket");
+    table.addColumn("transfer-type");
+    table.addColumn("payload-size");
+    table.addColumn("messages");
+    table.addColumn("GB/s");
+    table.addColumn("latency");
+    table.addColumn("p50 (us)");
+    table.addColumn("p99 (us)");
+    table.addColumn("p999 (us)");
+    table.addColumn("max (us)");
+
+    for(uint64_t i = 0; i < m_results.size(); i++)
+    {
+        const Result* result = &m_results[i];
+        table.addRow(std::vector<std::string>{result->socket,
+                                              result->transferType,
+                                              std::to_string(result->payloadSize),
+                                              std::to_string(result->numberOfMessages),
+                                              std::to_string(result->throughput),
+                                              result->latencyType,
+                                              std::to_string(result->p50),
+                                              std::to_string(result->p99),
+                                              std::to_string(result->p999),
+                                              std::to_string(result->max)});
+    }
+
+    std::cout<<"sessions: "<<m_config.numberOfSessions
+             <<", sender-threads per session: "<<m_config.senderThreads
+             <<", checksum: "<<(m_config.payloadChecksum ? "on" : "off")<<std::endl;
+    std::cout<<table.toString()<<std::endl;
+}
+
+/**
+ * @brief write all results as json into the output-file or to stdout, if no file was set
+ *
+ * @return false, if output-file could not be written, else true
+ */
+bool
+BenchmarkSuite::writeJson()
+{
+    std::ostringstream json;
+    json<<"{\n";
+    json<<"    \"sessions\": "<<m_config.numberOfSessions<<",\n";
+    json<<"    \"sender_threads\": "<<m_config.senderThreads<<",\n";
+    json<<"    \"volume\": "<<m_config.volume<<",\n";
+    json<<"    \"payload_checksum\": "<<(m_config.payloadChecksum ? "true" : "false")<<",\n";
+    json<<"    \"results\": [";
+
+    for(uint64_t i = 0; i < m_results.size(); i++)
+    {
+        const Result* result = &m_results[i];
+        if(i != 0) {
+            json<<",";
+        }
+
+        json<<"\n        {";
+        json<<"\"socket\": \""<<result->socket<<"\", ";
+        json<<"\"transfer_type\": \""<<result->transferType<<"\", ";
+        json<<"\"payload_size\": "<<result->payloadSize<<", ";
+        json<<"\"messages\": "<<result->numberOfMessages<<", ";
+        json<<"\"bytes\": "<<result->numberOfBytes<<", ";
+        json<<"\"duration_s\": "<<result->duration<<", ";
+        json<<"\"throughput_gb_per_s\": "<<result->throughput<<", ";
+        json<<"\"latency_type\": \""<<result->latencyType<<"\", ";
+        json<<"\"p50_us\": "<<result->p50<<", ";
+        json<<"\"p99_us\": "<<result->p99<<", ";
+        json<<"\"p999_us\": "<<result->p999<<", ";
+        json<<"\"max_us\": "<<result->max<<"}";
+    }
+
+    json<<"\n    ]\n";
+    json<<"}\n";
+
+    if(m_config.jsonOutput == "")
+    {
+        std::cout<<json.str();
+        return true;
+    }
+
+    std::ofstream outputFile(m_config.jsonOutput);
+    if(outputFile.is_open() == false)
+    {
+        std::cout<<"ERROR: can not write file "<<m_config.jsonOutput<<std::endl;
+        return false;
+    }
+    outputFile<<json.str();
+
+    return outputFile.good();
+}
+
+}
+}
@@ -0,0 +1,154 @@
+/**
+ * @file    benchmark_suite.h
+ *
+ * @author  Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef BENCHMARK_SUITE_H
+#define BENCHMARK_SUITE_H
+
+#include <iostream>
+#include <stdint.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <string>
+#include <vector>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class SessionController;
+class Session;
+
+class BenchmarkSuite
+{
+public:
+    struct Config
+    {
+        uint16_t port = 4321;
+        uint32_t numberOfSessions = 1;
+        uint32_t senderThreads = 1;
+        uint64_t volume = 256*1024*1024;  // bytes per measurement
+        std::vector<std::string> sockets;
+        std::vector<std::string> transferTypes;
+        std::vector<uint64_t> payloadSizes;
+        std::string certFile = "";
+        std::string keyFile = "";
+        std::string jsonOutput = "";
+        bool payloadChecksum = false;
+    };
+
+    BenchmarkSuite(const Config &config);
+    ~BenchmarkSuite();
+
+    bool runSuite();
+
+    static std::vector<uint64_t> getDefaultPayloadSizes();
+
+    // payload-prefix of each benchmark-message
+    struct MessagePrefix
+    {
+        uint64_t sendTime = 0;
+        uint64_t senderId = 0;
+    };
+
+    // state of one sending thread
+    struct SenderSlot
+    {
+        uint64_t id = 0;
+        Session* session = nullptr;
+        std::vector<uint8_t> buffer;
+        std::vector<uint64_t> latencies;
+
+        std::mutex cvMutex;
+        std::condition_variable cv;
+        bool replied = false;
+    };
+
+    // state of one receiving server-session
+    struct ReceiverSlot
+    {
+        std::vector<uint64_t> latencies;
+    };
+
+    static BenchmarkSuite* m_instance;
+    static uint64_t getCurrentTime();
+
+    // only modified while setting up the sessions of a socket-type
+    std::mutex m_setupMutex;
+    std::condition_variable m_setupCv;
+    std::unordered_map<Session*, ReceiverSlot*> m_receivers;
+    std::vector<SenderSlot*> m_senders;
+
+    // progress of a running measurement
+    std::atomic<uint64_t> m_receivedBytes;
+    uint64_t m_expectedBytes = 0;
+    std::mutex m_runMutex;
+    std::condition_variable m_runCv;
+
+    void addReceivedBytes(const uint64_t numberOfBytes);
+
+private:
+    struct Result
+    {
+        std::string socket = "";
+        std::string transferType = "";
+        uint64_t payloadSize = 0;
+        uint64_t numberOfMessages = 0;
+        uint64_t numberOfBytes = 0;
+        double duration = 0.0;    // seconds
+        double throughput = 0.0;  // GB/s
+        std::string latencyType = "";
+        uint64_t p50 = 0;
+        uint64_t p99 = 0;
+        uint64_t p999 = 0;
+        uint64_t max = 0;
+    };
+
+    Config m_config;
+    SessionController* m_controller = nullptr;
+    uint32_t m_serverId = 0;
+    std::vector<Session*> m_clientSessions;
+    std::vector<Result> m_results;
+
+    bool startSessions(const std::string &socket);
+    void stopSessions();
+
+    bool runMeasurement(const std::string &socket,
+                        const std::string &transferType,
+                        const uint64_t payloadSize);
+    void sendMessages(SenderSlot* slot,
+                      const std::string &transferType,
+                      const uint64_t payloadSize,
+                      const uint64_t numberOfMessages);
+
+    static uint64_t getPercentile(const std::vector<uint64_t> &sortedValues,
+                                  const double percentile);
+    void printResults();
+    bool writeJson();
+};
+
+}
+}
+
+#endif // BENCHMARK_SUITE_H
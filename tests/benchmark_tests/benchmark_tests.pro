@@ -28,14 +28,16 @@ LIBS += -L../../../libKitsunemimiPersistence/src/debug -lKitsunemimiPersistence
 LIBS += -L../../../libKitsunemimiPersistence/src/release -lKitsunemimiPersistence
 INCLUDEPATH += ../../../libKitsunemimiPersistence/include
 
-LIBS +=  -lssl -lcrypt
+LIBS +=  -lssl -lcrypt -llz4
 LIBS +=  -lboost_filesystem -lboost_system
 
 
 SOURCES += \
+    benchmark_suite.cpp \
     main.cpp \
     test_session.cpp
 
 HEADERS += \
+    benchmark_suite.h \
     test_session.h
 
@@ -22,10 +22,131 @@
 
 #include <libKitsunemimiPersistence/logger/logger.h>
 #include <libKitsunemimiArgs/arg_parser.h>
+#include <libKitsunemimiCommon/common_methods/string_methods.h>
 #include <test_session.h>
+#include <benchmark_suite.h>
 
 using Kitsunemimi::Persistence::initConsoleLogger;
 
+/**
+ * @brief convert the arguments for the benchmark-suite and run the suite
+ *
+ * @param argParser parser with the already parsed arguments
+ * @param port port for tcp- and tls-servers
+ * @param senderThreads number of sender-threads per session
+ *
+ * @return exit-code of the program
+ */
+int
+runSuite(Kitsunemimi::Args::ArgParser &argParser,
+         const uint16_t port,
+         const uint32_t senderThreads)
+{
+    Kitsunemimi::Sakura::BenchmarkSuite::Config config;
+    config.port = port;
+    config.senderThreads = senderThreads;
+
+    if(argParser.wasSet("sessions"))
+    {
+        const long numberOfSessions = argParser.getIntValues("sessions").at(0);
+        if(numberOfSessions < 1)
+        {
+            std::cout<<"ERROR: number of sessions must be at least 1."<<std::endl;
+            return 1;
+        }
+        config.numberOfSessions = static_cast<uint32_t>(numberOfSessions);
+    }
+    if(argParser.wasSet("volume"))
+    {
+        const long volume = argParser.getIntValues("volume").at(0);
+        if(volume < 1)
+        {
+            std::cout<<"ERROR: volume must be at least 1 MiB."<<std::endl;
+            return 1;
+        }
+        config.volume = static_cast<uint64_t>(volume) * 1024 * 1024;
+    }
+
+    std::string sockets = "tcp,uds";
+    std::string transferTypes = "stream,stack_stream,standalone,request";
+    if(argParser.wasSet("sockets")) {
+        sockets = argParser.getStringValues("sockets").at(0);
+    }
+    if(argParser.wasSet("transfer-types")) {
+        transferTypes = argParser.getStringValues("transfer-types").at(0);
+    }
+    if(argParser.wasSet("cert-file")) {
+        config.certFile = argParser.getStringValues("cert-file").at(0);
+    }
+    if(argParser.wasSet("key-file")) {
+        config.keyFile = argParser.getStringValues("key-file").at(0);
+    }
+    if(argParser.wasSet("json-output")) {
+        config.jsonOutput = argParser.getStringValues("json-output").at(0);
+    }
+    config.payloadChecksum = argParser.wasSet("checksum");
+    Kitsunemimi::splitStringByDelimiter(config.sockets, sockets, ',');
+    Kitsunemimi::splitStringByDelimiter(config.transferTypes, transferTypes, ',');
+
+    if(argParser.wasSet("payload-sizes"))
+    {
+        std::vector<std::string> sizes;
+        Kitsunemimi::splitStringByDelimiter(sizes,
+                                            argParser.getStringValues("payload-sizes").at(0),
+                                            ',');
+        for(uint32_t i = 0; i < sizes.size(); i++) {
+            config.payloadSizes.push_back(std::stoull(sizes.at(i)));
+        }
+    }
+
+    // precheck sockets
+    for(uint32_t i = 0; i < config.sockets.size(); i++)
+    {
+        const std::string socket = config.sockets.at(i);
+        if(socket != "tcp"
+                && socket != "uds"
+                && socket != "tls"
+                && socket != "shm")
+        {
+            std::cout<<"ERROR: type \""<<socket<<"\" is unknown. "
+                       "Choose \"tcp\", \"uds\", \"tls\" or \"shm\"."<<std::endl;
+            return 1;
+        }
+
+        if(socket == "tls"
+                && (config.certFile == "" || config.keyFile == ""))
+        {
+            std::cout<<"ERROR: tls requires --cert-file and --key-file."<<std::endl;
+            return 1;
+        }
+    }
+
+    // precheck transfer-types
+    for(uint32_t i = 0; i < config.transferTypes.size(); i++)
+    {
+        const std::string transferType = config.transferTypes.at(i);
+        if(transferType != "stream"
+                && transferType != "standalone"
+                && transferType != "request"
+                && transferType != "request_batch"
+                && transferType != "stack_stream")
+        {
+            std::cout<<"ERROR: transfer-type \""<<transferType<<"\" is unknown. "
+                       "Choose \"stream\", \"stack_stream\", \"standalone\", \"request\" "
+                       "or \"request_batch\"."
+                     <<std::endl;
+            return 1;
+        }
+    }
+
+    Kitsunemimi::Sakura::BenchmarkSuite suite(config);
+    if(suite.runSuite() == false) {
+        return 1;
+    }
+
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     //initConsoleLogger(true);
@@ -39,11 +160,44 @@ int main(int argc, char *argv[])
                              "type: tcp or uds (Default: tcp)");
     argParser.registerString("transfer-type,t",
                              "type of transfer: stream, standalone or request (Default: stream)");
+    argParser.registerInteger("sender-threads,n",
+                              "max number of threads, which send stream-messages in parallel over "
+                              "the same session. The test runs with 1, 2, 4, ... up to this number "
+                              "of threads (Default: 1)");
     argParser.registerInteger("package-size",
                               "Test-package-size in byte(Default: 128 KiB)",
-                              true,
+                              false,
                               true);
 
+    // benchmark-suite
+    argParser.registerFlag("suite",
+                           "run all combinations of the sockets, transfer-types and payload-sizes "
+                           "with multiple sessions within this process instead of a single test");
+    argParser.registerInteger("sessions,c",
+                              "number of sessions for the suite, where each session has "
+                              "--sender-threads threads (Default: 1)");
+    argParser.registerString("sockets",
+                             "comma-separated socket-types for the suite: tcp, uds, tls and shm "
+                             "(Default: tcp,uds)");
+    argParser.registerString("transfer-types",
+                             "comma-separated transfer-types for the suite: stream, "
+                             "stack_stream, standalone, request and request_batch "
+                             "(Default: stream,stack_stream,standalone,request)");
+    argParser.registerString("payload-sizes",
+                             "comma-separated payload-sizes in byte for the suite "
+                             "(Default: sizes from 1 KiB to 4 MiB around 128 KiB)");
+    argParser.registerInteger("volume",
+                              "number of MiB, which are transfered by each measurement of the "
+                              "suite (Default: 256)");
+    argParser.registerString("cert-file",
+                             "certificate-file for tls-sessions of the suite");
+    argParser.registerString("key-file",
+                             "key-file for tls-sessions of the suite");
+    argParser.registerString("json-output",
+                             "file for the json-output of the suite (Default: stdout)");
+    argParser.registerFlag("checksum",
+                           "use a crc32c-checksum for all messages of the sessions of the suite");
+
     bool ret = argParser.parse(argc, argv);
     if(ret == false) {
         return 1;
@@ -54,6 +208,7 @@ int main(int argc, char *argv[])
     std::string socket = "tcp";
     std::string transferType = "stream";
     long packageSize = 128*1024;
+    long senderThreads = 1;
 
     if(argParser.wasSet("address")) {
         address = argParser.getStringValues("address").at(0);
@@ -67,7 +222,26 @@ int main(int argc, char *argv[])
     if(argParser.wasSet("transfer-type")) {
         transferType = argParser.getStringValues("transfer-type").at(0);
     }
+    if(argParser.wasSet("sender-threads")) {
+        senderThreads = argParser.getIntValues("sender-threads").at(0);
+    }
+
+    // precheck number of threads
+    if(senderThreads < 1)
+    {
+        std::cout<<"ERROR: number of sender-threads must be at least 1."<<std::endl;
+        exit(1);
+    }
 
+    if(argParser.wasSet("suite")) {
+        return runSuite(argParser, port, static_cast<uint32_t>(senderThreads));
+    }
+
+    if(argParser.wasSet("package-size") == false)
+    {
+        std::cout<<"ERROR: package-size is required without --suite."<<std::endl;
+        exit(1);
+    }
     packageSize = argParser.getIntValue("package-size");
 
     // precheck type
@@ -96,6 +270,7 @@ int main(int argc, char *argv[])
     std::cout<<"socket: "<<socket<<std::endl;
     std::cout<<"transfer-type: "<<transferType<<std::endl;
     std::cout<<"package-size: "<<packageSize<<std::endl;
+    std::cout<<"sender-threads: "<<senderThreads<<std::endl;
     std::cout<<"--------------------------------------"<<std::endl;
 
     Kitsunemimi::Sakura::TestSession testSession(address,
@@ -103,5 +278,5 @@ int main(int argc, char *argv[])
                                                  socket,
                                                  transferType);
 
-    testSession.runTest(packageSize);
+    testSession.runTest(packageSize, static_cast<uint32_t>(senderThreads));
 }
@@ -54,7 +54,7 @@ void standaloneDataCallback(Kitsunemimi::Sakura::Session* session,
         if(session->isClientSide() == false)
         {
             TestSession::m_instance->m_sizeCounter += data->bufferPosition;
-            delete data;
+            session->releaseBuffer(data);
             uint8_t data[10];
             TestSession::m_instance->m_serverSession->sendResponse(data, 10, blockerId);
         }
@@ -66,7 +66,7 @@ void standaloneDataCallback(Kitsunemimi::Sakura::Session* session,
         if(session->isClientSide() == false)
         {
             TestSession::m_instance->m_sizeCounter += data->bufferPosition;
-            delete data;
+            session->releaseBuffer(data);
             uint8_t data[10];
             TestSession::m_instance->m_serverSession->sendStandaloneData(data, 10);
         }
@@ -186,11 +186,51 @@ TestSession::TestSession(const std::string &address,
     }
 }
 
+/**
+ * @brief send one round of stream-messages with multiple threads over the same client-session
+ *
+ * @param packageSize size of a single stream-message
+ * @param numberOfThreads number of parallel sending threads
+ */
+void
+TestSession::sendStreamParallel(const long packageSize,
+                                const uint32_t numberOfThreads)
+{
+    const long numberOfMessages = (10l*1024l*1024l*1024l) / packageSize;
+    std::vector<std::thread> threads;
+
+    for(uint32_t t = 0; t < numberOfThreads; t++)
+    {
+        // first thread additionally sends the rest of the division
+        long messagesOfThread = numberOfMessages / numberOfThreads;
+        if(t == 0) {
+            messagesOfThread += numberOfMessages % numberOfThreads;
+        }
+
+        threads.push_back(std::thread([this, packageSize, messagesOfThread]()
+        {
+            for(long i = 0; i < messagesOfThread; i++)
+            {
+                assert(m_clientSession->sendStreamData(m_dataBuffer,
+                                                       static_cast<uint64_t>(packageSize)));
+            }
+        }));
+    }
+
+    for(uint32_t t = 0; t < numberOfThreads; t++) {
+        threads[t].join();
+    }
+}
+
 /**
  * @brief run test
+ *
+ * @param packageSize size of a single message
+ * @param senderThreads max number of threads, which send stream-messages in parallel
  */
 void
-TestSession::runTest(const long packageSize)
+TestSession::runTest(const long packageSize,
+                     const uint32_t senderThreads)
 {
 
     if(m_isClient)
@@ -224,23 +264,35 @@ TestSession::runTest(const long packageSize)
             }
         }
 
-        // send stream-messages
+        // send stream-messages with 1, 2, 4, ... sender-threads
         if(m_transferType == "stream")
         {
-            m_timeSlot.name = "stream-speed";
-            for(int j = 0; j < 10; j++)
+            uint32_t numberOfThreads = 1;
+            while(true)
             {
-                std::cout<<"stream"<<std::endl;
-                m_timeSlot.startTimer();
-                for(long i = 0; i < (10l*1024l*1024l*1024l) / packageSize; i++)
+                m_timeSlot.name = "stream-speed (" + std::to_string(numberOfThreads)
+                                  + " sender-threads)";
+                m_timeSlot.values.clear();
+
+                for(int j = 0; j < 10; j++)
                 {
-                    assert(m_clientSession->sendStreamData(m_dataBuffer,
-                                                           static_cast<uint64_t>(packageSize)));
+                    std::cout<<"stream with "<<numberOfThreads<<" threads"<<std::endl;
+                    m_timeSlot.startTimer();
+                    sendStreamParallel(packageSize, numberOfThreads);
+                    m_cv.wait(lock);
+
+                    m_timeSlot.stopTimer();
+                    m_timeSlot.values.push_back(
+                                calculateSpeed(m_timeSlot.getDuration(MICRO_SECONDS)));
                 }
-                m_cv.wait(lock);
 
-                m_timeSlot.stopTimer();
-                m_timeSlot.values.push_back(calculateSpeed(m_timeSlot.getDuration(MICRO_SECONDS)));
+                // results of the last thread-number are added at the end of the test
+                if(numberOfThreads >= senderThreads) {
+                    break;
+                }
+
+                addToResult(m_timeSlot);
+                numberOfThreads = std::min(numberOfThreads * 2, senderThreads);
             }
         }
 
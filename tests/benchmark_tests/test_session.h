@@ -6,6 +6,9 @@
 #include <unistd.h>
 #include <chrono>
 #include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
 #include <condition_variable>
 
 #include <libKitsunemimiCommon/test_helper/speed_test_helper.h>
@@ -33,7 +36,10 @@ public:
                 const uint16_t port,
                 const std::string &socket,
                 const std::string &transferType);
-    void runTest(const long packageSize);
+    void runTest(const long packageSize,
+                 const uint32_t senderThreads = 1);
+    void sendStreamParallel(const long packageSize,
+                            const uint32_t numberOfThreads);
     double calculateSpeed(double duration);
 
     static TestSession* m_instance;
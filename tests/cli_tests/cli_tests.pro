@@ -23,7 +23,7 @@ LIBS += -L../../../libKitsunemimiPersistence/src/debug -lKitsunemimiPersistence
 LIBS += -L../../../libKitsunemimiPersistence/src/release -lKitsunemimiPersistence
 INCLUDEPATH += ../../../libKitsunemimiPersistence/include
 
-LIBS +=  -lssl -lcrypt
+LIBS +=  -lssl -lcrypt -llz4
 LIBS +=  -lboost_filesystem -lboost_program_options -lboost_system
 
 
@@ -0,0 +1,96 @@
+/**
+ * @file    fake_socket.h
+ *
+ * @author  Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef FAKE_SOCKET_H
+#define FAKE_SOCKET_H
+
+#include <stdint.h>
+#include <vector>
+#include <sys/types.h>
+
+#include <libKitsunemimiNetwork/abstract_socket.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief in-memory socket without any file-descriptor for benchmarks and tests, which call the
+ *        processing of the library directly. Sended data are counted and, if enabled, collected.
+ *        Nothing is received, so measured times contain only the processing within the library.
+ */
+class FakeSocket
+        : public Network::AbstractSocket
+{
+public:
+    FakeSocket() {}
+    ~FakeSocket() {}
+
+    bool initClientSide() { return true; }
+
+    uint64_t m_numberOfSendCalls = 0;
+    uint64_t m_numberOfSendBytes = 0;
+
+    // copy of all sended data, if collecting is enabled
+    bool m_collectData = false;
+    std::vector<uint8_t> m_sendData;
+
+protected:
+    // no receiving thread, which polls on a socket
+    void run()
+    {
+        while(m_abort == false) {
+            sleepThread(10000);
+        }
+    }
+
+    long recvData(int,
+                  void*,
+                  const size_t,
+                  int)
+    {
+        return 0;
+    }
+
+    ssize_t sendData(int,
+                     const void* bufferPosition,
+                     const size_t bufferSize,
+                     const bool)
+    {
+        m_numberOfSendCalls++;
+        m_numberOfSendBytes += bufferSize;
+
+        if(m_collectData)
+        {
+            const uint8_t* data = static_cast<const uint8_t*>(bufferPosition);
+            m_sendData.insert(m_sendData.end(), data, data + bufferSize);
+        }
+
+        return static_cast<ssize_t>(bufferSize);
+    }
+};
+
+}
+}
+
+#endif // FAKE_SOCKET_H
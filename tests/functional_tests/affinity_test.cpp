@@ -0,0 +1,295 @@
+/**
+ * @file       affinity_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include "affinity_test.h"
+
+#include <iostream>
+#include <sched.h>
+#include <unistd.h>
+
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+Kitsunemimi::Sakura::Affinity_Test* Affinity_Test::m_instance = nullptr;
+
+/**
+ * @brief streamDataCallback, which is triggered by the receiving thread of the session
+ */
+void affinityTestStreamCallback(Session* session,
+                                const void*,
+                                const uint64_t)
+{
+    if(session->isClientSide()) {
+        return;
+    }
+
+    Affinity_Test* test = Affinity_Test::m_instance;
+    std::unique_lock<std::mutex> lock(test->m_coresMutex);
+    test->m_streamCores = Affinity_Test::getCurrentCores();
+    test->m_numberOfStreamMessages++;
+}
+
+/**
+ * @brief standaloneDataCallback, which is triggered by a worker of the callback-dispatcher
+ */
+void affinityTestStandaloneCallback(Session* session,
+                                    const uint64_t,
+                                    DataBuffer* data)
+{
+    session->releaseBuffer(data);
+    if(session->isClientSide()) {
+        return;
+    }
+
+    Affinity_Test* test = Affinity_Test::m_instance;
+    std::unique_lock<std::mutex> lock(test->m_coresMutex);
+    test->m_standaloneCores = Affinity_Test::getCurrentCores();
+    test->m_numberOfStandaloneMessages++;
+}
+
+/**
+ * @brief sessionCreateCallback
+ */
+void affinityTestCreateCallback(Session* session,
+                                const std::string)
+{
+    session->setStreamMessageCallback(&affinityTestStreamCallback);
+    session->setStandaloneMessageCallback(&affinityTestStandaloneCallback);
+
+    if(session->isClientSide() == false) {
+        Affinity_Test::m_instance->m_serverSession = session;
+    }
+}
+
+/**
+ * @brief sessionCloseCallback
+ */
+void affinityTestCloseCallback(Session*,
+                               const std::string)
+{
+}
+
+/**
+ * @brief errorCallback
+ */
+void affinityTestErrorCallback(Session*,
+                               const uint8_t,
+                               const std::string message)
+{
+    std::cout<<"ERROR: "<<message<<std::endl;
+}
+
+/**
+ * @brief Affinity_Test::Affinity_Test
+ */
+Affinity_Test::Affinity_Test() :
+    Kitsunemimi::CompareTestHelper("Affinity_Test")
+{
+    Affinity_Test::m_instance = this;
+    m_serverSession = nullptr;
+
+    runTest();
+}
+
+/**
+ * @brief runTest
+ */
+void
+Affinity_Test::runTest()
+{
+    // use the cores, which are allowed for the test-process
+    const std::vector<uint32_t> allowedCores = getCurrentCores();
+    const bool hasCores = allowedCores.size() > 0;
+    TEST_EQUAL(hasCores, true);
+    if(hasCores == false) {
+        return;
+    }
+    const uint32_t firstCore = allowedCores.front();
+    const uint32_t lastCore = allowedCores.back();
+
+    SessionController* controller = new SessionController(&affinityTestCreateCallback,
+                                                          &affinityTestCloseCallback,
+                                                          &affinityTestErrorCallback);
+
+    TEST_EQUAL(controller->addTcpServer(1241), 1);
+    Session* session = controller->startTcpSession("127.0.0.1", 1241, "affinity");
+    for(uint32_t i = 0; i < 100 && m_serverSession == nullptr; i++) {
+        usleep(10000);
+    }
+
+    Session* serverSession = m_serverSession;
+    const bool isNullptr = session == nullptr || serverSession == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr)
+    {
+        delete controller;
+        return;
+    }
+
+    // policy of a single session pins its receiving thread
+    AffinityPolicy sessionPolicy;
+    sessionPolicy.cores.push_back(lastCore);
+    serverSession->setAffinity(sessionPolicy);
+    std::vector<uint32_t> cores = getStreamCores(session);
+    TEST_EQUAL(cores.size(), (uint64_t)1);
+    if(cores.size() == 1) {
+        TEST_EQUAL(cores[0], lastCore);
+    }
+
+    // global policy pins the shared worker-threads and the sessions without own policy
+    AffinityPolicy globalPolicy;
+    globalPolicy.cores.push_back(firstCore);
+    controller->setGlobalAffinity(globalPolicy);
+
+    cores = getStandaloneCores(session);
+    TEST_EQUAL(cores.size(), (uint64_t)1);
+    if(cores.size() == 1) {
+        TEST_EQUAL(cores[0], firstCore);
+    }
+
+    cores = getStreamCores(session);
+    TEST_EQUAL(cores.size(), (uint64_t)1);
+    if(cores.size() == 1) {
+        TEST_EQUAL(cores[0], lastCore);
+    }
+
+    serverSession->setAffinity(AffinityPolicy());
+    cores = getStreamCores(session);
+    TEST_EQUAL(cores.size(), (uint64_t)1);
+    if(cores.size() == 1) {
+        TEST_EQUAL(cores[0], firstCore);
+    }
+
+    // without policy all cores are allowed again
+    controller->setGlobalAffinity(AffinityPolicy());
+    cores = getStandaloneCores(session);
+    bool isUnpinned = cores.size() >= allowedCores.size();
+    TEST_EQUAL(isUnpinned, true);
+    cores = getStreamCores(session);
+    isUnpinned = cores.size() >= allowedCores.size();
+    TEST_EQUAL(isUnpinned, true);
+
+    TEST_EQUAL(session->closeSession(), true);
+    usleep(100000);
+
+    delete controller;
+}
+
+/**
+ * @brief get the cores, where the calling thread is allowed to run
+ *
+ * @return sorted list of core-ids
+ */
+std::vector<uint32_t>
+Affinity_Test::getCurrentCores()
+{
+    std::vector<uint32_t> result;
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if(sched_getaffinity(0, sizeof(cpu_set_t), &cpuSet) != 0) {
+        return result;
+    }
+
+    for(uint32_t i = 0; i < CPU_SETSIZE; i++)
+    {
+        if(CPU_ISSET(i, &cpuSet)) {
+            result.push_back(i);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief send a stream-message and get the cores of the receiving thread of the server
+ *
+ * @param session client-session to send over
+ *
+ * @return cores of the receiving thread of the server-session
+ */
+std::vector<uint32_t>
+Affinity_Test::getStreamCores(Session* session)
+{
+    uint32_t numberOfMessages = 0;
+    {
+        std::unique_lock<std::mutex> lock(m_coresMutex);
+        numberOfMessages = m_numberOfStreamMessages;
+    }
+
+    TEST_EQUAL(session->sendStreamData("affinity", 8), true);
+
+    for(uint32_t i = 0; i < 200; i++)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_coresMutex);
+            if(m_numberOfStreamMessages > numberOfMessages) {
+                return m_streamCores;
+            }
+        }
+        usleep(10000);
+    }
+
+    return std::vector<uint32_t>();
+}
+
+/**
+ * @brief send a standalone-message and get the cores of the worker, which triggered the callback
+ *
+ * @param session client-session to send over
+ *
+ * @return cores of the worker-thread
+ */
+std::vector<uint32_t>
+Affinity_Test::getStandaloneCores(Session* session)
+{
+    uint32_t numberOfMessages = 0;
+    {
+        std::unique_lock<std::mutex> lock(m_coresMutex);
+        numberOfMessages = m_numberOfStandaloneMessages;
+    }
+
+    const bool isSend = session->sendStandaloneData("affinity", 8) != 0;
+    TEST_EQUAL(isSend, true);
+
+    for(uint32_t i = 0; i < 200; i++)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_coresMutex);
+            if(m_numberOfStandaloneMessages > numberOfMessages) {
+                return m_standaloneCores;
+            }
+        }
+        usleep(10000);
+    }
+
+    return std::vector<uint32_t>();
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,68 @@
+/**
+ * @file       affinity_test.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef AFFINITY_TEST_H
+#define AFFINITY_TEST_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <libKitsunemimiCommon/test_helper/compare_test_helper.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+
+class Affinity_Test
+        : public Kitsunemimi::CompareTestHelper
+{
+public:
+    Affinity_Test();
+
+    void runTest();
+
+    static Affinity_Test* m_instance;
+
+    std::atomic<Session*> m_serverSession;
+
+    // cores of the last callbacks of the server
+    std::mutex m_coresMutex;
+    std::vector<uint32_t> m_streamCores;
+    std::vector<uint32_t> m_standaloneCores;
+    uint32_t m_numberOfStreamMessages = 0;
+    uint32_t m_numberOfStandaloneMessages = 0;
+
+    static std::vector<uint32_t> getCurrentCores();
+
+private:
+    std::vector<uint32_t> getStreamCores(Session* session);
+    std::vector<uint32_t> getStandaloneCores(Session* session);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // AFFINITY_TEST_H
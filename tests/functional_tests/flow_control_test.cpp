@@ -0,0 +1,218 @@
+/**
+ * @file       flow_control_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include "flow_control_test.h"
+
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+// size of the test-messages, so the credit-window of 1 MiB is used up after 16 messages
+#define FLOW_CONTROL_TEST_MESSAGE_SIZE (64*1024)
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+Kitsunemimi::Sakura::FlowControl_Test* FlowControl_Test::m_instance = nullptr;
+
+/**
+ * @brief streamDataCallback, which blocks the receiving thread of the server on request, so no
+ *        credits are given back to the client
+ */
+void flowControlTestStreamCallback(Session* session,
+                                   const void*,
+                                   const uint64_t dataSize)
+{
+    if(session->isClientSide()) {
+        return;
+    }
+
+    FlowControl_Test::m_instance->compare(dataSize, (uint64_t)FLOW_CONTROL_TEST_MESSAGE_SIZE);
+    FlowControl_Test::m_instance->m_numberOfStreamMessages++;
+
+    while(FlowControl_Test::m_instance->m_blockReceiver) {
+        usleep(1000);
+    }
+}
+
+/**
+ * @brief sessionCreateCallback
+ */
+void flowControlTestCreateCallback(Session* session,
+                                   const std::string)
+{
+    session->setStreamMessageCallback(&flowControlTestStreamCallback);
+}
+
+/**
+ * @brief sessionCloseCallback
+ */
+void flowControlTestCloseCallback(Session*,
+                                  const std::string)
+{
+}
+
+/**
+ * @brief errorCallback
+ */
+void flowControlTestErrorCallback(Session*,
+                                  const uint8_t errorCode,
+                                  const std::string message)
+{
+    if(errorCode == Session::errorCodes::MESSAGE_TIMEOUT) {
+        FlowControl_Test::m_instance->m_numberOfTimeouts++;
+    }
+
+    std::cout<<"ERROR: "<<message<<std::endl;
+}
+
+/**
+ * @brief FlowControl_Test::FlowControl_Test
+ */
+FlowControl_Test::FlowControl_Test() :
+    Kitsunemimi::CompareTestHelper("FlowControl_Test")
+{
+    FlowControl_Test::m_instance = this;
+    m_blockReceiver = false;
+    m_numberOfStreamMessages = 0;
+    m_numberOfTimeouts = 0;
+
+    runTest();
+}
+
+/**
+ * @brief runTest
+ */
+void
+FlowControl_Test::runTest()
+{
+    SessionController* controller = new SessionController(&flowControlTestCreateCallback,
+                                                          &flowControlTestCloseCallback,
+                                                          &flowControlTestErrorCallback);
+    controller->setStreamFlowControl(true);
+
+    TEST_EQUAL(controller->addTcpServer(1239), 1);
+    Session* session = controller->startTcpSession("127.0.0.1", 1239, "flow");
+    const bool isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr)
+    {
+        delete controller;
+        return;
+    }
+    TEST_EQUAL(session->isStreamFlowControlActive(), true);
+
+    const std::string message(FLOW_CONTROL_TEST_MESSAGE_SIZE, 'f');
+
+    //==============================================================================================
+    // trySendStreamData returns false without credits
+    //==============================================================================================
+    m_blockReceiver = true;
+    const uint32_t numberOfSendMessages = fillCreditWindow(session);
+    const bool isInWindow = numberOfSendMessages >= 14 && numberOfSendMessages <= 16;
+    TEST_EQUAL(isInWindow, true);
+
+    //==============================================================================================
+    // sendStreamData blocks until new credits are granted
+    //==============================================================================================
+    std::atomic<bool> isFinished(false);
+    std::atomic<bool> sendResult(false);
+    std::thread senderThread([&]() {
+        sendResult = session->sendStreamData(message.c_str(), message.size());
+        isFinished = true;
+    });
+
+    usleep(300000);
+    TEST_EQUAL(isFinished.load(), false);
+
+    // the server processes the data and grants new credits
+    m_blockReceiver = false;
+    for(uint32_t i = 0; i < 200 && isFinished == false; i++) {
+        usleep(10000);
+    }
+    TEST_EQUAL(isFinished.load(), true);
+    senderThread.join();
+    TEST_EQUAL(sendResult.load(), true);
+
+    for(uint32_t i = 0; i < 200 && m_numberOfStreamMessages < numberOfSendMessages + 1; i++) {
+        usleep(10000);
+    }
+    TEST_EQUAL(m_numberOfStreamMessages.load(), numberOfSendMessages + 1);
+    TEST_EQUAL(m_numberOfTimeouts.load(), (uint32_t)0);
+
+    //==============================================================================================
+    // timeout, when no credits are granted
+    //==============================================================================================
+    m_blockReceiver = true;
+    usleep(100000);
+    fillCreditWindow(session);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    TEST_EQUAL(session->sendStreamData(message.c_str(), message.size()), false);
+    const uint64_t duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+    const bool waitedForTimeout = duration >= 9500;
+    TEST_EQUAL(waitedForTimeout, true);
+    TEST_EQUAL(m_numberOfTimeouts.load(), (uint32_t)1);
+
+    m_blockReceiver = false;
+    usleep(100000);
+
+    TEST_EQUAL(session->closeSession(), true);
+    usleep(100000);
+
+    delete controller;
+}
+
+/**
+ * @brief send messages without blocking, until all credits of the session are used
+ *
+ * @param session session to send over
+ *
+ * @return number of send messages
+ */
+uint32_t
+FlowControl_Test::fillCreditWindow(Session* session)
+{
+    const std::string message(FLOW_CONTROL_TEST_MESSAGE_SIZE, 'f');
+
+    uint32_t numberOfSendMessages = 0;
+    while(numberOfSendMessages < 100
+          && session->trySendStreamData(message.c_str(), message.size()))
+    {
+        numberOfSendMessages++;
+    }
+
+    // nothing is send without credits
+    TEST_EQUAL(session->trySendStreamData(message.c_str(), message.size()), false);
+
+    return numberOfSendMessages;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
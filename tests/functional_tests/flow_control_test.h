@@ -0,0 +1,65 @@
+/**
+ * @file       flow_control_test.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef FLOW_CONTROL_TEST_H
+#define FLOW_CONTROL_TEST_H
+
+#include <atomic>
+
+#include <libKitsunemimiCommon/test_helper/compare_test_helper.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+
+class FlowControl_Test
+        : public Kitsunemimi::CompareTestHelper
+{
+public:
+    FlowControl_Test();
+
+    void runTest();
+
+    template<typename  T>
+    void compare(T isValue, T shouldValue)
+    {
+        TEST_EQUAL(isValue, shouldValue);
+    }
+
+    static FlowControl_Test* m_instance;
+
+    // the receiving thread of the server doesn't process data, as long as this is true
+    std::atomic<bool> m_blockReceiver;
+    std::atomic<uint32_t> m_numberOfStreamMessages;
+    std::atomic<uint32_t> m_numberOfTimeouts;
+
+private:
+    uint32_t fillCreditWindow(Session* session);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // FLOW_CONTROL_TEST_H
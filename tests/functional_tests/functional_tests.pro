@@ -23,13 +23,31 @@ LIBS += -L../../../libKitsunemimiPersistence/src/debug -lKitsunemimiPersistence
 LIBS += -L../../../libKitsunemimiPersistence/src/release -lKitsunemimiPersistence
 INCLUDEPATH += ../../../libKitsunemimiPersistence/include
 
-LIBS +=  -lssl -lcrypt
+LIBS +=  -lssl -lcrypt -llz4
 LIBS +=  -lboost_filesystem -lboost_system
 
 
 SOURCES += \
+    affinity_test.cpp \
+    flow_control_test.cpp \
+    link_session_test.cpp \
     main.cpp \
-    session_test.cpp
+    multiblock_priority_test.cpp \
+    request_test.cpp \
+    session_pool_test.cpp \
+    session_test.cpp \
+    shared_memory_test.cpp \
+    stream_batch_test.cpp \
+    stripe_test.cpp
 
 HEADERS += \
-    session_test.h
+    affinity_test.h \
+    flow_control_test.h \
+    link_session_test.h \
+    multiblock_priority_test.h \
+    request_test.h \
+    session_pool_test.h \
+    session_test.h \
+    shared_memory_test.h \
+    stream_batch_test.h \
+    stripe_test.h
@@ -0,0 +1,248 @@
+/**
+ * @file       link_session_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include "link_session_test.h"
+
+#include <iostream>
+#include <unistd.h>
+
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+Kitsunemimi::Sakura::LinkSession_Test* LinkSession_Test::m_instance = nullptr;
+
+/**
+ * @brief streamDataCallback of all sessions
+ */
+void linkTestStreamCallback(Session* session,
+                            const void* data,
+                            const uint64_t dataSize)
+{
+    LinkSession_Test::m_instance->addReceivedMessage(
+                session, std::string(static_cast<const char*>(data), dataSize));
+}
+
+/**
+ * @brief sessionCreateCallback
+ */
+void linkTestCreateCallback(Session* session,
+                            const std::string sessionIdentifier)
+{
+    session->setStreamMessageCallback(&linkTestStreamCallback);
+
+    if(session->isClientSide() == false)
+    {
+        if(sessionIdentifier == "link-a") {
+            LinkSession_Test::m_instance->m_serverSessionA = session;
+        } else {
+            LinkSession_Test::m_instance->m_serverSessionB = session;
+        }
+    }
+}
+
+/**
+ * @brief sessionCloseCallback
+ */
+void linkTestCloseCallback(Session*,
+                           const std::string)
+{
+}
+
+/**
+ * @brief errorCallback
+ */
+void linkTestErrorCallback(Session*,
+                           const uint8_t,
+                           const std::string message)
+{
+    std::cout<<"ERROR: "<<message<<std::endl;
+}
+
+/**
+ * @brief LinkSession_Test::LinkSession_Test
+ */
+LinkSession_Test::LinkSession_Test() :
+    Kitsunemimi::CompareTestHelper("LinkSession_Test")
+{
+    LinkSession_Test::m_instance = this;
+    m_serverSessionA = nullptr;
+    m_serverSessionB = nullptr;
+    m_clientSessionA = nullptr;
+
+    runTest();
+}
+
+/**
+ * @brief runTest
+ */
+void
+LinkSession_Test::runTest()
+{
+    SessionController* controller = new SessionController(&linkTestCreateCallback,
+                                                          &linkTestCloseCallback,
+                                                          &linkTestErrorCallback);
+    controller->setStreamFlowControl(true);
+
+    TEST_EQUAL(controller->addTcpServer(1237), 1);
+    Session* clientA = controller->startTcpSession("127.0.0.1", 1237, "link-a");
+    Session* clientB = controller->startTcpSession("127.0.0.1", 1237, "link-b");
+    m_clientSessionA = clientA;
+    for(uint32_t i = 0; i < 100 && (m_serverSessionA == nullptr || m_serverSessionB == nullptr); i++) {
+        usleep(10000);
+    }
+
+    Session* serverA = m_serverSessionA;
+    Session* serverB = m_serverSessionB;
+    const bool isNullptr = clientA == nullptr
+                           || clientB == nullptr
+                           || serverA == nullptr
+                           || serverB == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr)
+    {
+        delete controller;
+        return;
+    }
+
+    TEST_EQUAL(controller->linkSessions(serverA, serverB), true);
+    TEST_EQUAL(controller->linkSessions(serverA, serverB), false);
+    const bool isLinked = serverA->getLinkedSession() == serverB;
+    TEST_EQUAL(isLinked, true);
+
+    // forward in both directions
+    TEST_EQUAL(clientA->sendStreamData("forward-a", 9), true);
+    TEST_EQUAL(clientB->sendStreamData("forward-b", 9), true);
+    for(uint32_t i = 0; i < 500 && (getNumberOfReceivedMessages(true) < 1
+                                    || getNumberOfReceivedMessages(false) < 1); i++)
+    {
+        usleep(10000);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_receivedMutex);
+        TEST_EQUAL(m_receivedByClientB.size(), (uint64_t)1);
+        TEST_EQUAL(m_receivedByClientA.size(), (uint64_t)1);
+        if(m_receivedByClientB.size() == 1) {
+            TEST_EQUAL(m_receivedByClientB[0], std::string("forward-a"));
+        }
+        if(m_receivedByClientA.size() == 1) {
+            TEST_EQUAL(m_receivedByClientA[0], std::string("forward-b"));
+        }
+    }
+    // heartbeats are forwarded too
+    const bool isForwarded = serverA->getForwardingStats().numberOfMessages >= 1;
+    TEST_EQUAL(isForwarded, true);
+    TEST_EQUAL(serverA->getForwardingStats().numberOfQueuedMessages, (uint64_t)0);
+
+    // take all credits of the linked session, so the forwarded messages have to wait
+    const int64_t oldCredits = serverB->m_streamCredits.exchange(0);
+    TEST_EQUAL(clientA->sendStreamData("starved-1", 9), true);
+    TEST_EQUAL(clientA->sendStreamData("starved-2", 9), true);
+    for(uint32_t i = 0; i < 500 && serverA->getForwardingStats().numberOfQueuedMessages < 2; i++) {
+        usleep(10000);
+    }
+    usleep(100000);
+
+    // heartbeats behind the stream-messages are queued too, to keep the order
+    const bool isQueued = serverA->getForwardingStats().numberOfQueuedMessages >= 2;
+    TEST_EQUAL(isQueued, true);
+    TEST_EQUAL(getNumberOfReceivedMessages(false), (uint64_t)1);
+
+    // the queued messages are send with the next credits without new incoming data
+    serverB->addStreamCredits(static_cast<uint32_t>(oldCredits));
+    for(uint32_t i = 0; i < 500 && getNumberOfReceivedMessages(false) < 3; i++) {
+        usleep(10000);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_receivedMutex);
+        TEST_EQUAL(m_receivedByClientB.size(), (uint64_t)3);
+        if(m_receivedByClientB.size() == 3)
+        {
+            TEST_EQUAL(m_receivedByClientB[1], std::string("starved-1"));
+            TEST_EQUAL(m_receivedByClientB[2], std::string("starved-2"));
+        }
+    }
+    TEST_EQUAL(serverB->m_numberOfQueuedForwards.load(), (uint64_t)0);
+
+    // after the unlink, messages are processed by the server-session itself
+    TEST_EQUAL(controller->unlinkSession(serverA), true);
+    const uint64_t numberOfForwarded = serverA->getForwardingStats().numberOfMessages;
+    TEST_EQUAL(clientA->sendStreamData("unlinked", 8), true);
+    usleep(200000);
+    TEST_EQUAL(getNumberOfReceivedMessages(false), (uint64_t)3);
+    TEST_EQUAL(serverA->getForwardingStats().numberOfMessages, numberOfForwarded);
+
+    TEST_EQUAL(clientA->closeSession(), true);
+    TEST_EQUAL(clientB->closeSession(), true);
+    usleep(100000);
+
+    delete controller;
+}
+
+/**
+ * @brief add a stream-message to the list of the client, which had received it
+ *
+ * @param session session, which had received the message
+ * @param message payload of the message
+ */
+void
+LinkSession_Test::addReceivedMessage(Session* session, const std::string &message)
+{
+    // messages of the server-sessions are only expected after the unlink
+    if(session->isClientSide() == false) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_receivedMutex);
+    if(session == m_clientSessionA) {
+        m_receivedByClientA.push_back(message);
+    } else {
+        m_receivedByClientB.push_back(message);
+    }
+}
+
+/**
+ * @brief get number of stream-messages, which were received by one of the clients
+ *
+ * @param clientA true to get the number of the first client, false for the second one
+ *
+ * @return number of messages
+ */
+uint64_t
+LinkSession_Test::getNumberOfReceivedMessages(const bool clientA)
+{
+    std::unique_lock<std::mutex> lock(m_receivedMutex);
+    if(clientA) {
+        return m_receivedByClientA.size();
+    }
+    return m_receivedByClientB.size();
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,72 @@
+/**
+ * @file       link_session_test.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef LINK_SESSION_TEST_H
+#define LINK_SESSION_TEST_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <libKitsunemimiCommon/test_helper/compare_test_helper.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+
+class LinkSession_Test
+        : public Kitsunemimi::CompareTestHelper
+{
+public:
+    LinkSession_Test();
+
+    void runTest();
+
+    template<typename  T>
+    void compare(T isValue, T shouldValue)
+    {
+        TEST_EQUAL(isValue, shouldValue);
+    }
+
+    static LinkSession_Test* m_instance;
+
+    std::atomic<Session*> m_serverSessionA;
+    std::atomic<Session*> m_serverSessionB;
+    std::atomic<Session*> m_clientSessionA;
+
+    // stream-messages, which were received by the client-sessions
+    std::mutex m_receivedMutex;
+    std::vector<std::string> m_receivedByClientA;
+    std::vector<std::string> m_receivedByClientB;
+
+    void addReceivedMessage(Session* session, const std::string &message);
+    uint64_t getNumberOfReceivedMessages(const bool clientA);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // LINK_SESSION_TEST_H
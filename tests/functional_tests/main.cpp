@@ -22,7 +22,16 @@
 
 #include <libKitsunemimiPersistence/logger/logger.h>
 
+#include <affinity_test.h>
+#include <flow_control_test.h>
+#include <link_session_test.h>
+#include <multiblock_priority_test.h>
+#include <request_test.h>
+#include <session_pool_test.h>
 #include <session_test.h>
+#include <shared_memory_test.h>
+#include <stream_batch_test.h>
+#include <stripe_test.h>
 
 using Kitsunemimi::Persistence::initConsoleLogger;
 
@@ -31,5 +40,17 @@ int main()
 {
     initConsoleLogger(true);
 
+    // the callbacks of standalone-messages are triggered by the receiving thread, until the
+    // session-test starts the worker-threads of the callback-dispatcher
+    Kitsunemimi::Sakura::StreamBatch_Test();
+
     Kitsunemimi::Sakura::Session_Test();
+    Kitsunemimi::Sakura::Stripe_Test();
+    Kitsunemimi::Sakura::LinkSession_Test();
+    Kitsunemimi::Sakura::SharedMemory_Test();
+    Kitsunemimi::Sakura::Request_Test();
+    Kitsunemimi::Sakura::FlowControl_Test();
+    Kitsunemimi::Sakura::SessionPool_Test();
+    Kitsunemimi::Sakura::Affinity_Test();
+    Kitsunemimi::Sakura::MultiblockPriority_Test();
 }
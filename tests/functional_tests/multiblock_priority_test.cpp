@@ -0,0 +1,193 @@
+/**
+ * @file       multiblock_priority_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include "multiblock_priority_test.h"
+
+#include <iostream>
+#include <unistd.h>
+
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+Kitsunemimi::Sakura::MultiblockPriority_Test* MultiblockPriority_Test::m_instance = nullptr;
+
+/**
+ * @brief standaloneDataCallback, which checks the content of the received messages and stores
+ *        their order
+ */
+void priorityTestStandaloneCallback(Session* session,
+                                    const uint64_t,
+                                    DataBuffer* data)
+{
+    MultiblockPriority_Test* test = MultiblockPriority_Test::m_instance;
+    const std::string receivedMessage(static_cast<const char*>(data->data),
+                                      data->bufferPosition);
+    session->releaseBuffer(data);
+
+    std::string name = "broken";
+    if(receivedMessage == test->m_lowPriorityMessage) {
+        name = "low";
+    } else if(receivedMessage == test->m_highPriorityMessage) {
+        name = "high";
+    }
+
+    std::unique_lock<std::mutex> lock(test->m_receivedMutex);
+    test->m_receivedMessages.push_back(name);
+}
+
+/**
+ * @brief completionCallback of the message, which is send without copy
+ */
+void priorityTestCompletionCallback(void*,
+                                    Session*,
+                                    const uint64_t,
+                                    const bool)
+{
+}
+
+/**
+ * @brief sessionCreateCallback
+ */
+void priorityTestCreateCallback(Session* session,
+                                const std::string)
+{
+    session->setStandaloneMessageCallback(&priorityTestStandaloneCallback);
+}
+
+/**
+ * @brief sessionCloseCallback
+ */
+void priorityTestCloseCallback(Session*,
+                               const std::string)
+{
+}
+
+/**
+ * @brief errorCallback
+ */
+void priorityTestErrorCallback(Session*,
+                               const uint8_t,
+                               const std::string message)
+{
+    std::cout<<"ERROR: "<<message<<std::endl;
+}
+
+/**
+ * @brief MultiblockPriority_Test::MultiblockPriority_Test
+ */
+MultiblockPriority_Test::MultiblockPriority_Test() :
+    Kitsunemimi::CompareTestHelper("MultiblockPriority_Test")
+{
+    MultiblockPriority_Test::m_instance = this;
+
+    // the low-priority message has much more parts, so it is still in the queue, while the
+    // high-priority message is added
+    for(uint32_t i = 0; i < 60*128*1024 / 16; i++) {
+        m_lowPriorityMessage += "low-" + std::to_string(1000000 + i) + "-x";
+    }
+    for(uint32_t i = 0; i < 10*128*1024 / 16; i++) {
+        m_highPriorityMessage += "hig-" + std::to_string(1000000 + i) + "-y";
+    }
+
+    runTest();
+}
+
+/**
+ * @brief runTest
+ */
+void
+MultiblockPriority_Test::runTest()
+{
+    SessionController* controller = new SessionController(&priorityTestCreateCallback,
+                                                          &priorityTestCloseCallback,
+                                                          &priorityTestErrorCallback);
+
+    TEST_EQUAL(controller->addTcpServer(1242), 1);
+    Session* session = controller->startTcpSession("127.0.0.1", 1242, "priority");
+    const bool isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr)
+    {
+        delete controller;
+        return;
+    }
+
+    // both messages are in the queue at the same time, where the second one is added without
+    // copy, to keep the head-start of the first one small
+    const uint64_t lowId = session->sendStandaloneData(m_lowPriorityMessage.c_str(),
+                                                       m_lowPriorityMessage.size(),
+                                                       1);
+    const uint64_t highId = session->sendStandaloneDataNoCopy(m_highPriorityMessage.c_str(),
+                                                              m_highPriorityMessage.size(),
+                                                              &priorityTestCompletionCallback,
+                                                              nullptr,
+                                                              1);
+    const bool isSend = lowId != 0 && highId != 0;
+    TEST_EQUAL(isSend, true);
+
+    // the second message overtakes the first one with the higher priority
+    TEST_EQUAL(session->setMultiblockPriority(highId, 16), true);
+    TEST_EQUAL(session->setMultiblockPriority(lowId + highId + 1, 16), false);
+
+    for(uint32_t i = 0; i < 1000 && getNumberOfReceivedMessages() < 2; i++) {
+        usleep(10000);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_receivedMutex);
+        TEST_EQUAL(m_receivedMessages.size(), (uint64_t)2);
+        if(m_receivedMessages.size() == 2)
+        {
+            TEST_EQUAL(m_receivedMessages[0], std::string("high"));
+            TEST_EQUAL(m_receivedMessages[1], std::string("low"));
+        }
+    }
+
+    // messages, which are completely send, can not be changed anymore
+    TEST_EQUAL(session->setMultiblockPriority(highId, 1), false);
+
+    TEST_EQUAL(session->closeSession(), true);
+    usleep(100000);
+
+    delete controller;
+}
+
+/**
+ * @brief get number of completely received messages
+ *
+ * @return number of messages
+ */
+uint64_t
+MultiblockPriority_Test::getNumberOfReceivedMessages()
+{
+    std::unique_lock<std::mutex> lock(m_receivedMutex);
+    return m_receivedMessages.size();
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,429 @@
+/**
+ * @file       request_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include "request_test.h"
+
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+// requests with this prefix are answered by the server not until this delay in milliseconds,
+// which is longer than the timeout of these requests
+#define REQUEST_TEST_LATE_PREFIX "late:"
+#define REQUEST_TEST_LATE_DELAY 1500
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+Kitsunemimi::Sakura::Request_Test* Request_Test::m_instance = nullptr;
+
+/**
+ * @brief send a response with a delay
+ */
+void sendLateResponse(Session* session,
+                      const uint64_t blockerId,
+                      const std::string response)
+{
+    usleep(REQUEST_TEST_LATE_DELAY * 1000);
+    session->sendResponse(response.c_str(), response.size(), blockerId);
+    Request_Test::m_instance->m_numberOfLateResponses++;
+}
+
+/**
+ * @brief standaloneDataCallback of the server, which answers all requests
+ */
+void requestTestStandaloneCallback(Session* session,
+                                   const uint64_t blockerId,
+                                   DataBuffer* data)
+{
+    const std::string request(static_cast<const char*>(data->data), data->bufferPosition);
+    session->releaseBuffer(data);
+
+    if(session->isClientSide()
+            || blockerId == 0)
+    {
+        return;
+    }
+
+    // big requests are only answered with their size
+    std::string response = "response:" + request;
+    if(request.size() > 1024) {
+        response = "response:" + std::to_string(request.size());
+    }
+
+    if(request.find(REQUEST_TEST_LATE_PREFIX) == 0)
+    {
+        std::thread lateThread(&sendLateResponse, session, blockerId, response);
+        lateThread.detach();
+        return;
+    }
+
+    session->sendResponse(response.c_str(), response.size(), blockerId);
+}
+
+/**
+ * @brief callback of the async requests
+ */
+void requestTestResponseCallback(void* target,
+                                 Session* session,
+                                 const uint64_t id,
+                                 DataBuffer* data)
+{
+    Request_Test* test = static_cast<Request_Test*>(target);
+    if(data == nullptr)
+    {
+        test->addAsyncResponse(id, "timeout");
+        return;
+    }
+
+    test->addAsyncResponse(id, std::string(static_cast<const char*>(data->data),
+                                           data->bufferPosition));
+    session->releaseBuffer(data);
+}
+
+/**
+ * @brief sessionCreateCallback
+ */
+void requestTestCreateCallback(Session* session,
+                               const std::string)
+{
+    session->setStandaloneMessageCallback(&requestTestStandaloneCallback);
+}
+
+/**
+ * @brief sessionCloseCallback
+ */
+void requestTestCloseCallback(Session*,
+                              const std::string)
+{
+}
+
+/**
+ * @brief errorCallback
+ */
+void requestTestErrorCallback(Session*,
+                              const uint8_t errorCode,
+                              const std::string message)
+{
+    if(errorCode == Session::errorCodes::MESSAGE_TIMEOUT) {
+        Request_Test::m_instance->m_numberOfTimeouts++;
+    }
+
+    std::cout<<"ERROR: "<<message<<std::endl;
+}
+
+/**
+ * @brief Request_Test::Request_Test
+ */
+Request_Test::Request_Test() :
+    Kitsunemimi::CompareTestHelper("Request_Test")
+{
+    Request_Test::m_instance = this;
+    m_numberOfLateResponses = 0;
+    m_numberOfTimeouts = 0;
+
+    SessionController* controller = new SessionController(&requestTestCreateCallback,
+                                                          &requestTestCloseCallback,
+                                                          &requestTestErrorCallback);
+
+    TEST_EQUAL(controller->addTcpServer(1238), 1);
+    Session* session = controller->startTcpSession("127.0.0.1", 1238, "request");
+    const bool isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr)
+    {
+        delete controller;
+        return;
+    }
+
+    asyncRequestTest(session);
+    requestTest(session);
+    requestBatchTest(session);
+
+    TEST_EQUAL(session->closeSession(), true);
+    usleep(100000);
+
+    delete controller;
+}
+
+/**
+ * @brief test sendRequestAsync with response, timeout and a response after the timeout
+ */
+void
+Request_Test::asyncRequestTest(Session* session)
+{
+    // response
+    const std::string request = "async-request";
+    const uint64_t id = session->sendRequestAsync(request.c_str(),
+                                                  request.size(),
+                                                  1000,
+                                                  &requestTestResponseCallback,
+                                                  this);
+    bool isSend = id != 0;
+    TEST_EQUAL(isSend, true);
+    for(uint32_t i = 0; i < 200 && getAsyncResponses(id).size() == 0; i++) {
+        usleep(10000);
+    }
+
+    std::vector<std::string> responses = getAsyncResponses(id);
+    TEST_EQUAL(responses.size(), (uint64_t)1);
+    if(responses.size() == 1) {
+        TEST_EQUAL(responses[0], "response:" + request);
+    }
+
+    // timeout
+    const uint32_t numberOfTimeouts = m_numberOfTimeouts;
+    const std::string lateRequest = std::string(REQUEST_TEST_LATE_PREFIX) + "async-request";
+    const uint64_t lateId = session->sendRequestAsync(lateRequest.c_str(),
+                                                      lateRequest.size(),
+                                                      100,
+                                                      &requestTestResponseCallback,
+                                                      this);
+    isSend = lateId != 0;
+    TEST_EQUAL(isSend, true);
+    for(uint32_t i = 0; i < 100 && getAsyncResponses(lateId).size() == 0; i++) {
+        usleep(10000);
+    }
+
+    responses = getAsyncResponses(lateId);
+    TEST_EQUAL(responses.size(), (uint64_t)1);
+    if(responses.size() == 1) {
+        TEST_EQUAL(responses[0], std::string("timeout"));
+    }
+    TEST_EQUAL(m_numberOfTimeouts.load(), numberOfTimeouts + 1);
+
+    // the response after the timeout is dropped without a second call of the callback
+    waitForLateResponses(1);
+    usleep(100000);
+    TEST_EQUAL(getAsyncResponses(lateId).size(), (uint64_t)1);
+}
+
+/**
+ * @brief test sendRequest with response, timeout and a response after the timeout
+ */
+void
+Request_Test::requestTest(Session* session)
+{
+    // response
+    const std::string request = "blocking-request";
+    DataBuffer* response = session->sendRequest(request.c_str(), request.size(), 10);
+    bool isNullptr = response == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr == false)
+    {
+        const std::string responseContent(static_cast<const char*>(response->data),
+                                          response->bufferPosition);
+        TEST_EQUAL(responseContent, "response:" + request);
+        session->releaseBuffer(response);
+    }
+
+    // response of a multiblock-request
+    const std::string bigRequest(200*1024, 'x');
+    response = session->sendRequest(bigRequest.c_str(), bigRequest.size(), 10);
+    isNullptr = response == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr == false)
+    {
+        const std::string responseContent(static_cast<const char*>(response->data),
+                                          response->bufferPosition);
+        TEST_EQUAL(responseContent, "response:" + std::to_string(bigRequest.size()));
+        session->releaseBuffer(response);
+    }
+
+    // timeout, where the waiting thread is released without response
+    const std::string lateRequest = std::string(REQUEST_TEST_LATE_PREFIX) + "blocking-request";
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    response = session->sendRequest(lateRequest.c_str(), lateRequest.size(), 1);
+    const uint64_t duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+    isNullptr = response == nullptr;
+    TEST_EQUAL(isNullptr, true);
+    const bool waitedForTimeout = duration >= 900 && duration < REQUEST_TEST_LATE_DELAY;
+    TEST_EQUAL(waitedForTimeout, true);
+
+    // the late response comes, after the waiter of the request doesn't exist anymore, and the
+    // session has still to work afterwards
+    waitForLateResponses(2);
+    usleep(100000);
+    response = session->sendRequest(request.c_str(), request.size(), 10);
+    isNullptr = response == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr == false) {
+        session->releaseBuffer(response);
+    }
+}
+
+/**
+ * @brief test sendRequestBatch with all responses, with missing responses at the deadline and
+ *        with a request, which is send as multiblock-message
+ */
+void
+Request_Test::requestBatchTest(Session* session)
+{
+    Session::RequestSlot slots[5];
+    std::string requests[5];
+
+    // all responses
+    for(uint32_t i = 0; i < 5; i++)
+    {
+        requests[i] = "batch-request-" + std::to_string(i);
+        slots[i].data = requests[i].c_str();
+        slots[i].size = requests[i].size();
+    }
+    TEST_EQUAL(session->sendRequestBatch(slots, 5, 1000), (uint32_t)5);
+    for(uint32_t i = 0; i < 5; i++)
+    {
+        const bool isNullptr = slots[i].response == nullptr;
+        TEST_EQUAL(isNullptr, false);
+        if(isNullptr == false)
+        {
+            const std::string response(static_cast<const char*>(slots[i].response->data),
+                                       slots[i].response->bufferPosition);
+            TEST_EQUAL(response, "response:" + requests[i]);
+            session->releaseBuffer(slots[i].response);
+        }
+    }
+
+    // deadline with missing responses, whose slots stay empty
+    for(uint32_t i = 0; i < 4; i++)
+    {
+        requests[i] = "batch-request-" + std::to_string(i);
+        if(i % 2 == 1) {
+            requests[i] = REQUEST_TEST_LATE_PREFIX + requests[i];
+        }
+        slots[i].data = requests[i].c_str();
+        slots[i].size = requests[i].size();
+    }
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    TEST_EQUAL(session->sendRequestBatch(slots, 4, 200), (uint32_t)2);
+    const uint64_t duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+    const bool waitedForDeadline = duration >= 190 && duration < REQUEST_TEST_LATE_DELAY;
+    TEST_EQUAL(waitedForDeadline, true);
+    for(uint32_t i = 0; i < 4; i++)
+    {
+        const bool isNullptr = slots[i].response == nullptr;
+        const bool isLate = i % 2 == 1;
+        TEST_EQUAL(isNullptr, isLate);
+        if(isNullptr == false)
+        {
+            const std::string response(static_cast<const char*>(slots[i].response->data),
+                                       slots[i].response->bufferPosition);
+            TEST_EQUAL(response, "response:" + requests[i]);
+            session->releaseBuffer(slots[i].response);
+        }
+    }
+
+    // the late responses are dropped, after the batch is gone
+    waitForLateResponses(4);
+    usleep(100000);
+    for(uint32_t i = 0; i < 4; i++)
+    {
+        const bool isNullptr = slots[i].response == nullptr;
+        const bool isLate = i % 2 == 1;
+        TEST_EQUAL(isNullptr, isLate);
+    }
+
+    // mixed batch, where the big request is send as multiblock-message
+    requests[0] = "batch-request-small-0";
+    requests[1] = std::string(200*1024, 'y');
+    requests[2] = "batch-request-small-2";
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        slots[i].data = requests[i].c_str();
+        slots[i].size = requests[i].size();
+    }
+    TEST_EQUAL(session->sendRequestBatch(slots, 3, 5000), (uint32_t)3);
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        const bool isNullptr = slots[i].response == nullptr;
+        TEST_EQUAL(isNullptr, false);
+        if(isNullptr) {
+            continue;
+        }
+
+        const std::string response(static_cast<const char*>(slots[i].response->data),
+                                   slots[i].response->bufferPosition);
+        if(i == 1) {
+            TEST_EQUAL(response, "response:" + std::to_string(requests[i].size()));
+        } else {
+            TEST_EQUAL(response, "response:" + requests[i]);
+        }
+        session->releaseBuffer(slots[i].response);
+    }
+}
+
+/**
+ * @brief wait until the server has send a number of late responses
+ *
+ * @param numberOfResponses number of late responses to wait for
+ */
+void
+Request_Test::waitForLateResponses(const uint32_t numberOfResponses)
+{
+    for(uint32_t i = 0; i < 300 && m_numberOfLateResponses < numberOfResponses; i++) {
+        usleep(10000);
+    }
+    TEST_EQUAL(m_numberOfLateResponses.load(), numberOfResponses);
+}
+
+/**
+ * @brief store the result of an async request
+ *
+ * @param id id of the request
+ * @param response content of the response or "timeout"
+ */
+void
+Request_Test::addAsyncResponse(const uint64_t id, const std::string &response)
+{
+    std::unique_lock<std::mutex> lock(m_responseMutex);
+    m_asyncResponses[id].push_back(response);
+}
+
+/**
+ * @brief get all results of an async request
+ *
+ * @param id id of the request
+ *
+ * @return list of results, which should have at most one entry
+ */
+std::vector<std::string>
+Request_Test::getAsyncResponses(const uint64_t id)
+{
+    std::unique_lock<std::mutex> lock(m_responseMutex);
+    std::map<uint64_t, std::vector<std::string>>::const_iterator it;
+    it = m_asyncResponses.find(id);
+    if(it == m_asyncResponses.end()) {
+        return std::vector<std::string>();
+    }
+
+    return it->second;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,76 @@
+/**
+ * @file       request_test.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef REQUEST_TEST_H
+#define REQUEST_TEST_H
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <libKitsunemimiCommon/test_helper/compare_test_helper.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+
+class Request_Test
+        : public Kitsunemimi::CompareTestHelper
+{
+public:
+    Request_Test();
+
+    template<typename  T>
+    void compare(T isValue, T shouldValue)
+    {
+        TEST_EQUAL(isValue, shouldValue);
+    }
+
+    static Request_Test* m_instance;
+
+    std::atomic<uint32_t> m_numberOfLateResponses;
+    std::atomic<uint32_t> m_numberOfTimeouts;
+
+    // results of the async requests, where timeouts are stored as "timeout"
+    std::mutex m_responseMutex;
+    std::map<uint64_t, std::vector<std::string>> m_asyncResponses;
+
+    void addAsyncResponse(const uint64_t id, const std::string &response);
+    std::vector<std::string> getAsyncResponses(const uint64_t id);
+
+private:
+    void asyncRequestTest(Session* session);
+    void requestTest(Session* session);
+    void requestBatchTest(Session* session);
+
+    void waitForLateResponses(const uint32_t numberOfResponses);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // REQUEST_TEST_H
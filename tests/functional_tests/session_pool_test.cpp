@@ -0,0 +1,222 @@
+/**
+ * @file       session_pool_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include "session_pool_test.h"
+
+#include <iostream>
+#include <unistd.h>
+
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+Kitsunemimi::Sakura::SessionPool_Test* SessionPool_Test::m_instance = nullptr;
+
+/**
+ * @brief sessionCreateCallback
+ */
+void poolTestCreateCallback(Session* session,
+                            const std::string)
+{
+    if(session->isClientSide() == false)
+    {
+        SessionPool_Test* test = SessionPool_Test::m_instance;
+        std::unique_lock<std::mutex> lock(test->m_serverSessionsMutex);
+        test->m_serverSessions.push_back(session);
+    }
+}
+
+/**
+ * @brief sessionCloseCallback
+ */
+void poolTestCloseCallback(Session* session,
+                           const std::string)
+{
+    if(session->isClientSide() == false)
+    {
+        SessionPool_Test* test = SessionPool_Test::m_instance;
+        std::unique_lock<std::mutex> lock(test->m_serverSessionsMutex);
+        for(uint64_t i = 0; i < test->m_serverSessions.size(); i++)
+        {
+            if(test->m_serverSessions[i] == session)
+            {
+                test->m_serverSessions.erase(test->m_serverSessions.begin() + i);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief errorCallback
+ */
+void poolTestErrorCallback(Session*,
+                           const uint8_t,
+                           const std::string message)
+{
+    std::cout<<"ERROR: "<<message<<std::endl;
+}
+
+/**
+ * @brief SessionPool_Test::SessionPool_Test
+ */
+SessionPool_Test::SessionPool_Test() :
+    Kitsunemimi::CompareTestHelper("SessionPool_Test")
+{
+    SessionPool_Test::m_instance = this;
+
+    runTest();
+}
+
+/**
+ * @brief runTest
+ */
+void
+SessionPool_Test::runTest()
+{
+    SessionController* controller = new SessionController(&poolTestCreateCallback,
+                                                          &poolTestCloseCallback,
+                                                          &poolTestErrorCallback);
+
+    TEST_EQUAL(controller->addTcpServer(1240), 1);
+
+    SessionTarget target;
+    target.transport = SessionTarget::TCP;
+    target.address = "127.0.0.1";
+    target.port = 1240;
+
+    const SessionPoolStats startStats = controller->getSessionPoolStats();
+
+    // warm sessions are started in the background
+    TEST_EQUAL(controller->addSessionPool(target, 2), true);
+    TEST_EQUAL(waitForIdleSessions(controller, 2), true);
+    SessionPoolStats stats = controller->getSessionPoolStats();
+    TEST_EQUAL(stats.numberOfPools, startStats.numberOfPools + 1);
+
+    // hit and reuse of the released session, which was used last
+    Session* session = controller->acquireSession(target);
+    bool isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr)
+    {
+        delete controller;
+        return;
+    }
+    TEST_EQUAL(session->isHealthy(), true);
+    TEST_EQUAL(controller->releaseSession(session), true);
+    TEST_EQUAL(controller->releaseSession(session), false);
+
+    Session* reusedSession = controller->acquireSession(target);
+    const bool isReused = reusedSession == session;
+    TEST_EQUAL(isReused, true);
+
+    stats = controller->getSessionPoolStats();
+    TEST_EQUAL(stats.hits, startStats.hits + 2);
+    TEST_EQUAL(stats.misses, startStats.misses);
+    TEST_EQUAL(stats.numberOfAcquiredSessions, startStats.numberOfAcquiredSessions + 1);
+
+    // idle sessions, which are closed by the server, are discarded and replaced
+    TEST_EQUAL(waitForIdleSessions(controller, 2), true);
+    const uint32_t acquiredId = reusedSession->sessionId();
+    std::vector<Session*> serverSessions;
+    {
+        std::unique_lock<std::mutex> lock(m_serverSessionsMutex);
+        serverSessions = m_serverSessions;
+    }
+    uint64_t numberOfClosed = 0;
+    for(uint64_t i = 0; i < serverSessions.size(); i++)
+    {
+        if(serverSessions[i]->sessionId() != acquiredId)
+        {
+            serverSessions[i]->closeSession();
+            numberOfClosed++;
+        }
+    }
+    TEST_EQUAL(numberOfClosed, (uint64_t)2);
+
+    for(uint32_t i = 0; i < 200; i++)
+    {
+        stats = controller->getSessionPoolStats();
+        if(stats.numberOfDiscardedSessions >= startStats.numberOfDiscardedSessions + 2) {
+            break;
+        }
+        usleep(10000);
+    }
+    TEST_EQUAL(stats.numberOfDiscardedSessions, startStats.numberOfDiscardedSessions + 2);
+    TEST_EQUAL(waitForIdleSessions(controller, 2), true);
+
+    Session* newSession = controller->acquireSession(target);
+    isNullptr = newSession == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr == false) {
+        TEST_EQUAL(newSession->isHealthy(), true);
+    }
+
+    // the pool is full again, so released sessions are closed
+    TEST_EQUAL(waitForIdleSessions(controller, 2), true);
+    if(isNullptr == false) {
+        TEST_EQUAL(controller->releaseSession(newSession), false);
+    }
+    TEST_EQUAL(controller->releaseSession(reusedSession), false);
+    stats = controller->getSessionPoolStats();
+    TEST_EQUAL(stats.numberOfDiscardedSessions, startStats.numberOfDiscardedSessions + 4);
+    TEST_EQUAL(stats.numberOfAcquiredSessions, startStats.numberOfAcquiredSessions);
+
+    TEST_EQUAL(controller->removeSessionPool(target), true);
+    TEST_EQUAL(controller->removeSessionPool(target), false);
+    stats = controller->getSessionPoolStats();
+    TEST_EQUAL(stats.numberOfPools, startStats.numberOfPools);
+    usleep(100000);
+
+    delete controller;
+}
+
+/**
+ * @brief wait until the pools have a number of idle sessions
+ *
+ * @param controller controller with the session-pool
+ * @param numberOfSessions number of idle sessions to wait for
+ *
+ * @return true, if the number was reached within 2 seconds, else false
+ */
+bool
+SessionPool_Test::waitForIdleSessions(SessionController* controller,
+                                      const uint64_t numberOfSessions)
+{
+    for(uint32_t i = 0; i < 200; i++)
+    {
+        if(controller->getSessionPoolStats().numberOfIdleSessions == numberOfSessions) {
+            return true;
+        }
+        usleep(10000);
+    }
+
+    return false;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,60 @@
+/**
+ * @file       session_pool_test.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef SESSION_POOL_TEST_H
+#define SESSION_POOL_TEST_H
+
+#include <mutex>
+#include <vector>
+
+#include <libKitsunemimiCommon/test_helper/compare_test_helper.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+class SessionController;
+
+class SessionPool_Test
+        : public Kitsunemimi::CompareTestHelper
+{
+public:
+    SessionPool_Test();
+
+    void runTest();
+
+    static SessionPool_Test* m_instance;
+
+    std::mutex m_serverSessionsMutex;
+    std::vector<Session*> m_serverSessions;
+
+private:
+    bool waitForIdleSessions(SessionController* controller,
+                             const uint64_t numberOfSessions);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // SESSION_POOL_TEST_H
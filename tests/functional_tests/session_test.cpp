@@ -22,6 +22,12 @@
 
 #include "session_test.h"
 
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <message_definitions.h>
+
 namespace Kitsunemimi
 {
 namespace Sakura
@@ -55,6 +61,14 @@ void streamDataCallback(Session*,
         Session_Test::m_instance->compare(receivedMessage, Session_Test::m_instance->m_dynamicMessage);
     }
 
+    // the reply is send after the callback, so it comes later than the timeout of the sender
+    if(dataSize == Session_Test::m_instance->m_slowMessage.size())
+    {
+        ret = true;
+        Session_Test::m_instance->compare(receivedMessage, Session_Test::m_instance->m_slowMessage);
+        usleep(500000);
+    }
+
     Session_Test::m_instance->compare(ret,  true);
 }
 
@@ -64,7 +78,7 @@ void streamDataCallback(Session*,
  * @param data
  * @param dataSize
  */
-void standaloneDataCallback(Session*,
+void standaloneDataCallback(Session* session,
                             const uint64_t,
                             DataBuffer* data)
 {
@@ -85,16 +99,95 @@ void standaloneDataCallback(Session*,
                                           Session_Test::m_instance->m_multiBlockMessage);
     }
 
-    delete data;
+    session->releaseBuffer(data);
+}
+
+/**
+ * @brief multiblockPartCallback, which gets the parts of all incoming multiblock-messages of the
+ *        server-side. The parts of each message are delivered in order.
+ */
+void multiblockPartCallback(Session*,
+                            const uint64_t multiblockId,
+                            const uint64_t offset,
+                            const void* data,
+                            const uint64_t dataSize,
+                            const bool isLast)
+{
+    Session_Test* test = Session_Test::m_instance;
+
+    // each part follows directly after the last one of the same message
+    uint64_t* expectedOffset = &test->m_chunkedOffsets[multiblockId];
+    test->compare(offset, *expectedOffset);
+    *expectedOffset += dataSize;
+    test->m_chunkedParts[multiblockId]++;
+
+    // only the last part can be smaller than the maximum part-size
+    if(isLast == false) {
+        test->compare(dataSize, (uint64_t)MAX_SINGLE_MESSAGE_SIZE);
+    }
+
+    const std::string receivedPart(static_cast<const char*>(data), dataSize);
+    test->compare(receivedPart, test->m_chunkedMessage.substr(offset, dataSize));
+
+    if(isLast)
+    {
+        const uint64_t messageSize = offset + dataSize;
+        const uint32_t numberOfParts = static_cast<uint32_t>(
+                    (messageSize + MAX_SINGLE_MESSAGE_SIZE - 1) / MAX_SINGLE_MESSAGE_SIZE);
+        test->compare(test->m_chunkedParts[multiblockId], numberOfParts);
+
+        test->m_completeChunkedSizes.push_back(messageSize);
+        test->m_numberOfChunkedMessages++;
+    }
+}
+
+/**
+ * @brief completionCallback
+ */
+void completionCallback(void*,
+                        Session*,
+                        const uint64_t,
+                        const bool success)
+{
+    if(success) {
+        Session_Test::m_instance->m_numberOfCompletions++;
+    } else {
+        Session_Test::m_instance->m_numberOfFailedCompletions++;
+    }
+}
+
+/**
+ * @brief check if a file is still mapped into the memory of the process
+ *
+ * @param filePath path of the file
+ *
+ * @return true, if a mapping of the file exists, else false
+ */
+bool isFileMapped(const std::string &filePath)
+{
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    while(std::getline(maps, line))
+    {
+        if(line.find(filePath) != std::string::npos) {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 /**
  * @brief errorCallback
  */
 void errorCallback(Kitsunemimi::Sakura::Session*,
-                   const uint8_t,
+                   const uint8_t errorCode,
                    const std::string message)
 {
+    if(errorCode == Session::errorCodes::MESSAGE_TIMEOUT) {
+        Session_Test::m_instance->m_numberOfTimeouts++;
+    }
+
     std::cout<<"ERROR: "<<message<<std::endl;
 }
 
@@ -108,10 +201,16 @@ void sessionCreateCallback(Kitsunemimi::Sakura::Session* session,
 {
     session->setStreamMessageCallback(&streamDataCallback);
     session->setStandaloneMessageCallback(&standaloneDataCallback);
+    if(session->isClientSide() == false) {
+        session->setMultiblockPartCallback(&multiblockPartCallback);
+    }
 
     Session_Test::m_instance->compare(session->sessionId(), (uint32_t)131073);
     Session_Test::m_instance->m_numberOfInitSessions++;
     Session_Test::m_instance->compare(sessionIdentifier, std::string("test"));
+    Session_Test::m_instance->compare(session->isCompressionActive(), true);
+    Session_Test::m_instance->compare(session->isPayloadChecksumActive(), true);
+    Session_Test::m_instance->compare(session->isStreamFlowControlActive(), true);
 
     if(session->isClientSide())
     {
@@ -124,17 +223,110 @@ void sessionCreateCallback(Kitsunemimi::Sakura::Session* session,
                                       true);
         Session_Test::m_instance->compare(ret,  true);
 
+        // stream-message with a short timeout, whose reply is delayed by the receiver
+        SessionController* controller = SessionController::m_sessionController;
+        const uint8_t replyType = SessionController::STREAM_REPLY;
+        const uint32_t oldTimeout = controller->getReplyTimeout(replyType);
+        Session_Test::m_instance->compare(controller->setReplyTimeout(replyType, 150), true);
+        Session_Test::m_instance->compare(controller->getReplyTimeout(replyType), (uint32_t)200);
+        const std::string slowTestString = Session_Test::m_instance->m_slowMessage;
+        ret = session->sendStreamData(slowTestString.c_str(),
+                                      slowTestString.size(),
+                                      true);
+        Session_Test::m_instance->compare(ret,  true);
+        controller->setReplyTimeout(SessionController::STREAM_REPLY, oldTimeout);
+
+        // stream-message, which is written directly into the send-memory
+        Session::MessageReservation reservation = session->reserveMessage(staticTestString.size());
+        memcpy(reservation.payload, staticTestString.c_str(), staticTestString.size());
+        ret = session->commitStreamData(reservation, staticTestString.size());
+        Session_Test::m_instance->compare(ret,  true);
+        const bool isReleased = reservation.buffer == nullptr;
+        Session_Test::m_instance->compare(isReleased,  true);
+
+        // coalesced stream-message
+        const std::string dynamicTestString = Session_Test::m_instance->m_dynamicMessage;
+        Session_Test::m_instance->compare(session->setStreamCoalescing(4096, 1000), true);
+        ret = session->sendStreamData(dynamicTestString.c_str(),
+                                      dynamicTestString.size());
+        Session_Test::m_instance->compare(ret,  true);
+        Session_Test::m_instance->compare(session->flushStreamData(), true);
+        Session_Test::m_instance->compare(session->getCoalescingStats().numberOfFrames,
+                                          (uint64_t)1);
+        Session_Test::m_instance->compare(session->setStreamCoalescing(0, 0), true);
+
         // singleblock-message
         const std::string singleblockTestString = Session_Test::m_instance->m_singleBlockMessage;
         ret = session->sendStandaloneData(singleblockTestString.c_str(),
                                           singleblockTestString.size());
         Session_Test::m_instance->compare(ret,  true);
 
-        // multiblock-message
+        // bigger singleblock-message, which is compressed
         const std::string multiblockTestString = Session_Test::m_instance->m_multiBlockMessage;
         ret = session->sendStandaloneData(multiblockTestString.c_str(),
                                           multiblockTestString.size());
         Session_Test::m_instance->compare(ret,  true);
+
+        // only the bigger singleblock-message was above the threshold of the compression
+        const Session::CompressionStats compressionStats = session->getCompressionStats();
+        Session_Test::m_instance->compare(compressionStats.numberOfCompressions, (uint64_t)1);
+        Session_Test::m_instance->compare(compressionStats.uncompressedSendBytes,
+                                          (uint64_t)multiblockTestString.size());
+        const bool isCompressed = compressionStats.compressedSendBytes > 0
+                                  && compressionStats.compressedSendBytes
+                                     < compressionStats.uncompressedSendBytes;
+        Session_Test::m_instance->compare(isCompressed, true);
+        Session_Test::m_instance->compare(compressionStats.numberOfDecompressions, (uint64_t)0);
+
+        // multiblock-message with more parts than the window of unacknowledged parts, which is
+        // delivered part by part to the part-callback of the server
+        const std::string* chunkedTestString = &Session_Test::m_instance->m_chunkedMessage;
+        ret = session->sendStandaloneData(chunkedTestString->c_str(),
+                                          chunkedTestString->size());
+        Session_Test::m_instance->compare(ret,  true);
+
+        // singleblock-message without copy, which is send synchronously
+        const std::string* noCopyTestString = &Session_Test::m_instance->m_multiBlockMessage;
+        ret = session->sendStandaloneDataNoCopy(noCopyTestString->c_str(),
+                                                noCopyTestString->size(),
+                                                &completionCallback);
+        Session_Test::m_instance->compare(ret,  true);
+        Session_Test::m_instance->compare(Session_Test::m_instance->m_numberOfCompletions.load(),
+                                          (uint32_t)1);
+
+        // multiblock-message without copy, where the memory must be valid until completion
+        ret = session->sendStandaloneDataNoCopy(chunkedTestString->c_str(),
+                                                chunkedTestString->size(),
+                                                &completionCallback);
+        Session_Test::m_instance->compare(ret,  true);
+
+        // complete file by its path
+        const std::string filePath = Session_Test::m_instance->m_testFilePath;
+        ret = session->sendFile(filePath);
+        Session_Test::m_instance->compare(ret,  true);
+
+        // rest of the file by its file-descriptor, from an offset, which is not page-aligned
+        // but keeps the pattern of the content
+        const int fileDescriptor = open(filePath.c_str(), O_RDONLY);
+        ret = session->sendFile(fileDescriptor, 26 * 1000);
+        close(fileDescriptor);
+        Session_Test::m_instance->compare(ret,  true);
+
+        // range behind the end of the file
+        const uint64_t invalidId = session->sendFile(filePath, chunkedTestString->size(), 1);
+        Session_Test::m_instance->compare(invalidId,  (uint64_t)0);
+
+        // aborted before the receiver has accepted it, so the memory is given back with failure
+        const uint64_t abortedId = session->sendStandaloneDataNoCopy(chunkedTestString->c_str(),
+                                                                     chunkedTestString->size(),
+                                                                     &completionCallback);
+        Session_Test::m_instance->compare(abortedId == 0,  false);
+        session->abortMessages(abortedId);
+
+        // aborted file, whose mapping has to be removed
+        const uint64_t abortedFileId = session->sendFile(filePath);
+        Session_Test::m_instance->compare(abortedFileId == 0,  false);
+        session->abortMessages(abortedFileId);
     }
 }
 
@@ -164,6 +356,7 @@ Session_Test::initTestCase()
 {
     m_staticMessage = "hello!!! (static)";
     m_dynamicMessage = "hello!!! (dynamic)";
+    m_slowMessage = "hello!!! (slow reply)";
     m_singleBlockMessage ="------------------------------------------------------------------------"
                           "-------------------------------------#----------------------------------"
                           "------------------------------------------------------------------------"
@@ -221,6 +414,24 @@ Session_Test::initTestCase()
                           "-----------#------------------------------------------------------------"
                           "-------------------------------------------------#----------------------"
                           "-----#";
+
+    // more parts than the window of unacknowledged parts and an incomplete last part
+    const uint64_t chunkedSize = (MULTIBLOCK_PART_WINDOW + 8) * MAX_SINGLE_MESSAGE_SIZE + 1000;
+    m_chunkedMessage.resize(chunkedSize);
+    for(uint64_t i = 0; i < chunkedSize; i++) {
+        m_chunkedMessage[i] = static_cast<char>('a' + i % 26);
+    }
+    m_numberOfChunkedMessages = 0;
+    m_numberOfCompletions = 0;
+    m_numberOfTimeouts = 0;
+    m_numberOfFailedCompletions = 0;
+
+    // file with the same content
+    m_testFilePath = "/tmp/libKitsunemimiSakuraNetwork_session_test_"
+                     + std::to_string(getpid());
+    std::ofstream testFile(m_testFilePath, std::ios::binary | std::ios::trunc);
+    testFile.write(m_chunkedMessage.c_str(), static_cast<std::streamsize>(chunkedSize));
+    testFile.close();
 }
 
 /**
@@ -233,10 +444,70 @@ Session_Test::runTest()
                                                             &sessionCloseCallback,
                                                             &errorCallback);
 
+    // trigger callbacks of standalone-messages by worker-threads
+    TEST_EQUAL(m_controller->startCallbackDispatcher(2), true);
+    TEST_EQUAL(m_controller->startCallbackDispatcher(2), false);
+
+    // send multiblock-messages of all sessions by shared loop-threads
+    TEST_EQUAL(m_controller->startIoEngine(2), true);
+    TEST_EQUAL(m_controller->startIoEngine(2), false);
+    TEST_EQUAL(m_controller->getIoEngineStats().numberOfLoops, 2);
+
+    // sessions can only be taken out of existing pools
+    SessionTarget poolTarget;
+    poolTarget.address = "127.0.0.1";
+    poolTarget.port = 1234;
+    TEST_EQUAL(m_controller->addSessionPool(poolTarget, 0), false);
+    const bool noPoolSession = m_controller->acquireSession(poolTarget) == nullptr;
+    TEST_EQUAL(noPoolSession, true);
+    TEST_EQUAL(m_controller->removeSessionPool(poolTarget), false);
+    TEST_EQUAL(m_controller->getSessionPoolStats().numberOfPools, (uint64_t)0);
+
+    // timeouts only for messages, which have replies
+    TEST_EQUAL(m_controller->getReplyTimeout(SessionController::STREAM_REPLY), (uint32_t)2000);
+    TEST_EQUAL(m_controller->setReplyTimeout(ERROR_TYPE, 1000), false);
+    TEST_EQUAL(m_controller->getReplyTimeout(ERROR_TYPE), (uint32_t)0);
+    TEST_EQUAL(m_controller->setReplyTimeout(SessionController::SINGLEBLOCK_REPLY, 0), true);
+    TEST_EQUAL(m_controller->getReplyTimeout(SessionController::SINGLEBLOCK_REPLY), (uint32_t)100);
+    TEST_EQUAL(m_controller->setReplyTimeout(SessionController::SINGLEBLOCK_REPLY, 2000), true);
+
+    // affinity for a server, which doesn't exist
+    AffinityPolicy serverAffinity;
+    serverAffinity.cores.push_back(0);
+    TEST_EQUAL(m_controller->setServerAffinity(42, serverAffinity), false);
+
+    // compress payloads bigger than the singleblock-test-message
+    m_controller->setCompression(true, 1024);
+
+    // send stream-messages only with credits of the receiver
+    m_controller->setStreamFlowControl(true);
+
+    // check the integrity of all messages
+    m_controller->setPayloadChecksum(true);
+
     TEST_EQUAL(m_controller->addTcpServer(1234), 1);
     bool isNullptr = m_controller->startTcpSession("127.0.0.1", 1234, "test") == nullptr;
     TEST_EQUAL(isNullptr, false);
 
+    // wait until the chunk-streamed messages are complete, before the session is closed
+    for(uint32_t i = 0; i < 1000 && m_numberOfChunkedMessages < 4; i++) {
+        usleep(10000);
+    }
+    TEST_EQUAL(m_numberOfChunkedMessages.load(), (uint32_t)4);
+    TEST_EQUAL(m_completeChunkedSizes.size(), (uint64_t)4);
+
+    // the part of the file behind the offset is the only message with another size
+    uint32_t numberOfCompleteSizes = 0;
+    for(uint64_t i = 0; i < m_completeChunkedSizes.size(); i++)
+    {
+        if(m_completeChunkedSizes[i] == m_chunkedMessage.size()) {
+            numberOfCompleteSizes++;
+        } else {
+            TEST_EQUAL(m_completeChunkedSizes[i], m_chunkedMessage.size() - 26 * 1000);
+        }
+    }
+    TEST_EQUAL(numberOfCompleteSizes, (uint32_t)3);
+
     TEST_EQUAL(m_controller->getSession(131073)->closeSession(), true);
     const bool isNull = m_controller->getSession(131073) == nullptr;
     TEST_EQUAL(isNull, true);
@@ -245,6 +516,24 @@ Session_Test::runTest()
 
     TEST_EQUAL(m_numberOfInitSessions, 2);
     TEST_EQUAL(m_numberOfEndSessions, 2);
+    TEST_EQUAL(m_numberOfCompletions.load(), (uint32_t)2);
+    TEST_EQUAL(m_numberOfFailedCompletions.load(), (uint32_t)1);
+
+    // the mappings of finished and aborted files were removed
+    TEST_EQUAL(isFileMapped(m_testFilePath), false);
+    unlink(m_testFilePath.c_str());
+
+    // received buffers were given back to the pool
+    const bool buffersInPool = m_controller->getBufferPoolStats().bytesHeld > 0;
+    TEST_EQUAL(buffersInPool, true);
+
+    // both sides of the test are within this process, so all send messages were received too
+    const SessionMetrics metrics = m_controller->getGlobalMetrics();
+    TEST_EQUAL(metrics.sendMessages[STREAM_DATA_TYPE], metrics.receivedMessages[STREAM_DATA_TYPE]);
+    const bool singleblockCounted = metrics.sendMessages[SINGLEBLOCK_DATA_TYPE] > 0;
+    TEST_EQUAL(singleblockCounted, true);
+    TEST_EQUAL(metrics.numberOfTimeouts, 1);
+    TEST_EQUAL(m_numberOfTimeouts.load(), (uint32_t)1);
 
     delete m_controller;
 }
@@ -24,6 +24,9 @@
 #define SESSION_TEST_H
 
 #include <iostream>
+#include <atomic>
+#include <map>
+#include <vector>
 #include <libKitsunemimiPersistence/logger/logger.h>
 #include <libKitsunemimiSakuraNetwork/session_controller.h>
 #include <handler/session_handler.h>
@@ -58,9 +61,23 @@ public:
     std::string m_dynamicMessage = "";
     std::string m_singleBlockMessage = "";
     std::string m_multiBlockMessage = "";
+    std::string m_chunkedMessage = "";
+    std::string m_slowMessage = "";
+
+    // state of the chunk-streamed messages, which is only changed by the receiving thread
+    std::map<uint64_t, uint64_t> m_chunkedOffsets;
+    std::map<uint64_t, uint32_t> m_chunkedParts;
+    std::vector<uint64_t> m_completeChunkedSizes;
+    std::atomic<uint32_t> m_numberOfChunkedMessages;
+
+    // file, which is send from a memory-mapping
+    std::string m_testFilePath = "";
+    std::atomic<uint32_t> m_numberOfFailedCompletions;
 
     uint32_t m_numberOfInitSessions = 0;
     uint32_t m_numberOfEndSessions = 0;
+    std::atomic<uint32_t> m_numberOfCompletions;
+    std::atomic<uint32_t> m_numberOfTimeouts;
 };
 
 } // namespace Sakura
@@ -0,0 +1,232 @@
+/**
+ * @file       shared_memory_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include "shared_memory_test.h"
+
+#include <iostream>
+#include <unistd.h>
+
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+// stream-messages are send until more than two whole rings were written, so some of them are
+// wrapped around the end of the ring with 2 MiB
+#define SHM_TEST_STREAM_SIZE 100000
+#define SHM_TEST_NUMBER_OF_STREAMS 50
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+Kitsunemimi::Sakura::SharedMemory_Test* SharedMemory_Test::m_instance = nullptr;
+
+/**
+ * @brief streamDataCallback, which checks, that each stream-message is complete and in order
+ */
+void shmTestStreamCallback(Session*,
+                           const void* data,
+                           const uint64_t dataSize)
+{
+    SharedMemory_Test* test = SharedMemory_Test::m_instance;
+    const uint32_t index = test->m_numberOfStreamMessages.fetch_add(1);
+    const char expected = static_cast<char>('a' + index % 26);
+    const char* payload = static_cast<const char*>(data);
+
+    bool isBroken = dataSize != SHM_TEST_STREAM_SIZE;
+    for(uint64_t i = 0; i < dataSize && isBroken == false; i++) {
+        isBroken = payload[i] != expected;
+    }
+
+    if(isBroken) {
+        test->m_numberOfBrokenStreamMessages++;
+    }
+}
+
+/**
+ * @brief standaloneDataCallback
+ */
+void shmTestStandaloneCallback(Session* session,
+                               const uint64_t,
+                               DataBuffer* data)
+{
+    SharedMemory_Test* test = SharedMemory_Test::m_instance;
+    const std::string receivedMessage(static_cast<const char*>(data->data),
+                                      data->bufferPosition);
+    test->compare(receivedMessage, test->m_multiblockMessage);
+    test->m_numberOfMultiblockMessages++;
+
+    session->releaseBuffer(data);
+}
+
+/**
+ * @brief sessionCreateCallback
+ */
+void shmTestCreateCallback(Session* session,
+                           const std::string)
+{
+    session->setStreamMessageCallback(&shmTestStreamCallback);
+    session->setStandaloneMessageCallback(&shmTestStandaloneCallback);
+
+    if(session->isClientSide() == false) {
+        SharedMemory_Test::m_instance->m_serverSession = session;
+    }
+}
+
+/**
+ * @brief sessionCloseCallback
+ */
+void shmTestCloseCallback(Session* session,
+                          const std::string)
+{
+    if(session->isClientSide()) {
+        SharedMemory_Test::m_instance->m_numberOfClientCloses++;
+    } else {
+        SharedMemory_Test::m_instance->m_numberOfServerCloses++;
+    }
+}
+
+/**
+ * @brief errorCallback
+ */
+void shmTestErrorCallback(Session*,
+                          const uint8_t,
+                          const std::string message)
+{
+    std::cout<<"ERROR: "<<message<<std::endl;
+}
+
+/**
+ * @brief SharedMemory_Test::SharedMemory_Test
+ */
+SharedMemory_Test::SharedMemory_Test() :
+    Kitsunemimi::CompareTestHelper("SharedMemory_Test")
+{
+    SharedMemory_Test::m_instance = this;
+    m_serverSession = nullptr;
+    m_numberOfStreamMessages = 0;
+    m_numberOfBrokenStreamMessages = 0;
+    m_numberOfMultiblockMessages = 0;
+    m_numberOfClientCloses = 0;
+    m_numberOfServerCloses = 0;
+
+    // multiblock-message bigger than each single message within the ring
+    for(uint32_t i = 0; i < 5000; i++) {
+        m_multiblockMessage += "shared-memory-multiblock-message-" + std::to_string(i) + "-";
+    }
+
+    runTest();
+}
+
+/**
+ * @brief runTest
+ */
+void
+SharedMemory_Test::runTest()
+{
+    const std::string socketFile = "/tmp/sakura_shared_memory_test.sock";
+    unlink(socketFile.c_str());
+
+    SessionController* controller = new SessionController(&shmTestCreateCallback,
+                                                          &shmTestCloseCallback,
+                                                          &shmTestErrorCallback);
+
+    TEST_EQUAL(controller->addSharedMemoryServer(socketFile), 1);
+
+    //==============================================================================================
+    // data-transfer and close by the client
+    //==============================================================================================
+    Session* session = controller->startSharedMemorySession(socketFile, "shm");
+    bool isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr)
+    {
+        delete controller;
+        return;
+    }
+
+    const std::string streamChars = "abcdefghijklmnopqrstuvwxyz";
+    for(uint32_t i = 0; i < SHM_TEST_NUMBER_OF_STREAMS; i++)
+    {
+        const std::string payload(SHM_TEST_STREAM_SIZE, streamChars[i % 26]);
+        TEST_EQUAL(session->sendStreamData(payload.c_str(), payload.size()), true);
+    }
+
+    const bool isMultiblock = m_multiblockMessage.size() > 128*1024;
+    TEST_EQUAL(isMultiblock, true);
+    const uint64_t multiblockId = session->sendStandaloneData(m_multiblockMessage.c_str(),
+                                                              m_multiblockMessage.size());
+    const bool isSend = multiblockId != 0;
+    TEST_EQUAL(isSend, true);
+
+    for(uint32_t i = 0; i < 1000 && (m_numberOfStreamMessages < SHM_TEST_NUMBER_OF_STREAMS
+                                     || m_numberOfMultiblockMessages < 1); i++)
+    {
+        usleep(10000);
+    }
+
+    TEST_EQUAL(m_numberOfStreamMessages.load(), (uint32_t)SHM_TEST_NUMBER_OF_STREAMS);
+    TEST_EQUAL(m_numberOfBrokenStreamMessages.load(), (uint32_t)0);
+    TEST_EQUAL(m_numberOfMultiblockMessages.load(), (uint32_t)1);
+
+    TEST_EQUAL(session->closeSession(), true);
+    for(uint32_t i = 0; i < 100 && m_numberOfServerCloses < 1; i++) {
+        usleep(10000);
+    }
+    TEST_EQUAL(m_numberOfClientCloses.load(), (uint32_t)1);
+    TEST_EQUAL(m_numberOfServerCloses.load(), (uint32_t)1);
+
+    //==============================================================================================
+    // close by the server
+    //==============================================================================================
+    m_serverSession = nullptr;
+    session = controller->startSharedMemorySession(socketFile, "shm");
+    for(uint32_t i = 0; i < 100 && m_serverSession == nullptr; i++) {
+        usleep(10000);
+    }
+
+    Session* serverSession = m_serverSession;
+    isNullptr = session == nullptr || serverSession == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr)
+    {
+        delete controller;
+        return;
+    }
+
+    TEST_EQUAL(serverSession->closeSession(), true);
+    for(uint32_t i = 0; i < 100 && m_numberOfClientCloses < 2; i++) {
+        usleep(10000);
+    }
+    TEST_EQUAL(m_numberOfServerCloses.load(), (uint32_t)2);
+    TEST_EQUAL(m_numberOfClientCloses.load(), (uint32_t)2);
+
+    // the client-side can not send anymore after the close by the other side
+    TEST_EQUAL(session->sendStreamData("closed", 6), false);
+
+    delete controller;
+    unlink(socketFile.c_str());
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,67 @@
+/**
+ * @file       shared_memory_test.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef SHARED_MEMORY_TEST_H
+#define SHARED_MEMORY_TEST_H
+
+#include <atomic>
+#include <string>
+
+#include <libKitsunemimiCommon/test_helper/compare_test_helper.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+
+class SharedMemory_Test
+        : public Kitsunemimi::CompareTestHelper
+{
+public:
+    SharedMemory_Test();
+
+    void runTest();
+
+    template<typename  T>
+    void compare(T isValue, T shouldValue)
+    {
+        TEST_EQUAL(isValue, shouldValue);
+    }
+
+    static SharedMemory_Test* m_instance;
+
+    std::string m_multiblockMessage = "";
+    std::atomic<Session*> m_serverSession;
+
+    std::atomic<uint32_t> m_numberOfStreamMessages;
+    std::atomic<uint32_t> m_numberOfBrokenStreamMessages;
+    std::atomic<uint32_t> m_numberOfMultiblockMessages;
+    std::atomic<uint32_t> m_numberOfClientCloses;
+    std::atomic<uint32_t> m_numberOfServerCloses;
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // SHARED_MEMORY_TEST_H
@@ -0,0 +1,237 @@
+/**
+ * @file       stream_batch_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include "stream_batch_test.h"
+
+#include <iostream>
+#include <unistd.h>
+
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+Kitsunemimi::Sakura::StreamBatch_Test* StreamBatch_Test::m_instance = nullptr;
+
+/**
+ * @brief streamBatchCallback
+ */
+void streamBatchCallback(Session*,
+                         const Session::StreamSpan* spans,
+                         const uint64_t numberOfSpans)
+{
+    StreamBatch_Test* test = StreamBatch_Test::m_instance;
+    test->m_numberOfBatches++;
+
+    for(uint64_t i = 0; i < numberOfSpans; i++)
+    {
+        test->m_numberOfBatchMessages++;
+        test->addReceivedMessage(std::string(static_cast<const char*>(spans[i].data),
+                                             spans[i].size));
+    }
+}
+
+/**
+ * @brief streamDataCallback, which is only used without batch-callback
+ */
+void batchTestStreamCallback(Session*,
+                             const void* data,
+                             const uint64_t dataSize)
+{
+    StreamBatch_Test::m_instance->m_numberOfSingleMessages++;
+    StreamBatch_Test::m_instance->addReceivedMessage(std::string(static_cast<const char*>(data),
+                                                                 dataSize));
+}
+
+/**
+ * @brief standaloneDataCallback
+ */
+void batchTestStandaloneCallback(Session* session,
+                                 const uint64_t,
+                                 DataBuffer* data)
+{
+    StreamBatch_Test::m_instance->addReceivedMessage(
+                std::string(static_cast<const char*>(data->data), data->bufferPosition));
+    session->releaseBuffer(data);
+}
+
+/**
+ * @brief sessionCreateCallback
+ */
+void batchTestCreateCallback(Session* session,
+                             const std::string)
+{
+    if(session->isClientSide() == false)
+    {
+        session->setStreamMessageCallback(&batchTestStreamCallback);
+        session->setStreamBatchCallback(&streamBatchCallback);
+        session->setStandaloneMessageCallback(&batchTestStandaloneCallback);
+        StreamBatch_Test::m_instance->m_serverSession = session;
+    }
+}
+
+/**
+ * @brief sessionCloseCallback
+ */
+void batchTestCloseCallback(Session*,
+                            const std::string)
+{
+}
+
+/**
+ * @brief errorCallback
+ */
+void batchTestErrorCallback(Session*,
+                            const uint8_t,
+                            const std::string message)
+{
+    std::cout<<"ERROR: "<<message<<std::endl;
+}
+
+/**
+ * @brief StreamBatch_Test::StreamBatch_Test
+ */
+StreamBatch_Test::StreamBatch_Test() :
+    Kitsunemimi::CompareTestHelper("StreamBatch_Test")
+{
+    StreamBatch_Test::m_instance = this;
+    m_serverSession = nullptr;
+
+    runTest();
+}
+
+/**
+ * @brief runTest
+ */
+void
+StreamBatch_Test::runTest()
+{
+    SessionController* controller = new SessionController(&batchTestCreateCallback,
+                                                          &batchTestCloseCallback,
+                                                          &batchTestErrorCallback);
+
+    TEST_EQUAL(controller->addTcpServer(1236), 1);
+    Session* session = controller->startTcpSession("127.0.0.1", 1236, "batch");
+    const bool isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr)
+    {
+        delete controller;
+        return;
+    }
+
+    // stream-messages before and after a standalone-message, which must be delivered between
+    // the batches, because it is also processed by the receiving thread
+    const std::vector<std::string> messages = {"stream-1",
+                                               "stream-22",
+                                               "stream-333",
+                                               "standalone-1",
+                                               "stream-4444",
+                                               "stream-55555"};
+    for(uint64_t i = 0; i < messages.size(); i++)
+    {
+        bool ret = false;
+        if(messages[i].find("standalone") == 0)
+        {
+            ret = session->sendStandaloneData(messages[i].c_str(), messages[i].size()) != 0;
+        }
+        else
+        {
+            ret = session->sendStreamData(messages[i].c_str(), messages[i].size());
+        }
+        TEST_EQUAL(ret, true);
+    }
+
+    for(uint32_t i = 0; i < 500 && getNumberOfReceivedMessages() < messages.size(); i++) {
+        usleep(10000);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_receivedMutex);
+        TEST_EQUAL(m_receivedMessages.size(), messages.size());
+        for(uint64_t i = 0; i < m_receivedMessages.size() && i < messages.size(); i++) {
+            TEST_EQUAL(m_receivedMessages[i], messages[i]);
+        }
+
+        // all stream-messages were given to the batch-callback with at least two calls, because
+        // the standalone-message is between them
+        TEST_EQUAL(m_numberOfBatchMessages, (uint32_t)5);
+        const bool batchesInRange = m_numberOfBatches >= 2 && m_numberOfBatches <= 5;
+        TEST_EQUAL(batchesInRange, true);
+        TEST_EQUAL(m_numberOfSingleMessages, (uint32_t)0);
+    }
+
+    // without batch-callback the single stream-callback is used again
+    Session* serverSession = m_serverSession;
+    const bool noServerSession = serverSession == nullptr;
+    TEST_EQUAL(noServerSession, false);
+    if(noServerSession == false)
+    {
+        serverSession->setStreamBatchCallback(nullptr);
+        TEST_EQUAL(session->sendStreamData("stream-single", 13), true);
+        for(uint32_t i = 0; i < 500 && getNumberOfReceivedMessages() < messages.size() + 1; i++) {
+            usleep(10000);
+        }
+
+        std::unique_lock<std::mutex> lock(m_receivedMutex);
+        TEST_EQUAL(m_receivedMessages.size(), messages.size() + 1);
+        TEST_EQUAL(m_receivedMessages.back(), std::string("stream-single"));
+        TEST_EQUAL(m_numberOfSingleMessages, (uint32_t)1);
+        TEST_EQUAL(m_numberOfBatchMessages, (uint32_t)5);
+    }
+
+    TEST_EQUAL(session->closeSession(), true);
+    usleep(100000);
+
+    delete controller;
+}
+
+/**
+ * @brief add a payload to the list of received messages
+ *
+ * @param message received payload
+ */
+void
+StreamBatch_Test::addReceivedMessage(const std::string &message)
+{
+    std::unique_lock<std::mutex> lock(m_receivedMutex);
+    m_receivedMessages.push_back(message);
+}
+
+/**
+ * @brief get number of received messages
+ *
+ * @return number of messages
+ */
+uint64_t
+StreamBatch_Test::getNumberOfReceivedMessages()
+{
+    std::unique_lock<std::mutex> lock(m_receivedMutex);
+    return m_receivedMessages.size();
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
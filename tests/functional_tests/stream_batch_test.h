@@ -0,0 +1,72 @@
+/**
+ * @file       stream_batch_test.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef STREAM_BATCH_TEST_H
+#define STREAM_BATCH_TEST_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <libKitsunemimiCommon/test_helper/compare_test_helper.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+
+class StreamBatch_Test
+        : public Kitsunemimi::CompareTestHelper
+{
+public:
+    StreamBatch_Test();
+
+    void runTest();
+
+    template<typename  T>
+    void compare(T isValue, T shouldValue)
+    {
+        TEST_EQUAL(isValue, shouldValue);
+    }
+
+    static StreamBatch_Test* m_instance;
+
+    std::atomic<Session*> m_serverSession;
+
+    // all payloads of the server-side in the order of their callbacks
+    std::mutex m_receivedMutex;
+    std::vector<std::string> m_receivedMessages;
+    uint32_t m_numberOfBatches = 0;
+    uint32_t m_numberOfBatchMessages = 0;
+    uint32_t m_numberOfSingleMessages = 0;
+
+    void addReceivedMessage(const std::string &message);
+    uint64_t getNumberOfReceivedMessages();
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // STREAM_BATCH_TEST_H
@@ -0,0 +1,179 @@
+/**
+ * @file       stripe_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include "stripe_test.h"
+
+#include <iostream>
+#include <unistd.h>
+#include <message_definitions.h>
+
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+Kitsunemimi::Sakura::Stripe_Test* Stripe_Test::m_instance = nullptr;
+
+/**
+ * @brief standaloneDataCallback, which gets the parts of all connections as one message
+ */
+void stripeStandaloneCallback(Session* session,
+                              const uint64_t,
+                              DataBuffer* data)
+{
+    std::string receivedMessage(static_cast<const char*>(data->data), data->bufferPosition);
+    Stripe_Test::m_instance->compare(receivedMessage.size(),
+                                     Stripe_Test::m_instance->m_message.size());
+    Stripe_Test::m_instance->compare(receivedMessage, Stripe_Test::m_instance->m_message);
+    Stripe_Test::m_instance->m_numberOfMessages++;
+
+    session->releaseBuffer(data);
+}
+
+/**
+ * @brief sessionCreateCallback, which is only called for the primary connection
+ */
+void stripeCreateCallback(Session* session,
+                          const std::string sessionIdentifier)
+{
+    Stripe_Test::m_instance->compare(sessionIdentifier, std::string("stripe"));
+    if(session->isClientSide() == false)
+    {
+        session->setStandaloneMessageCallback(&stripeStandaloneCallback);
+        Stripe_Test::m_instance->m_serverSession = session;
+    }
+}
+
+/**
+ * @brief sessionCloseCallback
+ */
+void stripeCloseCallback(Session*,
+                         const std::string)
+{
+}
+
+/**
+ * @brief errorCallback
+ */
+void stripeErrorCallback(Session*,
+                         const uint8_t,
+                         const std::string message)
+{
+    std::cout<<"ERROR: "<<message<<std::endl;
+}
+
+/**
+ * @brief Stripe_Test::Stripe_Test
+ */
+Stripe_Test::Stripe_Test() :
+    Kitsunemimi::CompareTestHelper("Stripe_Test")
+{
+    Stripe_Test::m_instance = this;
+
+    initTestCase();
+    runTest();
+}
+
+/**
+ * @brief initTestCase
+ */
+void
+Stripe_Test::initTestCase()
+{
+    // more parts than connections and an incomplete last part
+    const uint64_t messageSize = 12 * MAX_SINGLE_MESSAGE_SIZE + 500;
+    m_message.resize(messageSize);
+    for(uint64_t i = 0; i < messageSize; i++) {
+        m_message[i] = static_cast<char>('a' + (i / 7) % 26);
+    }
+
+    m_serverSession = nullptr;
+    m_numberOfMessages = 0;
+}
+
+/**
+ * @brief runTest
+ */
+void
+Stripe_Test::runTest()
+{
+    SessionController* controller = new SessionController(&stripeCreateCallback,
+                                                          &stripeCloseCallback,
+                                                          &stripeErrorCallback);
+
+    TEST_EQUAL(controller->addTcpServer(1235), 1);
+    Session* session = controller->startTcpSession("127.0.0.1", 1235, "stripe", 3);
+    const bool isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr)
+    {
+        delete controller;
+        return;
+    }
+
+    // the additional connections are confirmed by the server, before the session is given out
+    TEST_EQUAL(session->getNumberOfStripes(), (uint32_t)2);
+    TEST_EQUAL(session->getStripeStats().size(), (uint64_t)3);
+
+    const bool isSend = session->sendStandaloneData(m_message.c_str(), m_message.size()) != 0;
+    TEST_EQUAL(isSend, true);
+    for(uint32_t i = 0; i < 1000 && m_numberOfMessages < 1; i++) {
+        usleep(10000);
+    }
+    TEST_EQUAL(m_numberOfMessages.load(), (uint32_t)1);
+
+    // the parts were distributed round-robin over all connections
+    const std::vector<Session::StripeStats> clientStats = session->getStripeStats();
+    for(uint64_t i = 0; i < clientStats.size(); i++)
+    {
+        const bool partsSend = clientStats[i].sendBytes >= 4 * MAX_SINGLE_MESSAGE_SIZE;
+        TEST_EQUAL(partsSend, true);
+    }
+
+    // the server knows all connections of the session too
+    Session* serverSession = m_serverSession;
+    const bool noServerSession = serverSession == nullptr;
+    TEST_EQUAL(noServerSession, false);
+    if(noServerSession == false)
+    {
+        TEST_EQUAL(serverSession->getNumberOfStripes(), (uint32_t)2);
+        const std::vector<Session::StripeStats> serverStats = serverSession->getStripeStats();
+        TEST_EQUAL(serverStats.size(), (uint64_t)3);
+        for(uint64_t i = 0; i < serverStats.size(); i++)
+        {
+            const bool partsReceived = serverStats[i].receivedBytes >= 4 * MAX_SINGLE_MESSAGE_SIZE;
+            TEST_EQUAL(partsReceived, true);
+        }
+    }
+
+    TEST_EQUAL(session->closeSession(), true);
+    usleep(100000);
+
+    delete controller;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
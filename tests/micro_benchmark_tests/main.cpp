@@ -0,0 +1,60 @@
+/**
+ * @file    main.cpp
+ *
+ * @author  Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <libKitsunemimiArgs/arg_parser.h>
+#include <micro_benchmark.h>
+
+int main(int argc, char *argv[])
+{
+    Kitsunemimi::Args::ArgParser argParser;
+
+    argParser.registerInteger("iterations,i",
+                              "number of messages for each benchmark (Default: 1000000)");
+    argParser.registerString("filter,f",
+                             "run only benchmarks, which contain this string within their name");
+
+    bool ret = argParser.parse(argc, argv);
+    if(ret == false) {
+        return 1;
+    }
+
+    long iterations = 1000000;
+    std::string filter = "";
+
+    if(argParser.wasSet("iterations")) {
+        iterations = argParser.getIntValues("iterations").at(0);
+    }
+    if(argParser.wasSet("filter")) {
+        filter = argParser.getStringValues("filter").at(0);
+    }
+
+    if(iterations < 1)
+    {
+        std::cout<<"ERROR: number of iterations must be at least 1."<<std::endl;
+        return 1;
+    }
+
+    Kitsunemimi::Sakura::MicroBenchmark benchmark(static_cast<uint64_t>(iterations), filter);
+    benchmark.runAll();
+
+    return 0;
+}
@@ -0,0 +1,400 @@
+/**
+ * @file    micro_benchmark.cpp
+ *
+ * @author  Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include "micro_benchmark.h"
+#include <fake_socket.h>
+
+#include <chrono>
+
+#include <callbacks.h>
+#include <multiblock_io.h>
+#include <handler/session_handler.h>
+#include <handler/reply_handler.h>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+
+#include <libKitsunemimiCommon/common_items/table_item.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+// prevent, that the compiler removes the benchmarked calls
+volatile uint64_t g_benchmarkSink = 0;
+
+/**
+ * @brief callbacks, which do nothing, to measure only the library
+ */
+void
+benchmarkStreamCallback(Session*,
+                        const void*,
+                        const uint64_t dataSize)
+{
+    g_benchmarkSink = dataSize;
+}
+
+void
+benchmarkStreamBatchCallback(Session*,
+                             const Session::StreamSpan* spans,
+                             const uint64_t numberOfSpans)
+{
+    g_benchmarkSink = spans[numberOfSpans - 1].size;
+}
+
+void
+benchmarkSessionCallback(Session*,
+                         const std::string)
+{
+}
+
+void
+benchmarkErrorCallback(Session*,
+                       const uint8_t,
+                       const std::string message)
+{
+    std::cout<<"ERROR: "<<message<<std::endl;
+}
+
+/**
+ * @brief get current time for the measurement
+ *
+ * @return time of the steady-clock in nanoseconds
+ */
+inline uint64_t
+getNanoTime()
+{
+    const std::chrono::steady_clock::duration now =
+            std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+/**
+ * @brief constructor, which creates a ready session on top of an in-memory socket and prepares
+ *        the incoming messages for the decode-benchmarks
+ *
+ * @param iterations number of messages per benchmark
+ * @param filter only benchmarks, which contain this string within their name, are executed
+ */
+MicroBenchmark::MicroBenchmark(const uint64_t iterations,
+                               const std::string &filter)
+{
+    m_iterations = iterations;
+    m_filter = filter;
+    memset(m_payload, 0, sizeof(m_payload));
+
+    m_controller = new SessionController(&benchmarkSessionCallback,
+                                         &benchmarkSessionCallback,
+                                         &benchmarkErrorCallback);
+
+    // session is never closed, because the fake-socket has no connection to close
+    m_socket = new FakeSocket();
+    m_session = new Session(m_socket);
+    SessionHandler::m_sessionHandler->addSession(1, m_session);
+    m_session->connectiSession(1);
+    m_session->makeSessionReady(1, "micro-benchmark");
+    m_session->setHeartbeat(0, 0);
+    m_session->setStreamMessageCallback(&benchmarkStreamCallback);
+
+    // separate handler without timer-thread, so the entries are never removed by timeouts
+    m_replyHandler = new ReplyHandler();
+
+    // incoming stream-message with 128 byte payload
+    Data_Stream_Header streamHeader;
+    streamHeader.commonHeader.sessionId = 1;
+    streamHeader.commonHeader.messageId = 1;
+    streamHeader.commonHeader.payloadSize = 128;
+    streamHeader.commonHeader.totalMessageSize = sizeof(Data_Stream_Header)
+                                                 + 128
+                                                 + sizeof(CommonMessageFooter);
+    CommonMessageFooter footer;
+    addData_RingBuffer(m_streamMessage, &streamHeader, sizeof(Data_Stream_Header));
+    addData_RingBuffer(m_streamMessage, m_payload, 128);
+    addData_RingBuffer(m_streamMessage, &footer, sizeof(CommonMessageFooter));
+
+    // the same stream-message multiple times for the batched processing
+    for(uint32_t i = 0; i < STREAM_BATCH_SIZE; i++)
+    {
+        addData_RingBuffer(m_streamMessages, &streamHeader, sizeof(Data_Stream_Header));
+        addData_RingBuffer(m_streamMessages, m_payload, 128);
+        addData_RingBuffer(m_streamMessages, &footer, sizeof(CommonMessageFooter));
+    }
+
+    // incoming heartbeat-reply
+    Heartbeat_Reply_Message heartbeatReply;
+    heartbeatReply.commonHeader.sessionId = 1;
+    heartbeatReply.commonHeader.messageId = 1;
+    addData_RingBuffer(m_heartbeatReplyMessage, &heartbeatReply, sizeof(heartbeatReply));
+}
+
+/**
+ * @brief run all benchmarks, which match the filter, and print the results
+ */
+void
+MicroBenchmark::runAll()
+{
+    runBenchmark("send_Heartbeat_Start", &MicroBenchmark::sendHeartbeatStart);
+    runBenchmark("send_Data_Stream/128", &MicroBenchmark::sendStreamSmall);
+    runBenchmark("send_Data_Stream/4096", &MicroBenchmark::sendStreamPage);
+    runBenchmark("send_Data_SingleBlock/1024", &MicroBenchmark::sendSingleBlock);
+
+    runBenchmark("processMessage/Stream/128", &MicroBenchmark::processStreamMessage);
+    runBenchmark("processMessage/Heartbeat_Reply", &MicroBenchmark::processHeartbeatReply);
+    runBenchmark("processMessage_callback/Stream/128/batch",
+                 &MicroBenchmark::processStreamBatch);
+    runBenchmark("process_Stream_Data_Type/128", &MicroBenchmark::dispatchStreamType);
+    runBenchmark("process_Heartbeat_Type/Reply", &MicroBenchmark::dispatchHeartbeatType);
+
+    runBenchmark("ReplyHandler::addMessage", &MicroBenchmark::replyHandlerAdd);
+    runBenchmark("ReplyHandler::addMessage+removeMessage",
+                 &MicroBenchmark::replyHandlerAddRemove);
+    runBenchmark("MultiblockIO::getRandValue", &MicroBenchmark::getRandValue);
+
+    printResults();
+}
+
+/**
+ * @brief run a single benchmark, if it matches the filter
+ *
+ * @param name name of the benchmark
+ * @param function benchmark-function, which returns the duration of all iterations
+ */
+void
+MicroBenchmark::runBenchmark(const std::string &name,
+                             BenchmarkFunction function)
+{
+    if(m_filter != ""
+            && name.find(m_filter) == std::string::npos)
+    {
+        return;
+    }
+
+    // warm up caches and branch-predictors
+    (this->*function)(m_iterations / 10 + 1);
+
+    const uint64_t sendCallsBefore = m_socket->m_numberOfSendCalls;
+    const uint64_t duration = (this->*function)(m_iterations);
+    const uint64_t sendCalls = m_socket->m_numberOfSendCalls - sendCallsBefore;
+
+    Result result;
+    result.name = name;
+    result.iterations = m_iterations;
+    result.timePerMessage = static_cast<double>(duration) / static_cast<double>(m_iterations);
+    result.sendCallsPerMessage = static_cast<double>(sendCalls)
+                                 / static_cast<double>(m_iterations);
+    m_results.push_back(result);
+}
+
+/**
+ * @brief print the results as table
+ */
+void
+MicroBenchmark::printResults()
+{
+    TableItem table;
+    table.addColumn("benchmark");
+    table.addColumn("ns/message");
+    table.addColumn("iterations");
+    table.addColumn("socket-writes/message");
+
+    for(uint64_t i = 0; i < m_results.size(); i++)
+    {
+        const Result* result = &m_results[i];
+        table.addRow(std::vector<std::string>{result->name,
+                                              std::to_string(result->timePerMessage),
+                                              std::to_string(result->iterations),
+                                              std::to_string(result->sendCallsPerMessage)});
+    }
+
+    std::cout<<table.toString()<<std::endl;
+}
+
+//==================================================================================================
+
+uint64_t
+MicroBenchmark::sendHeartbeatStart(const uint64_t iterations)
+{
+    const uint64_t start = getNanoTime();
+    for(uint64_t i = 0; i < iterations; i++) {
+        send_Heartbeat_Start(m_session);
+    }
+    return getNanoTime() - start;
+}
+
+uint64_t
+MicroBenchmark::sendStreamSmall(const uint64_t iterations)
+{
+    const uint64_t start = getNanoTime();
+    for(uint64_t i = 0; i < iterations; i++) {
+        send_Data_Stream(m_session, m_payload, 128, false);
+    }
+    return getNanoTime() - start;
+}
+
+uint64_t
+MicroBenchmark::sendStreamPage(const uint64_t iterations)
+{
+    const uint64_t start = getNanoTime();
+    for(uint64_t i = 0; i < iterations; i++) {
+        send_Data_Stream(m_session, m_payload, 4096, false);
+    }
+    return getNanoTime() - start;
+}
+
+uint64_t
+MicroBenchmark::sendSingleBlock(const uint64_t iterations)
+{
+    const uint64_t start = getNanoTime();
+    for(uint64_t i = 0; i < iterations; i++) {
+        send_Data_SingleBlock(m_session, i + 1, m_payload, 1024);
+    }
+    return getNanoTime() - start;
+}
+
+//==================================================================================================
+
+uint64_t
+MicroBenchmark::processStreamMessage(const uint64_t iterations)
+{
+    // the ring-buffer is not moved forward, so the same message is processed again each time
+    uint64_t processedBytes = 0;
+    const uint64_t start = getNanoTime();
+    for(uint64_t i = 0; i < iterations; i++) {
+        processedBytes += processMessage(m_session, &m_streamMessage);
+    }
+    const uint64_t duration = getNanoTime() - start;
+
+    g_benchmarkSink = processedBytes;
+    return duration;
+}
+
+uint64_t
+MicroBenchmark::processHeartbeatReply(const uint64_t iterations)
+{
+    uint64_t processedBytes = 0;
+    const uint64_t start = getNanoTime();
+    for(uint64_t i = 0; i < iterations; i++) {
+        processedBytes += processMessage(m_session, &m_heartbeatReplyMessage);
+    }
+    const uint64_t duration = getNanoTime() - start;
+
+    g_benchmarkSink = processedBytes;
+    return duration;
+}
+
+uint64_t
+MicroBenchmark::processStreamBatch(const uint64_t iterations)
+{
+    // each call processes STREAM_BATCH_SIZE messages, so the time is still per message
+    const uint64_t numberOfCalls = (iterations + STREAM_BATCH_SIZE - 1) / STREAM_BATCH_SIZE;
+    m_session->setStreamBatchCallback(&benchmarkStreamBatchCallback);
+
+    uint64_t processedBytes = 0;
+    const uint64_t start = getNanoTime();
+    for(uint64_t i = 0; i < numberOfCalls; i++) {
+        processedBytes += processMessage_callback(m_session, &m_streamMessages, nullptr);
+    }
+    const uint64_t duration = getNanoTime() - start;
+
+    m_session->setStreamBatchCallback(nullptr);
+
+    g_benchmarkSink = processedBytes;
+    return duration;
+}
+
+uint64_t
+MicroBenchmark::dispatchStreamType(const uint64_t iterations)
+{
+    const void* rawMessage = getDataPointer_RingBuffer(m_streamMessage,
+                                                       m_streamMessage.usedSize);
+    const CommonMessageHeader* header = static_cast<const CommonMessageHeader*>(rawMessage);
+
+    const uint64_t start = getNanoTime();
+    for(uint64_t i = 0; i < iterations; i++) {
+        process_Stream_Data_Type(m_session, header, rawMessage);
+    }
+    return getNanoTime() - start;
+}
+
+uint64_t
+MicroBenchmark::dispatchHeartbeatType(const uint64_t iterations)
+{
+    const void* rawMessage = getDataPointer_RingBuffer(m_heartbeatReplyMessage,
+                                                       m_heartbeatReplyMessage.usedSize);
+    const CommonMessageHeader* header = static_cast<const CommonMessageHeader*>(rawMessage);
+
+    const uint64_t start = getNanoTime();
+    for(uint64_t i = 0; i < iterations; i++) {
+        process_Heartbeat_Type(m_session, header, rawMessage);
+    }
+    return getNanoTime() - start;
+}
+
+//==================================================================================================
+
+uint64_t
+MicroBenchmark::replyHandlerAdd(const uint64_t iterations)
+{
+    const uint64_t start = getNanoTime();
+    for(uint64_t i = 0; i < iterations; i++) {
+        m_replyHandler->addMessage(HEARTBEAT_TYPE, 1, i, m_session);
+    }
+    const uint64_t duration = getNanoTime() - start;
+
+    // cleanup is not part of the measurement
+    for(uint64_t i = 0; i < iterations; i++) {
+        m_replyHandler->removeMessage(1, i);
+    }
+
+    return duration;
+}
+
+uint64_t
+MicroBenchmark::replyHandlerAddRemove(const uint64_t iterations)
+{
+    const uint64_t start = getNanoTime();
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        m_replyHandler->addMessage(HEARTBEAT_TYPE, 1, i, m_session);
+        m_replyHandler->removeMessage(1, i);
+    }
+    return getNanoTime() - start;
+}
+
+uint64_t
+MicroBenchmark::getRandValue(const uint64_t iterations)
+{
+    uint64_t sum = 0;
+    const uint64_t start = getNanoTime();
+    for(uint64_t i = 0; i < iterations; i++) {
+        sum += MultiblockIO::getRandValue();
+    }
+    const uint64_t duration = getNanoTime() - start;
+
+    g_benchmarkSink = sum;
+    return duration;
+}
+
+}
+}
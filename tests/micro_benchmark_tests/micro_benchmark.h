@@ -0,0 +1,101 @@
+/**
+ * @file    micro_benchmark.h
+ *
+ * @author  Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef MICRO_BENCHMARK_H
+#define MICRO_BENCHMARK_H
+
+#include <iostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <libKitsunemimiCommon/buffer/ring_buffer.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class SessionController;
+class Session;
+class ReplyHandler;
+class FakeSocket;
+
+class MicroBenchmark
+{
+public:
+    MicroBenchmark(const uint64_t iterations,
+                   const std::string &filter);
+
+    void runAll();
+
+private:
+    typedef uint64_t (MicroBenchmark::*BenchmarkFunction)(const uint64_t);
+
+    struct Result
+    {
+        std::string name = "";
+        uint64_t iterations = 0;
+        double timePerMessage = 0.0;  // nanoseconds
+        double sendCallsPerMessage = 0.0;
+    };
+
+    uint64_t m_iterations = 0;
+    std::string m_filter = "";
+    std::vector<Result> m_results;
+
+    SessionController* m_controller = nullptr;
+    FakeSocket* m_socket = nullptr;
+    Session* m_session = nullptr;
+    ReplyHandler* m_replyHandler = nullptr;
+
+    uint8_t m_payload[4096];
+    RingBuffer m_streamMessage;
+    RingBuffer m_streamMessages;
+    RingBuffer m_heartbeatReplyMessage;
+
+    void runBenchmark(const std::string &name,
+                      BenchmarkFunction function);
+    void printResults();
+
+    // encode
+    uint64_t sendHeartbeatStart(const uint64_t iterations);
+    uint64_t sendStreamSmall(const uint64_t iterations);
+    uint64_t sendStreamPage(const uint64_t iterations);
+    uint64_t sendSingleBlock(const uint64_t iterations);
+
+    // decode
+    uint64_t processStreamMessage(const uint64_t iterations);
+    uint64_t processHeartbeatReply(const uint64_t iterations);
+    uint64_t processStreamBatch(const uint64_t iterations);
+    uint64_t dispatchStreamType(const uint64_t iterations);
+    uint64_t dispatchHeartbeatType(const uint64_t iterations);
+
+    // handler
+    uint64_t replyHandlerAdd(const uint64_t iterations);
+    uint64_t replyHandlerAddRemove(const uint64_t iterations);
+    uint64_t getRandValue(const uint64_t iterations);
+};
+
+}
+}
+
+#endif // MICRO_BENCHMARK_H
@@ -6,6 +6,8 @@ CONFIG += c++14
 SUBDIRS = \
     functional_tests \
     cli_tests \
-    benchmark_tests
+    benchmark_tests \
+    micro_benchmark_tests \
+    unit_tests
 
 tests.depends = src
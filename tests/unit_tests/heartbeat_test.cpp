@@ -0,0 +1,184 @@
+/**
+ * @file       heartbeat_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include "heartbeat_test.h"
+#include <fake_socket.h>
+
+#include <unistd.h>
+
+#include <handler/session_handler.h>
+#include <handler/heartbeat_handler.h>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+Heartbeat_Test* Heartbeat_Test::m_instance = nullptr;
+
+/**
+ * @brief errorCallback
+ */
+void
+heartbeatErrorCallback(Session*,
+                       const uint8_t errorCode,
+                       const std::string)
+{
+    if(errorCode == Session::errorCodes::MESSAGE_TIMEOUT) {
+        Heartbeat_Test::m_instance->m_numberOfTimeouts++;
+    }
+}
+
+/**
+ * @brief Heartbeat_Test::Heartbeat_Test
+ */
+Heartbeat_Test::Heartbeat_Test() :
+    Kitsunemimi::CompareTestHelper("Heartbeat_Test")
+{
+    Heartbeat_Test::m_instance = this;
+
+    initTestCase();
+    missThreshold_test();
+    interval_test();
+}
+
+/**
+ * @brief initTestCase
+ */
+void
+Heartbeat_Test::initTestCase()
+{
+    m_numberOfTimeouts = 0;
+
+    // nothing is ever received over the fake-socket, so every check sees only silence
+    m_socket = new FakeSocket();
+    m_session = new Session(m_socket);
+    SessionHandler::m_sessionHandler->addSession(4, m_session);
+    m_session->connectiSession(4);
+    m_session->makeSessionReady(4, "heartbeat-test");
+    m_session->setErrorCallback(&heartbeatErrorCallback);
+}
+
+/**
+ * @brief timeout is reported, when more heartbeats than the threshold were send without any
+ *        incoming traffic. The checks are triggered directly, so the test doesn't depend on the
+ *        timing of the heartbeat-handler.
+ */
+void
+Heartbeat_Test::missThreshold_test()
+{
+    TEST_EQUAL(m_session->setHeartbeat(100, 2), true);
+    SessionHandler::m_heartbeatHandler->removeSession(m_session);
+    m_numberOfTimeouts = 0;
+    const uint64_t sendCallsBefore = m_socket->m_numberOfSendCalls;
+
+    // incoming traffic within the interval makes a heartbeat unnecessary
+    setSilence(10);
+    TEST_EQUAL(m_session->checkHeartbeat(), true);
+    TEST_EQUAL(m_socket->m_numberOfSendCalls, sendCallsBefore);
+    TEST_EQUAL(m_session->isHealthy(), true);
+
+    // missed heartbeats up to the threshold are tolerated
+    setSilence(150);
+    m_session->checkHeartbeat();
+    m_session->checkHeartbeat();
+    TEST_EQUAL(m_socket->m_numberOfSendCalls, sendCallsBefore + 2);
+    TEST_EQUAL(m_numberOfTimeouts.load(), (uint32_t)0);
+    TEST_EQUAL(m_session->isHealthy(), true);
+
+    m_session->checkHeartbeat();
+    TEST_EQUAL(m_socket->m_numberOfSendCalls, sendCallsBefore + 3);
+    TEST_EQUAL(m_numberOfTimeouts.load(), (uint32_t)1);
+
+    // counting starts again after the timeout and after incoming traffic
+    m_session->checkHeartbeat();
+    m_session->checkHeartbeat();
+    TEST_EQUAL(m_numberOfTimeouts.load(), (uint32_t)1);
+    setSilence(10);
+    m_session->checkHeartbeat();
+    setSilence(150);
+    m_session->checkHeartbeat();
+    m_session->checkHeartbeat();
+    TEST_EQUAL(m_numberOfTimeouts.load(), (uint32_t)1);
+    m_session->checkHeartbeat();
+    TEST_EQUAL(m_numberOfTimeouts.load(), (uint32_t)2);
+
+    // longer silence than all tolerated intervals
+    setSilence(301);
+    TEST_EQUAL(m_session->isHealthy(), false);
+
+    // a new configuration resets the counter, where a check of the handler, before the session
+    // is removed again, sees incoming traffic
+    setSilence(10);
+    TEST_EQUAL(m_session->setHeartbeat(100, 0), true);
+    SessionHandler::m_heartbeatHandler->removeSession(m_session);
+    setSilence(150);
+    m_session->checkHeartbeat();
+    TEST_EQUAL(m_numberOfTimeouts.load(), (uint32_t)3);
+}
+
+/**
+ * @brief the heartbeat-handler checks the session with its interval, until the heartbeats are
+ *        disabled
+ */
+void
+Heartbeat_Test::interval_test()
+{
+    m_numberOfTimeouts = 0;
+    const uint64_t sendCallsBefore = m_socket->m_numberOfSendCalls;
+
+    // about 10 checks within the time, where each check sends a heartbeat, because there is no
+    // incoming traffic, and each second one reports a timeout
+    TEST_EQUAL(m_session->setHeartbeat(50, 1), true);
+    usleep(500000);
+    TEST_EQUAL(m_session->setHeartbeat(0, 0), true);
+
+    const uint64_t numberOfHeartbeats = m_socket->m_numberOfSendCalls - sendCallsBefore;
+    const bool heartbeatsInInterval = numberOfHeartbeats >= 5 && numberOfHeartbeats <= 11;
+    TEST_EQUAL(heartbeatsInInterval, true);
+    const uint32_t numberOfTimeouts = m_numberOfTimeouts.load();
+    const bool timeoutsInInterval = numberOfTimeouts >= 2 && numberOfTimeouts <= 6;
+    TEST_EQUAL(timeoutsInInterval, true);
+
+    // no checks anymore, after the heartbeats were disabled
+    const uint64_t sendCallsAfter = m_socket->m_numberOfSendCalls;
+    usleep(200000);
+    TEST_EQUAL(m_socket->m_numberOfSendCalls, sendCallsAfter);
+    TEST_EQUAL(m_numberOfTimeouts.load(), numberOfTimeouts);
+}
+
+/**
+ * @brief set the time since the last incoming traffic of the session
+ *
+ * @param silence time in milliseconds
+ */
+void
+Heartbeat_Test::setSilence(const uint64_t silence)
+{
+    m_session->m_lastInboundTraffic = HeartbeatHandler::getCurrentTime() - silence;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
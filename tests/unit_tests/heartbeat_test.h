@@ -0,0 +1,64 @@
+/**
+ * @file       heartbeat_test.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef HEARTBEAT_TEST_H
+#define HEARTBEAT_TEST_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include <libKitsunemimiCommon/test_helper/compare_test_helper.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+class FakeSocket;
+
+class Heartbeat_Test
+        : public Kitsunemimi::CompareTestHelper
+{
+public:
+    Heartbeat_Test();
+
+    static Heartbeat_Test* m_instance;
+
+    std::atomic<uint32_t> m_numberOfTimeouts;
+
+private:
+    FakeSocket* m_socket = nullptr;
+    Session* m_session = nullptr;
+
+    void initTestCase();
+
+    void missThreshold_test();
+    void interval_test();
+
+    void setSilence(const uint64_t silence);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // HEARTBEAT_TEST_H
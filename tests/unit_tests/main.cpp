@@ -0,0 +1,62 @@
+/**
+ * @file       main.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include <libKitsunemimiPersistence/logger/logger.h>
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+
+#include <heartbeat_test.h>
+#include <multiblock_io_test.h>
+#include <payload_checksum_test.h>
+
+using Kitsunemimi::Persistence::initConsoleLogger;
+using Kitsunemimi::Sakura::Session;
+using Kitsunemimi::Sakura::SessionController;
+
+void sessionCallback(Session*,
+                     const std::string)
+{
+}
+
+void errorCallback(Session*,
+                   const uint8_t,
+                   const std::string message)
+{
+    std::cout<<"ERROR: "<<message<<std::endl;
+}
+
+int main()
+{
+    initConsoleLogger(true);
+
+    // the handlers of the library are created by the controller and shared by all tests
+    SessionController* controller = new SessionController(&sessionCallback,
+                                                          &sessionCallback,
+                                                          &errorCallback);
+
+    Kitsunemimi::Sakura::MultiblockIO_Test();
+    Kitsunemimi::Sakura::PayloadChecksum_Test();
+    Kitsunemimi::Sakura::Heartbeat_Test();
+
+    // the sessions of the tests are never closed, so the controller is not deleted
+    (void)controller;
+}
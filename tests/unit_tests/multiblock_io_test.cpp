@@ -0,0 +1,305 @@
+/**
+ * @file       multiblock_io_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include "multiblock_io_test.h"
+#include <fake_socket.h>
+
+#include <string.h>
+
+#include <callbacks.h>
+#include <multiblock_io.h>
+#include <message_definitions.h>
+#include <handler/session_handler.h>
+#include <handler/buffer_pool.h>
+#include <messages_processing/multiblock_data_processing.h>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+MultiblockIO_Test* MultiblockIO_Test::m_instance = nullptr;
+
+// size of four parts, where the last one is not complete
+#define TEST_PAYLOAD_SIZE (3 * MAX_SINGLE_MESSAGE_SIZE + 100)
+
+/**
+ * @brief standaloneDataCallback
+ */
+void
+unitStandaloneDataCallback(Session* session,
+                           const uint64_t,
+                           DataBuffer* data)
+{
+    MultiblockIO_Test* test = MultiblockIO_Test::m_instance;
+    test->m_numberOfMessages++;
+    test->m_lastMessageSize = data->bufferPosition;
+    test->m_lastMessageEqual = data->bufferPosition == test->m_payload.size()
+                               && memcmp(data->data,
+                                         test->m_payload.data(),
+                                         test->m_payload.size()) == 0;
+    session->releaseBuffer(data);
+}
+
+/**
+ * @brief errorCallback
+ */
+void
+unitErrorCallback(Session*,
+                  const uint8_t errorCode,
+                  const std::string)
+{
+    MultiblockIO_Test::m_instance->m_numberOfErrors++;
+    MultiblockIO_Test::m_instance->m_lastErrorCode = errorCode;
+}
+
+/**
+ * @brief process a single part of a multiblock-message like the receiving thread
+ *
+ * @param session session, which receives the part
+ * @param multiblockId id of the multiblock-message
+ * @param partId id of the part
+ * @param payload complete payload of the message
+ */
+void
+processPart(Session* session,
+            const uint64_t multiblockId,
+            const uint32_t partId,
+            const std::vector<uint8_t> &payload)
+{
+    const uint64_t offset = static_cast<uint64_t>(partId) * MAX_SINGLE_MESSAGE_SIZE;
+    uint64_t partSize = payload.size() - offset;
+    if(partSize > MAX_SINGLE_MESSAGE_SIZE) {
+        partSize = MAX_SINGLE_MESSAGE_SIZE;
+    }
+
+    std::vector<uint8_t> rawMessage(sizeof(Data_MultiBlock_Header) + partSize);
+    Data_MultiBlock_Header header;
+    header.multiblockId = multiblockId;
+    header.partId = partId;
+    header.totalPartNumber = static_cast<uint32_t>((payload.size() + MAX_SINGLE_MESSAGE_SIZE - 1)
+                                                   / MAX_SINGLE_MESSAGE_SIZE);
+    header.commonHeader.payloadSize = static_cast<uint32_t>(partSize);
+    memcpy(rawMessage.data(), &header, sizeof(Data_MultiBlock_Header));
+    memcpy(&rawMessage[sizeof(Data_MultiBlock_Header)], &payload[offset], partSize);
+
+    process_Data_Multiblock(session,
+                            reinterpret_cast<Data_MultiBlock_Header*>(rawMessage.data()),
+                            rawMessage.data());
+}
+
+/**
+ * @brief MultiblockIO_Test::MultiblockIO_Test
+ */
+MultiblockIO_Test::MultiblockIO_Test() :
+    Kitsunemimi::CompareTestHelper("MultiblockIO_Test")
+{
+    MultiblockIO_Test::m_instance = this;
+
+    initTestCase();
+    reassembly_test();
+    deferredFinish_test();
+    expiredFinish_test();
+}
+
+/**
+ * @brief initTestCase
+ */
+void
+MultiblockIO_Test::initTestCase()
+{
+    // each part gets another pattern, so a part at the wrong position is detected
+    m_payload.resize(TEST_PAYLOAD_SIZE);
+    for(uint64_t i = 0; i < m_payload.size(); i++) {
+        m_payload[i] = static_cast<uint8_t>((i / MAX_SINGLE_MESSAGE_SIZE) * 31 + i % 251);
+    }
+
+    // session is never closed, because the fake-socket has no connection to close
+    m_socket = new FakeSocket();
+    m_session = new Session(m_socket);
+    SessionHandler::m_sessionHandler->addSession(1, m_session);
+    m_session->connectiSession(1);
+    m_session->makeSessionReady(1, "unit-test");
+    m_session->setHeartbeat(0, 0);
+    m_session->setStandaloneMessageCallback(&unitStandaloneDataCallback);
+    m_session->setErrorCallback(&unitErrorCallback);
+}
+
+/**
+ * @brief parts in any order and duplicated parts are written to their final position
+ */
+void
+MultiblockIO_Test::reassembly_test()
+{
+    MultiblockIO* multiblockIo = m_session->m_multiblockIo;
+    const uint64_t multiblockId = 42;
+    const std::vector<uint32_t> order = {2, 0, 1, 0};
+
+    TEST_EQUAL(multiblockIo->createIncomingBuffer(multiblockId, m_payload.size()), true);
+
+    MultiblockIO::MultiblockMessage message = multiblockIo->getIncomingBuffer(multiblockId);
+    TEST_EQUAL(message.numberOfPackages, 4);
+
+    for(uint32_t i = 0; i < order.size(); i++)
+    {
+        const uint32_t partId = order[i];
+        const uint64_t offset = static_cast<uint64_t>(partId) * MAX_SINGLE_MESSAGE_SIZE;
+        TEST_EQUAL(multiblockIo->writeIntoIncomingBuffer(multiblockId,
+                                                         partId,
+                                                         &m_payload[offset],
+                                                         MAX_SINGLE_MESSAGE_SIZE),
+                   true);
+    }
+
+    // the duplicated part is only counted once
+    message = multiblockIo->getIncomingBuffer(multiblockId);
+    TEST_EQUAL(message.numberOfReceivedPackages, 3);
+    TEST_EQUAL(multiblockIo->isIncomingComplete(message), false);
+
+    // parts behind the end of the message or of unknown messages are rejected
+    TEST_EQUAL(multiblockIo->writeIntoIncomingBuffer(multiblockId, 4, m_payload.data(), 100),
+               false);
+    TEST_EQUAL(multiblockIo->writeIntoIncomingBuffer(multiblockId,
+                                                     3,
+                                                     m_payload.data(),
+                                                     MAX_SINGLE_MESSAGE_SIZE),
+               false);
+    TEST_EQUAL(multiblockIo->writeIntoIncomingBuffer(multiblockId + 1, 0, m_payload.data(), 100),
+               false);
+
+    TEST_EQUAL(multiblockIo->writeIntoIncomingBuffer(multiblockId,
+                                                     3,
+                                                     &m_payload[3 * MAX_SINGLE_MESSAGE_SIZE],
+                                                     100),
+               true);
+
+    message = multiblockIo->getIncomingBuffer(multiblockId);
+    TEST_EQUAL(multiblockIo->isIncomingComplete(message), true);
+    TEST_EQUAL(message.multiBlockBuffer->bufferPosition, m_payload.size());
+    TEST_EQUAL(memcmp(message.multiBlockBuffer->data, m_payload.data(), m_payload.size()), 0);
+
+    // a finish can not be stored for an already complete message
+    TEST_EQUAL(multiblockIo->deferIncomingFinish(multiblockId, 0, 0), false);
+    TEST_EQUAL(multiblockIo->deferIncomingFinish(multiblockId + 1, 0, 0), false);
+
+    TEST_EQUAL(multiblockIo->removeIncomingMessage(multiblockId), true);
+    SessionHandler::m_bufferPool->releaseBuffer(message.multiBlockBuffer);
+}
+
+/**
+ * @brief the finish over the primary connection arrives before the last part over an additional
+ *        connection, so the message is finished together with the last part
+ */
+void
+MultiblockIO_Test::deferredFinish_test()
+{
+    const uint64_t multiblockId = 43;
+    m_numberOfMessages = 0;
+    m_numberOfErrors = 0;
+
+    // simulate an additional connection and the receiving thread of the primary connection
+    m_session->m_numberOfStripes = 1;
+    Session::m_receivingSession = m_session;
+
+    m_session->m_multiblockIo->createIncomingBuffer(multiblockId, m_payload.size());
+    processPart(m_session, multiblockId, 3, m_payload);
+    processPart(m_session, multiblockId, 0, m_payload);
+    processPart(m_session, multiblockId, 2, m_payload);
+
+    Data_MultiFinish_Message finish;
+    finish.multiblockId = multiblockId;
+    process_Data_Multi_Finish(m_session, &finish);
+
+    // the finish is stored and neither reported as error nor delivered
+    TEST_EQUAL(m_numberOfMessages, 0);
+    TEST_EQUAL(m_numberOfErrors, 0);
+    TEST_EQUAL(m_session->m_multiblockIo->getIncomingBuffer(multiblockId).finishReceived, true);
+
+    // the last part finishes the message
+    processPart(m_session, multiblockId, 1, m_payload);
+    TEST_EQUAL(m_numberOfMessages, 1);
+    TEST_EQUAL(m_lastMessageSize, m_payload.size());
+    TEST_EQUAL(m_lastMessageEqual, true);
+    TEST_EQUAL(m_numberOfErrors, 0);
+    TEST_EQUAL(m_session->m_multiblockIo->getIncomingBuffer(multiblockId).multiblockId, 0);
+
+    // without additional connections an incomplete message is an error at once
+    m_session->m_numberOfStripes = 0;
+    m_session->m_multiblockIo->createIncomingBuffer(multiblockId, m_payload.size());
+    processPart(m_session, multiblockId, 0, m_payload);
+    process_Data_Multi_Finish(m_session, &finish);
+    TEST_EQUAL(m_numberOfMessages, 1);
+    TEST_EQUAL(m_numberOfErrors, 1);
+    TEST_EQUAL(m_lastErrorCode, Session::errorCodes::MULTIBLOCK_FAILED);
+    TEST_EQUAL(m_session->m_multiblockIo->getIncomingBuffer(multiblockId).multiblockId, 0);
+
+    Session::m_receivingSession = nullptr;
+}
+
+/**
+ * @brief a stored finish, whose missing parts never arrive, is removed after the timeout
+ */
+void
+MultiblockIO_Test::expiredFinish_test()
+{
+    MultiblockIO* multiblockIo = m_session->m_multiblockIo;
+    const uint64_t multiblockId = 44;
+
+    multiblockIo->createIncomingBuffer(multiblockId, m_payload.size());
+    multiblockIo->writeIntoIncomingBuffer(multiblockId, 0, m_payload.data(), MAX_SINGLE_MESSAGE_SIZE);
+    TEST_EQUAL(multiblockIo->deferIncomingFinish(multiblockId, 0x8, 7), true);
+
+    uint8_t flags = 0;
+    uint64_t blockerId = 0;
+    TEST_EQUAL(multiblockIo->takeDeferredFinish(multiblockId, flags, blockerId), false);
+
+    // not expired yet
+    std::vector<MultiblockIO::MultiblockMessage> expired;
+    expired = multiblockIo->takeExpiredFinishes(DEFERRED_FINISH_TIMEOUT);
+    TEST_EQUAL(expired.size(), 0);
+    TEST_EQUAL(multiblockIo->getIncomingBuffer(multiblockId).multiblockId, multiblockId);
+
+    // expired, so the message is removed and given back for the release of the buffer
+    expired = multiblockIo->takeExpiredFinishes(0);
+    TEST_EQUAL(expired.size(), 1);
+    TEST_EQUAL(expired[0].multiblockId, multiblockId);
+    TEST_EQUAL(expired[0].finishFlags, 0x8);
+    TEST_EQUAL(expired[0].finishBlockerId, 7);
+    TEST_EQUAL(multiblockIo->getIncomingBuffer(multiblockId).multiblockId, 0);
+
+    // late parts of the removed message are rejected
+    TEST_EQUAL(multiblockIo->writeIntoIncomingBuffer(multiblockId,
+                                                     1,
+                                                     &m_payload[MAX_SINGLE_MESSAGE_SIZE],
+                                                     MAX_SINGLE_MESSAGE_SIZE),
+               false);
+
+    for(uint64_t i = 0; i < expired.size(); i++) {
+        SessionHandler::m_bufferPool->releaseBuffer(expired[i].multiBlockBuffer);
+    }
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,70 @@
+/**
+ * @file       multiblock_io_test.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef MULTIBLOCK_IO_TEST_H
+#define MULTIBLOCK_IO_TEST_H
+
+#include <iostream>
+#include <stdint.h>
+#include <vector>
+
+#include <libKitsunemimiCommon/test_helper/compare_test_helper.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+class FakeSocket;
+
+class MultiblockIO_Test
+        : public Kitsunemimi::CompareTestHelper
+{
+public:
+    MultiblockIO_Test();
+
+    static MultiblockIO_Test* m_instance;
+
+    std::vector<uint8_t> m_payload;
+
+    uint32_t m_numberOfMessages = 0;
+    uint64_t m_lastMessageSize = 0;
+    bool m_lastMessageEqual = false;
+    uint32_t m_numberOfErrors = 0;
+    uint8_t m_lastErrorCode = 0;
+
+private:
+    FakeSocket* m_socket = nullptr;
+    Session* m_session = nullptr;
+
+    void initTestCase();
+
+    void reassembly_test();
+    void deferredFinish_test();
+    void expiredFinish_test();
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // MULTIBLOCK_IO_TEST_H
@@ -0,0 +1,234 @@
+/**
+ * @file       payload_checksum_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#include "payload_checksum_test.h"
+#include <fake_socket.h>
+
+#include <string.h>
+#include <sys/uio.h>
+
+#include <callbacks.h>
+#include <payload_checksum.h>
+#include <message_definitions.h>
+#include <handler/session_handler.h>
+#include <messages_processing/stream_data_processing.h>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+PayloadChecksum_Test* PayloadChecksum_Test::m_instance = nullptr;
+
+/**
+ * @brief streamDataCallback
+ */
+void
+checksumStreamDataCallback(Session*,
+                           const void*,
+                           const uint64_t)
+{
+    PayloadChecksum_Test::m_instance->m_numberOfStreamMessages++;
+}
+
+/**
+ * @brief errorCallback
+ */
+void
+checksumErrorCallback(Session*,
+                      const uint8_t errorCode,
+                      const std::string)
+{
+    PayloadChecksum_Test::m_instance->m_numberOfErrors++;
+    PayloadChecksum_Test::m_instance->m_lastErrorCode = errorCode;
+}
+
+/**
+ * @brief PayloadChecksum_Test::PayloadChecksum_Test
+ */
+PayloadChecksum_Test::PayloadChecksum_Test() :
+    Kitsunemimi::CompareTestHelper("PayloadChecksum_Test")
+{
+    PayloadChecksum_Test::m_instance = this;
+
+    initTestCase();
+    knownAnswer_test();
+    hardwareParity_test();
+    segments_test();
+    checksumMismatch_test();
+}
+
+/**
+ * @brief initTestCase
+ */
+void
+PayloadChecksum_Test::initTestCase()
+{
+    // data without regular pattern
+    m_data.resize(32 * 1024);
+    uint32_t value = 0x12345678;
+    for(uint64_t i = 0; i < m_data.size(); i++)
+    {
+        value = value * 1103515245 + 12345;
+        m_data[i] = static_cast<uint8_t>(value >> 16);
+    }
+
+    // session is never closed, because the fake-socket has no connection to close
+    m_socket = new FakeSocket();
+    m_socket->m_collectData = true;
+    m_session = new Session(m_socket);
+    SessionHandler::m_sessionHandler->addSession(3, m_session);
+    m_session->connectiSession(3);
+    m_session->makeSessionReady(3, "checksum-test");
+    m_session->setHeartbeat(0, 0);
+    m_session->setStreamMessageCallback(&checksumStreamDataCallback);
+    m_session->setErrorCallback(&checksumErrorCallback);
+    m_session->m_payloadChecksum = true;
+}
+
+/**
+ * @brief check value of the crc32c-specification
+ */
+void
+PayloadChecksum_Test::knownAnswer_test()
+{
+    const char* checkString = "123456789";
+
+    TEST_EQUAL(crc32c(0, checkString, 9), 0xE3069283);
+    TEST_EQUAL(crc32cWithoutHardware(0, checkString, 9), 0xE3069283);
+    TEST_EQUAL(crc32c(0, checkString, 0), 0);
+
+    // calculation over multiple blocks
+    const uint32_t firstPart = crc32c(0, checkString, 4);
+    TEST_EQUAL(crc32c(firstPart, &checkString[4], 5), 0xE3069283);
+}
+
+/**
+ * @brief the cpu-instructions, if available, calculate the same values like the software, for
+ *        all sizes and alignments, which are handled by different code-paths
+ */
+void
+PayloadChecksum_Test::hardwareParity_test()
+{
+    std::cout<<"hardware-checksum available: "<<isHardwareChecksumAvailable()<<std::endl;
+
+    const std::vector<uint64_t> sizes = {0, 1, 7, 8, 9, 15, 16, 17, 63, 64, 65, 1000, 16385};
+    for(uint64_t offset = 0; offset < 8; offset++)
+    {
+        for(uint64_t i = 0; i < sizes.size(); i++)
+        {
+            const uint8_t* data = &m_data[offset];
+            TEST_EQUAL(crc32c(0, data, sizes[i]), crc32cWithoutHardware(0, data, sizes[i]));
+            TEST_EQUAL(crc32c(0x89ABCDEF, data, sizes[i]),
+                       crc32cWithoutHardware(0x89ABCDEF, data, sizes[i]));
+        }
+    }
+}
+
+/**
+ * @brief the checksum over a range of multiple segments is the same like over the continuous
+ *        data
+ */
+void
+PayloadChecksum_Test::segments_test()
+{
+    struct iovec segments[3];
+    segments[0].iov_base = &m_data[0];
+    segments[0].iov_len = 24;
+    segments[1].iov_base = &m_data[24];
+    segments[1].iov_len = 1000;
+    segments[2].iov_base = &m_data[1024];
+    segments[2].iov_len = 13;
+
+    TEST_EQUAL(getSegmentsChecksum(segments, 3, 0, 1037), crc32c(0, &m_data[0], 1037));
+    TEST_EQUAL(getSegmentsChecksum(segments, 3, 16, 1029), crc32c(0, &m_data[16], 1013));
+    TEST_EQUAL(getSegmentsChecksum(segments, 3, 30, 40), crc32c(0, &m_data[30], 10));
+    TEST_EQUAL(getSegmentsChecksum(segments, 3, 24, 24), 0);
+}
+
+/**
+ * @brief messages with matching checksum are processed and broken messages are dropped
+ */
+void
+PayloadChecksum_Test::checksumMismatch_test()
+{
+    const uint64_t checksumErrorsBefore = m_session->getMetrics().numberOfChecksumErrors;
+    const uint32_t payloadSize = 20000;
+
+    // big message, which is written segment by segment, where the checksum is written into the
+    // footer of the last segment instead of an additional write
+    m_socket->m_sendData.clear();
+    m_socket->m_numberOfSendCalls = 0;
+    TEST_EQUAL(send_Data_Stream(m_session, m_data.data(), payloadSize, false), true);
+    TEST_EQUAL(m_socket->m_numberOfSendCalls, 3);
+    TEST_EQUAL(m_socket->m_sendData.size(), getStreamMessageSize(payloadSize));
+
+    // valid message
+    TEST_EQUAL(processSendData(), getStreamMessageSize(payloadSize));
+    TEST_EQUAL(m_numberOfStreamMessages, 1);
+    TEST_EQUAL(m_numberOfErrors, 0);
+
+    // broken payload
+    m_socket->m_sendData[sizeof(Data_Stream_Header) + 1000] ^= 0x1;
+    TEST_EQUAL(processSendData(), getStreamMessageSize(payloadSize));
+    TEST_EQUAL(m_numberOfStreamMessages, 1);
+    TEST_EQUAL(m_numberOfErrors, 1);
+    TEST_EQUAL(m_lastErrorCode, Session::errorCodes::CHECKSUM_MISMATCH);
+
+    // small message, which is gathered into a single write
+    m_socket->m_sendData.clear();
+    m_socket->m_numberOfSendCalls = 0;
+    TEST_EQUAL(send_Data_Stream(m_session, m_data.data(), 128, false), true);
+    TEST_EQUAL(m_socket->m_numberOfSendCalls, 1);
+
+    // broken checksum itself
+    const uint64_t footerPos = m_socket->m_sendData.size() - sizeof(CommonMessageFooter);
+    m_socket->m_sendData[footerPos] ^= 0x80;
+    TEST_EQUAL(processSendData(), getStreamMessageSize(128));
+    TEST_EQUAL(m_numberOfStreamMessages, 1);
+    TEST_EQUAL(m_numberOfErrors, 2);
+
+    TEST_EQUAL(m_session->getMetrics().numberOfChecksumErrors, checksumErrorsBefore + 2);
+}
+
+/**
+ * @brief give the data, which were send over the fake-socket, to the processing of incoming
+ *        messages of the same session
+ *
+ * @return number of processed bytes
+ */
+uint64_t
+PayloadChecksum_Test::processSendData()
+{
+    RingBuffer* recvBuffer = new RingBuffer();
+    addData_RingBuffer(*recvBuffer, m_socket->m_sendData.data(), m_socket->m_sendData.size());
+    const uint64_t processedBytes = processMessage(m_session, recvBuffer);
+    delete recvBuffer;
+
+    return processedBytes;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
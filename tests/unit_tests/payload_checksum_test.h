@@ -0,0 +1,71 @@
+/**
+ * @file       payload_checksum_test.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+
+#ifndef PAYLOAD_CHECKSUM_TEST_H
+#define PAYLOAD_CHECKSUM_TEST_H
+
+#include <iostream>
+#include <stdint.h>
+#include <vector>
+
+#include <libKitsunemimiCommon/test_helper/compare_test_helper.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+class FakeSocket;
+
+class PayloadChecksum_Test
+        : public Kitsunemimi::CompareTestHelper
+{
+public:
+    PayloadChecksum_Test();
+
+    static PayloadChecksum_Test* m_instance;
+
+    uint32_t m_numberOfStreamMessages = 0;
+    uint32_t m_numberOfErrors = 0;
+    uint8_t m_lastErrorCode = 0;
+
+private:
+    FakeSocket* m_socket = nullptr;
+    Session* m_session = nullptr;
+
+    std::vector<uint8_t> m_data;
+
+    void initTestCase();
+
+    void knownAnswer_test();
+    void hardwareParity_test();
+    void segments_test();
+    void checksumMismatch_test();
+
+    uint64_t processSendData();
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // PAYLOAD_CHECKSUM_TEST_H
@@ -0,0 +1,41 @@
+include(../../defaults.pri)
+
+QT -= qt core gui
+
+CONFIG   -= app_bundle
+CONFIG += c++14 console
+
+LIBS += -L../../src -lKitsunemimiSakuraNetwork
+INCLUDEPATH += $$PWD
+INCLUDEPATH += ../common
+
+LIBS += -L../../../libKitsunemimiCommon/src -lKitsunemimiCommon
+LIBS += -L../../../libKitsunemimiCommon/src/debug -lKitsunemimiCommon
+LIBS += -L../../../libKitsunemimiCommon/src/release -lKitsunemimiCommon
+INCLUDEPATH += ../../../libKitsunemimiCommon/include
+
+LIBS += -L../../../libKitsunemimiNetwork/src -lKitsunemimiNetwork
+LIBS += -L../../../libKitsunemimiNetwork/src/debug -lKitsunemimiNetwork
+LIBS += -L../../../libKitsunemimiNetwork/src/release -lKitsunemimiNetwork
+INCLUDEPATH += ../../../libKitsunemimiNetwork/include
+
+LIBS += -L../../../libKitsunemimiPersistence/src -lKitsunemimiPersistence
+LIBS += -L../../../libKitsunemimiPersistence/src/debug -lKitsunemimiPersistence
+LIBS += -L../../../libKitsunemimiPersistence/src/release -lKitsunemimiPersistence
+INCLUDEPATH += ../../../libKitsunemimiPersistence/include
+
+LIBS +=  -lssl -lcrypt -llz4
+LIBS +=  -lboost_filesystem -lboost_system
+
+
+SOURCES += \
+    heartbeat_test.cpp \
+    main.cpp \
+    multiblock_io_test.cpp \
+    payload_checksum_test.cpp
+
+HEADERS += \
+    heartbeat_test.h \
+    multiblock_io_test.h \
+    payload_checksum_test.h \
+    ../common/fake_socket.h